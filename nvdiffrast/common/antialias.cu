@@ -24,23 +24,6 @@ static __forceinline__ __device__ int max_idx3(float n0, float n1, float n2, flo
     return 0;
 }
 
-//------------------------------------------------------------------------
-// Format of antialiasing work items stored in work buffer. Usually accessed directly as int4.
-
-struct AAWorkItem
-{
-    enum
-    {
-        EDGE_MASK       = 3,    // Edge index in lowest bits.
-        FLAG_DOWN_BIT   = 2,    // Down instead of right.
-        FLAG_TRI1_BIT   = 3,    // Edge is from other pixel's triangle.
-    };
-
-    int             px, py;         // Pixel x, y.
-    unsigned int    pz_flags;       // High 16 bits = pixel z, low 16 bits = edge index and flags.
-    float           alpha;          // Antialiasing alpha value. Zero if no AA.
-};
-
 //------------------------------------------------------------------------
 // Hash functions. Adapted from public-domain code at http://www.burtleburtle.net/bob/hash/doobs.html
 
@@ -136,15 +119,17 @@ static __forceinline__ __device__ int evhash_find_vertex(const AntialiasKernelPa
 //------------------------------------------------------------------------
 // Mesh analysis kernel.
 
-__global__ void AntialiasFwdMeshKernel(const AntialiasKernelParams p)
+template <class IndexT>
+static __forceinline__ __device__ void AntialiasFwdMeshKernelTemplate(const AntialiasKernelParams p)
 {
     int idx = threadIdx.x + blockIdx.x * blockDim.x;
     if (idx >= p.numTriangles)
         return;
 
-    int v0 = p.tri[idx * 3 + 0];
-    int v1 = p.tri[idx * 3 + 1];
-    int v2 = p.tri[idx * 3 + 2];
+    const IndexT* pTri = (const IndexT*)p.tri;
+    int v0 = pTri[idx * 3 + 0];
+    int v1 = pTri[idx * 3 + 1];
+    int v2 = pTri[idx * 3 + 2];
 
     if (v0 < 0 || v0 >= p.numVertices ||
         v1 < 0 || v1 >= p.numVertices ||
@@ -159,6 +144,10 @@ __global__ void AntialiasFwdMeshKernel(const AntialiasKernelParams p)
     evhash_insert_vertex(p, v0, v1, v2);
 }
 
+// Template specializations.
+__global__ void AntialiasFwdMeshKernel   (const AntialiasKernelParams p) { AntialiasFwdMeshKernelTemplate<int>(p); }
+__global__ void AntialiasFwdMeshKernelU16(const AntialiasKernelParams p) { AntialiasFwdMeshKernelTemplate<unsigned short>(p); }
+
 //------------------------------------------------------------------------
 // Discontinuity finder kernel.
 
@@ -171,21 +160,23 @@ __global__ void AntialiasFwdDiscontinuityKernel(const AntialiasKernelParams p)
     if (px >= p.width || py >= p.height || pz >= p.n)
         return;
 
-    // Pointer to our TriIdx and fetch.
-    int pidx0 = ((px + p.width * (py + p.height * pz)) << 2) + 3;
-    float tri0 = p.rasterOut[pidx0]; // These can stay as float, as we only compare them against each other.
+    // Pointer to our TriIdx and fetch. Float ids can be read as bits, as we only compare them against each other.
+    const int* triPtr = p.rasterTri ? p.rasterTri : (const int*)p.rasterOut + 3;
+    int triStride = p.rasterTri ? 1 : 4;
+    int pidx0 = (px + p.width * (py + p.height * pz)) * triStride;
+    int tri0 = triPtr[pidx0];
 
     // Look right, clamp at edge.
     int pidx1 = pidx0;
     if (px < p.width - 1)
-        pidx1 += 4;
-    float tri1 = p.rasterOut[pidx1];
+        pidx1 += triStride;
+    int tri1 = triPtr[pidx1];
 
     // Look down, clamp at edge.
     int pidx2 = pidx0;
     if (py < p.height - 1)
-        pidx2 += p.width << 2;
-    float tri2 = p.rasterOut[pidx2];
+        pidx2 += p.width * triStride;
+    int tri2 = triPtr[pidx2];
 
     // Determine amount of work.
     int count = 0;
@@ -216,7 +207,8 @@ __global__ void AntialiasFwdDiscontinuityKernel(const AntialiasKernelParams p)
 //------------------------------------------------------------------------
 // Forward analysis kernel.
 
-__global__ void AntialiasFwdAnalysisKernel(const AntialiasKernelParams p)
+template <class IndexT>
+static __forceinline__ __device__ void AntialiasFwdAnalysisKernelTemplate(const AntialiasKernelParams p)
 {
     __shared__ int s_base;
     int workCount = p.workBuffer[0].x;
@@ -240,10 +232,22 @@ __global__ void AntialiasFwdAnalysisKernel(const AntialiasKernelParams p)
 
         int pixel0 = px + p.width * (py + p.height * pz);
         int pixel1 = pixel0 + (d ? p.width : 1);
-        float2 zt0 = ((float2*)p.rasterOut)[(pixel0 << 1) + 1];
-        float2 zt1 = ((float2*)p.rasterOut)[(pixel1 << 1) + 1];
-        int tri0 = float_to_triidx(zt0.y) - 1;
-        int tri1 = float_to_triidx(zt1.y) - 1;
+        float2 zt0, zt1;
+        int tri0, tri1;
+        if (p.rasterTri)
+        {
+            zt0.x = p.rasterOut[pixel0];
+            zt1.x = p.rasterOut[pixel1];
+            tri0 = p.rasterTri[pixel0] - 1;
+            tri1 = p.rasterTri[pixel1] - 1;
+        }
+        else
+        {
+            zt0 = ((float2*)p.rasterOut)[(pixel0 << 1) + 1];
+            zt1 = ((float2*)p.rasterOut)[(pixel1 << 1) + 1];
+            tri0 = float_to_triidx(zt0.y) - 1;
+            tri1 = float_to_triidx(zt1.y) - 1;
+        }
 
         // Select triangle based on background / depth.
         int tri = (tri0 >= 0) ? tri0 : tri1;
@@ -261,9 +265,10 @@ __global__ void AntialiasFwdAnalysisKernel(const AntialiasKernelParams p)
             continue;
 
         // Fetch vertex indices.
-        int vi0 = p.tri[tri * 3 + 0];
-        int vi1 = p.tri[tri * 3 + 1];
-        int vi2 = p.tri[tri * 3 + 2];
+        const IndexT* pTri = (const IndexT*)p.tri;
+        int vi0 = pTri[tri * 3 + 0];
+        int vi1 = pTri[tri * 3 + 1];
+        int vi2 = pTri[tri * 3 + 2];
 
         // Bail out if vertex indices are corrupt.
         if (vi0 < 0 || vi0 >= p.numVertices ||
@@ -276,8 +281,8 @@ __global__ void AntialiasFwdAnalysisKernel(const AntialiasKernelParams p)
         int op1 = evhash_find_vertex(p, vi0, vi2, vi1);
         int op2 = evhash_find_vertex(p, vi1, vi0, vi2);
 
-        // Instance mode: Adjust vertex indices based on minibatch index.
-        if (p.instance_mode)
+        // Instance mode: Adjust vertex indices based on minibatch index, unless vertices are shared and transformed per image.
+        if (p.instance_mode && !p.mtx)
         {
             int vbase = pz * p.numVertices;
             vi0 += vbase;
@@ -295,6 +300,16 @@ __global__ void AntialiasFwdAnalysisKernel(const AntialiasKernelParams p)
         float4 o0 = (op0 < 0) ? p0 : ((float4*)p.pos)[op0];
         float4 o1 = (op1 < 0) ? p1 : ((float4*)p.pos)[op1];
         float4 o2 = (op2 < 0) ? p2 : ((float4*)p.pos)[op2];
+        if (p.mtx)
+        {
+            const float* m = p.mtx + 16 * pz;
+            p0 = xfm_pos(m, p0);
+            p1 = xfm_pos(m, p1);
+            p2 = xfm_pos(m, p2);
+            o0 = xfm_pos(m, o0);
+            o1 = xfm_pos(m, o1);
+            o2 = xfm_pos(m, o2);
+        }
 
         // Project vertices to pixel space.
         float w0  = 1.f / p0.w;
@@ -381,10 +396,15 @@ __global__ void AntialiasFwdAnalysisKernel(const AntialiasKernelParams p)
     }
 }
 
+// Template specializations.
+__global__ void AntialiasFwdAnalysisKernel   (const AntialiasKernelParams p) { AntialiasFwdAnalysisKernelTemplate<int>(p); }
+__global__ void AntialiasFwdAnalysisKernelU16(const AntialiasKernelParams p) { AntialiasFwdAnalysisKernelTemplate<unsigned short>(p); }
+
 //------------------------------------------------------------------------
 // Gradient kernel.
 
-__global__ void AntialiasGradKernel(const AntialiasKernelParams p)
+template <class IndexT>
+static __forceinline__ __device__ void AntialiasGradKernelTemplate(const AntialiasKernelParams p)
 {
     // Temporary space for coalesced atomics.
     CA_DECLARE_TEMP(AA_GRAD_KERNEL_THREADS_PER_BLOCK);
@@ -425,7 +445,8 @@ __global__ void AntialiasGradKernel(const AntialiasKernelParams p)
             float ds = __int_as_float(__float_as_int(1.0) | (tri1 << 31));
             int pixel0 = px + p.width * (py + p.height * pz);
             int pixel1 = pixel0 + (d ? p.width : 1);
-            int tri = float_to_triidx(p.rasterOut[((tri1 ? pixel1 : pixel0) << 2) + 3]) - 1;
+            int pixelT = tri1 ? pixel1 : pixel0;
+            int tri = (p.rasterTri ? p.rasterTri[pixelT] : float_to_triidx(p.rasterOut[(pixelT << 2) + 3])) - 1;
             if (tri1)
             {
                 px += 1 - d;
@@ -475,8 +496,9 @@ __global__ void AntialiasGradKernel(const AntialiasKernelParams p)
             // Fetch vertex indices of the active edge and their positions.
             int i1 = (di < 2) ? (di + 1) : 0;
             int i2 = (i1 < 2) ? (i1 + 1) : 0;
-            int vi1 = p.tri[3 * tri + i1];
-            int vi2 = p.tri[3 * tri + i2];
+            const IndexT* pTri = (const IndexT*)p.tri;
+            int vi1 = pTri[3 * tri + i1];
+            int vi2 = pTri[3 * tri + i2];
 
             // Bail out if vertex indices are corrupt.
             bool vtxFail = (vi1 < 0 || vi1 >= p.numVertices || vi2 < 0 || vi2 >= p.numVertices);
@@ -484,16 +506,19 @@ __global__ void AntialiasGradKernel(const AntialiasKernelParams p)
             if (vtxFail)
                 continue;
 
-            // Instance mode: Adjust vertex indices based on minibatch index.
-            if (p.instance_mode)
+            // Instance mode: Adjust vertex indices based on minibatch index, unless vertices are shared and transformed per image.
+            if (p.instance_mode && !p.mtx)
             {
                 vi1 += pz * p.numVertices;
                 vi2 += pz * p.numVertices;
             }
 
-            // Fetch vertex positions.
-            float4 p1 = ((float4*)p.pos)[vi1];
-            float4 p2 = ((float4*)p.pos)[vi2];
+            // Fetch vertex positions. Keep the untransformed ones for the transform gradient.
+            float4 v1 = ((float4*)p.pos)[vi1];
+            float4 v2 = ((float4*)p.pos)[vi2];
+            const float* m = p.mtx ? p.mtx + 16 * pz : 0;
+            float4 p1 = m ? xfm_pos(m, v1) : v1;
+            float4 p2 = m ? xfm_pos(m, v2) : v2;
 
             // Project vertices to pixel space.
             float pxh = p.xh;
@@ -556,10 +581,31 @@ __global__ void AntialiasGradKernel(const AntialiasKernelParams p)
             CA_SET_GROUP_MASK(tri ^ (di << 30), amask, AA_GRAD_KERNEL_THREADS_PER_BLOCK);
 
             // Accumulate gradients.
-            caAtomicAdd3_xyw(p.gradPos + 4 * vi1, gp1x, gp1y, gp1w);
-            caAtomicAdd3_xyw(p.gradPos + 4 * vi2, gp2x, gp2y, gp2w);
+            if (!m)
+            {
+                caAtomicAdd3_xyw(p.gradPos + 4 * vi1, gp1x, gp1y, gp1w);
+                caAtomicAdd3_xyw(p.gradPos + 4 * vi2, gp2x, gp2y, gp2w);
+                continue;
+            }
+
+            // Shared vertices: pull the clip-space gradients back through the transform.
+            caAtomicAdd4(p.gradPos + 4 * vi1, xfm_grad_t(m, gp1x, gp1y, gp1w));
+            caAtomicAdd4(p.gradPos + 4 * vi2, xfm_grad_t(m, gp2x, gp2y, gp2w));
+
+            // Transform gradient is the outer product of clip-space gradients and vertices. Regroup by image.
+            {
+                CA_SET_GROUP_MASK(pz, amask, AA_GRAD_KERNEL_THREADS_PER_BLOCK);
+                float* gm = p.gradMtx + 16 * pz;
+                caAtomicAdd4(gm + 0,  gp1x * v1 + gp2x * v2);
+                caAtomicAdd4(gm + 4,  gp1y * v1 + gp2y * v2);
+                caAtomicAdd4(gm + 12, gp1w * v1 + gp2w * v2);
+            }
         }
     }
 }
 
+// Template specializations.
+__global__ void AntialiasGradKernel   (const AntialiasKernelParams p) { AntialiasGradKernelTemplate<int>(p); }
+__global__ void AntialiasGradKernelU16(const AntialiasKernelParams p) { AntialiasGradKernelTemplate<unsigned short>(p); }
+
 //------------------------------------------------------------------------
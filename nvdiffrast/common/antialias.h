@@ -26,13 +26,16 @@
 struct AntialiasKernelParams
 {
     const float*    color;          // Incoming color buffer.
-    const float*    rasterOut;      // Incoming rasterizer output buffer.
-    const int*      tri;            // Incoming triangle buffer.
+    const float*    rasterOut;      // Incoming rasterizer output buffer, or z/w plane of compact output.
+    const int*      rasterTri;      // Triangle id plane of compact rasterizer output, NULL if rasterOut is float4.
+    const void*     tri;            // Incoming triangle buffer, int32 or uint16 indices.
     const float*    pos;            // Incoming position buffer.
+    const float*    mtx;            // Per-image 4x4 vertex transforms in instance mode, or NULL.
     float*          output;         // Output buffer of forward kernel.
     const float*    dy;             // Incoming gradients.
     float*          gradColor;      // Output buffer, color gradient.
     float*          gradPos;        // Output buffer, position gradient.
+    float*          gradMtx;        // Output buffer, vertex transform gradient.
     int4*           workBuffer;     // Buffer for storing intermediate work items. First item reserved for counters.
     uint4*          evHash;         // Edge-vertex hash.
     int             allocTriangles; // Number of triangles accommodated by evHash. Always power of two.
@@ -45,6 +48,34 @@ struct AntialiasKernelParams
     float           xh, yh;         // Transfer to pixel space.
     int             instance_mode;  // 0=normal, 1=instance mode.
     int             tri_const;      // 1 if triangle array is known to be constant.
+    int             tri_u16;        // 1 if triangle indices are uint16. Cuda kernels have specializations instead.
 };
 
 //------------------------------------------------------------------------
+// Format of antialiasing work items stored in work buffer. Usually accessed directly as int4.
+
+struct AAWorkItem
+{
+    enum
+    {
+        EDGE_MASK       = 3,    // Edge index in lowest bits.
+        FLAG_DOWN_BIT   = 2,    // Down instead of right.
+        FLAG_TRI1_BIT   = 3,    // Edge is from other pixel's triangle.
+    };
+
+    int             px, py;         // Pixel x, y.
+    unsigned int    pz_flags;       // High 16 bits = pixel z, low 16 bits = edge index and flags.
+    float           alpha;          // Antialiasing alpha value. Zero if no AA.
+};
+
+//------------------------------------------------------------------------
+// CPU implementation. Takes the same params as the CUDA kernels, with all
+// pointers in host memory. The work buffer has the same layout as on the
+// GPU, with the items sorted by pixel.
+
+class ThreadPool;
+void AntialiasCpuConstructTopologyHash  (const AntialiasKernelParams& p, ThreadPool& pool); // evHash must be zeroed.
+void AntialiasCpuFwd                    (const AntialiasKernelParams& p, ThreadPool& pool); // output must be initialized with color.
+void AntialiasCpuGrad                   (const AntialiasKernelParams& p, ThreadPool& pool); // gradColor must be initialized with dy, gradPos and gradMtx zeroed.
+
+//------------------------------------------------------------------------
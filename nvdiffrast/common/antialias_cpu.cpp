@@ -0,0 +1,822 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "antialias.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Helpers. Same silhouette math as in antialias.cu. The Cuda compiler fuses
+// the multiply-adds in the analysis, and they are spelled out with fmaf()
+// here so that the edge decisions come out identical.
+
+#define F32_MAX (3.402823466e+38f)
+static inline int   float_as_int(float x) { int i; memcpy(&i, &x, 4); return i; }
+static inline float int_as_float(int i)   { float x; memcpy(&x, &i, 4); return x; }
+static inline bool  same_sign(float a, float b) { return (float_as_int(a) ^ float_as_int(b)) >= 0; }
+static inline bool  rational_gt(float n0, float n1, float d0, float d1) { return (n0*d1 > n1*d0) == same_sign(d0, d1); }
+static inline int   max_idx3(float n0, float n1, float n2, float d0, float d1, float d2)
+{
+    bool g10 = rational_gt(n1, n0, d1, d0);
+    bool g20 = rational_gt(n2, n0, d2, d0);
+    bool g21 = rational_gt(n2, n1, d2, d1);
+    if (g20 && g21) return 2;
+    if (g10) return 1;
+    return 0;
+}
+
+//------------------------------------------------------------------------
+// Hash functions. Same hashing and probing as in antialias.cu so that the
+// topology hash tensor is interchangeable between the implementations.
+
+#define JENKINS_MAGIC (0x9e3779b9u)
+static inline void jenkins_mix(unsigned int& a, unsigned int& b, unsigned int& c)
+{
+    a -= b; a -= c; a ^= (c>>13);
+    b -= c; b -= a; b ^= (a<<8);
+    c -= a; c -= b; c ^= (b>>13);
+    a -= b; a -= c; a ^= (c>>12);
+    b -= c; b -= a; b ^= (a<<16);
+    c -= a; c -= b; c ^= (b>>5);
+    a -= b; a -= c; a ^= (c>>3);
+    b -= c; b -= a; b ^= (a<<10);
+    c -= a; c -= b; c ^= (b>>15);
+}
+
+class CpuHashIndex
+{
+public:
+    CpuHashIndex(const AntialiasKernelParams& p, uint64_t key)
+    {
+        m_mask = (p.allocTriangles << AA_LOG_HASH_ELEMENTS_PER_TRIANGLE(p.allocTriangles)) - 1;
+        m_idx  = (uint32_t)(key & 0xffffffffu);
+        m_skip = (uint32_t)(key >> 32);
+        uint32_t dummy = JENKINS_MAGIC;
+        jenkins_mix(m_idx, m_skip, dummy);
+        m_idx &= m_mask;
+        m_skip &= m_mask;
+        m_skip |= 1;
+    }
+    int  get    (void) const { return m_idx; }
+    void next   (void) { m_idx = (m_idx + m_skip) & m_mask; }
+private:
+    uint32_t m_idx, m_skip, m_mask;
+};
+
+static inline uint64_t hash_key(int va, int vb)
+{
+    uint64_t v0 = (uint32_t)std::min(va, vb) + 1; // canonical vertex order
+    uint64_t v1 = (uint32_t)std::max(va, vb) + 1;
+    return v0 | (v1 << 32);
+}
+
+// Lock-free insertion, same protocol as the atomicCAS version in
+// antialias.cu. The key half of an entry is claimed with a 64-bit CAS and
+// the vertex slots with 32-bit CAS, so all workers can insert concurrently.
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic types must match entry layout");
+
+static void hash_insert(const AntialiasKernelParams& p, uint64_t key, int v)
+{
+    CpuHashIndex idx(p, key);
+    for(;;)
+    {
+        uint64_t prev = 0;
+        std::atomic<uint64_t>* k = (std::atomic<uint64_t>*)&p.evHash[idx.get()];
+        if (k->compare_exchange_strong(prev, key, std::memory_order_relaxed) || prev == key)
+            break;
+        idx.next();
+    }
+    std::atomic<uint32_t>* q = (std::atomic<uint32_t>*)&p.evHash[idx.get()];
+    uint32_t a = 0;
+    if (!q[2].compare_exchange_strong(a, (uint32_t)v, std::memory_order_relaxed) && a != (uint32_t)v)
+    {
+        uint32_t b = 0;
+        q[3].compare_exchange_strong(b, (uint32_t)v, std::memory_order_relaxed);
+    }
+}
+
+static void hash_find(const AntialiasKernelParams& p, uint64_t key, int& v0, int& v1)
+{
+    CpuHashIndex idx(p, key);
+    for(;;)
+    {
+        const unsigned int* q = (const unsigned int*)&p.evHash[idx.get()];
+        uint64_t k = ((uint64_t)q[0]) | (((uint64_t)q[1]) << 32);
+        if (k == key || k == 0)
+        {
+            v0 = (int)q[2];
+            v1 = (int)q[3];
+            return;
+        }
+        idx.next();
+    }
+}
+
+static inline void evhash_insert_vertex(const AntialiasKernelParams& p, int va, int vb, int vn)
+{
+    if (va == vb)
+        return;
+    hash_insert(p, hash_key(va, vb), vn + 1);
+}
+
+static inline int evhash_find_vertex(const AntialiasKernelParams& p, int va, int vb, int vr)
+{
+    if (va == vb)
+        return -1;
+
+    int vn0, vn1;
+    hash_find(p, hash_key(va, vb), vn0, vn1);
+    if (vn0 - 1 == vr) return vn1 - 1;
+    if (vn1 - 1 == vr) return vn0 - 1;
+    return -1;
+}
+
+//------------------------------------------------------------------------
+// Mesh analysis.
+
+void AntialiasCpuConstructTopologyHash(const AntialiasKernelParams& p, ThreadPool& pool)
+{
+    // All workers insert concurrently. Completion of parallelFor publishes the relaxed stores.
+    pool.parallelFor(0, p.numTriangles, 4096, [&](int begin, int end, int)
+    {
+        for (int idx = begin; idx < end; idx++)
+        {
+            int v0 = tri_index_host(p.tri, p.tri_u16, idx * 3 + 0);
+            int v1 = tri_index_host(p.tri, p.tri_u16, idx * 3 + 1);
+            int v2 = tri_index_host(p.tri, p.tri_u16, idx * 3 + 2);
+
+            if (v0 < 0 || v0 >= p.numVertices ||
+                v1 < 0 || v1 >= p.numVertices ||
+                v2 < 0 || v2 >= p.numVertices)
+                continue;
+
+            if (v0 == v1 || v1 == v2 || v2 == v0)
+                continue;
+
+            evhash_insert_vertex(p, v1, v2, v0);
+            evhash_insert_vertex(p, v2, v0, v1);
+            evhash_insert_vertex(p, v0, v1, v2);
+        }
+    });
+}
+
+//------------------------------------------------------------------------
+// Discontinuity finder, one image row per call. Appends work items as
+// groups of four ints and returns their number.
+
+static int AntialiasCpuDiscontinuityRow(const AntialiasKernelParams& p, int py, int pz, std::vector<int>& items)
+{
+    // Float ids can be read as bits, as we only compare them against each other.
+    const int* triPtr = p.rasterTri ? p.rasterTri : (const int*)p.rasterOut + 3;
+    int triStride = p.rasterTri ? 1 : 4;
+    int count = 0;
+    for (int px=0; px < p.width; px++)
+    {
+        // Pointer to our TriIdx and fetch.
+        int pidx0 = (px + p.width * (py + p.height * pz)) * triStride;
+        int tri0 = triPtr[pidx0];
+
+        // Look right, clamp at edge.
+        int pidx1 = pidx0;
+        if (px < p.width - 1)
+            pidx1 += triStride;
+        int tri1 = triPtr[pidx1];
+
+        // Look down, clamp at edge.
+        int pidx2 = pidx0;
+        if (py < p.height - 1)
+            pidx2 += p.width * triStride;
+        int tri2 = triPtr[pidx2];
+
+        // Emit work items.
+        if (tri1 != tri0)
+        {
+            int item[4] = { px, py, (pz << 16), 0 };
+            items.insert(items.end(), item, item + 4);
+            count++;
+        }
+        if (tri2 != tri0)
+        {
+            int item[4] = { px, py, (pz << 16) + (1 << AAWorkItem::FLAG_DOWN_BIT), 0 };
+            items.insert(items.end(), item, item + 4);
+            count++;
+        }
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------
+// Analysis of a single work item. Same as the loop body of
+// AntialiasFwdAnalysisKernel, except that the output is not touched here.
+// The flags and alpha are rewritten as on the GPU, and the resolve pass
+// applies them to the output afterwards.
+
+static void AntialiasCpuAnalyzeItem(const AntialiasKernelParams& p, int* pItem)
+{
+    int px = pItem[0];
+    int py = pItem[1];
+    int pz = (int)(((unsigned int)pItem[2]) >> 16);
+    int d  = (pItem[2] >> AAWorkItem::FLAG_DOWN_BIT) & 1;
+
+    int pixel0 = px + p.width * (py + p.height * pz);
+    int pixel1 = pixel0 + (d ? p.width : 1);
+    float z0, z1;
+    int tri0, tri1;
+    if (p.rasterTri)
+    {
+        z0 = p.rasterOut[pixel0];
+        z1 = p.rasterOut[pixel1];
+        tri0 = p.rasterTri[pixel0] - 1;
+        tri1 = p.rasterTri[pixel1] - 1;
+    }
+    else
+    {
+        z0 = p.rasterOut[(pixel0 << 2) + 2];
+        z1 = p.rasterOut[(pixel1 << 2) + 2];
+        tri0 = float_to_triidx_host(p.rasterOut[(pixel0 << 2) + 3]) - 1;
+        tri1 = float_to_triidx_host(p.rasterOut[(pixel1 << 2) + 3]) - 1;
+    }
+
+    // Select triangle based on background / depth.
+    int tri = (tri0 >= 0) ? tri0 : tri1;
+    if (tri0 >= 0 && tri1 >= 0)
+        tri = (z0 < z1) ? tri0 : tri1;
+    if (tri == tri1)
+    {
+        // Calculate with respect to neighbor pixel if chose that triangle.
+        px += 1 - d;
+        py += d;
+    }
+
+    // Bail out if triangle index is corrupt.
+    if (tri < 0 || tri >= p.numTriangles)
+        return;
+
+    // Fetch vertex indices.
+    int vi0 = tri_index_host(p.tri, p.tri_u16, tri * 3 + 0);
+    int vi1 = tri_index_host(p.tri, p.tri_u16, tri * 3 + 1);
+    int vi2 = tri_index_host(p.tri, p.tri_u16, tri * 3 + 2);
+
+    // Bail out if vertex indices are corrupt.
+    if (vi0 < 0 || vi0 >= p.numVertices ||
+        vi1 < 0 || vi1 >= p.numVertices ||
+        vi2 < 0 || vi2 >= p.numVertices)
+        return;
+
+    // Fetch opposite vertex indices. Use vertex itself (always silhouette) if no opposite vertex exists.
+    int op0 = evhash_find_vertex(p, vi2, vi1, vi0);
+    int op1 = evhash_find_vertex(p, vi0, vi2, vi1);
+    int op2 = evhash_find_vertex(p, vi1, vi0, vi2);
+
+    // Instance mode: Adjust vertex indices based on minibatch index, unless vertices are shared and transformed per image.
+    if (p.instance_mode && !p.mtx)
+    {
+        int vbase = pz * p.numVertices;
+        vi0 += vbase;
+        vi1 += vbase;
+        vi2 += vbase;
+        if (op0 >= 0) op0 += vbase;
+        if (op1 >= 0) op1 += vbase;
+        if (op2 >= 0) op2 += vbase;
+    }
+
+    // Fetch vertex positions.
+    const float* p0 = p.pos + 4 * vi0;
+    const float* p1 = p.pos + 4 * vi1;
+    const float* p2 = p.pos + 4 * vi2;
+    const float* o0 = (op0 < 0) ? p0 : p.pos + 4 * op0;
+    const float* o1 = (op1 < 0) ? p1 : p.pos + 4 * op1;
+    const float* o2 = (op2 < 0) ? p2 : p.pos + 4 * op2;
+    float t[6][4];
+    if (p.mtx)
+    {
+        const float* m = p.mtx + 16 * pz;
+        xfm_pos_host(m, p0, t[0]); p0 = t[0];
+        xfm_pos_host(m, p1, t[1]); p1 = t[1];
+        xfm_pos_host(m, p2, t[2]); p2 = t[2];
+        xfm_pos_host(m, o0, t[3]); o0 = t[3];
+        xfm_pos_host(m, o1, t[4]); o1 = t[4];
+        xfm_pos_host(m, o2, t[5]); o2 = t[5];
+    }
+
+    // Project vertices to pixel space.
+    float w0  = 1.f / p0[3];
+    float w1  = 1.f / p1[3];
+    float w2  = 1.f / p2[3];
+    float ow0 = 1.f / o0[3];
+    float ow1 = 1.f / o1[3];
+    float ow2 = 1.f / o2[3];
+    float fx  = (float)px + .5f - p.xh;
+    float fy  = (float)py + .5f - p.yh;
+    float x0  = fmaf(p0[0] * w0, p.xh, -fx);
+    float y0  = fmaf(p0[1] * w0, p.yh, -fy);
+    float x1  = fmaf(p1[0] * w1, p.xh, -fx);
+    float y1  = fmaf(p1[1] * w1, p.yh, -fy);
+    float x2  = fmaf(p2[0] * w2, p.xh, -fx);
+    float y2  = fmaf(p2[1] * w2, p.yh, -fy);
+    float ox0 = fmaf(o0[0] * ow0, p.xh, -fx);
+    float oy0 = fmaf(o0[1] * ow0, p.yh, -fy);
+    float ox1 = fmaf(o1[0] * ow1, p.xh, -fx);
+    float oy1 = fmaf(o1[1] * ow1, p.yh, -fy);
+    float ox2 = fmaf(o2[0] * ow2, p.xh, -fx);
+    float oy2 = fmaf(o2[1] * ow2, p.yh, -fy);
+
+    // Signs to kill non-silhouette edges.
+    float bb = fmaf(x1-x0, y2-y0, -((x2-x0)*(y1-y0))); // Triangle itself.
+    float a0 = fmaf(x1-ox0, y2-oy0, -((x2-ox0)*(y1-oy0))); // Wings.
+    float a1 = fmaf(x2-ox1, y0-oy1, -((x0-ox1)*(y2-oy1)));
+    float a2 = fmaf(x0-ox2, y1-oy2, -((x1-ox2)*(y0-oy2)));
+
+    // If no matching signs anywhere, skip the rest.
+    if (!(same_sign(a0, bb) || same_sign(a1, bb) || same_sign(a2, bb)))
+        return;
+
+    // XY flip for horizontal edges.
+    if (d)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+        std::swap(x2, y2);
+    }
+
+    float dx0 = x2 - x1;
+    float dx1 = x0 - x2;
+    float dx2 = x1 - x0;
+    float dy0 = y2 - y1;
+    float dy1 = y0 - y2;
+    float dy2 = y1 - y0;
+
+    // Check if an edge crosses between us and the neighbor pixel.
+    float dc = -F32_MAX;
+    float ds = (tri == tri0) ? 1.f : -1.f;
+    float d0 = ds * fmaf(x1, dy0, -(y1*dx0));
+    float d1 = ds * fmaf(x2, dy1, -(y2*dx1));
+    float d2 = ds * fmaf(x0, dy2, -(y0*dx2));
+
+    if (same_sign(y1, y2)) d0 = -F32_MAX, dy0 = 1.f;
+    if (same_sign(y2, y0)) d1 = -F32_MAX, dy1 = 1.f;
+    if (same_sign(y0, y1)) d2 = -F32_MAX, dy2 = 1.f;
+
+    int di = max_idx3(d0, d1, d2, dy0, dy1, dy2);
+    if (di == 0 && same_sign(a0, bb) && fabsf(dy0) >= fabsf(dx0)) dc = d0 / dy0;
+    if (di == 1 && same_sign(a1, bb) && fabsf(dy1) >= fabsf(dx1)) dc = d1 / dy1;
+    if (di == 2 && same_sign(a2, bb) && fabsf(dy2) >= fabsf(dx2)) dc = d2 / dy2;
+    float eps = .0625f; // Expect no more than 1/16 pixel inaccuracy.
+
+    // Record the edge if a suitable one was found.
+    if (dc > -eps && dc < 1.f + eps)
+    {
+        dc = fminf(fmaxf(dc, 0.f), 1.f);
+        float alpha = ds * (.5f - dc);
+
+        // Rewrite the work item's flags and alpha. Keep original px, py.
+        unsigned int flags = pz << 16;
+        flags |= di;
+        flags |= d << AAWorkItem::FLAG_DOWN_BIT;
+        flags |= ((unsigned int)float_as_int(ds) >> 31) << AAWorkItem::FLAG_TRI1_BIT;
+        pItem[2] = (int)flags;
+        pItem[3] = float_as_int(alpha);
+    }
+}
+
+//------------------------------------------------------------------------
+// Resolve pass, one output row per call. Adds the blend of every analyzed
+// item that targets this row. The target is pixel0 for positive alpha and
+// pixel1 otherwise, so a row collects from its own items and from the
+// down-items of the row above.
+
+static void AntialiasCpuResolveRow(const AntialiasKernelParams& p, int row, const int* rowOfs)
+{
+    const int* items = (const int*)(p.workBuffer + 1);
+    for (int r = (row % p.height) ? row - 1 : row; r <= row; r++)
+    {
+        for (int i = rowOfs[r]; i < rowOfs[r + 1]; i++)
+        {
+            const int* item = items + 4 * i;
+            float alpha = int_as_float(item[3]);
+            if (alpha == 0.f)
+                continue; // No effect.
+
+            int d = (item[2] >> AAWorkItem::FLAG_DOWN_BIT) & 1;
+            bool toPixel0 = (alpha > 0.f);
+            if (toPixel0 ? (r != row) : (d ? (r == row) : (r != row)))
+                continue; // Targets another row.
+
+            int pz = (int)(((unsigned int)item[2]) >> 16);
+            int pixel0 = item[0] + p.width * (item[1] + p.height * pz);
+            int pixel1 = pixel0 + (d ? p.width : 1);
+            const float* pColor0 = p.color + (size_t)pixel0 * p.channels;
+            const float* pColor1 = p.color + (size_t)pixel1 * p.channels;
+            float* pOutput = p.output + (size_t)(toPixel0 ? pixel0 : pixel1) * p.channels;
+            for (int c=0; c < p.channels; c++)
+                pOutput[c] += alpha * (pColor1[c] - pColor0[c]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// Forward pass.
+
+void AntialiasCpuFwd(const AntialiasKernelParams& p, ThreadPool& pool)
+{
+    int rows      = p.height * p.n;
+    int grain     = std::max(1, rows / (pool.getNumThreads() * 4));
+    int numBlocks = (rows + grain - 1) / grain;
+
+    // Phase 1: row-parallel discontinuity scan into per-block work lists.
+    std::vector<std::vector<int> > lists(numBlocks);
+    std::vector<int> rowOfs(rows + 1);
+    pool.run(numBlocks, [&](int blockIdx, int)
+    {
+        int end = std::min(rows, (blockIdx + 1) * grain);
+        for (int i = blockIdx * grain; i < end; i++)
+            rowOfs[i + 1] = AntialiasCpuDiscontinuityRow(p, i % p.height, i / p.height, lists[blockIdx]);
+    });
+
+    // Row offsets and item count. First slot holds the counters as on the GPU.
+    rowOfs[0] = 0;
+    for (int i=0; i < rows; i++)
+        rowOfs[i + 1] += rowOfs[i];
+    int workCount = rowOfs[rows];
+    int* counters = (int*)p.workBuffer;
+    counters[0] = workCount;
+    counters[1] = counters[2] = counters[3] = 0;
+
+    // Concatenate the lists into the work buffer in pixel order.
+    int* items = (int*)(p.workBuffer + 1);
+    pool.run(numBlocks, [&](int blockIdx, int)
+    {
+        const std::vector<int>& list = lists[blockIdx];
+        if (!list.empty())
+            memcpy(items + 4 * (size_t)rowOfs[blockIdx * grain], &list[0], list.size() * sizeof(int));
+    });
+    lists.clear();
+
+    // Phase 2: analysis with work stealing. Every worker starts on its own
+    // share of the items and steals from the other shares once it runs dry.
+    int numQueues = pool.getNumThreads();
+    int steal     = 64; // Items claimed per fetch.
+    std::unique_ptr<std::atomic<int>[]> queueNext(new std::atomic<int>[numQueues]);
+    for (int q=0; q < numQueues; q++)
+        queueNext[q].store((int)((int64_t)workCount * q / numQueues));
+    pool.run(numQueues, [&](int home, int)
+    {
+        for (int k=0; k < numQueues; k++)
+        {
+            int q   = (home + k) % numQueues;
+            int end = (int)((int64_t)workCount * (q + 1) / numQueues);
+            for(;;)
+            {
+                int begin = queueNext[q].fetch_add(steal);
+                if (begin >= end)
+                    break;
+                for (int i = begin; i < std::min(begin + steal, end); i++)
+                    AntialiasCpuAnalyzeItem(p, items + 4 * (size_t)i);
+            }
+        }
+    });
+
+    // Phase 3: blend into the output, rows are independent.
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+            AntialiasCpuResolveRow(p, i, &rowOfs[0]);
+    });
+}
+
+//------------------------------------------------------------------------
+// Gradient pass. Work items are sorted by pixel, so the items of an image
+// row form a contiguous range that can be found by binary search. Each row
+// task writes the color gradients of its own row in place, collecting from
+// its own items and from the down-items of the row above, and accumulates
+// position gradients into a private per-worker buffer. The buffers are
+// reduced at the end.
+
+#define AA_CPU_GRAD_BLOCK_VERTICES 256
+
+struct AntialiasCpuGradAccum
+{
+    std::vector<int>    blockOfs;   // Offset of each vertex block in data, or -1 if not touched.
+    std::vector<float>  data;       // Gradient storage for the touched blocks, four floats per vertex.
+    std::vector<float>  mtxData;    // Transform gradients, 16 floats per image. Only with shared vertices.
+
+    void touch(int vi)
+    {
+        int b = vi / AA_CPU_GRAD_BLOCK_VERTICES;
+        if (blockOfs[b] < 0)
+        {
+            blockOfs[b] = (int)data.size();
+            data.resize(data.size() + AA_CPU_GRAD_BLOCK_VERTICES * 4, 0.f);
+        }
+    }
+
+    float* get(int vi) // Valid until the next touch().
+    {
+        return &data[blockOfs[vi / AA_CPU_GRAD_BLOCK_VERTICES] + (vi % AA_CPU_GRAD_BLOCK_VERTICES) * 4];
+    }
+};
+
+// Set up an analyzed work item. Returns false if the item has no effect.
+static inline bool AntialiasCpuGradItem(const AntialiasKernelParams& p, const int* item, int& pixel0, int& pixel1, int& tri, float& alpha)
+{
+    if (item[3] == 0)
+        return false; // No effect.
+
+    int pz   = (int)(((unsigned int)item[2]) >> 16);
+    int d    = (item[2] >> AAWorkItem::FLAG_DOWN_BIT) & 1;
+    int tri1 = (item[2] >> AAWorkItem::FLAG_TRI1_BIT) & 1;
+    alpha  = int_as_float(item[3]);
+    pixel0 = item[0] + p.width * (item[1] + p.height * pz);
+    pixel1 = pixel0 + (d ? p.width : 1);
+    int pixelT = tri1 ? pixel1 : pixel0;
+    tri    = (p.rasterTri ? p.rasterTri[pixelT] : float_to_triidx_host(p.rasterOut[(pixelT << 2) + 3])) - 1;
+
+    // Bail out if triangle index is corrupt.
+    return (tri >= 0 && tri < p.numTriangles);
+}
+
+static void AntialiasCpuGradRow(const AntialiasKernelParams& p, const int* items, int begin, int end, int prevBegin, int prevEnd, AntialiasCpuGradAccum& acc)
+{
+    int pixel0, pixel1, tri;
+    float alpha;
+
+    // Down-items of the row above contribute to pixel1 on this row.
+    for (int k = prevBegin; k < prevEnd; k++)
+    {
+        const int* item = items + 4 * (size_t)k;
+        if (!((item[2] >> AAWorkItem::FLAG_DOWN_BIT) & 1) || !AntialiasCpuGradItem(p, item, pixel0, pixel1, tri, alpha))
+            continue;
+
+        const float* pDy = p.dy + (size_t)(alpha > 0.f ? pixel0 : pixel1) * p.channels;
+        float* pGrad1 = p.gradColor + (size_t)pixel1 * p.channels;
+        for (int i=0; i < p.channels; i++)
+            if (pDy[i] != 0.f)
+                pGrad1[i] += alpha * pDy[i];
+    }
+
+    // Own items.
+    for (int k = begin; k < end; k++)
+    {
+        const int* item = items + 4 * (size_t)k;
+        if (!AntialiasCpuGradItem(p, item, pixel0, pixel1, tri, alpha))
+            continue;
+
+        // Unpack work item and replicate setup from forward analysis.
+        int px = item[0];
+        int py = item[1];
+        int pz = (int)(((unsigned int)item[2]) >> 16);
+        int d  = (item[2] >> AAWorkItem::FLAG_DOWN_BIT) & 1;
+        int di = item[2] & AAWorkItem::EDGE_MASK;
+        if ((item[2] >> AAWorkItem::FLAG_TRI1_BIT) & 1)
+        {
+            px += 1 - d;
+            py += d;
+        }
+
+        // Outgoing color gradients. Pixel1 is on the next row for down-items, that row picks it up.
+        float* pGrad0 = p.gradColor + (size_t)pixel0 * p.channels;
+        float* pGrad1 = d ? NULL : p.gradColor + (size_t)pixel1 * p.channels;
+
+        // Incoming color gradients.
+        const float* pDy = p.dy + (size_t)(alpha > 0.f ? pixel0 : pixel1) * p.channels;
+
+        // Position gradient weight based on colors and incoming gradients.
+        float dd = 0.f;
+        const float* pColor0 = p.color + (size_t)pixel0 * p.channels;
+        const float* pColor1 = p.color + (size_t)pixel1 * p.channels;
+
+        // Loop over channels and accumulate.
+        for (int i=0; i < p.channels; i++)
+        {
+            float dy = pDy[i];
+            if (dy != 0.f)
+            {
+                // Update position gradient weight.
+                dd = fmaf(dy, pColor1[i] - pColor0[i], dd);
+
+                // Update color gradients.
+                float v = alpha * dy;
+                pGrad0[i] += -v;
+                if (pGrad1)
+                    pGrad1[i] += v;
+            }
+        }
+
+        // If position weight is zero, skip the rest.
+        if (dd == 0.f)
+            continue;
+
+        // Fetch vertex indices of the active edge and their positions.
+        int i1 = (di < 2) ? (di + 1) : 0;
+        int i2 = (i1 < 2) ? (i1 + 1) : 0;
+        int vi1 = tri_index_host(p.tri, p.tri_u16, 3 * tri + i1);
+        int vi2 = tri_index_host(p.tri, p.tri_u16, 3 * tri + i2);
+
+        // Bail out if vertex indices are corrupt.
+        if (vi1 < 0 || vi1 >= p.numVertices || vi2 < 0 || vi2 >= p.numVertices)
+            continue;
+
+        // Instance mode: Adjust vertex indices based on minibatch index, unless vertices are shared and transformed per image.
+        if (p.instance_mode && !p.mtx)
+        {
+            vi1 += pz * p.numVertices;
+            vi2 += pz * p.numVertices;
+        }
+
+        // Fetch vertex positions.
+        const float* m = p.mtx ? p.mtx + 16 * pz : NULL;
+        float p1[4], p2[4];
+        if (m)
+        {
+            xfm_pos_host(m, p.pos + 4 * vi1, p1);
+            xfm_pos_host(m, p.pos + 4 * vi2, p2);
+        }
+        else
+        {
+            memcpy(p1, p.pos + 4 * vi1, sizeof(p1));
+            memcpy(p2, p.pos + 4 * vi2, sizeof(p2));
+        }
+
+        // Project vertices to pixel space.
+        float pxh = p.xh;
+        float pyh = p.yh;
+        float fx = (float)px + .5f - pxh;
+        float fy = (float)py + .5f - pyh;
+
+        // XY flip for horizontal edges.
+        if (d)
+        {
+            std::swap(p1[0], p1[1]);
+            std::swap(p2[0], p2[1]);
+            std::swap(pxh, pyh);
+            std::swap(fx, fy);
+        }
+
+        // Gradient calculation setup.
+        float w1 = 1.f / p1[3];
+        float w2 = 1.f / p2[3];
+        float x1 = fmaf(p1[0] * w1, pxh, -fx);
+        float y1 = fmaf(p1[1] * w1, pyh, -fy);
+        float x2 = fmaf(p2[0] * w2, pxh, -fx);
+        float y2 = fmaf(p2[1] * w2, pyh, -fy);
+        float dx = x2 - x1;
+        float dy = y2 - y1;
+        float db = fmaf(x1, dy, -(y1*dx));
+
+        // Compute inverse delta-y with epsilon.
+        float ep = copysignf(1e-3f, dy); // ~1/1000 pixel.
+        float iy = 1.f / (dy + ep);
+
+        // Compute position gradients.
+        float dby = db * iy;
+        float iw1 = -w1 * iy * dd;
+        float iw2 =  w2 * iy * dd;
+        float gp1x = iw1 * pxh * y2;
+        float gp2x = iw2 * pxh * y1;
+        float gp1y = iw1 * pyh * (dby - x2);
+        float gp2y = iw2 * pyh * (dby - x1);
+        float gp1w = -fmaf(p1[0], gp1x, p1[1] * gp1y) * w1;
+        float gp2w = -fmaf(p2[0], gp2x, p2[1] * gp2y) * w2;
+
+        // XY flip the gradients.
+        if (d)
+        {
+            std::swap(gp1x, gp1y);
+            std::swap(gp2x, gp2y);
+        }
+
+        // Kill position gradients if alpha was saturated.
+        if (fabsf(alpha) >= 0.5f)
+        {
+            gp1x = gp1y = gp1w = 0.f;
+            gp2x = gp2y = gp2w = 0.f;
+        }
+
+        // Accumulate gradients.
+        acc.touch(vi1);
+        acc.touch(vi2);
+        float* g1 = acc.get(vi1);
+        float* g2 = acc.get(vi2);
+        if (!m)
+        {
+            g1[0] += gp1x;
+            g1[1] += gp1y;
+            g1[3] += gp1w;
+            g2[0] += gp2x;
+            g2[1] += gp2y;
+            g2[3] += gp2w;
+            continue;
+        }
+
+        // Shared vertices: M^T g for the vertices and g v^T for the matrix.
+        float gv1[4], gv2[4];
+        xfm_grad_t_host(m, gp1x, gp1y, gp1w, gv1);
+        xfm_grad_t_host(m, gp2x, gp2y, gp2w, gv2);
+        const float* v1 = p.pos + 4 * vi1;
+        const float* v2 = p.pos + 4 * vi2;
+        float* gm = &acc.mtxData[16 * pz];
+        for (int i=0; i < 4; i++)
+        {
+            g1[i] += gv1[i];
+            g2[i] += gv2[i];
+            gm[i +  0] += gp1x * v1[i] + gp2x * v2[i];
+            gm[i +  4] += gp1y * v1[i] + gp2y * v2[i];
+            gm[i + 12] += gp1w * v1[i] + gp2w * v2[i];
+        }
+    }
+}
+
+void AntialiasCpuGrad(const AntialiasKernelParams& p, ThreadPool& pool)
+{
+    int workCount = ((const int*)p.workBuffer)[0];
+    const int* items = (const int*)(p.workBuffer + 1);
+
+    // Size of the position gradient buffer in vertices.
+    int numGradVertices = (p.instance_mode && !p.mtx) ? p.numVertices * p.n : p.numVertices;
+    int numBlocks       = (numGradVertices + AA_CPU_GRAD_BLOCK_VERTICES - 1) / AA_CPU_GRAD_BLOCK_VERTICES;
+    int blockFloats     = AA_CPU_GRAD_BLOCK_VERTICES * 4;
+
+    // Private accumulators, one per worker.
+    int numThreads = pool.getNumThreads();
+    std::vector<AntialiasCpuGradAccum> accums(numThreads);
+    for (int i=0; i < numThreads; i++)
+    {
+        accums[i].blockOfs.assign(numBlocks, -1);
+        accums[i].mtxData.assign(p.mtx ? 16 * p.n : 0, 0.f);
+    }
+
+    // Item range of each row, from the pixel order of the work buffer.
+    int rows = p.height * p.n;
+    std::vector<int> rowOfs(rows + 1);
+    for (int r=0; r <= rows; r++)
+    {
+        int lo = 0, hi = workCount;
+        while (lo < hi)
+        {
+            int mid = lo + ((hi - lo) >> 1);
+            const int* item = items + 4 * (size_t)mid;
+            int itemRow = item[1] + p.height * (int)(((unsigned int)item[2]) >> 16);
+            if (itemRow < r)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        rowOfs[r] = lo;
+    }
+
+    // Process rows.
+    int grain = std::max(1, rows / (numThreads * 4));
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int threadIdx)
+    {
+        for (int r = begin; r < end; r++)
+        {
+            bool top = !(r % p.height);
+            AntialiasCpuGradRow(p, items, rowOfs[r], rowOfs[r + 1], top ? 0 : rowOfs[r - 1], top ? 0 : rowOfs[r], accums[threadIdx]);
+        }
+    });
+
+    // Merge the accumulators of each vertex block with a pairwise tree and write the result.
+    pool.parallelFor(0, numBlocks, 16, [&](int begin, int end, int)
+    {
+        std::vector<float*> src(numThreads);
+        for (int b = begin; b < end; b++)
+        {
+            int n = 0;
+            for (int t=0; t < numThreads; t++)
+                if (accums[t].blockOfs[b] >= 0)
+                    src[n++] = &accums[t].data[accums[t].blockOfs[b]];
+            if (!n)
+                continue; // Untouched, leave at zero.
+
+            for (int stride = 1; stride < n; stride *= 2)
+            for (int t = 0; t + stride < n; t += 2 * stride)
+            {
+                float* dst = src[t];
+                const float* add = src[t + stride];
+                for (int i=0; i < blockFloats; i++)
+                    dst[i] += add[i];
+            }
+
+            // Last block may be partial.
+            int numFloats = std::min(AA_CPU_GRAD_BLOCK_VERTICES, numGradVertices - b * AA_CPU_GRAD_BLOCK_VERTICES) * 4;
+            memcpy(p.gradPos + (size_t)b * blockFloats, src[0], numFloats * sizeof(float));
+        }
+    });
+
+    // Sum the transform gradients.
+    if (p.mtx)
+        for (int t=0; t < numThreads; t++)
+            for (int i=0; i < 16 * p.n; i++)
+                p.gradMtx[i] += accums[t].mtxData[i];
+}
+
+//------------------------------------------------------------------------
@@ -7,24 +7,129 @@
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #pragma once
-#if (defined(USE_HIP) || defined(USE_ROCM))
+#if defined(NVDR_CPU_ONLY)
+// Builds without Cuda only compile the CPU code paths.
+#elif (defined(USE_HIP) || defined(USE_ROCM))
 #include <hip/hip_runtime.h>
 #include <hip/hip_cooperative_groups.h>
 #else
 #include <cuda.h>
 #endif
 #include <stdint.h>
+#include <string.h>
+#include <math.h>
 
 //------------------------------------------------------------------------
 // C++ helper function prototypes.
 
+#ifndef NVDR_CPU_ONLY
 dim3 getLaunchBlockSize(int maxWidth, int maxHeight, int width, int height);
 dim3 getLaunchGridSize(dim3 blockSize, int width, int height, int depth);
+#else
+// Vector types that appear in kernel parameter structs.
+struct int4  { int x, y, z, w; };
+struct uint4 { unsigned int x, y, z, w; };
+#endif
+
+//------------------------------------------------------------------------
+// Host versions of the triangle index conversions for the CPU code paths.
+
+static inline int   float_to_triidx_host(float x) { if (x <= 16777216.f) return (int)x;   int i; memcpy(&i, &x, 4); return i - 0x4a800000; }
+static inline float triidx_to_float_host(int x)   { if (x <= 0x01000000) return (float)x; float f; x += 0x4a800000; memcpy(&f, &x, 4); return f; }
+
+//------------------------------------------------------------------------
+// Triangle vertex index fetch for the CPU code paths. Index buffers hold
+// int32 or uint16 values. The Cuda kernels are templated on the type.
+
+static inline int tri_index_host(const void* tri, int u16, int i) { return u16 ? (int)((const unsigned short*)tri)[i] : ((const int*)tri)[i]; }
+
+//------------------------------------------------------------------------
+// Storage types for attribute, texture and color data. All arithmetic is
+// done in fp32, half precision types only affect loads and stores. The
+// Cuda kernels are templated on the type, the CPU code paths work on fp32
+// copies and use storage_round_host() where the kernels store.
+
+#define NVDR_STORAGE_F32    0
+#define NVDR_STORAGE_F16    1
+#define NVDR_STORAGE_BF16   2
+
+static inline float half_to_float_host(unsigned short h)
+{
+    unsigned int e = (h >> 10) & 0x1f;
+    unsigned int m = h & 0x3ff;
+    if (!e)
+        return ldexpf((float)m, -24) * ((h & 0x8000) ? -1.f : 1.f); // Zero or subnormal.
+    unsigned int x = ((h & 0x8000u) << 16) | ((e == 31) ? (0x7f800000u | (m << 13)) : (((e + 112) << 23) | (m << 13)));
+    float f; memcpy(&f, &x, 4); return f;
+}
+
+static inline unsigned short float_to_half_host(float f) // Round to nearest even.
+{
+    unsigned int x; memcpy(&x, &f, 4);
+    unsigned int sign = (x >> 16) & 0x8000u;
+    x &= 0x7fffffffu;
+    if (x >= 0x47800000u) // Overflow, inf or nan.
+        return sign | ((x > 0x7f800000u) ? 0x7e00u : 0x7c00u);
+    if (x < 0x38800000u) // Result is subnormal, let the fp32 adder round.
+    {
+        float a; memcpy(&a, &x, 4);
+        a += 0.5f;
+        memcpy(&x, &a, 4);
+        return sign | (x - 0x3f000000u);
+    }
+    x += 0xc8000fffu + ((x >> 13) & 1); // Rebias exponent and round.
+    return sign | (x >> 13);
+}
+
+static inline float storage_round_host(float x, int type)
+{
+    if (type == NVDR_STORAGE_F16)
+        return half_to_float_host(float_to_half_host(x));
+    if (type == NVDR_STORAGE_BF16)
+    {
+        unsigned int u; memcpy(&u, &x, 4);
+        if ((u & 0x7fffffffu) > 0x7f800000u)
+            return x; // Keep nan.
+        u = (u + 0x7fffu + ((u >> 16) & 1)) & 0xffff0000u;
+        memcpy(&x, &u, 4);
+    }
+    return x;
+}
+
+//------------------------------------------------------------------------
+// Per-image vertex transforms. Matrices are row-major 4x4, one per image,
+// and take shared positions to clip space as M * v. The multiply-adds are
+// spelled out so that the CPU and GPU code paths agree bit for bit. The
+// gradient version applies the transpose to a clip-space gradient whose z
+// component is zero, as it always is for the rasterizer and antialiasing.
+
+static inline void xfm_pos_host(const float* m, const float* v, float* out)
+{
+    float r[4];
+    for (int i=0; i < 4; i++)
+        r[i] = fmaf(m[4*i+0], v[0], fmaf(m[4*i+1], v[1], fmaf(m[4*i+2], v[2], m[4*i+3] * v[3])));
+    memcpy(out, r, sizeof(r));
+}
+
+static inline void xfm_grad_t_host(const float* m, float gx, float gy, float gw, float* out)
+{
+    for (int i=0; i < 4; i++)
+        out[i] = gx * m[i] + gy * m[4+i] + gw * m[12+i];
+}
 
 //------------------------------------------------------------------------
 // The rest is CUDA device code specific stuff.
 
 #if (defined(__CUDACC__) || defined(USE_HIP))
+#if (defined(USE_HIP) || defined(USE_ROCM))
+#include <hip/hip_fp16.h>
+#include <hip/hip_bf16.h>
+typedef __hip_bfloat16 nvdr_bfloat16;
+#else
+#include <cuda_fp16.h>
+#include <cuda_bf16.h>
+typedef __nv_bfloat16 nvdr_bfloat16;
+#endif
 
 //------------------------------------------------------------------------
 // Helpers for CUDA vector types.
@@ -187,6 +292,53 @@ static __device__ __forceinline__ uint4 make_uint4(const uint2& a, const uint2&
 
 template<class T> static __device__ __forceinline__ void swap(T& a, T& b)                  { T temp = a; a = b; b = temp; }
 
+//------------------------------------------------------------------------
+// Storage type conversions and loads/stores, see NVDR_STORAGE_*. Vector
+// variants move 1, 2 or 4 consecutive values with a single access.
+
+static __device__ __forceinline__ float storage_to_float(float x)                          { return x; }
+static __device__ __forceinline__ float storage_to_float(__half x)                         { return __half2float(x); }
+static __device__ __forceinline__ float storage_to_float(nvdr_bfloat16 x)                  { return __bfloat162float(x); }
+template<class S> static __device__ __forceinline__ S float_to_storage(float x);
+template<> __device__ __forceinline__ float         float_to_storage<float>        (float x) { return x; }
+template<> __device__ __forceinline__ __half        float_to_storage<__half>       (float x) { return __float2half_rn(x); }
+template<> __device__ __forceinline__ nvdr_bfloat16 float_to_storage<nvdr_bfloat16>(float x) { return __float2bfloat16(x); }
+
+template<class S> struct __align__(4) nvdr_storage2 { S x, y; };
+template<class S> struct __align__(8) nvdr_storage4 { S x, y, z, w; };
+
+static __device__ __forceinline__ void load_storage(float&  a, const float* p)             { a = *p; }
+static __device__ __forceinline__ void load_storage(float2& a, const float* p)             { a = *(const float2*)p; }
+static __device__ __forceinline__ void load_storage(float4& a, const float* p)             { a = *(const float4*)p; }
+static __device__ __forceinline__ void store_storage(float* p, const float&  a)            { *p = a; }
+static __device__ __forceinline__ void store_storage(float* p, const float2& a)            { *(float2*)p = a; }
+static __device__ __forceinline__ void store_storage(float* p, const float4& a)            { *(float4*)p = a; }
+template<class S> static __device__ __forceinline__ void load_storage(float&  a, const S* p) { a = storage_to_float(*p); }
+template<class S> static __device__ __forceinline__ void load_storage(float2& a, const S* p) { nvdr_storage2<S> v = *(const nvdr_storage2<S>*)p; a = make_float2(storage_to_float(v.x), storage_to_float(v.y)); }
+template<class S> static __device__ __forceinline__ void load_storage(float4& a, const S* p) { nvdr_storage4<S> v = *(const nvdr_storage4<S>*)p; a = make_float4(storage_to_float(v.x), storage_to_float(v.y), storage_to_float(v.z), storage_to_float(v.w)); }
+template<class S> static __device__ __forceinline__ void store_storage(S* p, const float&  a) { *p = float_to_storage<S>(a); }
+template<class S> static __device__ __forceinline__ void store_storage(S* p, const float2& a) { nvdr_storage2<S> v; v.x = float_to_storage<S>(a.x); v.y = float_to_storage<S>(a.y); *(nvdr_storage2<S>*)p = v; }
+template<class S> static __device__ __forceinline__ void store_storage(S* p, const float4& a) { nvdr_storage4<S> v; v.x = float_to_storage<S>(a.x); v.y = float_to_storage<S>(a.y); v.z = float_to_storage<S>(a.z); v.w = float_to_storage<S>(a.w); *(nvdr_storage4<S>*)p = v; }
+
+//------------------------------------------------------------------------
+// Device versions of the per-image vertex transforms, see xfm_pos_host().
+
+static __device__ __forceinline__ float4 xfm_pos(const float* m, float4 v)
+{
+    float4 r0 = ((const float4*)m)[0], r1 = ((const float4*)m)[1], r2 = ((const float4*)m)[2], r3 = ((const float4*)m)[3];
+    return make_float4(
+        fmaf(r0.x, v.x, fmaf(r0.y, v.y, fmaf(r0.z, v.z, r0.w * v.w))),
+        fmaf(r1.x, v.x, fmaf(r1.y, v.y, fmaf(r1.z, v.z, r1.w * v.w))),
+        fmaf(r2.x, v.x, fmaf(r2.y, v.y, fmaf(r2.z, v.z, r2.w * v.w))),
+        fmaf(r3.x, v.x, fmaf(r3.y, v.y, fmaf(r3.z, v.z, r3.w * v.w))));
+}
+
+static __device__ __forceinline__ float4 xfm_grad_t(const float* m, float gx, float gy, float gw)
+{
+    float4 r0 = ((const float4*)m)[0], r1 = ((const float4*)m)[1], r3 = ((const float4*)m)[3];
+    return gx * r0 + gy * r1 + gw * r3;
+}
+
 //------------------------------------------------------------------------
 // Triangle ID <-> float32 conversion functions to support very large triangle IDs.
 //
@@ -315,6 +467,15 @@ static __device__ __forceinline__ float triidx_to_float(int x)   { if (x <= 0x01
         caAtomicAdd((ptr)+3, (w));      \
     } while(0)
 
+#define caAtomicAdd4(ptr, v)            \
+    do {                                \
+        float4 _ca_v = (v);             \
+        caAtomicAdd((ptr), _ca_v.x);    \
+        caAtomicAdd((ptr)+1, _ca_v.y);  \
+        caAtomicAdd((ptr)+2, _ca_v.z);  \
+        caAtomicAdd((ptr)+3, _ca_v.w);  \
+    } while(0)
+
 #define caAtomicAddTexture(ptr, level, idx, value, warp_size)  \
     do {                                            \
         CA_SET_GROUP((idx) ^ ((level) << 27), warp_size);      \
@@ -337,6 +498,14 @@ static __device__ __forceinline__ float triidx_to_float(int x)   { if (x <= 0x01
         atomicAdd((ptr)+1, (y));        \
         atomicAdd((ptr)+3, (w));        \
     } while(0)
+#define caAtomicAdd4(ptr, v)            \
+    do {                                \
+        float4 _ca_v = (v);             \
+        atomicAdd((ptr), _ca_v.x);      \
+        atomicAdd((ptr)+1, _ca_v.y);    \
+        atomicAdd((ptr)+2, _ca_v.z);    \
+        atomicAdd((ptr)+3, _ca_v.w);    \
+    } while(0)
 #define caAtomicAddTexture(ptr, level, idx, value) atomicAdd((ptr)+(idx), (value))
 #endif // __CUDA_ARCH__ >= 700
 
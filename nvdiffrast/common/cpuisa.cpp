@@ -0,0 +1,55 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "cpuisa.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------
+// CPUID based detection, including OS support for the register state.
+
+static CpuIsa detectCpuIsa(void)
+{
+#if NVDR_CPU_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return CpuIsa_Scalar;
+    __cpuid(info, 1);
+    bool fma     = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave)
+        return CpuIsa_Scalar;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    bool avx2    = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+    if (avx512f && (xcr0 & 0xE6) == 0xE6) // XMM, YMM, opmask and ZMM state enabled by the OS.
+        return CpuIsa_AVX512;
+    if (avx2 && fma && (xcr0 & 0x06) == 0x06)
+        return CpuIsa_AVX2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return CpuIsa_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return CpuIsa_AVX2;
+#endif
+#endif
+    return CpuIsa_Scalar;
+}
+
+CpuIsa getCpuIsa(void)
+{
+    static const CpuIsa s_isa = detectCpuIsa();
+    return s_isa;
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,41 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+
+//------------------------------------------------------------------------
+// Instruction set selection for the CPU code paths. SIMD variants are
+// compiled with per-function target attributes, so that the plugin builds
+// with default compiler flags, and are picked at runtime with getCpuIsa().
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NVDR_CPU_X86 1
+#include <immintrin.h>
+#else
+#define NVDR_CPU_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define NVDR_CPU_TARGET(ISA)
+#else
+#define NVDR_CPU_TARGET(ISA) __attribute__((target(ISA)))
+#endif
+
+#define NVDR_CPU_AVX2   NVDR_CPU_TARGET("avx2,fma")
+#define NVDR_CPU_AVX512 NVDR_CPU_TARGET("avx512f")
+
+enum CpuIsa
+{
+    CpuIsa_Scalar = 0,
+    CpuIsa_AVX2,                    // AVX2 + FMA.
+    CpuIsa_AVX512,                  // AVX-512F.
+};
+
+CpuIsa getCpuIsa(void);             // Best instruction set supported by the CPU and the OS.
+
+//------------------------------------------------------------------------
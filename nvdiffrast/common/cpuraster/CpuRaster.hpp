@@ -0,0 +1,96 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include <cstddef>
+
+//------------------------------------------------------------------------
+// Multi-threaded CPU counterpart of CudaRaster. The pipeline follows the
+// same setup -> bin -> coarse -> fine structure and uses the same fixed-
+// point snapping, depth plane equations and 8x8 coverage masks, so that
+// the color (triangle id) and depth buffers match CudaRaster bit for bit.
+// Bins are the unit of parallel work in the coarse and fine stages, which
+// makes every pixel owned by exactly one worker and removes the need for
+// atomics in the raster operations.
+//------------------------------------------------------------------------
+
+class ThreadPool;
+
+namespace CR
+{
+
+class CpuRasterImpl;
+
+//------------------------------------------------------------------------
+// Interface class to isolate user from implementation details.
+//------------------------------------------------------------------------
+
+class CpuRaster
+{
+public:
+    enum
+    {
+        RenderModeFlag_EnableBackfaceCulling = 1 << 0,   // Enable backface culling.
+        RenderModeFlag_EnableDepthPeeling    = 1 << 1,   // Enable depth peeling. Must have a peel buffer set.
+        RenderModeFlag_EnableFrontfaceCulling = 1 << 2,  // Enable frontface culling.
+    };
+
+    enum
+    {
+        IndexType_Int32     = 0,    // Triangle indices as int3.
+        IndexType_UInt16,           // Triangle indices as ushort3.
+    };
+
+    // Per-image counters in terms of the equivalent CudaRaster structures: subtriangles that survive setup,
+    // and the bin and tile segments needed to hold the triangle lists. Summed over the draws since the last
+    // reset, excluding peeling iterations that reuse earlier results. Storage grows on demand, so there are
+    // no capacities or retries to report and those fields are zero.
+
+    struct ImageStats
+    {
+        long long           numSubtris;
+        long long           numBinSegs;
+        long long           numTileSegs;
+        long long           numActiveTiles;
+        int                 numRetries;
+        int                 maxSubtris;
+        int                 maxBinSegs;
+        int                 maxTileSegs;
+    };
+
+public:
+                            CpuRaster               (int numThreads);                                   // Zero = use the global thread pool.
+                            ~CpuRaster              (void);
+
+    void                    setBufferSize           (int width, int height, int numImages);              // Width and height are internally rounded up to multiples of tile size (8x8) for buffer sizes.
+    void                    setViewport             (int width, int height, int offsetX, int offsetY);   // Tiled rendering viewport setup.
+    void                    setRenderModeFlags      (unsigned int renderModeFlags);                      // Affects all subsequent calls to drawTriangles(). Defaults to zero.
+    void                    setMinTriangleArea      (float pixels);                                      // Cull triangles whose snapped area is below this many pixels. Triangles that need clipping are kept. Defaults to zero.
+    void                    deferredClear           (unsigned int clearColor);                           // Clears color and depth buffers during next call to drawTriangles().
+    void                    setVertexBuffer         (const void* vertices, int numVertices);             // CPU pointer managed by caller. Vertex positions in clip space as float4 (x, y, z, w).
+    void                    setIndexBuffer          (const void* indices, int numTriangles, int indexType = IndexType_Int32); // CPU pointer managed by caller. Triangle indices (idx0, idx1, idx2) in the format given by IndexType_*.
+    void                    setVertexTransforms     (const void* matrices);                              // CPU pointer managed by caller, or NULL. In instance mode, one row-major 4x4 float matrix per image that transforms the vertex buffer, which is then shared by all images.
+    bool                    drawTriangles           (const int* ranges, bool peel);                      // Ranges (offsets and counts) as #triangles entries, not as bytes. If NULL, draw all triangles.
+    void*                   getColorBuffer          (void);                                              // CPU pointer managed by CpuRaster.
+    void*                   getDepthBuffer          (void);                                              // CPU pointer managed by CpuRaster.
+    void                    swapDepthAndPeel        (void);                                              // Swap depth and peeling buffers.
+    ThreadPool&             getThreadPool           (void);                                              // Pool used by the pipeline, also available for shading passes.
+    int                     getImageStats           (ImageStats* stats, int maxImages) const;            // Fills up to maxImages entries, returns the number of images of the current buffer size.
+    void                    resetImageStats         (void);
+    size_t                  getBufferBytes          (void) const;                                        // Bytes allocated for internal buffers.
+
+private:
+                            CpuRaster               (const CpuRaster&); // forbidden
+    CpuRaster&              operator=               (const CpuRaster&); // forbidden
+
+private:
+    CpuRasterImpl*          m_impl;                 // Opaque pointer to implementation.
+};
+
+//------------------------------------------------------------------------
+} // namespace CR
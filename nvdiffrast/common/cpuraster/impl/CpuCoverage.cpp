@@ -0,0 +1,403 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "CpuCoverage.hpp"
+#include "CpuUtil.inl"
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Scalar fallback.
+//------------------------------------------------------------------------
+
+static void trianglePixelCoverage_scalar(U64* coverage, const CRTriangleHeader* headers, int numTris, int tileX, int tileY, int widthPixelsVp, int heightPixelsVp)
+{
+    const U64* lut = cover8x8_getLUT();
+    for (int i=0; i < numTris; i++)
+        coverage[i] = trianglePixelCoverage(headers[i], tileX, tileY, widthPixelsVp, heightPixelsVp, lut);
+}
+
+#if NVDR_CPU_X86
+
+//------------------------------------------------------------------------
+// AVX2 + FMA, 8 triangles per iteration. Follows cover8x8_exact_fast()
+// and cover8x8_lookupMask() operation by operation: slct() becomes a
+// blend on the sign bit, the 64-bit yinit is kept as lo/hi lanes, and the
+// final mask lookups are 64-bit gathers.
+//------------------------------------------------------------------------
+
+NVDR_CPU_AVX2 static inline __m256i slct_avx2(__m256i a, __m256i b, __m256i c)
+{
+    return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _mm256_castsi256_ps(c)));
+}
+
+NVDR_CPU_AVX2 static inline __m256i s16lo_avx2(__m256i a) { return _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16); }
+NVDR_CPU_AVX2 static inline __m256i s16hi_avx2(__m256i a) { return _mm256_srai_epi32(a, 16); }
+
+NVDR_CPU_AVX2 static inline void add_add_carry_avx2(__m256i& yfrac, __m256i yinc, __m256i& shape)
+{
+    __m256i sign  = _mm256_set1_epi32((int)0x80000000u);
+    __m256i sum   = _mm256_add_epi32(yfrac, yinc);
+    __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(yfrac, sign), _mm256_xor_si256(sum, sign)); // Unsigned sum < yfrac.
+    shape = _mm256_sub_epi32(_mm256_add_epi32(shape, shape), carry);
+    yfrac = sum;
+}
+
+NVDR_CPU_AVX2 static inline __m256i f32_to_u32_sat_avx2(__m256 a)
+{
+    __m256  two31 = _mm256_set1_ps(2147483648.0f);
+    __m256  r     = _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256  big   = _mm256_cmp_ps(r, two31, _CMP_GE_OQ);
+    __m256i v     = _mm256_cvttps_epi32(_mm256_sub_ps(r, _mm256_and_ps(big, two31)));
+    v = _mm256_xor_si256(v, _mm256_and_si256(_mm256_castps_si256(big), _mm256_set1_epi32((int)0x80000000u)));
+    v = _mm256_or_si256(v, _mm256_castps_si256(_mm256_cmp_ps(a, _mm256_set1_ps(4294967296.0f), _CMP_GE_OQ)));
+    return _mm256_andnot_si256(_mm256_castps_si256(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NGT_UQ)), v); // NaN or <= 0.
+}
+
+NVDR_CPU_AVX2 static inline void f32_to_s64_half_avx2(__m128i& lo, __m128i& hi, __m128 a)
+{
+    // Through doubles: every float is exact, and so are both 32-bit halves.
+    __m256d r  = _mm256_round_pd(_mm256_cvtps_pd(a), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d hd = _mm256_floor_pd(_mm256_mul_pd(r, _mm256_set1_pd(1.0 / 4294967296.0)));
+    __m256d ld = _mm256_fnmadd_pd(hd, _mm256_set1_pd(4294967296.0), r);
+    hi = _mm256_cvttpd_epi32(hd);
+    lo = _mm_xor_si128(_mm256_cvttpd_epi32(_mm256_sub_pd(ld, _mm256_set1_pd(2147483648.0))), _mm_set1_epi32((int)0x80000000u));
+}
+
+NVDR_CPU_AVX2 static inline void f32_to_s64_avx2(__m256i& lo, __m256i& hi, __m256 a)
+{
+    __m128i l0, h0, l1, h1;
+    f32_to_s64_half_avx2(l0, h0, _mm256_castps256_ps128(a));
+    f32_to_s64_half_avx2(l1, h1, _mm256_extractf128_ps(a, 1));
+    lo = _mm256_inserti128_si256(_mm256_castsi128_si256(l0), l1, 1);
+    hi = _mm256_inserti128_si256(_mm256_castsi128_si256(h0), h1, 1);
+
+    // Saturate and zero NaNs.
+    __m256i big   = _mm256_castps_si256(_mm256_cmp_ps(a, _mm256_set1_ps( 9223372036854775808.0f), _CMP_GE_OQ));
+    __m256i small = _mm256_castps_si256(_mm256_cmp_ps(a, _mm256_set1_ps(-9223372036854775808.0f), _CMP_LE_OQ));
+    __m256i nan   = _mm256_castps_si256(_mm256_cmp_ps(a, a, _CMP_UNORD_Q));
+    hi = slct_avx2(hi, _mm256_set1_epi32(0x7fffffff), big);
+    lo = _mm256_or_si256(lo, big);
+    hi = slct_avx2(hi, _mm256_set1_epi32((int)0x80000000u), small);
+    lo = _mm256_andnot_si256(small, lo);
+    hi = _mm256_andnot_si256(nan, hi);
+    lo = _mm256_andnot_si256(nan, lo);
+}
+
+NVDR_CPU_AVX2 static inline void cover8x8_exact_fast_avx2(__m256i* mask, __m256i ox, __m256i oy, __m256i dx, __m256i dy, __m256i flips, const U64* lut)
+{
+    F32  yinitBias  = (F32)(1 << (31 - CR_MAXVIEWPORT_LOG2 - CR_SUBPIXEL_LOG2 * 2));
+    F32  yinitScale = (F32)(1 << (32 - CR_SUBPIXEL_LOG2));
+    F32  yincScale  = 65536.0f * 65536.0f;
+
+    __m256i slctFlipY  = _mm256_slli_epi32(flips, 31 - CR_FLIPBIT_FLIP_Y);
+    __m256i slctFlipX  = _mm256_slli_epi32(flips, 31 - CR_FLIPBIT_FLIP_X);
+    __m256i slctSwapXY = _mm256_slli_epi32(flips, 31 - CR_FLIPBIT_SWAP_XY);
+    __m256i complMask  = _mm256_cmpgt_epi32(flips, _mm256_set1_epi32((1 << CR_FLIPBIT_COMPL) - 1));
+    __m256i sign       = _mm256_set1_epi32((int)0x80000000u);
+
+    // Evaluate cross product.
+
+    __m256i t   = _mm256_sub_epi32(_mm256_mullo_epi32(ox, dy), _mm256_mullo_epi32(oy, dx));
+    __m256i tx  = _mm256_sub_epi32(t, _mm256_mullo_epi32(dy, _mm256_set1_epi32(7 << CR_SUBPIXEL_LOG2)));
+    __m256  det = _mm256_cvtepi32_ps(slct_avx2(t, tx, slctFlipX));
+    det = _mm256_xor_ps(det, _mm256_castsi256_ps(_mm256_and_si256(complMask, sign)));
+
+    // Represent Y as a function of X.
+
+    __m256  xrcp  = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_cvtepi32_ps(_mm256_abs_epi32(slct_avx2(dx, dy, slctSwapXY))));
+    __m256  yzero = _mm256_fmadd_ps(_mm256_mul_ps(det, _mm256_set1_ps(yinitScale)), xrcp, _mm256_set1_ps(yinitBias));
+    yzero = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_castps_si256(yzero), _mm256_and_si256(_mm256_srai_epi32(slctFlipY, 31), sign)));
+    __m256i yfrac, yhi;
+    f32_to_s64_avx2(yfrac, yhi, yzero);
+    __m256i yinc = f32_to_u32_sat_avx2(_mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_abs_epi32(slct_avx2(dy, dx, slctSwapXY))), xrcp), _mm256_set1_ps(yincScale)));
+
+    // First half.
+
+    __m256i yhi4  = _mm256_add_epi32(yhi, _mm256_set1_epi32(4));
+    __m256i shape = _mm256_min_epi32(_mm256_max_epi32(yhi4, _mm256_setzero_si256()), _mm256_set1_epi32(11));
+    add_add_carry_avx2(yfrac, yinc, shape);
+    add_add_carry_avx2(yfrac, yinc, shape);
+    add_add_carry_avx2(yfrac, yinc, shape);
+    __m256i oct = _mm256_and_si256(_mm256_srli_epi32(flips, CR_FLIPBIT_FLIP_X), _mm256_set1_epi32(3));
+    __m256i idx = _mm256_add_epi32(oct, _mm256_slli_epi32(shape, 2));
+    __m256i m0  = _mm256_i32gather_epi64((const long long*)lut, _mm256_castsi256_si128(idx), 8);
+    __m256i m1  = _mm256_i32gather_epi64((const long long*)lut, _mm256_extracti128_si256(idx, 1), 8);
+
+    // Second half. The clamp to [-8, 11] before adding the 0..4 bit count
+    // keeps the 32-bit sum from wrapping, as the 64-bit sum does not either.
+
+    add_add_carry_avx2(yfrac, yinc, shape);
+    __m256i s = _mm256_and_si256(shape, _mm256_set1_epi32(15));
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i popc = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(s, one), _mm256_and_si256(_mm256_srli_epi32(s, 1), one)),
+                                    _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(s, 2), one), _mm256_srli_epi32(s, 3)));
+    shape = _mm256_add_epi32(_mm256_min_epi32(_mm256_max_epi32(yhi4, _mm256_set1_epi32(-8)), _mm256_set1_epi32(11)), popc);
+    shape = _mm256_min_epi32(_mm256_max_epi32(shape, _mm256_setzero_si256()), _mm256_set1_epi32(11));
+    add_add_carry_avx2(yfrac, yinc, shape);
+    add_add_carry_avx2(yfrac, yinc, shape);
+    add_add_carry_avx2(yfrac, yinc, shape);
+    idx = _mm256_add_epi32(_mm256_add_epi32(oct, _mm256_slli_epi32(shape, 2)), _mm256_set1_epi32(12 << 5));
+    m0 = _mm256_or_si256(m0, _mm256_i32gather_epi64((const long long*)lut, _mm256_castsi256_si128(idx), 8));
+    m1 = _mm256_or_si256(m1, _mm256_i32gather_epi64((const long long*)lut, _mm256_extracti128_si256(idx, 1), 8));
+
+    // Complement.
+
+    mask[0] = _mm256_xor_si256(m0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(complMask)));
+    mask[1] = _mm256_xor_si256(m1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(complMask, 1)));
+}
+
+NVDR_CPU_AVX2 static void trianglePixelCoverage_avx2(U64* coverage, const CRTriangleHeader* headers, int numTris, int tileX, int tileY, int widthPixelsVp, int heightPixelsVp)
+{
+    const U64* lut = cover8x8_getLUT();
+    const int* base = (const int*)headers;
+
+    int baseX = (tileX << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((widthPixelsVp  - 1) << (CR_SUBPIXEL_LOG2 - 1));
+    int baseY = (tileY << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((heightPixelsVp - 1) << (CR_SUBPIXEL_LOG2 - 1));
+    __m256i bx = _mm256_set1_epi32((S16)baseX);
+    __m256i by = _mm256_set1_epi32((S16)baseY);
+
+    for (int i=0; i < numTris; i += 8)
+    {
+        // Gather header words. Lanes past the end repeat the last triangle.
+        __m256i lane = _mm256_min_epi32(_mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(i)), _mm256_set1_epi32(numTris - 1));
+        __m256i ofs  = _mm256_slli_epi32(lane, 2);
+        __m256i hx   = _mm256_i32gather_epi32(base + 0, ofs, 4);
+        __m256i hy   = _mm256_i32gather_epi32(base + 1, ofs, 4);
+        __m256i hz   = _mm256_i32gather_epi32(base + 2, ofs, 4);
+        __m256i hw   = _mm256_i32gather_epi32(base + 3, ofs, 4);
+
+        // Extract S16 vertex positions while subtracting tile coordinates.
+        __m256i v0x  = _mm256_sub_epi32(s16lo_avx2(hx), bx);
+        __m256i v0y  = _mm256_sub_epi32(s16hi_avx2(hx), by);
+        __m256i v01x = _mm256_sub_epi32(s16lo_avx2(hy), s16lo_avx2(hx));
+        __m256i v01y = _mm256_sub_epi32(s16hi_avx2(hy), s16hi_avx2(hx));
+        __m256i v20x = _mm256_sub_epi32(s16lo_avx2(hx), s16lo_avx2(hz));
+        __m256i v20y = _mm256_sub_epi32(s16hi_avx2(hx), s16hi_avx2(hz));
+
+        // Extract flipbits.
+        __m256i f3c = _mm256_set1_epi32(0x3C);
+        __m256i f01 = _mm256_and_si256(_mm256_srli_epi32(hw, 6), f3c);
+        __m256i f12 = _mm256_and_si256(_mm256_srli_epi32(hw, 2), f3c);
+        __m256i f20 = _mm256_and_si256(_mm256_slli_epi32(hw, 2), f3c);
+
+        // Compute per-edge coverage masks and combine.
+        __m256i c01[2], c12[2], c20[2];
+        cover8x8_exact_fast_avx2(c01, v0x, v0y, v01x, v01y, f01, lut);
+        cover8x8_exact_fast_avx2(c12, _mm256_add_epi32(v0x, v01x), _mm256_add_epi32(v0y, v01y),
+                                 _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_add_epi32(v01x, v20x)),
+                                 _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_add_epi32(v01y, v20y)), f12, lut);
+        cover8x8_exact_fast_avx2(c20, v0x, v0y, v20x, v20y, f20, lut);
+
+        U64 result[8];
+        _mm256_storeu_si256((__m256i*)(result + 0), _mm256_and_si256(_mm256_and_si256(c01[0], c12[0]), c20[0]));
+        _mm256_storeu_si256((__m256i*)(result + 4), _mm256_and_si256(_mm256_and_si256(c01[1], c12[1]), c20[1]));
+        memcpy(coverage + i, result, std::min(numTris - i, 8) * sizeof(U64));
+    }
+}
+
+//------------------------------------------------------------------------
+// AVX-512F, 16 triangles per iteration. Same steps as the AVX2 version,
+// with mask registers in place of the sign-bit selects.
+//------------------------------------------------------------------------
+
+// GCC 12 fills the pass-through operand of the unmasked intrinsics with a
+// self-initialized variable (_mm512_undefined_*) and warns about it once
+// inlined here. The operand is never read.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+NVDR_CPU_AVX512 static inline __m512i s16lo_avx512(__m512i a) { return _mm512_srai_epi32(_mm512_slli_epi32(a, 16), 16); }
+NVDR_CPU_AVX512 static inline __m512i s16hi_avx512(__m512i a) { return _mm512_srai_epi32(a, 16); }
+
+NVDR_CPU_AVX512 static inline void add_add_carry_avx512(__m512i& yfrac, __m512i yinc, __m512i& shape)
+{
+    __m512i sum   = _mm512_add_epi32(yfrac, yinc);
+    __mmask16 carry = _mm512_cmplt_epu32_mask(sum, yfrac);
+    shape = _mm512_add_epi32(shape, shape);
+    shape = _mm512_mask_add_epi32(shape, carry, shape, _mm512_set1_epi32(1));
+    yfrac = sum;
+}
+
+NVDR_CPU_AVX512 static inline __m512i f32_to_u32_sat_avx512(__m512 a)
+{
+    __m512    two31 = _mm512_set1_ps(2147483648.0f);
+    __m512    r     = _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __mmask16 big   = _mm512_cmp_ps_mask(r, two31, _CMP_GE_OQ);
+    __m512i   v     = _mm512_cvttps_epi32(_mm512_mask_sub_ps(r, big, r, two31));
+    v = _mm512_mask_xor_epi32(v, big, v, _mm512_set1_epi32((int)0x80000000u));
+    v = _mm512_mask_mov_epi32(v, _mm512_cmp_ps_mask(a, _mm512_set1_ps(4294967296.0f), _CMP_GE_OQ), _mm512_set1_epi32(-1));
+    return _mm512_maskz_mov_epi32(_mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_GT_OQ), v); // Zero if NaN or <= 0.
+}
+
+NVDR_CPU_AVX512 static inline void f32_to_s64_half_avx512(__m256i& lo, __m256i& hi, __m256 a)
+{
+    __m512d r  = _mm512_roundscale_pd(_mm512_cvtps_pd(a), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d hd = _mm512_roundscale_pd(_mm512_mul_pd(r, _mm512_set1_pd(1.0 / 4294967296.0)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    __m512d ld = _mm512_fnmadd_pd(hd, _mm512_set1_pd(4294967296.0), r);
+    hi = _mm512_cvttpd_epi32(hd);
+    lo = _mm256_xor_si256(_mm512_cvttpd_epi32(_mm512_sub_pd(ld, _mm512_set1_pd(2147483648.0))), _mm256_set1_epi32((int)0x80000000u));
+}
+
+NVDR_CPU_AVX512 static inline void f32_to_s64_avx512(__m512i& lo, __m512i& hi, __m512 a)
+{
+    __m256i l0, h0, l1, h1;
+    f32_to_s64_half_avx512(l0, h0, _mm512_castps512_ps256(a));
+    f32_to_s64_half_avx512(l1, h1, _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1)));
+    lo = _mm512_inserti64x4(_mm512_castsi256_si512(l0), l1, 1);
+    hi = _mm512_inserti64x4(_mm512_castsi256_si512(h0), h1, 1);
+
+    // Saturate and zero NaNs.
+    __mmask16 big   = _mm512_cmp_ps_mask(a, _mm512_set1_ps( 9223372036854775808.0f), _CMP_GE_OQ);
+    __mmask16 small = _mm512_cmp_ps_mask(a, _mm512_set1_ps(-9223372036854775808.0f), _CMP_LE_OQ);
+    __mmask16 valid = _mm512_cmp_ps_mask(a, a, _CMP_ORD_Q);
+    hi = _mm512_mask_mov_epi32(hi, big,   _mm512_set1_epi32(0x7fffffff));
+    lo = _mm512_mask_mov_epi32(lo, big,   _mm512_set1_epi32(-1));
+    hi = _mm512_mask_mov_epi32(hi, small, _mm512_set1_epi32((int)0x80000000u));
+    lo = _mm512_mask_mov_epi32(lo, small, _mm512_setzero_si512());
+    hi = _mm512_maskz_mov_epi32(valid, hi);
+    lo = _mm512_maskz_mov_epi32(valid, lo);
+}
+
+NVDR_CPU_AVX512 static inline void cover8x8_exact_fast_avx512(__m512i* mask, __m512i ox, __m512i oy, __m512i dx, __m512i dy, __m512i flips, const U64* lut)
+{
+    F32  yinitBias  = (F32)(1 << (31 - CR_MAXVIEWPORT_LOG2 - CR_SUBPIXEL_LOG2 * 2));
+    F32  yinitScale = (F32)(1 << (32 - CR_SUBPIXEL_LOG2));
+    F32  yincScale  = 65536.0f * 65536.0f;
+
+    __mmask16 slctFlipY  = _mm512_test_epi32_mask(flips, _mm512_set1_epi32(1 << CR_FLIPBIT_FLIP_Y));
+    __mmask16 slctFlipX  = _mm512_test_epi32_mask(flips, _mm512_set1_epi32(1 << CR_FLIPBIT_FLIP_X));
+    __mmask16 slctSwapXY = _mm512_test_epi32_mask(flips, _mm512_set1_epi32(1 << CR_FLIPBIT_SWAP_XY));
+    __mmask16 complMask  = _mm512_test_epi32_mask(flips, _mm512_set1_epi32(~((1 << CR_FLIPBIT_COMPL) - 1)));
+    __m512i   sign       = _mm512_set1_epi32((int)0x80000000u);
+
+    // Evaluate cross product.
+
+    __m512i t   = _mm512_sub_epi32(_mm512_mullo_epi32(ox, dy), _mm512_mullo_epi32(oy, dx));
+    __m512i tx  = _mm512_sub_epi32(t, _mm512_mullo_epi32(dy, _mm512_set1_epi32(7 << CR_SUBPIXEL_LOG2)));
+    __m512i det = _mm512_castps_si512(_mm512_cvtepi32_ps(_mm512_mask_blend_epi32(slctFlipX, t, tx)));
+    det = _mm512_mask_xor_epi32(det, complMask, det, sign);
+
+    // Represent Y as a function of X.
+
+    __m512  xrcp  = _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_cvtepi32_ps(_mm512_abs_epi32(_mm512_mask_blend_epi32(slctSwapXY, dx, dy))));
+    __m512i yzero = _mm512_castps_si512(_mm512_fmadd_ps(_mm512_mul_ps(_mm512_castsi512_ps(det), _mm512_set1_ps(yinitScale)), xrcp, _mm512_set1_ps(yinitBias)));
+    yzero = _mm512_mask_xor_epi32(yzero, slctFlipY, yzero, sign);
+    __m512i yfrac, yhi;
+    f32_to_s64_avx512(yfrac, yhi, _mm512_castsi512_ps(yzero));
+    __m512i yinc = f32_to_u32_sat_avx512(_mm512_mul_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_abs_epi32(_mm512_mask_blend_epi32(slctSwapXY, dy, dx))), xrcp), _mm512_set1_ps(yincScale)));
+
+    // First half.
+
+    __m512i yhi4  = _mm512_add_epi32(yhi, _mm512_set1_epi32(4));
+    __m512i shape = _mm512_min_epi32(_mm512_max_epi32(yhi4, _mm512_setzero_si512()), _mm512_set1_epi32(11));
+    add_add_carry_avx512(yfrac, yinc, shape);
+    add_add_carry_avx512(yfrac, yinc, shape);
+    add_add_carry_avx512(yfrac, yinc, shape);
+    __m512i oct = _mm512_and_si512(_mm512_srli_epi32(flips, CR_FLIPBIT_FLIP_X), _mm512_set1_epi32(3));
+    __m512i idx = _mm512_add_epi32(oct, _mm512_slli_epi32(shape, 2));
+    __m512i m0  = _mm512_i32gather_epi64(_mm512_castsi512_si256(idx), (const void*)lut, 8);
+    __m512i m1  = _mm512_i32gather_epi64(_mm512_extracti64x4_epi64(idx, 1), (const void*)lut, 8);
+
+    // Second half, with the same wrap-free clamp as in the AVX2 version.
+
+    add_add_carry_avx512(yfrac, yinc, shape);
+    __m512i s = _mm512_and_si512(shape, _mm512_set1_epi32(15));
+    __m512i one = _mm512_set1_epi32(1);
+    __m512i popc = _mm512_add_epi32(_mm512_add_epi32(_mm512_and_si512(s, one), _mm512_and_si512(_mm512_srli_epi32(s, 1), one)),
+                                    _mm512_add_epi32(_mm512_and_si512(_mm512_srli_epi32(s, 2), one), _mm512_srli_epi32(s, 3)));
+    shape = _mm512_add_epi32(_mm512_min_epi32(_mm512_max_epi32(yhi4, _mm512_set1_epi32(-8)), _mm512_set1_epi32(11)), popc);
+    shape = _mm512_min_epi32(_mm512_max_epi32(shape, _mm512_setzero_si512()), _mm512_set1_epi32(11));
+    add_add_carry_avx512(yfrac, yinc, shape);
+    add_add_carry_avx512(yfrac, yinc, shape);
+    add_add_carry_avx512(yfrac, yinc, shape);
+    idx = _mm512_add_epi32(_mm512_add_epi32(oct, _mm512_slli_epi32(shape, 2)), _mm512_set1_epi32(12 << 5));
+    m0 = _mm512_or_si512(m0, _mm512_i32gather_epi64(_mm512_castsi512_si256(idx), (const void*)lut, 8));
+    m1 = _mm512_or_si512(m1, _mm512_i32gather_epi64(_mm512_extracti64x4_epi64(idx, 1), (const void*)lut, 8));
+
+    // Complement.
+
+    __m512i ones = _mm512_set1_epi64(-1);
+    mask[0] = _mm512_mask_xor_epi64(m0, (__mmask8)(complMask & 0xFF), m0, ones);
+    mask[1] = _mm512_mask_xor_epi64(m1, (__mmask8)(complMask >> 8), m1, ones);
+}
+
+NVDR_CPU_AVX512 static void trianglePixelCoverage_avx512(U64* coverage, const CRTriangleHeader* headers, int numTris, int tileX, int tileY, int widthPixelsVp, int heightPixelsVp)
+{
+    const U64* lut = cover8x8_getLUT();
+    const int* base = (const int*)headers;
+
+    int baseX = (tileX << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((widthPixelsVp  - 1) << (CR_SUBPIXEL_LOG2 - 1));
+    int baseY = (tileY << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((heightPixelsVp - 1) << (CR_SUBPIXEL_LOG2 - 1));
+    __m512i bx = _mm512_set1_epi32((S16)baseX);
+    __m512i by = _mm512_set1_epi32((S16)baseY);
+
+    for (int i=0; i < numTris; i += 16)
+    {
+        // Gather header words. Lanes past the end repeat the last triangle.
+        __m512i lane = _mm512_min_epi32(_mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(i)), _mm512_set1_epi32(numTris - 1));
+        __m512i ofs  = _mm512_slli_epi32(lane, 2);
+        __m512i hx   = _mm512_i32gather_epi32(ofs, (const void*)(base + 0), 4);
+        __m512i hy   = _mm512_i32gather_epi32(ofs, (const void*)(base + 1), 4);
+        __m512i hz   = _mm512_i32gather_epi32(ofs, (const void*)(base + 2), 4);
+        __m512i hw   = _mm512_i32gather_epi32(ofs, (const void*)(base + 3), 4);
+
+        // Extract S16 vertex positions while subtracting tile coordinates.
+        __m512i v0x  = _mm512_sub_epi32(s16lo_avx512(hx), bx);
+        __m512i v0y  = _mm512_sub_epi32(s16hi_avx512(hx), by);
+        __m512i v01x = _mm512_sub_epi32(s16lo_avx512(hy), s16lo_avx512(hx));
+        __m512i v01y = _mm512_sub_epi32(s16hi_avx512(hy), s16hi_avx512(hx));
+        __m512i v20x = _mm512_sub_epi32(s16lo_avx512(hx), s16lo_avx512(hz));
+        __m512i v20y = _mm512_sub_epi32(s16hi_avx512(hx), s16hi_avx512(hz));
+
+        // Extract flipbits.
+        __m512i f3c = _mm512_set1_epi32(0x3C);
+        __m512i f01 = _mm512_and_si512(_mm512_srli_epi32(hw, 6), f3c);
+        __m512i f12 = _mm512_and_si512(_mm512_srli_epi32(hw, 2), f3c);
+        __m512i f20 = _mm512_and_si512(_mm512_slli_epi32(hw, 2), f3c);
+
+        // Compute per-edge coverage masks and combine.
+        __m512i c01[2], c12[2], c20[2];
+        cover8x8_exact_fast_avx512(c01, v0x, v0y, v01x, v01y, f01, lut);
+        cover8x8_exact_fast_avx512(c12, _mm512_add_epi32(v0x, v01x), _mm512_add_epi32(v0y, v01y),
+                                   _mm512_sub_epi32(_mm512_setzero_si512(), _mm512_add_epi32(v01x, v20x)),
+                                   _mm512_sub_epi32(_mm512_setzero_si512(), _mm512_add_epi32(v01y, v20y)), f12, lut);
+        cover8x8_exact_fast_avx512(c20, v0x, v0y, v20x, v20y, f20, lut);
+
+        U64 result[16];
+        _mm512_storeu_si512((void*)(result + 0), _mm512_and_si512(_mm512_and_si512(c01[0], c12[0]), c20[0]));
+        _mm512_storeu_si512((void*)(result + 8), _mm512_and_si512(_mm512_and_si512(c01[1], c12[1]), c20[1]));
+        memcpy(coverage + i, result, std::min(numTris - i, 16) * sizeof(U64));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // NVDR_CPU_X86
+
+//------------------------------------------------------------------------
+// Runtime dispatch.
+//------------------------------------------------------------------------
+
+CoverageFunc CR::getCoverageFunc(CpuIsa isa)
+{
+#if NVDR_CPU_X86
+    if (isa >= CpuIsa_AVX512)
+        return trianglePixelCoverage_avx512;
+    if (isa >= CpuIsa_AVX2)
+        return trianglePixelCoverage_avx2;
+#endif
+    return trianglePixelCoverage_scalar;
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,28 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "../../cudaraster/impl/PrivateDefs.hpp"
+#include "../../cpuisa.h"
+
+namespace CR
+{
+//------------------------------------------------------------------------
+// 8x8 tile coverage for a batch of set-up triangles. The SIMD variants run
+// the LUT-based edge evaluation of trianglePixelCoverage() for 8 (AVX2) or
+// 16 (AVX-512) triangles per instruction and produce identical masks.
+//------------------------------------------------------------------------
+
+#define CR_CPU_COVERAGE_BATCH 16    // Maximum number of triangles per call.
+
+typedef void (*CoverageFunc)(U64* coverage, const CRTriangleHeader* headers, int numTris, int tileX, int tileY, int widthPixelsVp, int heightPixelsVp);
+
+CoverageFunc getCoverageFunc(CpuIsa isa); // Falls back to a narrower variant if isa was not compiled in.
+
+//------------------------------------------------------------------------
+} // namespace CR
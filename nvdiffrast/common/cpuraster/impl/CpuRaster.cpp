@@ -0,0 +1,108 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "../CpuRaster.hpp"
+#include "CpuRasterImpl.hpp"
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Stub interface implementation.
+//------------------------------------------------------------------------
+
+CpuRaster::CpuRaster(int numThreads)
+{
+    m_impl = new CpuRasterImpl(numThreads);
+}
+
+CpuRaster::~CpuRaster()
+{
+    delete m_impl;
+}
+
+void CpuRaster::setBufferSize(int width, int height, int numImages)
+{
+    m_impl->setBufferSize(Vec3i(width, height, numImages));
+}
+
+void CpuRaster::setViewport(int width, int height, int offsetX, int offsetY)
+{
+    m_impl->setViewport(Vec2i(width, height), Vec2i(offsetX, offsetY));
+}
+
+void CpuRaster::setRenderModeFlags(U32 flags)
+{
+    m_impl->setRenderModeFlags(flags);
+}
+
+void CpuRaster::setMinTriangleArea(float pixels)
+{
+    m_impl->setMinTriangleArea(pixels);
+}
+
+void CpuRaster::deferredClear(U32 clearColor)
+{
+    m_impl->deferredClear(clearColor);
+}
+
+void CpuRaster::setVertexTransforms(const void* matrices)
+{
+    m_impl->setVertexTransforms(matrices);
+}
+
+void CpuRaster::setVertexBuffer(const void* vertices, int numVertices)
+{
+    m_impl->setVertexBuffer(vertices, numVertices);
+}
+
+void CpuRaster::setIndexBuffer(const void* indices, int numTriangles, int indexType)
+{
+    m_impl->setIndexBuffer(indices, numTriangles, indexType == IndexType_UInt16);
+}
+
+bool CpuRaster::drawTriangles(const int* ranges, bool peel)
+{
+    return m_impl->drawTriangles((const Vec2i*)ranges, peel);
+}
+
+void* CpuRaster::getColorBuffer(void)
+{
+    return m_impl->getColorBuffer();
+}
+
+void* CpuRaster::getDepthBuffer(void)
+{
+    return m_impl->getDepthBuffer();
+}
+
+void CpuRaster::swapDepthAndPeel(void)
+{
+    m_impl->swapDepthAndPeel();
+}
+
+ThreadPool& CpuRaster::getThreadPool(void)
+{
+    return m_impl->getThreadPool();
+}
+
+int CpuRaster::getImageStats(ImageStats* stats, int maxImages) const
+{
+    return m_impl->getImageStats(stats, maxImages);
+}
+
+void CpuRaster::resetImageStats(void)
+{
+    m_impl->resetImageStats();
+}
+
+size_t CpuRaster::getBufferBytes(void) const
+{
+    return m_impl->getBufferBytes();
+}
+
+//------------------------------------------------------------------------
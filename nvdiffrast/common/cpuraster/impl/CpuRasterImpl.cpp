@@ -0,0 +1,794 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "../../threadpool.h"
+#include "CpuRasterImpl.hpp"
+#include "CpuUtil.inl"
+#include <stdexcept>
+
+using namespace CR;
+using std::min;
+using std::max;
+
+//------------------------------------------------------------------------
+
+CpuRasterImpl::CpuRasterImpl(int numThreads)
+:   m_pool                  (NULL),
+    m_ownPool               (false),
+    m_coverageFunc          (getCoverageFunc(getCpuIsa())),
+    m_renderModeFlags       (0),
+    m_minArea               (0),
+    m_deferredClear         (false),
+    m_clearColor            (0),
+    m_vertexPtr             (NULL),
+    m_indexPtr              (NULL),
+    m_shortIndices          (false),
+    m_vertexMtxPtr          (NULL),
+    m_numVertices           (0),
+    m_numTriangles          (0),
+
+    m_numImages             (0),
+    m_bufferSizePixels      (0, 0),
+    m_bufferSizeVp          (0, 0),
+    m_sizePixels            (0, 0),
+    m_sizeVp                (0, 0),
+    m_offsetPixels          (0, 0),
+    m_sizeBins              (0, 0),
+    m_numBins               (0),
+    m_sizeTiles             (0, 0),
+    m_numTiles              (0),
+    m_bandsPerBin           (1),
+
+    m_xs                    (1.f),
+    m_ys                    (1.f),
+    m_xo                    (0.f),
+    m_yo                    (0.f),
+
+    m_numChunks             (0)
+{
+    if (numThreads > 0)
+    {
+        m_pool = new ThreadPool(numThreads);
+        m_ownPool = true;
+    }
+    else
+        m_pool = &ThreadPool::getGlobal();
+
+    m_scratch.resize(m_pool->getNumThreads());
+}
+
+//------------------------------------------------------------------------
+
+CpuRasterImpl::~CpuRasterImpl(void)
+{
+    if (m_ownPool)
+        delete m_pool;
+}
+
+//------------------------------------------------------------------------
+
+void CpuRasterImpl::setBufferSize(Vec3i size)
+{
+    // Internal buffer width and height must be divisible by tile size.
+    int w = (size.x + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+    int h = (size.y + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+
+    m_bufferSizePixels = Vec2i(w, h);
+    m_bufferSizeVp     = Vec2i(size.x, size.y);
+    m_numImages        = size.z;
+
+    m_colorBuffer.resize((size_t)w * h * size.z);
+    m_depthBuffer.resize((size_t)w * h * size.z);
+}
+
+//------------------------------------------------------------------------
+
+int CpuRasterImpl::getImageStats(CpuRaster::ImageStats* stats, int maxImages) const
+{
+    for (int i=0; i < m_numImages && i < maxImages; i++)
+    {
+        if (i < (int)m_imageStats.size())
+            stats[i] = m_imageStats[i];
+        else
+            memset(&stats[i], 0, sizeof(stats[i])); // Not drawn since reset.
+    }
+    return m_numImages;
+}
+
+size_t CpuRasterImpl::getBufferBytes(void) const
+{
+    size_t bytes = (m_colorBuffer.capacity() + m_depthBuffer.capacity() + m_peelBuffer.capacity()) * sizeof(U32);
+    for (int i=0; i < (int)m_chunks.size(); i++)
+    {
+        const Chunk& c = m_chunks[i];
+        bytes += c.subtris.capacity() * sizeof(Subtri) + (c.binOfs.capacity() + c.binData.capacity()) * sizeof(S32);
+    }
+    for (int i=0; i < (int)m_scratch.size(); i++)
+        bytes += m_scratch[i].tileOfs.capacity() * sizeof(S32) + m_scratch[i].tileData.capacity() * sizeof(const Subtri*);
+    return bytes;
+}
+
+//------------------------------------------------------------------------
+
+void CpuRasterImpl::setViewport(Vec2i size, Vec2i offset)
+{
+    // Offset must be divisible by tile size.
+    if ((offset.x & (CR_TILE_SIZE - 1)) != 0 || (offset.y & (CR_TILE_SIZE - 1)) != 0)
+        throw std::runtime_error("invalid viewport offset");
+
+    // Round internal viewport size to multiples of tile size.
+    int w = (size.x + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+    int h = (size.y + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+
+    m_sizePixels    = Vec2i(w, h);
+    m_offsetPixels  = offset;
+    m_sizeVp        = Vec2i(size.x, size.y);
+    m_sizeTiles.x   = m_sizePixels.x >> CR_TILE_LOG2;
+    m_sizeTiles.y   = m_sizePixels.y >> CR_TILE_LOG2;
+    m_numTiles      = m_sizeTiles.x * m_sizeTiles.y;
+    m_sizeBins.x    = (m_sizeTiles.x + CR_BIN_SIZE - 1) >> CR_BIN_LOG2;
+    m_sizeBins.y    = (m_sizeTiles.y + CR_BIN_SIZE - 1) >> CR_BIN_LOG2;
+    m_numBins       = m_sizeBins.x * m_sizeBins.y;
+}
+
+//------------------------------------------------------------------------
+
+void CpuRasterImpl::swapDepthAndPeel(void)
+{
+    m_peelBuffer.resize(m_depthBuffer.size()); // Ensure equal size.
+    m_depthBuffer.swap(m_peelBuffer);
+}
+
+//------------------------------------------------------------------------
+
+bool CpuRasterImpl::drawTriangles(const Vec2i* ranges, bool peel)
+{
+    bool instanceMode = (!ranges);
+
+    // Vertex position adjustments according to current viewport size and offset.
+    m_xs = (float)m_bufferSizeVp.x / (float)m_sizeVp.x;
+    m_ys = (float)m_bufferSizeVp.y / (float)m_sizeVp.y;
+    m_xo = (float)(m_bufferSizeVp.x - m_sizeVp.x - 2 * m_offsetPixels.x) / (float)m_sizeVp.x;
+    m_yo = (float)(m_bufferSizeVp.y - m_sizeVp.y - 2 * m_offsetPixels.y) / (float)m_sizeVp.y;
+
+    // Split bins into bands of tile rows until there is enough work for all workers.
+    int numThreads = m_pool->getNumThreads();
+    m_bandsPerBin = 1;
+    while (m_bandsPerBin < CR_BIN_SIZE && m_numImages * m_numBins * m_bandsPerBin < numThreads * CR_CPU_TASKS_PER_THREAD)
+        m_bandsPerBin <<= 1;
+
+    // Setup and bin stages. Skipped in peeling iterations that reuse the previous results.
+    bool fullDraw = (!peel || m_numChunks == 0);
+    if (fullDraw)
+    {
+        // Partition every image into chunks of triangles.
+        m_imageFirstChunk.resize(m_numImages + 1);
+        std::vector<CRImageParams> imageParams(m_numImages);
+        int numChunks = 0;
+        for (int i=0; i < m_numImages; i++)
+        {
+            CRImageParams& ip = imageParams[i];
+            ip.triOffset    = instanceMode ? 0 : ranges[i].x;
+            ip.triCount     = instanceMode ? m_numTriangles : max(ranges[i].y, 0);
+            m_imageFirstChunk[i] = numChunks;
+            numChunks += (ip.triCount + CR_CPU_SETUP_CHUNK_SIZE - 1) >> CR_CPU_SETUP_CHUNK_LOG2;
+        }
+        m_imageFirstChunk[m_numImages] = numChunks;
+
+        // Chunk storage is kept to reuse allocations between calls.
+        if ((int)m_chunks.size() < numChunks)
+            m_chunks.resize(numChunks);
+        m_numChunks = numChunks;
+        for (int i=0; i < m_numImages; i++)
+        for (int c = m_imageFirstChunk[i]; c < m_imageFirstChunk[i + 1]; c++)
+        {
+            Chunk& chunk = m_chunks[c];
+            chunk.imageIdx  = i;
+            chunk.taskBegin = (c - m_imageFirstChunk[i]) << CR_CPU_SETUP_CHUNK_LOG2;
+            chunk.taskEnd   = min(chunk.taskBegin + CR_CPU_SETUP_CHUNK_SIZE, imageParams[i].triCount);
+        }
+
+        m_pool->run(numChunks, [&](int taskIdx, int)
+        {
+            Chunk& chunk = m_chunks[taskIdx];
+            setupStage(chunk, imageParams[chunk.imageIdx], instanceMode);
+            binStage(chunk);
+        });
+    }
+
+    // Coarse and fine stages, one task per band of tile rows within a bin.
+    int tasksPerImage = m_numBins * m_bandsPerBin;
+    if (fullDraw)
+        m_taskTileStats.assign(m_numImages * tasksPerImage, Vec2i(0, 0));
+    m_pool->run(m_numImages * tasksPerImage, [&](int taskIdx, int threadIdx)
+    {
+        int imageIdx = taskIdx / tasksPerImage;
+        int binTask  = taskIdx - imageIdx * tasksPerImage;
+        coarseStage(imageIdx, binTask / m_bandsPerBin, binTask % m_bandsPerBin, m_scratch[threadIdx], fullDraw ? &m_taskTileStats[taskIdx] : NULL);
+    });
+
+    // Accumulate statistics.
+    if (fullDraw)
+    {
+        if ((int)m_imageStats.size() < m_numImages)
+        {
+            CpuRaster::ImageStats zero;
+            memset(&zero, 0, sizeof(zero));
+            m_imageStats.resize(m_numImages, zero);
+        }
+        for (int i=0; i < m_numImages; i++)
+        {
+            CpuRaster::ImageStats& is = m_imageStats[i];
+            for (int c = m_imageFirstChunk[i]; c < m_imageFirstChunk[i + 1]; c++)
+            {
+                const Chunk& chunk = m_chunks[c];
+                is.numSubtris += chunk.subtris.size();
+                for (int b=0; b < m_numBins; b++)
+                    is.numBinSegs += (chunk.binOfs[b + 1] - chunk.binOfs[b] + CR_BIN_SEG_SIZE - 1) >> CR_BIN_SEG_LOG2;
+            }
+            for (int t=0; t < tasksPerImage; t++)
+            {
+                is.numTileSegs    += m_taskTileStats[i * tasksPerImage + t].x;
+                is.numActiveTiles += m_taskTileStats[i * tasksPerImage + t].y;
+            }
+        }
+    }
+
+    m_deferredClear = false;
+    return true; // Intermediate storage grows on demand, so there is no overflow.
+}
+
+//------------------------------------------------------------------------
+// Setup stage. Follows triangleSetupImpl() in TriangleSetup.inl.
+//------------------------------------------------------------------------
+
+static inline void transformVertex(const float* m, F32* v)
+{
+    F32 r[4];
+    for (int i=0; i < 4; i++)
+        r[i] = fmaf(m[4*i+0], v[0], fmaf(m[4*i+1], v[1], fmaf(m[4*i+2], v[2], m[4*i+3] * v[3])));
+    memcpy(v, r, sizeof(r));
+}
+
+static inline void snapTriangle(
+    int widthPixelsVp, int heightPixelsVp,
+    const F32* v0, const F32* v1, const F32* v2,
+    S32* p0, S32* p1, S32* p2, F32* rcpW, S32* lo, S32* hi)
+{
+    F32 viewScaleX = (F32)(widthPixelsVp  << (CR_SUBPIXEL_LOG2 - 1));
+    F32 viewScaleY = (F32)(heightPixelsVp << (CR_SUBPIXEL_LOG2 - 1));
+    rcpW[0] = 1.0f / v0[3];
+    rcpW[1] = 1.0f / v1[3];
+    rcpW[2] = 1.0f / v2[3];
+    p0[0] = f32_to_s32_sat(v0[0] * rcpW[0] * viewScaleX), p0[1] = f32_to_s32_sat(v0[1] * rcpW[0] * viewScaleY);
+    p1[0] = f32_to_s32_sat(v1[0] * rcpW[1] * viewScaleX), p1[1] = f32_to_s32_sat(v1[1] * rcpW[1] * viewScaleY);
+    p2[0] = f32_to_s32_sat(v2[0] * rcpW[2] * viewScaleX), p2[1] = f32_to_s32_sat(v2[1] * rcpW[2] * viewScaleY);
+    lo[0] = min_min(p0[0], p1[0], p2[0]), lo[1] = min_min(p0[1], p1[1], p2[1]);
+    hi[0] = max_max(p0[0], p1[0], p2[0]), hi[1] = max_max(p0[1], p1[1], p2[1]);
+}
+
+static inline bool prepareTriangle(
+    int widthPixelsVp, int heightPixelsVp, U32 renderModeFlags, S32 minArea,
+    const S32* p0, const S32* p1, const S32* p2, const S32* lo, const S32* hi,
+    S32* d1, S32* d2, S32& area)
+{
+    // Backfacing, frontfacing, degenerate or too small => cull.
+
+    d1[0] = p1[0] - p0[0], d1[1] = p1[1] - p0[1];
+    d2[0] = p2[0] - p0[0], d2[1] = p2[1] - p0[1];
+    area = d1[0] * d2[1] - d1[1] * d2[0];
+
+    if (area == 0)
+        return false; // Degenerate.
+
+    if (area < 0 && (renderModeFlags & CpuRaster::RenderModeFlag_EnableBackfaceCulling) != 0)
+        return false; // Backfacing.
+
+    if (area > 0 && (renderModeFlags & CpuRaster::RenderModeFlag_EnableFrontfaceCulling) != 0)
+        return false; // Frontfacing.
+
+    if (std::abs(area) < minArea)
+        return false; // Too small.
+
+    // AABB falls between samples => cull.
+
+    int sampleSize = 1 << CR_SUBPIXEL_LOG2;
+    int biasX = (widthPixelsVp  << (CR_SUBPIXEL_LOG2 - 1)) - (sampleSize >> 1);
+    int biasY = (heightPixelsVp << (CR_SUBPIXEL_LOG2 - 1)) - (sampleSize >> 1);
+    int lox = (int)((U32)lo[0] + (sampleSize - 1) + biasX) & -sampleSize;
+    int loy = (int)((U32)lo[1] + (sampleSize - 1) + biasY) & -sampleSize;
+    int hix = (hi[0] + biasX) & -sampleSize;
+    int hiy = (hi[1] + biasY) & -sampleSize;
+
+    if (lox > hix || loy > hiy)
+        return false; // Between pixels.
+
+    // AABB covers 1 or 2 samples => cull if they are not covered.
+
+    int diff = (hix + hiy - lox) - loy;
+    if (diff <= sampleSize)
+    {
+        for (int corner = 0; corner < 2; corner++)
+        {
+            int cx = corner ? hix : lox;
+            int cy = corner ? hiy : loy;
+            S32 t0x = p0[0] + biasX - cx, t0y = p0[1] + biasY - cy;
+            S32 t1x = p1[0] + biasX - cx, t1y = p1[1] + biasY - cy;
+            S32 t2x = p2[0] + biasX - cx, t2y = p2[1] + biasY - cy;
+            S32 e0 = t0x * t1y - t0y * t1x;
+            S32 e1 = t1x * t2y - t1y * t2x;
+            S32 e2 = t2x * t0y - t2y * t0x;
+            if (area < 0)
+            {
+                e0 = -e0;
+                e1 = -e1;
+                e2 = -e2;
+            }
+
+            if (e0 >= 0 && e1 >= 0 && e2 >= 0)
+                break; // Covered.
+
+            if (corner == 1 || diff == 0)
+                return false; // Between pixels.
+        }
+    }
+
+    // Otherwise => proceed to output the triangle.
+
+    return true; // Visible.
+}
+
+static inline void setupTriangle(
+    int widthPixelsVp, int heightPixelsVp,
+    CRTriangleHeader& th, CRTriangleData& td, int triId,
+    F32 v0z, F32 v1z, F32 v2z,
+    S32* p0, S32* p1, S32* p2, F32* rcpW,
+    S32* d1, S32* d2, S32 area)
+{
+    // Swap vertices 1 and 2 if area is negative. Only executed if backface culling is
+    // disabled (if it is enabled, we never come here with area < 0).
+
+    S32 q1[2] = { p1[0], p1[1] };
+    S32 q2[2] = { p2[0], p2[1] };
+    S32 e1[2] = { d1[0], d1[1] };
+    S32 e2[2] = { d2[0], d2[1] };
+    F32 rw[3] = { rcpW[0], rcpW[1], rcpW[2] };
+    if (area < 0)
+    {
+        swap(e1[0], e2[0]), swap(e1[1], e2[1]);
+        swap(q1[0], q2[0]), swap(q1[1], q2[1]);
+        swap(v1z, v2z);
+        swap(rw[1], rw[2]);
+        area = -area;
+    }
+
+    S32 wv0x = p0[0] + (widthPixelsVp  << (CR_SUBPIXEL_LOG2 - 1));
+    S32 wv0y = p0[1] + (heightPixelsVp << (CR_SUBPIXEL_LOG2 - 1));
+
+    // Setup depth plane equation.
+
+    F32 zcoef = (F32)(CR_DEPTH_MAX - CR_DEPTH_MIN) * 0.5f;
+    F32 zbias = (F32)(CR_DEPTH_MAX + CR_DEPTH_MIN) * 0.5f;
+    F32 zv0 = fmaf(v0z * zcoef, rw[0], zbias);
+    F32 zv1 = fmaf(v1z * zcoef, rw[1], zbias);
+    F32 zv2 = fmaf(v2z * zcoef, rw[2], zbias);
+    U32 zpleq[3];
+    setupPleq(zpleq, zv0, zv1, zv2, wv0x - (1 << (CR_SUBPIXEL_LOG2 - 1)), wv0y - (1 << (CR_SUBPIXEL_LOG2 - 1)), e1[0], e1[1], e2[0], e2[1], 1.0f / (F32)area);
+
+    U32 zmin = f32_to_u32_sat(fminf(fminf(zv0, zv1), zv2) - (F32)CR_LERP_ERROR(0));
+
+    // Write CRTriangleData.
+
+    td.zx = zpleq[0];
+    td.zy = zpleq[1];
+    td.zb = zpleq[2];
+    td.id = triId;
+
+    // Determine flipbits.
+
+    U32 f01 = cover8x8_selectFlips(e1[0], e1[1]);
+    U32 f12 = cover8x8_selectFlips(e2[0] - e1[0], e2[1] - e1[1]);
+    U32 f20 = cover8x8_selectFlips(-e2[0], -e2[1]);
+
+    // Write CRTriangleHeader.
+
+    th.v0x = (S16)p0[0], th.v0y = (S16)p0[1];
+    th.v1x = (S16)q1[0], th.v1y = (S16)q1[1];
+    th.v2x = (S16)q2[0], th.v2y = (S16)q2[1];
+    th.misc = (zmin & 0xfffff000u) | (f01 << 6) | (f12 << 2) | (f20 >> 2);
+}
+
+void CpuRasterImpl::setupStage(Chunk& chunk, const CRImageParams& ip, bool instanceMode) const
+{
+    chunk.subtris.clear();
+
+    int wVp = m_sizeVp.x;
+    int hVp = m_sizeVp.y;
+    const float* vertexBuffer = m_vertexPtr;
+    const float* vertexMtx = instanceMode ? m_vertexMtxPtr : NULL;
+    if (vertexMtx)
+        vertexMtx += 16 * chunk.imageIdx; // Shared vertices, per-image transform.
+    else if (instanceMode)
+        vertexBuffer += (size_t)m_numVertices * chunk.imageIdx * 4; // Instance offset.
+
+    for (int taskIdx = chunk.taskBegin; taskIdx < chunk.taskEnd; taskIdx++)
+    {
+        // Determine triangle index.
+
+        int triIdx = taskIdx;
+        if (!instanceMode)
+            triIdx += ip.triOffset;
+
+        // Read vertex indices.
+
+        if ((U32)triIdx >= (U32)m_numTriangles)
+            continue; // Bad triangle index.
+
+        U32 vi0, vi1, vi2;
+        if (m_shortIndices)
+        {
+            const U16* idx = (const U16*)m_indexPtr + triIdx * 3;
+            vi0 = idx[0], vi1 = idx[1], vi2 = idx[2];
+        }
+        else
+        {
+            const S32* idx = (const S32*)m_indexPtr + triIdx * 3;
+            vi0 = idx[0], vi1 = idx[1], vi2 = idx[2];
+        }
+        if (vi0 >= (U32)m_numVertices || vi1 >= (U32)m_numVertices || vi2 >= (U32)m_numVertices)
+            continue; // Bad vertex index.
+
+        // Read vertex positions and adjust them according to current viewport size and offset.
+
+        F32 v0[4], v1[4], v2[4];
+        memcpy(v0, vertexBuffer + vi0 * 4, sizeof(v0));
+        memcpy(v1, vertexBuffer + vi1 * 4, sizeof(v1));
+        memcpy(v2, vertexBuffer + vi2 * 4, sizeof(v2));
+        if (vertexMtx)
+        {
+            transformVertex(vertexMtx, v0);
+            transformVertex(vertexMtx, v1);
+            transformVertex(vertexMtx, v2);
+        }
+
+        v0[0] = fmaf(v0[0], m_xs, v0[3] * m_xo);
+        v0[1] = fmaf(v0[1], m_ys, v0[3] * m_yo);
+        v1[0] = fmaf(v1[0], m_xs, v1[3] * m_xo);
+        v1[1] = fmaf(v1[1], m_ys, v1[3] * m_yo);
+        v2[0] = fmaf(v2[0], m_xs, v2[3] * m_xo);
+        v2[1] = fmaf(v2[1], m_ys, v2[3] * m_yo);
+
+        // Outside view frustum => cull.
+
+        if ((v0[3] < fabsf(v0[0])) | (v0[3] < fabsf(v0[1])) | (v0[3] < fabsf(v0[2])))
+        {
+            if (((v0[3] < +v0[0]) & (v1[3] < +v1[0]) & (v2[3] < +v2[0])) |
+                ((v0[3] < -v0[0]) & (v1[3] < -v1[0]) & (v2[3] < -v2[0])) |
+                ((v0[3] < +v0[1]) & (v1[3] < +v1[1]) & (v2[3] < +v2[1])) |
+                ((v0[3] < -v0[1]) & (v1[3] < -v1[1]) & (v2[3] < -v2[1])) |
+                ((v0[3] < +v0[2]) & (v1[3] < +v1[2]) & (v2[3] < +v2[2])) |
+                ((v0[3] < -v0[2]) & (v1[3] < -v1[2]) & (v2[3] < -v2[2])))
+                continue;
+        }
+
+        // Inside depth range => try to snap vertices.
+
+        if ((v0[3] >= fabsf(v0[2])) & (v1[3] >= fabsf(v1[2])) & (v2[3] >= fabsf(v2[2])))
+        {
+            // Inside S16 range and small enough => fast path.
+
+            S32 p0[2], p1[2], p2[2], lo[2], hi[2];
+            F32 rcpW[3];
+
+            snapTriangle(wVp, hVp, v0, v1, v2, p0, p1, p2, rcpW, lo, hi);
+            S32 loxy = min(lo[0], lo[1]);
+            S32 hixy = max(hi[0], hi[1]);
+            S32 aabbLimit = (1 << (CR_MAXVIEWPORT_LOG2 + CR_SUBPIXEL_LOG2)) - 1;
+
+            if (loxy >= -32768 && hixy <= 32767 && hixy - loxy <= aabbLimit)
+            {
+                S32 d1[2], d2[2], area;
+                if (prepareTriangle(wVp, hVp, m_renderModeFlags, m_minArea, p0, p1, p2, lo, hi, d1, d2, area))
+                {
+                    chunk.subtris.resize(chunk.subtris.size() + 1);
+                    Subtri& st = chunk.subtris.back();
+                    setupTriangle(wVp, hVp, st.header, st.data, triIdx + 1, v0[2], v1[2], v2[2], p0, p1, p2, rcpW, d1, d2, area);
+                }
+                continue;
+            }
+        }
+
+        // Clip to view frustum.
+
+        F32 bary[18];
+        F32 ov0[4], od1[4], od2[4];
+        for (int c=0; c < 4; c++)
+        {
+            ov0[c] = v0[c];
+            od1[c] = v1[c] - v0[c];
+            od2[c] = v2[c] - v0[c];
+        }
+        int numVerts = clipTriangleWithFrustum(bary, ov0, v1, v2, od1, od2);
+
+        // Set up non-culled subtriangles as a fan. The area threshold applies to whole
+        // triangles only, as culling a part of a clipped triangle would leave a hole.
+
+        F32 w0[4], w1[4], w2[4];
+        for (int c=0; c < 4; c++)
+        {
+            w0[c] = fmaf(od2[c], bary[1], fmaf(od1[c], bary[0], ov0[c]));
+            w1[c] = fmaf(od2[c], bary[3], fmaf(od1[c], bary[2], ov0[c]));
+        }
+
+        for (int i = 2; i < numVerts; i++)
+        {
+            for (int c=0; c < 4; c++)
+                w2[c] = fmaf(od2[c], bary[i * 2 + 1], fmaf(od1[c], bary[i * 2 + 0], ov0[c]));
+
+            S32 p0[2], p1[2], p2[2], lo[2], hi[2], d1[2], d2[2], area;
+            F32 rcpW[3];
+
+            snapTriangle(wVp, hVp, w0, w1, w2, p0, p1, p2, rcpW, lo, hi);
+            if (prepareTriangle(wVp, hVp, m_renderModeFlags, 0, p0, p1, p2, lo, hi, d1, d2, area))
+            {
+                chunk.subtris.resize(chunk.subtris.size() + 1);
+                Subtri& st = chunk.subtris.back();
+                setupTriangle(wVp, hVp, st.header, st.data, triIdx + 1, w0[2], w1[2], w2[2], p0, p1, p2, rcpW, d1, d2, area);
+            }
+
+            memcpy(w1, w2, sizeof(w1));
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// Bin stage. Conservative bin AABBs as in BinRaster.inl, stored in CSR
+// form so that per-bin triangle order equals the input order.
+//------------------------------------------------------------------------
+
+static inline void subtriBounds(const CRTriangleHeader& th, int widthPixelsVp, int heightPixelsVp, int shift, int maxX, int maxY, int& lox, int& loy, int& hix, int& hiy)
+{
+    // Subpixel positions relative to the viewport corner.
+    S32 ox = widthPixelsVp  * (CR_SUBPIXEL_SIZE >> 1);
+    S32 oy = heightPixelsVp * (CR_SUBPIXEL_SIZE >> 1);
+    lox = min(max((min_min(th.v0x, th.v1x, th.v2x) + ox) >> shift, 0), maxX);
+    loy = min(max((min_min(th.v0y, th.v1y, th.v2y) + oy) >> shift, 0), maxY);
+    hix = min(max((max_max(th.v0x, th.v1x, th.v2x) + ox) >> shift, 0), maxX);
+    hiy = min(max((max_max(th.v0y, th.v1y, th.v2y) + oy) >> shift, 0), maxY);
+}
+
+void CpuRasterImpl::binStage(Chunk& chunk) const
+{
+    int shift = CR_BIN_LOG2 + CR_TILE_LOG2 + CR_SUBPIXEL_LOG2;
+    int numSubtris = (int)chunk.subtris.size();
+
+    // Count.
+    chunk.binOfs.assign(m_numBins + 1, 0);
+    for (int i=0; i < numSubtris; i++)
+    {
+        int lox, loy, hix, hiy;
+        subtriBounds(chunk.subtris[i].header, m_sizeVp.x, m_sizeVp.y, shift, m_sizeBins.x - 1, m_sizeBins.y - 1, lox, loy, hix, hiy);
+        for (int y = loy; y <= hiy; y++)
+        for (int x = lox; x <= hix; x++)
+            chunk.binOfs[x + y * m_sizeBins.x + 1]++;
+    }
+
+    // Prefix sum.
+    for (int i=0; i < m_numBins; i++)
+        chunk.binOfs[i + 1] += chunk.binOfs[i];
+
+    // Scatter. Offsets are advanced in place and shifted back afterwards.
+    chunk.binData.resize(chunk.binOfs[m_numBins]);
+    for (int i=0; i < numSubtris; i++)
+    {
+        int lox, loy, hix, hiy;
+        subtriBounds(chunk.subtris[i].header, m_sizeVp.x, m_sizeVp.y, shift, m_sizeBins.x - 1, m_sizeBins.y - 1, lox, loy, hix, hiy);
+        for (int y = loy; y <= hiy; y++)
+        for (int x = lox; x <= hix; x++)
+            chunk.binData[chunk.binOfs[x + y * m_sizeBins.x]++] = i;
+    }
+    for (int i = m_numBins; i > 0; i--)
+        chunk.binOfs[i] = chunk.binOfs[i - 1];
+    chunk.binOfs[0] = 0;
+}
+
+//------------------------------------------------------------------------
+// Coarse stage. Distributes the bin's triangles into per-tile lists for a
+// band of tile rows and hands each non-empty tile to the fine stage.
+//------------------------------------------------------------------------
+
+void CpuRasterImpl::coarseStage(int imageIdx, int binIdx, int bandIdx, Scratch& s, Vec2i* tileStats)
+{
+    int binY = binIdx / m_sizeBins.x;
+    int binX = binIdx - binY * m_sizeBins.x;
+    int bandHeight = CR_BIN_SIZE / m_bandsPerBin;
+
+    // Tile range of this task, clamped to the viewport.
+    int tileX0 = binX << CR_BIN_LOG2;
+    int tileY0 = (binY << CR_BIN_LOG2) + bandIdx * bandHeight;
+    int tileX1 = min(tileX0 + CR_BIN_SIZE, m_sizeTiles.x);
+    int tileY1 = min(tileY0 + bandHeight, m_sizeTiles.y);
+    if (tileX0 >= tileX1 || tileY0 >= tileY1)
+        return;
+
+    int widthInBand = tileX1 - tileX0;
+    int numTilesInBand = widthInBand * (tileY1 - tileY0);
+    int shift = CR_TILE_LOG2 + CR_SUBPIXEL_LOG2;
+
+    // Count per-tile triangles in chunk order.
+    s.tileOfs.assign(numTilesInBand + 1, 0);
+    for (int c = m_imageFirstChunk[imageIdx]; c < m_imageFirstChunk[imageIdx + 1]; c++)
+    {
+        const Chunk& chunk = m_chunks[c];
+        for (int i = chunk.binOfs[binIdx]; i < chunk.binOfs[binIdx + 1]; i++)
+        {
+            int lox, loy, hix, hiy;
+            subtriBounds(chunk.subtris[chunk.binData[i]].header, m_sizeVp.x, m_sizeVp.y, shift, tileX1 - 1, tileY1 - 1, lox, loy, hix, hiy);
+            lox = max(lox, tileX0), loy = max(loy, tileY0);
+            for (int y = loy; y <= hiy; y++)
+            for (int x = lox; x <= hix; x++)
+                s.tileOfs[(x - tileX0) + (y - tileY0) * widthInBand + 1]++;
+        }
+    }
+    if (tileStats)
+    {
+        for (int i=0; i < numTilesInBand; i++)
+        {
+            int count = s.tileOfs[i + 1];
+            tileStats->x += (count + CR_TILE_SEG_SIZE - 1) >> CR_TILE_SEG_LOG2;
+            tileStats->y += (count > 0) ? 1 : 0;
+        }
+    }
+    for (int i=0; i < numTilesInBand; i++)
+        s.tileOfs[i + 1] += s.tileOfs[i];
+
+    // Scatter.
+    s.tileData.resize(s.tileOfs[numTilesInBand]);
+    for (int c = m_imageFirstChunk[imageIdx]; c < m_imageFirstChunk[imageIdx + 1]; c++)
+    {
+        const Chunk& chunk = m_chunks[c];
+        for (int i = chunk.binOfs[binIdx]; i < chunk.binOfs[binIdx + 1]; i++)
+        {
+            const Subtri* st = &chunk.subtris[chunk.binData[i]];
+            int lox, loy, hix, hiy;
+            subtriBounds(st->header, m_sizeVp.x, m_sizeVp.y, shift, tileX1 - 1, tileY1 - 1, lox, loy, hix, hiy);
+            lox = max(lox, tileX0), loy = max(loy, tileY0);
+            for (int y = loy; y <= hiy; y++)
+            for (int x = lox; x <= hix; x++)
+                s.tileData[s.tileOfs[(x - tileX0) + (y - tileY0) * widthInBand]++] = st;
+        }
+    }
+
+    // Fine raster every tile that has triangles, or all tiles if clearing.
+    int begin = 0;
+    for (int i=0; i < numTilesInBand; i++)
+    {
+        int end = s.tileOfs[i];
+        if (end > begin || m_deferredClear)
+            fineStage(imageIdx, tileX0 + i % widthInBand, tileY0 + i / widthInBand, s.tileData.data() + begin, end - begin);
+        begin = end;
+    }
+}
+
+//------------------------------------------------------------------------
+// Fine stage. Processes the tile's triangles in order with the same
+// depth test as FineRaster.inl: closer or equal depth wins, so on ties the
+// later triangle in the input order is kept exactly like on the GPU.
+//------------------------------------------------------------------------
+
+void CpuRasterImpl::fineStage(int imageIdx, int tileX, int tileY, const Subtri* const* tris, int numTris)
+{
+    bool enablePeel = (m_renderModeFlags & CpuRaster::RenderModeFlag_EnableDepthPeeling) != 0;
+
+    // Surface pointers with the viewport offset baked in.
+    size_t stride = m_bufferSizePixels.x;
+    size_t imageOfs = (size_t)m_bufferSizePixels.x * m_bufferSizePixels.y * imageIdx;
+    size_t tileOfs = imageOfs + (size_t)(m_offsetPixels.x + (tileX << CR_TILE_LOG2)) + stride * (m_offsetPixels.y + (tileY << CR_TILE_LOG2));
+    U32* pColor = m_colorBuffer.data() + tileOfs;
+    U32* pDepth = m_depthBuffer.data() + tileOfs;
+    const U32* pPeel = enablePeel ? m_peelBuffer.data() + tileOfs : NULL;
+
+    // Read or clear tile.
+    U32 tileColor[CR_TILE_SQR];
+    U32 tileDepth[CR_TILE_SQR];
+    U32 tilePeel[CR_TILE_SQR];
+    for (int y=0; y < CR_TILE_SIZE; y++)
+    for (int x=0; x < CR_TILE_SIZE; x++)
+    {
+        int i = x + y * CR_TILE_SIZE;
+        tileColor[i] = m_deferredClear ? m_clearColor : pColor[x + stride * y];
+        tileDepth[i] = m_deferredClear ? CR_DEPTH_MAX : pDepth[x + stride * y];
+        if (enablePeel)
+            tilePeel[i] = pPeel[x + stride * y];
+    }
+
+    // Tile z max for early z cull, refreshed lazily.
+    U32 tileZMax = 0;
+    bool tileZUpd = true;
+    auto refreshZMax = [&]()
+    {
+        if (!tileZUpd)
+            return;
+        tileZMax = 0;
+        for (int i=0; i < CR_TILE_SQR; i++)
+            tileZMax = max(tileZMax, tileDepth[i]);
+        tileZUpd = false;
+    };
+
+    // Process triangles in batches with the coverage masks computed up front.
+    CRTriangleHeader batchHeaders[CR_CPU_COVERAGE_BATCH];
+    S32 batchIdx[CR_CPU_COVERAGE_BATCH];
+    U64 batchCoverage[CR_CPU_COVERAGE_BATCH];
+    int t = 0;
+    while (t < numTris)
+    {
+        refreshZMax();
+
+        // Collect triangles that survive early z cull. Tile z max never grows,
+        // so a triangle culled here would also be culled when its turn comes.
+        int batchSize = 0;
+        for (; t < numTris && batchSize < CR_CPU_COVERAGE_BATCH; t++)
+        {
+            if ((tris[t]->header.misc & 0xFFFFF000u) > tileZMax)
+                continue;
+            batchHeaders[batchSize] = tris[t]->header;
+            batchIdx[batchSize] = t;
+            batchSize++;
+        }
+        if (!batchSize)
+            break;
+
+        m_coverageFunc(batchCoverage, batchHeaders, batchSize, tileX, tileY, m_sizeVp.x, m_sizeVp.y);
+
+        for (int b=0; b < batchSize; b++)
+        {
+            const Subtri& st = *tris[batchIdx[b]];
+
+            refreshZMax();
+
+            // Early z cull.
+            if ((st.header.misc & 0xFFFFF000u) > tileZMax)
+                continue;
+
+            // Per-pixel depth test.
+            U64 coverage = batchCoverage[b];
+            while (coverage)
+            {
+                int pixelInTile = findLowestBit(coverage);
+                coverage &= coverage - 1;
+
+                U32 pixelX = (tileX << CR_TILE_LOG2) + (pixelInTile & 7);
+                U32 pixelY = (tileY << CR_TILE_LOG2) + (pixelInTile >> 3);
+                U32 depth = st.data.zx * pixelX + st.data.zy * pixelY + st.data.zb;
+
+                if (enablePeel && depth <= tilePeel[pixelInTile])
+                    continue;
+
+                U32 oldDepth = tileDepth[pixelInTile];
+                if (depth > oldDepth)
+                    continue;
+                if (oldDepth == tileZMax)
+                    tileZUpd = true; // Replacing previous zmax => need to update.
+
+                tileDepth[pixelInTile] = depth;
+                tileColor[pixelInTile] = st.data.id;
+            }
+        }
+    }
+
+    // Write tile back to the framebuffer.
+    for (int y=0; y < CR_TILE_SIZE; y++)
+    for (int x=0; x < CR_TILE_SIZE; x++)
+    {
+        int i = x + y * CR_TILE_SIZE;
+        pColor[x + stride * y] = tileColor[i];
+        pDepth[x + stride * y] = tileDepth[i];
+    }
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "../../cudaraster/impl/PrivateDefs.hpp"
+#include "../CpuRaster.hpp"
+#include "CpuCoverage.hpp"
+#include <vector>
+
+class ThreadPool;
+
+namespace CR
+{
+//------------------------------------------------------------------------
+
+#define CR_CPU_SETUP_CHUNK_LOG2 12      // Triangles per setup/bin task.
+#define CR_CPU_SETUP_CHUNK_SIZE (1 << CR_CPU_SETUP_CHUNK_LOG2)
+#define CR_CPU_TASKS_PER_THREAD 4       // Minimum number of coarse/fine tasks per worker, achieved by splitting bins into bands of tile rows.
+
+//------------------------------------------------------------------------
+
+class CpuRasterImpl
+{
+public:
+                            CpuRasterImpl           (int numThreads);
+                            ~CpuRasterImpl          (void);
+
+    void                    setBufferSize           (Vec3i size);
+    void                    setViewport             (Vec2i size, Vec2i offset);
+    void                    setRenderModeFlags      (U32 flags) { m_renderModeFlags = flags; }
+    void                    setMinTriangleArea      (float pixels) { m_minArea = minTriangleAreaToSubpixels(pixels); }
+    void                    deferredClear           (U32 color) { m_deferredClear = true; m_clearColor = color; }
+    void                    setVertexBuffer         (const void* ptr, int numVertices) { m_vertexPtr = (const float*)ptr; m_numVertices = numVertices; } // CPU pointer.
+    void                    setIndexBuffer          (const void* ptr, int numTriangles, bool shortIndices) { m_indexPtr = ptr; m_numTriangles = numTriangles; m_shortIndices = shortIndices; } // CPU pointer.
+    void                    setVertexTransforms     (const void* ptr) { m_vertexMtxPtr = (const float*)ptr; } // CPU pointer.
+    bool                    drawTriangles           (const Vec2i* ranges, bool peel);
+    void*                   getColorBuffer          (void) { return m_colorBuffer.data(); }
+    void*                   getDepthBuffer          (void) { return m_depthBuffer.data(); }
+    void                    swapDepthAndPeel        (void);
+    ThreadPool&             getThreadPool           (void) { return *m_pool; }
+    int                     getImageStats           (CpuRaster::ImageStats* stats, int maxImages) const;
+    void                    resetImageStats         (void) { m_imageStats.clear(); }
+    size_t                  getBufferBytes          (void) const;
+
+private:
+    // Set-up triangle as produced by the setup stage, same layout as on the GPU.
+
+    struct Subtri
+    {
+        CRTriangleHeader    header;
+        CRTriangleData      data;
+    };
+
+    // Setup and bin output for a contiguous run of triangles of one image.
+    // Bin contents are stored in CSR form to keep the chunk order intact.
+
+    struct Chunk
+    {
+        S32                 imageIdx;
+        S32                 taskBegin;              // First triangle task within the image.
+        S32                 taskEnd;
+        std::vector<Subtri> subtris;                // In triangle order.
+        std::vector<S32>    binOfs;                 // numBins + 1 offsets into binData.
+        std::vector<S32>    binData;                // Subtri indices per bin.
+    };
+
+    // Per-worker coarse raster output.
+
+    struct Scratch
+    {
+        std::vector<S32>            tileOfs;        // CR_BIN_SQR + 1 offsets into tileData.
+        std::vector<const Subtri*>  tileData;       // Subtris per tile in drawing order.
+    };
+
+    void                    setupStage              (Chunk& chunk, const CRImageParams& ip, bool instanceMode) const;
+    void                    binStage                (Chunk& chunk) const;
+    void                    coarseStage             (int imageIdx, int binIdx, int bandIdx, Scratch& s, Vec2i* tileStats);
+    void                    fineStage               (int imageIdx, int tileX, int tileY, const Subtri* const* tris, int numTris);
+
+    // Thread pool.
+
+    ThreadPool*             m_pool;
+    bool                    m_ownPool;
+
+    // Coverage kernel for the instruction set of the host CPU.
+
+    CoverageFunc            m_coverageFunc;
+
+    // State.
+
+    unsigned int            m_renderModeFlags;
+    S32                     m_minArea;              // In the units of CRParams::minArea.
+    bool                    m_deferredClear;
+    unsigned int            m_clearColor;
+    const float*            m_vertexPtr;
+    const void*             m_indexPtr;
+    bool                    m_shortIndices;         // 16-bit unsigned instead of 32-bit indices.
+    const float*            m_vertexMtxPtr;         // Per-image vertex transforms, instance mode only.
+    int                     m_numVertices;          // Input buffer size.
+    int                     m_numTriangles;         // Input buffer size.
+
+    // Surfaces.
+
+    std::vector<U32>        m_colorBuffer;
+    std::vector<U32>        m_depthBuffer;
+    std::vector<U32>        m_peelBuffer;
+    int                     m_numImages;
+    Vec2i                   m_bufferSizePixels;     // Internal buffer size.
+    Vec2i                   m_bufferSizeVp;         // Total viewport size.
+    Vec2i                   m_sizePixels;           // Internal size at which all computation is done.
+    Vec2i                   m_sizeVp;               // Size to which output will be cropped outside, determines viewport size.
+    Vec2i                   m_offsetPixels;         // Viewport offset for tiled rendering.
+    Vec2i                   m_sizeBins;
+    S32                     m_numBins;
+    Vec2i                   m_sizeTiles;
+    S32                     m_numTiles;
+    S32                     m_bandsPerBin;          // Coarse/fine tasks per bin.
+
+    // Per-draw parameters.
+
+    F32                     m_xs, m_ys, m_xo, m_yo; // Vertex position adjustments for tiled rendering.
+
+    // Intermediate results, kept across calls for peeling iterations.
+
+    std::vector<Chunk>      m_chunks;
+    std::vector<S32>        m_imageFirstChunk;      // numImages + 1 entries.
+    int                     m_numChunks;
+    std::vector<Scratch>    m_scratch;              // Per worker.
+
+    // Statistics.
+
+    std::vector<CpuRaster::ImageStats> m_imageStats; // Grows to the largest number of images drawn.
+    std::vector<Vec2i>      m_taskTileStats;        // Tile segments and active tiles per coarse task.
+};
+
+//------------------------------------------------------------------------
+} // namespace CR
@@ -0,0 +1,326 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+//------------------------------------------------------------------------
+// Host versions of the helpers in cudaraster/impl/Util.inl. Conversions
+// follow PTX cvt semantics (round to nearest even, saturate, NaN -> 0), and
+// every a * b + c that the device compiler contracts into an FMA is written
+// as an explicit fmaf() so that the results are identical to the GPU.
+//------------------------------------------------------------------------
+
+#include "../../cudaraster/impl/PrivateDefs.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace CR
+{
+//------------------------------------------------------------------------
+
+template<class T> static inline void swap(T& a, T& b) { T t = a; a = b; b = t; }
+
+static inline S32   float_as_s32        (F32 a)                 { S32 v; memcpy(&v, &a, sizeof(v)); return v; }
+static inline U32   getLo               (S64 a)                 { return (U32)a; }
+static inline S32   getHi               (S64 a)                 { return (S32)(a >> 32); }
+static inline S32   min_min             (S32 a, S32 b, S32 c)   { return std::min(a, std::min(b, c)); }
+static inline S32   max_max             (S32 a, S32 b, S32 c)   { return std::max(a, std::max(b, c)); }
+static inline S32   slct                (S32 a, S32 b, S32 c)   { return c >= 0 ? a : b; }
+static inline F32   slct                (F32 a, F32 b, S32 c)   { return c >= 0 ? a : b; }
+static inline S32   sub_s16lo_s16lo     (U32 a, U32 b)          { return (S32)(S16)(a & 0xFFFF) - (S32)(S16)(b & 0xFFFF); }
+static inline S32   sub_s16hi_s16lo     (U32 a, U32 b)          { return (S32)(S16)(a >> 16) - (S32)(S16)(b & 0xFFFF); }
+static inline S32   sub_s16hi_s16hi     (U32 a, U32 b)          { return (S32)(S16)(a >> 16) - (S32)(S16)(b >> 16); }
+
+static inline void add_add_carry(U32& rlo, U32 alo, U32 blo, U32& rhi, U32 ahi, U32 bhi)
+{
+    U64 r = (((U64)ahi << 32) | alo) + (((U64)bhi << 32) | blo);
+    rlo = (U32)r;
+    rhi = (U32)(r >> 32);
+}
+
+static inline U32 add_clamp_0_x(S32 a, S32 b, S32 c)
+{
+    S64 sum = (S64)a + (S64)b;
+    U32 s = (sum < 0) ? 0 : (sum > (S64)CR_U32_MAX ? CR_U32_MAX : (U32)sum);
+    return (s < (U32)c) ? s : (U32)c;
+}
+
+//------------------------------------------------------------------------
+// Bit counting.
+
+#if defined(_MSC_VER)
+static inline int   popc32              (U32 a)                 { a = a - ((a >> 1) & 0x55555555u); a = (a & 0x33333333u) + ((a >> 2) & 0x33333333u); return (int)((((a + (a >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24); }
+static inline int   popc64              (U64 a)                 { return popc32((U32)a) + popc32((U32)(a >> 32)); }
+static inline int   findLowestBit       (U64 a)                 { unsigned long idx; _BitScanForward64(&idx, a); return (int)idx; } // a != 0.
+#else
+static inline int   popc32              (U32 a)                 { return __builtin_popcount(a); }
+static inline int   popc64              (U64 a)                 { return __builtin_popcountll(a); }
+static inline int   findLowestBit       (U64 a)                 { return __builtin_ctzll(a); } // a != 0.
+#endif
+
+//------------------------------------------------------------------------
+// Float to integer conversions.
+
+static inline S32 f32_to_s32_sat(F32 a) // cvt.rni.sat.s32.f32
+{
+    if (!(a == a))              return 0;
+    if (a >=  2147483648.0f)    return CR_S32_MAX;
+    if (a <= -2147483648.0f)    return CR_S32_MIN;
+    return (S32)std::nearbyint(a);
+}
+
+static inline U32 f32_to_u32_sat(F32 a) // cvt.rni.sat.u32.f32
+{
+    if (!(a == a) || a <= 0.0f) return 0;
+    if (a >= 4294967296.0f)     return CR_U32_MAX;
+    return (U32)std::nearbyint(a);
+}
+
+static inline U32 f32_to_u32_rz_sat(F32 a) // cvt.rzi.sat.u32.f32, i.e., a plain (U32) cast on the device.
+{
+    if (!(a == a) || a <= 0.0f) return 0;
+    if (a >= 4294967296.0f)     return CR_U32_MAX;
+    return (U32)a;
+}
+
+static inline S64 f32_to_s64(F32 a) // cvt.rni.s64.f32
+{
+    if (!(a == a))                      return 0;
+    if (a >=  9223372036854775808.0f)   return INT64_MAX;
+    if (a <= -9223372036854775808.0f)   return INT64_MIN;
+    return (S64)std::nearbyint(a);
+}
+
+//------------------------------------------------------------------------
+// Clipping.
+
+static inline int clipPolygonWithPlane(F32* baryOut, const F32* baryIn, int numIn, F32 v0, F32 v1, F32 v2)
+{
+    int numOut = 0;
+    if (numIn >= 3)
+    {
+        int ai = (numIn - 1) * 2;
+        F32 av = fmaf(v2, baryIn[ai + 1], fmaf(v1, baryIn[ai + 0], v0));
+        for (int bi = 0; bi < numIn * 2; bi += 2)
+        {
+            F32 bv = fmaf(v2, baryIn[bi + 1], fmaf(v1, baryIn[bi + 0], v0));
+            if (av * bv < 0.0f)
+            {
+                F32 bc = av / (av - bv);
+                F32 ac = 1.0f - bc;
+                baryOut[numOut + 0] = fmaf(baryIn[ai + 0], ac, baryIn[bi + 0] * bc);
+                baryOut[numOut + 1] = fmaf(baryIn[ai + 1], ac, baryIn[bi + 1] * bc);
+                numOut += 2;
+            }
+            if (bv >= 0.0f)
+            {
+                baryOut[numOut + 0] = baryIn[bi + 0];
+                baryOut[numOut + 1] = baryIn[bi + 1];
+                numOut += 2;
+            }
+            ai = bi;
+            av = bv;
+        }
+    }
+    return (numOut >> 1);
+}
+
+static inline int clipTriangleWithFrustum(F32* bary, const F32* v0, const F32* v1, const F32* v2, const F32* d1, const F32* d2)
+{
+    int num = 3;
+    bary[0] = 0.0f, bary[1] = 0.0f;
+    bary[2] = 1.0f, bary[3] = 0.0f;
+    bary[4] = 0.0f, bary[5] = 1.0f;
+
+    for (int c=0; c < 3; c++)
+    {
+        if ((v0[3] < fabsf(v0[c])) | (v1[3] < fabsf(v1[c])) | (v2[3] < fabsf(v2[c])))
+        {
+            F32 temp[18];
+            num = clipPolygonWithPlane(temp, bary, num, v0[3] + v0[c], d1[3] + d1[c], d2[3] + d2[c]);
+            num = clipPolygonWithPlane(bary, temp, num, v0[3] - v0[c], d1[3] - d1[c], d2[3] - d2[c]);
+        }
+    }
+    return num;
+}
+
+//------------------------------------------------------------------------
+// Depth plane equation. v0 = subpixels relative to the bottom-left sampling point.
+
+static inline void setupPleq(U32* pleq, F32 vx, F32 vy, F32 vz, S32 v0x, S32 v0y, S32 d1x, S32 d1y, S32 d2x, S32 d2y, F32 areaRcp)
+{
+    F32 mx = fmaxf(fmaxf(vx, vy), vz);
+    int sh = std::min(std::max((float_as_s32(mx) >> 23) - (127 + 22), 0), 8);
+    S32 t0 = f32_to_u32_rz_sat(vx) >> sh;
+    S32 t1 = (f32_to_u32_rz_sat(vy) >> sh) - t0;
+    S32 t2 = (f32_to_u32_rz_sat(vz) >> sh) - t0;
+
+    U32 rcpMant = (float_as_s32(areaRcp) & 0x007FFFFF) | 0x00800000;
+    int rcpShift = (23 + 127) - (float_as_s32(areaRcp) >> 23);
+
+    S64 xc = ((S64)t1 * d2y - (S64)t2 * d1y) * rcpMant;
+    S64 yc = ((S64)t2 * d1x - (S64)t1 * d2x) * rcpMant;
+    pleq[0] = (U32)(xc >> (rcpShift - (sh + CR_SUBPIXEL_LOG2)));
+    pleq[1] = (U32)(yc >> (rcpShift - (sh + CR_SUBPIXEL_LOG2)));
+
+    S32 centerX = (v0x * 2 + min_min(d1x, d2x, 0) + max_max(d1x, d2x, 0)) >> (CR_SUBPIXEL_LOG2 + 1);
+    S32 centerY = (v0y * 2 + min_min(d1y, d2y, 0) + max_max(d1y, d2y, 0)) >> (CR_SUBPIXEL_LOG2 + 1);
+    S32 vcx = v0x - centerX * CR_SUBPIXEL_SIZE;
+    S32 vcy = v0y - centerY * CR_SUBPIXEL_SIZE;
+
+    pleq[2] = (U32)t0 << sh;
+    pleq[2] -= (U32)(((xc >> 13) * vcx + (yc >> 13) * vcy) >> (rcpShift - (sh + 13)));
+    pleq[2] -= pleq[0] * (U32)centerX + pleq[1] * (U32)centerY;
+}
+
+//------------------------------------------------------------------------
+// 8x8 coverage masks.
+
+static inline U32 cover8x8_selectFlips(S32 dx, S32 dy)
+{
+    U32 flips = 0;
+    if (dy > 0 || (dy == 0 && dx <= 0))
+        flips ^= (1 << CR_FLIPBIT_FLIP_X) ^ (1 << CR_FLIPBIT_FLIP_Y) ^ (1 << CR_FLIPBIT_COMPL);
+    if (dx > 0)
+        flips ^= (1 << CR_FLIPBIT_FLIP_X) ^ (1 << CR_FLIPBIT_FLIP_Y);
+    if (std::abs(dx) < std::abs(dy))
+        flips ^= (1 << CR_FLIPBIT_SWAP_XY) ^ (1 << CR_FLIPBIT_FLIP_Y);
+    return flips;
+}
+
+static inline void cover8x8_setupLUT(U64* lut)
+{
+    for (S32 lutIdx = 0; lutIdx < CR_COVER8X8_LUT_SIZE; lutIdx++)
+    {
+        int half       = (lutIdx < (12 << 5)) ? 0 : 1;
+        int yint       = (lutIdx >> 5) - half * 12 - 3;
+        U32 shape      = ((lutIdx >> 2) & 7) << (31 - 2);
+        S32 slctSwapXY = (S32)((U32)lutIdx << (31 - 1));
+        S32 slctNegX   = (S32)((U32)lutIdx << (31 - 0));
+        S32 slctCompl  = slctSwapXY ^ slctNegX;
+
+        U64 mask = 0;
+        int xlo = half * 4;
+        int xhi = xlo + 4;
+        for (int x = xlo; x < xhi; x++)
+        {
+            int ylo = slct(0, std::max(yint, 0), slctCompl);
+            int yhi = slct(std::min(yint, 8), 8, slctCompl);
+            for (int y = ylo; y < yhi; y++)
+            {
+                int xx = slct(x, y, slctSwapXY);
+                int yy = slct(y, x, slctSwapXY);
+                xx = slct(xx, 7 - xx, slctNegX);
+                mask |= (U64)1 << (xx + yy * 8);
+            }
+            yint += shape >> 31;
+            shape <<= 1;
+        }
+        lut[lutIdx] = mask;
+    }
+}
+
+static inline const U64* cover8x8_getLUT(void)
+{
+    struct LUT { U64 data[CR_COVER8X8_LUT_SIZE]; LUT(void) { cover8x8_setupLUT(data); } };
+    static const LUT s_lut; // Thread-safe initialization.
+    return s_lut.data;
+}
+
+static inline U64 cover8x8_lookupMask(S64 yinit, U32 yinc, U32 flips, const U64* lut)
+{
+    // First half. Byte offsets of the device version are expressed as entry indices.
+
+    U32 yfrac = getLo(yinit);
+    U32 shape = add_clamp_0_x(getHi(yinit) + 4, 0, 11);
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    int oct = flips & ((1 << CR_FLIPBIT_FLIP_X) | (1 << CR_FLIPBIT_SWAP_XY));
+    U64 mask = lut[(oct >> 3) + (shape << 2)];
+
+    // Second half.
+
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    shape = add_clamp_0_x(getHi(yinit) + 4, popc32(shape & 15), 11);
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    add_add_carry(yfrac, yfrac, yinc, shape, shape, shape);
+    mask |= lut[(oct >> 3) + (shape << 2) + (12 << 5)];
+    return (flips >= (1 << CR_FLIPBIT_COMPL)) ? ~mask : mask;
+}
+
+static inline U64 cover8x8_exact_fast(S32 ox, S32 oy, S32 dx, S32 dy, U32 flips, const U64* lut)
+{
+    F32  yinitBias  = (F32)(1 << (31 - CR_MAXVIEWPORT_LOG2 - CR_SUBPIXEL_LOG2 * 2));
+    F32  yinitScale = (F32)(1 << (32 - CR_SUBPIXEL_LOG2));
+    F32  yincScale  = 65536.0f * 65536.0f;
+
+    S32  slctFlipY  = (S32)(flips << (31 - CR_FLIPBIT_FLIP_Y));
+    S32  slctFlipX  = (S32)(flips << (31 - CR_FLIPBIT_FLIP_X));
+    S32  slctSwapXY = (S32)(flips << (31 - CR_FLIPBIT_SWAP_XY));
+
+    // Evaluate cross product.
+
+    S32 t = ox * dy - oy * dx;
+    F32 det = (F32)slct(t, t - dy * (7 << CR_SUBPIXEL_LOG2), slctFlipX);
+    if (flips >= (1 << CR_FLIPBIT_COMPL))
+        det = -det;
+
+    // Represent Y as a function of X.
+
+    F32 xrcp  = 1.0f / (F32)std::abs(slct(dx, dy, slctSwapXY));
+    F32 yzero = fmaf(det * yinitScale, xrcp, yinitBias);
+    S64 yinit = f32_to_s64(slct(yzero, -yzero, slctFlipY));
+    U32 yinc  = f32_to_u32_sat((F32)std::abs(slct(dy, dx, slctSwapXY)) * xrcp * yincScale);
+
+    // Lookup.
+
+    return cover8x8_lookupMask(yinit, yinc, flips, lut);
+}
+
+//------------------------------------------------------------------------
+// Coverage of an 8x8 pixel tile by a set-up triangle, identical to
+// trianglePixelCoverage() in FineRaster.inl.
+
+static inline U64 trianglePixelCoverage(const CRTriangleHeader& th, int tileX, int tileY, int widthPixelsVp, int heightPixelsVp, const U64* lut)
+{
+    U32 hx, hy, hz, hw;
+    memcpy(&hx, &th.v0x, sizeof(U32));
+    memcpy(&hy, &th.v1x, sizeof(U32));
+    memcpy(&hz, &th.v2x, sizeof(U32));
+    hw = th.misc;
+
+    int baseX = (tileX << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((widthPixelsVp  - 1) << (CR_SUBPIXEL_LOG2 - 1));
+    int baseY = (tileY << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((heightPixelsVp - 1) << (CR_SUBPIXEL_LOG2 - 1));
+
+    // Extract S16 vertex positions while subtracting tile coordinates.
+    S32 v0x  = sub_s16lo_s16lo(hx, baseX);
+    S32 v0y  = sub_s16hi_s16lo(hx, baseY);
+    S32 v01x = sub_s16lo_s16lo(hy, hx);
+    S32 v01y = sub_s16hi_s16hi(hy, hx);
+    S32 v20x = sub_s16lo_s16lo(hx, hz);
+    S32 v20y = sub_s16hi_s16hi(hx, hz);
+
+    // Extract flipbits.
+    U32 f01 = (hw >> 6) & 0x3C;
+    U32 f12 = (hw >> 2) & 0x3C;
+    U32 f20 = (hw << 2) & 0x3C;
+
+    // Compute per-edge coverage masks and combine.
+    U64 c01 = cover8x8_exact_fast(v0x, v0y, v01x, v01y, f01, lut);
+    U64 c12 = cover8x8_exact_fast(v0x + v01x, v0y + v01y, -v01x - v20x, -v01y - v20y, f12, lut);
+    U64 c20 = cover8x8_exact_fast(v0x, v0y, v20x, v20y, f20, lut);
+    return c01 & c12 & c20;
+}
+
+//------------------------------------------------------------------------
+} // namespace CR
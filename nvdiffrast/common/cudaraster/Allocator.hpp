@@ -0,0 +1,138 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace CR
+{
+//------------------------------------------------------------------------
+// Allocation counters. Requests are counted at the allocator that serves
+// them, so a pool and its upstream report cache hits and actual
+// allocations separately.
+//------------------------------------------------------------------------
+
+struct AllocatorStats
+{
+    long long               numAllocs;              // Successful allocate() calls.
+    long long               numReleases;            // release() calls.
+    long long               bytesAllocated;         // Total bytes over all allocate() calls.
+    long long               bytesInUse;             // Allocated and not yet released.
+    long long               peakBytesInUse;
+};
+
+//------------------------------------------------------------------------
+// Memory source for CudaRaster buffers. Thread-safe. Release must be
+// called with the same size as the allocation.
+//------------------------------------------------------------------------
+
+class Allocator
+{
+public:
+                            Allocator               (void);
+    virtual                 ~Allocator              (void);
+
+    void*                   allocate                (size_t bytes);
+    void                    release                 (void* ptr, size_t bytes);
+    AllocatorStats          getStats                (void) const;
+    void                    resetStats              (void);             // Zeroes the counters except bytesInUse.
+
+protected:
+    virtual void*           doAllocate              (size_t bytes) = 0; // Called with the lock held.
+    virtual void            doRelease               (void* ptr, size_t bytes) = 0;
+
+private:
+                            Allocator               (const Allocator&); // forbidden
+    Allocator&              operator=               (const Allocator&); // forbidden
+
+    mutable std::mutex      m_mutex;
+    AllocatorStats          m_stats;
+};
+
+//------------------------------------------------------------------------
+// GPU memory straight from the driver.
+//------------------------------------------------------------------------
+
+class DeviceAllocator : public Allocator
+{
+protected:
+    void*                   doAllocate              (size_t bytes);
+    void                    doRelease               (void* ptr, size_t bytes);
+};
+
+//------------------------------------------------------------------------
+// Page-locked host memory straight from the driver.
+//------------------------------------------------------------------------
+
+class PinnedHostAllocator : public Allocator
+{
+protected:
+    void*                   doAllocate              (size_t bytes);
+    void                    doRelease               (void* ptr, size_t bytes);
+};
+
+//------------------------------------------------------------------------
+// Pageable host memory carved from large chunks. A chunk is reused from
+// the start once everything in it has been released. Needs no GPU.
+//------------------------------------------------------------------------
+
+class HostArenaAllocator : public Allocator
+{
+public:
+                            HostArenaAllocator      (size_t chunkBytes = 1 << 20);
+                            ~HostArenaAllocator     (void);
+
+protected:
+    void*                   doAllocate              (size_t bytes);
+    void                    doRelease               (void* ptr, size_t bytes);
+
+private:
+    struct Chunk
+    {
+        char*               base;
+        size_t              bytes;
+        size_t              top;                    // Bump pointer.
+        int                 numLive;                // Allocations not yet released.
+    };
+
+    size_t                  m_chunkBytes;
+    std::vector<Chunk>      m_chunks;
+};
+
+//------------------------------------------------------------------------
+// Caches released blocks in size classes of four steps per power of two,
+// and serves later requests of the same class from the cache. Blocks go
+// back to the upstream allocator in trim() and on destruction.
+//------------------------------------------------------------------------
+
+class PoolAllocator : public Allocator
+{
+public:
+                            PoolAllocator           (Allocator& upstream);
+                            ~PoolAllocator          (void);
+
+    void                    trim                    (void);
+    static size_t           getClassSize            (size_t bytes);
+
+protected:
+    void*                   doAllocate              (size_t bytes);
+    void                    doRelease               (void* ptr, size_t bytes);
+
+private:
+    void                    trimNoLock              (void);
+
+    Allocator&                              m_upstream;
+    std::map<size_t, std::vector<void*> >   m_free; // Cached blocks by class size.
+    std::mutex                              m_poolMutex;
+};
+
+//------------------------------------------------------------------------
+} // namespace CR
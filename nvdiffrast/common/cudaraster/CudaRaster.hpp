@@ -7,6 +7,7 @@
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #pragma once
+#include <cstddef>
 
 //------------------------------------------------------------------------
 // This is a slimmed-down and modernized version of the original
@@ -27,6 +28,36 @@ namespace CR
 #endif
 
 class RasterImpl;
+class Allocator;
+
+//------------------------------------------------------------------------
+// Counters of intermediate buffer sizing.
+//------------------------------------------------------------------------
+
+struct CapacityStats
+{
+    long long               numDraws;               // Draws checked for overflow, excluding peeling.
+    long long               numRetried;             // Draws that overflowed and had images rendered again.
+    long long               numPredicted;           // Draws sized from the history of the same workload shape.
+    long long               numMispredicted;        // Predicted draws that overflowed.
+};
+
+//------------------------------------------------------------------------
+// Per-image pipeline counters, summed over the draws resolved since the
+// last reset. Peeling draws reuse earlier results and are not counted.
+//------------------------------------------------------------------------
+
+struct ImageStats
+{
+    long long               numSubtris;             // Triangle setup output, including the slots of culled triangles.
+    long long               numBinSegs;             // Bin segments written by the bin rasterizer.
+    long long               numTileSegs;            // Tile segments written by the coarse rasterizer.
+    long long               numActiveTiles;         // Tiles that received triangles.
+    int                     numRetries;             // Times the image was rendered again after an overflow.
+    int                     maxSubtris;             // Largest buffer capacities the image was rendered with.
+    int                     maxBinSegs;
+    int                     maxTileSegs;
+};
 
 //------------------------------------------------------------------------
 // Interface class to isolate user from implementation details.
@@ -39,22 +70,48 @@ public:
     {
         RenderModeFlag_EnableBackfaceCulling = 1 << 0,   // Enable backface culling.
         RenderModeFlag_EnableDepthPeeling    = 1 << 1,   // Enable depth peeling. Must have a peel buffer set.
+        RenderModeFlag_EnableFrontfaceCulling = 1 << 2,  // Enable frontface culling.
+    };
+
+    enum
+    {
+        DrawStatus_Success  = 0,    // All draws fit in the internal buffers.
+        DrawStatus_Retried,         // Some images were rendered again with enlarged buffers. Anything that consumed their output must be redone.
+        DrawStatus_Overflow,        // Some images did not fit even at maximum buffer sizes.
+    };
+
+    enum
+    {
+        IndexType_Int32     = 0,    // Triangle indices as int3.
+        IndexType_UInt16,           // Triangle indices as ushort3.
     };
 
 public:
 					        CudaRaster				(void);
 					        ~CudaRaster				(void);
 
-    void                    setBufferSize           (int width, int height, int numImages);              // Width and height are internally rounded up to multiples of tile size (8x8) for buffer sizes.
-    void                    setViewport             (int width, int height, int offsetX, int offsetY);   // Tiled rendering viewport setup.
+    void                    setAllocators           (Allocator* device, Allocator* host);                // Memory sources for internal GPU and page-locked host buffers, NULL for driver allocations. Releases all buffers. Allocators must outlive CudaRaster.
+    void                    setBufferSize           (int width, int height, int numImages);              // Width and height are internally rounded up to multiples of tile size (8x8) for buffer sizes. Resolves pending draws first.
+    void                    setViewport             (int width, int height, int offsetX, int offsetY);   // Tiled rendering viewport setup. Larger than CR_MAXVIEWPORT_SIZE is split into tiles that are drawn as separate images in the same launches.
     void                    setRenderModeFlags      (unsigned int renderModeFlags);                      // Affects all subsequent calls to drawTriangles(). Defaults to zero.
+    void                    setMinTriangleArea      (float pixels);                                      // Cull triangles whose snapped area is below this many pixels. Triangles that need clipping are kept. Defaults to zero.
     void                    deferredClear           (unsigned int clearColor);                           // Clears color and depth buffers during next call to drawTriangles().
     void                    setVertexBuffer         (void* vertices, int numVertices);                   // GPU pointer managed by caller. Vertex positions in clip space as float4 (x, y, z, w).
-    void                    setIndexBuffer          (void* indices, int numTriangles);                   // GPU pointer managed by caller. Triangle index+color quadruplets as uint4 (idx0, idx1, idx2, color).
-    bool                    drawTriangles           (const int* ranges, bool peel, STREAM stream); // Ranges (offsets and counts) as #triangles entries, not as bytes. If NULL, draw all triangles. Returns false in case of internal overflow.
+    void                    setIndexBuffer          (void* indices, int numTriangles, int indexType = IndexType_Int32); // GPU pointer managed by caller. Triangle indices (idx0, idx1, idx2) in the format given by IndexType_*.
+    void                    setVertexTransforms     (const void* matrices);                              // GPU pointer managed by caller, or NULL. In instance mode, one row-major 4x4 float matrix per image that transforms the vertex buffer, which is then shared by all images.
+    void                    setInstanceRange        (int offset, int count);                             // Triangles drawn for each instance when ranges are NULL. Defaults to all.
+    bool                    drawTriangles           (const int* ranges, bool peel, STREAM stream);       // Ranges (offsets and counts) as #triangles entries, not as bytes. If NULL, draw all triangles. Does not wait for the GPU. Returns false if an implicit resolve overflowed.
+    int                     resolve                 (void);                                              // Wait for overflow checks of pending draws and render overflowed images again. Returns DrawStatus_*.
+    void                    setCapacityPercentile   (float percentile);                                  // Percentile of observed demand used to size buffers for recurring workload shapes, in [0, 1]. Defaults to 1 (maximum).
+    CapacityStats           getCapacityStats        (void) const;
+    void                    resetCapacityStats      (void);
+    int                     getImageStats           (ImageStats* stats, int maxImages) const;            // Fills up to maxImages entries, returns the number of images of the current buffer size.
+    void                    resetImageStats         (void);
+    size_t                  getBufferBytes          (void) const;                                        // Bytes allocated for internal buffers, excluding small per-draw records.
+    void                    setMemoryBudget         (size_t bytes);                                      // Upper limit for intermediate buffers in bytes, 0 = unlimited (default). Images are rendered in batches that fit, and images that don't fit alone overflow. Draws fail if the smallest buffers of one image don't fit. Resolves pending draws first.
     void*                   getColorBuffer          (void);                                              // GPU pointer managed by CudaRaster.
     void*                   getDepthBuffer          (void);                                              // GPU pointer managed by CudaRaster.
-    void                    swapDepthAndPeel        (void);                                              // Swap depth and peeling buffers.
+    void                    swapDepthAndPeel        (void);                                              // Swap depth and peeling buffers. Resolves pending draws first.
 
 private:
 					        CudaRaster           	(const CudaRaster&); // forbidden
@@ -0,0 +1,211 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "../Allocator.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Allocator base.
+//------------------------------------------------------------------------
+
+Allocator::Allocator(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+Allocator::~Allocator(void)
+{
+    // empty
+}
+
+void* Allocator::allocate(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    void* ptr = doAllocate(bytes);
+    m_stats.numAllocs       += 1;
+    m_stats.bytesAllocated  += bytes;
+    m_stats.bytesInUse      += bytes;
+    if (m_stats.bytesInUse > m_stats.peakBytesInUse)
+        m_stats.peakBytesInUse = m_stats.bytesInUse;
+    return ptr;
+}
+
+void Allocator::release(void* ptr, size_t bytes)
+{
+    if (!ptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    doRelease(ptr, bytes);
+    m_stats.numReleases += 1;
+    m_stats.bytesInUse  -= bytes;
+}
+
+AllocatorStats Allocator::getStats(void) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void Allocator::resetStats(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    long long bytesInUse = m_stats.bytesInUse;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.bytesInUse      = bytesInUse;
+    m_stats.peakBytesInUse  = bytesInUse;
+}
+
+//------------------------------------------------------------------------
+// Host arena.
+//------------------------------------------------------------------------
+
+static const size_t c_arenaAlign = 256; // Same as driver allocations.
+
+static void* alignedAlloc(size_t bytes)
+{
+#ifdef _MSC_VER
+    return _aligned_malloc(bytes, c_arenaAlign);
+#else
+    return aligned_alloc(c_arenaAlign, bytes); // Size must be a multiple of the alignment.
+#endif
+}
+
+static void alignedFree(void* ptr)
+{
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+HostArenaAllocator::HostArenaAllocator(size_t chunkBytes)
+:   m_chunkBytes((chunkBytes + c_arenaAlign - 1) & ~(c_arenaAlign - 1))
+{
+    // empty
+}
+
+HostArenaAllocator::~HostArenaAllocator(void)
+{
+    for (int i=0; i < (int)m_chunks.size(); i++)
+        alignedFree(m_chunks[i].base);
+}
+
+void* HostArenaAllocator::doAllocate(size_t bytes)
+{
+    size_t size = (bytes + c_arenaAlign - 1) & ~(c_arenaAlign - 1);
+
+    // Bump-allocate from the first chunk with room.
+    for (int i=0; i < (int)m_chunks.size(); i++)
+    {
+        Chunk& c = m_chunks[i];
+        if (c.bytes - c.top < size)
+            continue;
+        void* ptr = c.base + c.top;
+        c.top += size;
+        c.numLive++;
+        return ptr;
+    }
+
+    // Add a chunk. Oversized requests get one of their own.
+    Chunk c;
+    c.bytes   = size > m_chunkBytes ? size : m_chunkBytes;
+    c.base    = (char*)alignedAlloc(c.bytes);
+    c.top     = size;
+    c.numLive = 1;
+    if (!c.base)
+        throw std::bad_alloc();
+    m_chunks.push_back(c);
+    return c.base;
+}
+
+void HostArenaAllocator::doRelease(void* ptr, size_t)
+{
+    for (int i=0; i < (int)m_chunks.size(); i++)
+    {
+        Chunk& c = m_chunks[i];
+        if ((char*)ptr < c.base || (char*)ptr >= c.base + c.bytes)
+            continue;
+        if (--c.numLive == 0)
+            c.top = 0; // Chunk is empty, start over.
+        return;
+    }
+}
+
+//------------------------------------------------------------------------
+// Size-class pool.
+//------------------------------------------------------------------------
+
+PoolAllocator::PoolAllocator(Allocator& upstream)
+:   m_upstream(upstream)
+{
+    // empty
+}
+
+PoolAllocator::~PoolAllocator(void)
+{
+    trimNoLock();
+}
+
+size_t PoolAllocator::getClassSize(size_t bytes)
+{
+    // Round up to 256 bytes, then to one of four steps between consecutive powers of two.
+    if (bytes <= 256)
+        return 256;
+    size_t pow2 = 256;
+    while (pow2 < bytes && pow2 <= ((size_t)-1 >> 1))
+        pow2 <<= 1;
+    size_t step = pow2 >> 3; // Quarter of the interval [pow2/2, pow2].
+    return (bytes + step - 1) / step * step;
+}
+
+void* PoolAllocator::doAllocate(size_t bytes)
+{
+    size_t size = getClassSize(bytes);
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        std::map<size_t, std::vector<void*> >::iterator it = m_free.find(size);
+        if (it != m_free.end() && !it->second.empty())
+        {
+            void* ptr = it->second.back();
+            it->second.pop_back();
+            return ptr;
+        }
+    }
+    return m_upstream.allocate(size);
+}
+
+void PoolAllocator::doRelease(void* ptr, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    m_free[getClassSize(bytes)].push_back(ptr);
+}
+
+void PoolAllocator::trim(void)
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    trimNoLock();
+}
+
+void PoolAllocator::trimNoLock(void)
+{
+    for (std::map<size_t, std::vector<void*> >::iterator it = m_free.begin(); it != m_free.end(); ++it)
+        for (int i=0; i < (int)it->second.size(); i++)
+            m_upstream.release(it->second[i], it->first);
+    m_free.clear();
+}
+
+//------------------------------------------------------------------------
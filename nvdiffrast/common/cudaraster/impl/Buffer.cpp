@@ -6,26 +6,39 @@
 // distribution of this software and related documentation without an express
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
-#include "../../framework.h"
 #include "Buffer.hpp"
 
 using namespace CR;
 
+//------------------------------------------------------------------------
+
+static size_t getGrowSize(size_t bytes, size_t oldBytes)
+{
+    size_t geometric = oldBytes + (oldBytes >> 1);
+    return bytes > geometric ? bytes : geometric;
+}
+
 //------------------------------------------------------------------------
 // GPU buffer.
 //------------------------------------------------------------------------
 
 Buffer::Buffer(void)
-:   m_gpuPtr(NULL),
-    m_bytes (0)
+:   m_allocator (&getDefaultDeviceAllocator()),
+    m_gpuPtr    (NULL),
+    m_bytes     (0)
 {
     // empty
 }
 
 Buffer::~Buffer(void)
 {
-    if (m_gpuPtr)
-        cudaFree(m_gpuPtr); // Don't throw an exception.
+    m_allocator->release(m_gpuPtr, m_bytes); // Doesn't throw an exception.
+}
+
+void Buffer::setAllocator(Allocator& allocator)
+{
+    reset(0);
+    m_allocator = &allocator;
 }
 
 void Buffer::reset(size_t bytes)
@@ -33,14 +46,11 @@ void Buffer::reset(size_t bytes)
     if (bytes == m_bytes)
         return;
 
-    if (m_gpuPtr)
-    {
-        NVDR_CHECK_CUDA_ERROR(cudaFree(m_gpuPtr));
-        m_gpuPtr = NULL;
-    }
+    m_allocator->release(m_gpuPtr, m_bytes);
+    m_gpuPtr = NULL;
 
     if (bytes > 0)
-        NVDR_CHECK_CUDA_ERROR(cudaMalloc(&m_gpuPtr, bytes));
+        m_gpuPtr = m_allocator->allocate(bytes);
 
     m_bytes = bytes;
 }
@@ -48,7 +58,7 @@ void Buffer::reset(size_t bytes)
 void Buffer::grow(size_t bytes)
 {
     if (bytes > m_bytes)
-        reset(bytes);
+        reset(getGrowSize(bytes, m_bytes));
 }
 
 //------------------------------------------------------------------------
@@ -56,16 +66,22 @@ void Buffer::grow(size_t bytes)
 //------------------------------------------------------------------------
 
 HostBuffer::HostBuffer(void)
-:   m_hostPtr(NULL),
-    m_bytes  (0)
+:   m_allocator (&getDefaultHostAllocator()),
+    m_hostPtr   (NULL),
+    m_bytes     (0)
 {
     // empty
 }
 
 HostBuffer::~HostBuffer(void)
 {
-    if (m_hostPtr)
-        cudaFreeHost(m_hostPtr); // Don't throw an exception.
+    m_allocator->release(m_hostPtr, m_bytes); // Doesn't throw an exception.
+}
+
+void HostBuffer::setAllocator(Allocator& allocator)
+{
+    reset(0);
+    m_allocator = &allocator;
 }
 
 void HostBuffer::reset(size_t bytes)
@@ -73,14 +89,11 @@ void HostBuffer::reset(size_t bytes)
     if (bytes == m_bytes)
         return;
 
-    if (m_hostPtr)
-    {
-        NVDR_CHECK_CUDA_ERROR(cudaFreeHost(m_hostPtr));
-        m_hostPtr = NULL;
-    }
+    m_allocator->release(m_hostPtr, m_bytes);
+    m_hostPtr = NULL;
 
     if (bytes > 0)
-        NVDR_CHECK_CUDA_ERROR(cudaMallocHost(&m_hostPtr, bytes));
+        m_hostPtr = m_allocator->allocate(bytes);
 
     m_bytes = bytes;
 }
@@ -88,7 +101,7 @@ void HostBuffer::reset(size_t bytes)
 void HostBuffer::grow(size_t bytes)
 {
     if (bytes > m_bytes)
-        reset(bytes);
+        reset(getGrowSize(bytes, m_bytes));
 }
 
 //------------------------------------------------------------------------
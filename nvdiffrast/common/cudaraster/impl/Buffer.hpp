@@ -8,25 +8,33 @@
 
 #pragma once
 #include "Defs.hpp"
+#include "../Allocator.hpp"
 
 namespace CR
 {
 //------------------------------------------------------------------------
 
+Allocator&          getDefaultDeviceAllocator   (void); // Driver allocators, in DriverAllocator.cpp.
+Allocator&          getDefaultHostAllocator     (void);
+
+//------------------------------------------------------------------------
+
 class Buffer
 {
 public:
                     Buffer      (void);
                     ~Buffer     (void);
 
-    void            reset       (size_t bytes);
-    void            grow        (size_t bytes);
+    void            setAllocator(Allocator& allocator);  // Releases current memory.
+    void            reset       (size_t bytes);         // Exact size.
+    void            grow        (size_t bytes);         // Geometric, at least 1.5x the previous size.
     void*           getPtr      (size_t offset = 0) { return (void*)(((uintptr_t)m_gpuPtr) + offset); }
     size_t          getSize     (void) const { return m_bytes; }
 
-    void            setPtr      (void* ptr) { m_gpuPtr = ptr; }
+    void            setPtr      (void* ptr) { m_gpuPtr = ptr; } // Must come from the same allocator with the same size.
 
 private:
+    Allocator*      m_allocator;
     void*           m_gpuPtr;
     size_t          m_bytes;
 };
@@ -39,14 +47,16 @@ public:
                     HostBuffer  (void);
                     ~HostBuffer (void);
 
-    void            reset       (size_t bytes);
-    void            grow        (size_t bytes);
+    void            setAllocator(Allocator& allocator);  // Releases current memory.
+    void            reset       (size_t bytes);         // Exact size.
+    void            grow        (size_t bytes);         // Geometric, at least 1.5x the previous size.
     void*           getPtr      (void) { return m_hostPtr; }
     size_t          getSize     (void) const { return m_bytes; }
 
-    void            setPtr      (void* ptr) { m_hostPtr = ptr; }
+    void            setPtr      (void* ptr) { m_hostPtr = ptr; } // Must come from the same allocator with the same size.
 
 private:
+    Allocator*      m_allocator;
     void*           m_hostPtr;
     size_t          m_bytes;
 };
@@ -0,0 +1,84 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "CapacityPredictor.hpp"
+#include <algorithm>
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+
+bool CapacityPredictor::Key::operator<(const Key& k) const
+{
+    if (width     != k.width)     return width     < k.width;
+    if (height    != k.height)    return height    < k.height;
+    if (numImages != k.numImages) return numImages < k.numImages;
+    return triCount < k.triCount;
+}
+
+//------------------------------------------------------------------------
+
+CapacityPredictor::CapacityPredictor(void)
+:   m_percentile(1.f)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------
+
+static S32 percentileOf(S32* values, int count, float percentile)
+{
+    int k = (int)(percentile * (float)(count - 1) + .5f);
+    k = std::min(std::max(k, 0), count - 1);
+    std::nth_element(values, values + k, values + count);
+    return values[k];
+}
+
+bool CapacityPredictor::predict(CRCapacities& demand, const Key& key) const
+{
+    std::map<Key, History>::const_iterator it = m_history.find(key);
+    if (it == m_history.end())
+        return false;
+
+    // Each field separately, the peaks don't necessarily come from the same draw.
+    const History& h = it->second;
+    int count = h.numValid;
+    S32 subtris[CR_PREDICTOR_HISTORY], binSegs[CR_PREDICTOR_HISTORY], tileSegs[CR_PREDICTOR_HISTORY];
+    for (int i=0; i < count; i++)
+    {
+        subtris[i]  = h.demand[i].maxSubtris;
+        binSegs[i]  = h.demand[i].maxBinSegs;
+        tileSegs[i] = h.demand[i].maxTileSegs;
+    }
+
+    demand.maxSubtris  = percentileOf(subtris,  count, m_percentile);
+    demand.maxBinSegs  = percentileOf(binSegs,  count, m_percentile);
+    demand.maxTileSegs = percentileOf(tileSegs, count, m_percentile);
+    return true;
+}
+
+void CapacityPredictor::record(const Key& key, const CRCapacities& demand)
+{
+    // Forget an arbitrary shape when full. Workloads with this many shapes aren't repetitive anyway.
+    std::map<Key, History>::iterator it = m_history.find(key);
+    if (it == m_history.end())
+    {
+        if ((int)m_history.size() >= CR_PREDICTOR_MAX_KEYS)
+            m_history.erase(m_history.begin());
+        it = m_history.insert(std::make_pair(key, History())).first;
+        it->second.numValid = 0;
+        it->second.next     = 0;
+    }
+
+    History& h = it->second;
+    h.demand[h.next] = demand;
+    h.next     = (h.next + 1) % CR_PREDICTOR_HISTORY;
+    h.numValid = std::min(h.numValid + 1, CR_PREDICTOR_HISTORY);
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "Defs.hpp"
+#include <map>
+
+namespace CR
+{
+//------------------------------------------------------------------------
+
+#define CR_PREDICTOR_HISTORY    32      // Observations kept per workload shape.
+#define CR_PREDICTOR_MAX_KEYS   1024    // Workload shapes remembered.
+
+//------------------------------------------------------------------------
+// Intermediate buffer capacities, per image.
+//------------------------------------------------------------------------
+
+struct CRCapacities
+{
+    S32         maxSubtris;
+    S32         maxBinSegs;
+    S32         maxTileSegs;
+};
+
+//------------------------------------------------------------------------
+// Learns the intermediate buffer demand of recurring workload shapes from
+// the atomics of earlier draws. The demand of a draw is the maximum over
+// its images, and the prediction is the configured percentile over the
+// latest observations of the same shape.
+//------------------------------------------------------------------------
+
+class CapacityPredictor
+{
+public:
+    struct Key
+    {
+        S32                 width;                  // Viewport in pixels.
+        S32                 height;
+        S32                 numImages;
+        S32                 triCount;               // Maximum over images.
+
+        bool                operator<               (const Key& k) const;
+    };
+
+                            CapacityPredictor       (void);
+
+    void                    setPercentile           (float percentile) { m_percentile = percentile; } // In [0, 1], 1 = maximum.
+    float                   getPercentile           (void) const { return m_percentile; }
+    bool                    predict                 (CRCapacities& demand, const Key& key) const; // Returns false if the shape hasn't been seen.
+    void                    record                  (const Key& key, const CRCapacities& demand);
+    void                    clear                   (void) { m_history.clear(); }
+
+private:
+    struct History
+    {
+        CRCapacities        demand[CR_PREDICTOR_HISTORY];
+        S32                 numValid;
+        S32                 next;                   // Ring buffer position.
+    };
+
+    float                   m_percentile;
+    std::map<Key, History>  m_history;
+};
+
+//------------------------------------------------------------------------
+} // namespace CR
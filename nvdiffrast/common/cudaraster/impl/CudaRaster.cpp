@@ -9,6 +9,8 @@
 #include "Defs.hpp"
 #include "../CudaRaster.hpp"
 #include "RasterImpl.hpp"
+#include <algorithm>
+#include <cstring>
 
 using namespace CR;
 
@@ -26,6 +28,11 @@ CudaRaster::~CudaRaster()
     delete m_impl;
 }
 
+void CudaRaster::setAllocators(Allocator* device, Allocator* host)
+{
+    m_impl->setAllocators(device ? *device : getDefaultDeviceAllocator(), host ? *host : getDefaultHostAllocator());
+}
+
 void CudaRaster::setBufferSize(int width, int height, int numImages)
 {
     m_impl->setBufferSize(Vec3i(width, height, numImages));
@@ -41,6 +48,11 @@ void CudaRaster::setRenderModeFlags(U32 flags)
     m_impl->setRenderModeFlags(flags);
 }
 
+void CudaRaster::setMinTriangleArea(float pixels)
+{
+    m_impl->setMinTriangleArea(pixels);
+}
+
 void CudaRaster::deferredClear(U32 clearColor)
 {
     m_impl->deferredClear(clearColor);
@@ -51,9 +63,19 @@ void CudaRaster::setVertexBuffer(void* vertices, int numVertices)
     m_impl->setVertexBuffer(vertices, numVertices);
 }
 
-void CudaRaster::setIndexBuffer(void* indices, int numTriangles)
+void CudaRaster::setVertexTransforms(const void* matrices)
+{
+    m_impl->setVertexTransforms(matrices);
+}
+
+void CudaRaster::setIndexBuffer(void* indices, int numTriangles, int indexType)
 {
-    m_impl->setIndexBuffer(indices, numTriangles);
+    m_impl->setIndexBuffer(indices, numTriangles, indexType == IndexType_UInt16);
+}
+
+void CudaRaster::setInstanceRange(int offset, int count)
+{
+    m_impl->setInstanceRange(offset, count);
 }
 
 bool CudaRaster::drawTriangles(const int* ranges, bool peel, cudaStream_t stream)
@@ -61,6 +83,73 @@ bool CudaRaster::drawTriangles(const int* ranges, bool peel, cudaStream_t stream
     return m_impl->drawTriangles((const Vec2i*)ranges, peel, stream);
 }
 
+int CudaRaster::resolve(void)
+{
+    static_assert((int)DrawStatus_Overflow == (int)RasterPlanner::Status_Overflow, "draw status mismatch");
+    return m_impl->resolve();
+}
+
+void CudaRaster::setCapacityPercentile(float percentile)
+{
+    m_impl->setCapacityPercentile(percentile);
+}
+
+CapacityStats CudaRaster::getCapacityStats(void) const
+{
+    const RasterPlanner::Stats& s = m_impl->getCapacityStats();
+    CapacityStats r;
+    r.numDraws        = s.numDraws;
+    r.numRetried      = s.numRetried;
+    r.numPredicted    = s.numPredicted;
+    r.numMispredicted = s.numMispredicted;
+    return r;
+}
+
+void CudaRaster::resetCapacityStats(void)
+{
+    m_impl->resetCapacityStats();
+}
+
+int CudaRaster::getImageStats(ImageStats* stats, int maxImages) const
+{
+    // Viewport tiles are drawn as separate images. Sum their work, capacities are per tile.
+    const std::vector<RasterPlanner::ImageStats>& s = m_impl->getImageStats();
+    int numImages = m_impl->getNumImages();
+    int numTiles  = m_impl->getNumViewportTiles();
+    for (int i=0; i < numImages && i < maxImages; i++)
+    {
+        ImageStats& r = stats[i];
+        memset(&r, 0, sizeof(r));
+        for (int j = i * numTiles; j < (i + 1) * numTiles && j < (int)s.size(); j++) // Not drawn since reset if out of range.
+        {
+            r.numSubtris     += s[j].numSubtris;
+            r.numBinSegs     += s[j].numBinSegs;
+            r.numTileSegs    += s[j].numTileSegs;
+            r.numActiveTiles += s[j].numActiveTiles;
+            r.numRetries     = std::max(r.numRetries,  s[j].numRetries);
+            r.maxSubtris     = std::max(r.maxSubtris,  s[j].caps.maxSubtris);
+            r.maxBinSegs     = std::max(r.maxBinSegs,  s[j].caps.maxBinSegs);
+            r.maxTileSegs    = std::max(r.maxTileSegs, s[j].caps.maxTileSegs);
+        }
+    }
+    return numImages;
+}
+
+void CudaRaster::resetImageStats(void)
+{
+    m_impl->resetImageStats();
+}
+
+size_t CudaRaster::getBufferBytes(void) const
+{
+    return m_impl->getTotalBufferSizes();
+}
+
+void CudaRaster::setMemoryBudget(size_t bytes)
+{
+    m_impl->setMemoryBudget(bytes);
+}
+
 void* CudaRaster::getColorBuffer(void)
 {
     return m_impl->getColorBuffer();
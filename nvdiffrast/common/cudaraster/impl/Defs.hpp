@@ -7,7 +7,7 @@
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #pragma once
-#ifdef USE_ROCM
+#if defined(USE_ROCM) && !defined(NVDR_CPU_ONLY)
 #include <hip/hip_runtime.h> 
 #endif
 #include <cstdint>
@@ -34,6 +34,12 @@ namespace CR
 #   define CR_CUDA_CONST    static const
 #endif
 
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#   define CR_HOST_DEVICE_FUNC  __host__ __device__ __inline__   // Callable from kernels and host code alike.
+#else
+#   define CR_HOST_DEVICE_FUNC  inline
+#endif
+
 #define CR_UNREF(X)         ((void)(X))
 #define CR_ARRAY_SIZE(X)    ((int)(sizeof(X) / sizeof((X)[0])))
 
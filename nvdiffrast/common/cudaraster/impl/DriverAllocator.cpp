@@ -0,0 +1,59 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "../../framework.h"
+#include "Buffer.hpp"
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Driver allocators. Kept apart from the other allocators and the buffers,
+// which need neither the driver nor the framework headers.
+//------------------------------------------------------------------------
+
+void* DeviceAllocator::doAllocate(size_t bytes)
+{
+    void* ptr = NULL;
+    NVDR_CHECK_CUDA_ERROR(cudaMalloc(&ptr, bytes));
+    return ptr;
+}
+
+void DeviceAllocator::doRelease(void* ptr, size_t)
+{
+    cudaFree(ptr); // Don't throw an exception.
+}
+
+void* PinnedHostAllocator::doAllocate(size_t bytes)
+{
+    void* ptr = NULL;
+    NVDR_CHECK_CUDA_ERROR(cudaMallocHost(&ptr, bytes));
+    return ptr;
+}
+
+void PinnedHostAllocator::doRelease(void* ptr, size_t)
+{
+    cudaFreeHost(ptr); // Don't throw an exception.
+}
+
+//------------------------------------------------------------------------
+// Default allocators.
+//------------------------------------------------------------------------
+
+Allocator& CR::getDefaultDeviceAllocator(void)
+{
+    static DeviceAllocator s_allocator;
+    return s_allocator;
+}
+
+Allocator& CR::getDefaultHostAllocator(void)
+{
+    static PinnedHostAllocator s_allocator;
+    return s_allocator;
+}
+
+//------------------------------------------------------------------------
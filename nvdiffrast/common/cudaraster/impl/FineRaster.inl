@@ -204,6 +204,12 @@ __device__ __inline__ void fineRasterImpl(const CRParams p)
     const S32*      activeTiles     = (const S32*)p.activeTiles  + CR_MAXTILES_SQR * blockIdx.z;
     const S32*      tileFirstSeg    = (const S32*)p.tileFirstSeg + CR_MAXTILES_SQR * blockIdx.z;
 
+    // Output image and viewport tile.
+    const CRImageParams& ip         = getImageParams(p, blockIdx.z);
+    int             vpX             = ip.vpTileX * p.widthPixels;
+    int             vpY             = ip.vpTileY * p.heightPixels;
+    size_t          imageOffset     = (size_t)p.strideX * p.strideY * ip.imageIdx + vpX + (size_t)p.strideX * vpY;
+
     volatile U32*   tileColor       = s_tileColor[threadIdx.y];
     volatile U32*   tileDepth       = s_tileDepth[threadIdx.y];
     volatile U32*   tilePeel        = s_tilePeel[threadIdx.y];
@@ -238,6 +244,10 @@ __device__ __inline__ void fineRasterImpl(const CRParams p)
         int px = (tileX << CR_TILE_LOG2) + (threadIdx.x & (CR_TILE_SIZE - 1));
         int py = (tileY << CR_TILE_LOG2) + (threadIdx.x >> CR_TILE_LOG2);
 
+        // Last viewport tiles may extend past the buffer.
+        if (vpX + (tileX << CR_TILE_LOG2) >= p.strideX || vpY + (tileY << CR_TILE_LOG2) >= p.strideY)
+            continue;
+
         // initialize per-tile state
         int triRead = 0, triWrite = 0;
         int fragRead = 0, fragWrite = 0;
@@ -254,8 +264,8 @@ __device__ __inline__ void fineRasterImpl(const CRParams p)
         }
         else // otherwise => read tile from framebuffer
         {
-            U32* pColor = (U32*)p.colorBuffer + p.strideX * p.strideY * blockIdx.z;
-            U32* pDepth = (U32*)p.depthBuffer + p.strideX * p.strideY * blockIdx.z;
+            U32* pColor = (U32*)p.colorBuffer + imageOffset;
+            U32* pDepth = (U32*)p.depthBuffer + imageOffset;
 			tileColor[threadIdx.x] = pColor[px + p.strideX * py];
             tileDepth[threadIdx.x] = pDepth[px + p.strideX * py];
             tileColor[threadIdx.x + 32] = pColor[px + p.strideX * (py + 4)];
@@ -265,7 +275,7 @@ __device__ __inline__ void fineRasterImpl(const CRParams p)
         // read peeling inputs if enabled
         if (p.renderModeFlags & CudaRaster::RenderModeFlag_EnableDepthPeeling)
         {
-            U32* pPeel = (U32*)p.peelBuffer + p.strideX * p.strideY * blockIdx.z;
+            U32* pPeel = (U32*)p.peelBuffer + imageOffset;
             tilePeel[threadIdx.x] = pPeel[px + p.strideX * py];
             tilePeel[threadIdx.x + 32] = pPeel[px + p.strideX * (py + 4)];
         }
@@ -389,8 +399,8 @@ __device__ __inline__ void fineRasterImpl(const CRParams p)
         {
             int px = (tileX << CR_TILE_LOG2) + (threadIdx.x & (CR_TILE_SIZE - 1));
             int py = (tileY << CR_TILE_LOG2) + (threadIdx.x >> CR_TILE_LOG2);
-            U32* pColor = (U32*)p.colorBuffer + p.strideX * p.strideY * blockIdx.z;
-            U32* pDepth = (U32*)p.depthBuffer + p.strideX * p.strideY * blockIdx.z;
+            U32* pColor = (U32*)p.colorBuffer + imageOffset;
+            U32* pDepth = (U32*)p.depthBuffer + imageOffset;
             pColor[px + p.strideX * py] = tileColor[threadIdx.x];
             pDepth[px + p.strideX * py] = tileDepth[threadIdx.x];
             pColor[px + p.strideX * (py + 4)] = tileColor[threadIdx.x + 32];
@@ -66,6 +66,10 @@ struct CRImageParams
 {
     S32         triOffset;          // First triangle index to draw.
     S32         triCount;           // Number of triangles to draw.
+    S32         taskOffset;         // In range mode, triangles of the preceding images in the draw.
+    S32         imageIdx;           // Output image. A large viewport is drawn as several images, one per viewport tile.
+    S32         vpTileX;            // Viewport tile within the output image.
+    S32         vpTileY;
     S32         binBatchSize;       // Number of triangles per batch.
 };
 
@@ -78,12 +82,14 @@ struct CRParams
     CRAtomics*  atomics;            // Work counters. Per-image.
     S32         numImages;          // Batch size.
     S32         totalCount;         // In range mode, total number of triangles to render.
+    S32         taskBase;           // In range mode, taskOffset of the first image.
     S32         instanceMode;       // 0 = range mode, 1 = instance mode.
 
     S32         numVertices;        // Number of vertices in input buffer, not counting multiples in instance mode.
     S32         numTriangles;       // Number of triangles in input buffer.
     void*       vertexBuffer;       // numVertices * float4(x, y, z, w)
-    void*       indexBuffer;        // numTriangles * int3(vi0, vi1, vi2)
+    void*       indexBuffer;        // numTriangles * int3(vi0, vi1, vi2), or ushort3 with the U16 setup kernel
+    const void* vertexMtx;          // numImages * float4x4, row-major. If set, all images share vertexBuffer and transform it. Instance mode only.
 
     S32         widthPixels;        // Render buffer size in pixels. Must be multiple of tile size (8x8).
     S32         heightPixels;
@@ -103,6 +109,7 @@ struct CRParams
     S32         numTiles;           // widthTiles * heightTiles
 
     U32         renderModeFlags;
+    S32         minArea;            // Cull triangles whose doubled area in subpixels is smaller. Not applied to clipped triangles.
     S32         deferredClear;      // 1 = Clear framebuffer before rendering triangles.
     U32         clearColor;
     U32         clearDepth;
@@ -149,5 +156,108 @@ struct CRParams
     const CRImageParams* imageParamsExtra; // After CR_EMBED_IMAGE_PARAMS.
 };
 
+//------------------------------------------------------------------------
+// Range mode task numbering. Setup tasks are numbered consecutively over
+// the images of a draw, and a launch covers a run of images starting from
+// the task offset of its first image. Shared by the host and the setup
+// kernel.
+//------------------------------------------------------------------------
+
+// Assigns taskOffset to each image, zero in instance mode. Returns the total number of tasks, which may exceed 2^31-1.
+static inline S64 setTaskOffsets(CRImageParams* imageParams, int numImages, bool instanceMode)
+{
+    S64 taskOffset = 0;
+    for (int i=0; i < numImages; i++)
+    {
+        imageParams[i].taskOffset = (S32)taskOffset;
+        if (!instanceMode && imageParams[i].triCount > 0)
+            taskOffset += imageParams[i].triCount;
+    }
+    return taskOffset;
+}
+
+// Sets taskBase and totalCount for a launch of a run of images in range mode.
+static inline void setTaskRange(CRParams& p, const CRImageParams* imageParams, int numImages)
+{
+    const CRImageParams& last = imageParams[numImages - 1];
+    p.taskBase   = imageParams[0].taskOffset;
+    p.totalCount = last.taskOffset + (last.triCount > 0 ? last.triCount : 0) - p.taskBase;
+}
+
+CR_HOST_DEVICE_FUNC const CRImageParams& getImageParams(const CRParams& p, int idx)
+{
+    return (idx < CR_EMBED_IMAGE_PARAMS) ? p.imageParamsFirst[idx] : p.imageParamsExtra[idx - CR_EMBED_IMAGE_PARAMS];
+}
+
+// Last image of the launch whose first task is at or before taskIdx. Empty images share the
+// offset of the next image and are thus never returned for taskIdx < totalCount.
+CR_HOST_DEVICE_FUNC int findImageForTask(const CRParams& p, int taskIdx)
+{
+    int lo = 0;
+    int hi = p.numImages - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) >> 1;
+        if (getImageParams(p, mid).taskOffset - p.taskBase <= taskIdx)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+//------------------------------------------------------------------------
+// Viewport tiling. A viewport larger than CR_MAXVIEWPORT_SIZE is split
+// into equal tiles, and each tile of each output image is drawn as an
+// image of its own. Vertices are shifted by two units in normalized
+// device coordinates per tile, and the fine stage writes a tile at a
+// multiple of its size in pixels, so tiles must be multiples of
+// CR_TILE_SIZE.
+//------------------------------------------------------------------------
+
+// Equal tiles of at most CR_MAXVIEWPORT_SIZE covering the viewport. The last ones may extend past it.
+static inline void getViewportTiling(Vec2i size, Vec2i& numTiles, Vec2i& tileSize)
+{
+    numTiles.x = (size.x > CR_MAXVIEWPORT_SIZE) ? (size.x + CR_MAXVIEWPORT_SIZE - 1) / CR_MAXVIEWPORT_SIZE : 1;
+    numTiles.y = (size.y > CR_MAXVIEWPORT_SIZE) ? (size.y + CR_MAXVIEWPORT_SIZE - 1) / CR_MAXVIEWPORT_SIZE : 1;
+    tileSize.x = ((size.x + numTiles.x - 1) / numTiles.x + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+    tileSize.y = ((size.y + numTiles.y - 1) / numTiles.y + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+}
+
+// Output image and viewport tile of an image of the draw. Tiles are consecutive per output image, in row-major order.
+static inline void setImageTile(CRImageParams& ip, int drawImageIdx, Vec2i numVpTiles)
+{
+    int numTiles = numVpTiles.x * numVpTiles.y;
+    int tile     = drawImageIdx % numTiles;
+    ip.imageIdx  = drawImageIdx / numTiles;
+    ip.vpTileX   = tile % numVpTiles.x;
+    ip.vpTileY   = tile / numVpTiles.x;
+}
+
+// Vertex position adjustments that map the full viewport of bufferSize onto the one of sizeVp at offset, or onto its first tile.
+static inline void setViewportTransform(CRParams& p, Vec2i bufferSize, Vec2i sizeVp, Vec2i offset)
+{
+    p.xs = (float)bufferSize.x / (float)sizeVp.x;
+    p.ys = (float)bufferSize.y / (float)sizeVp.y;
+    p.xo = (float)(bufferSize.x - sizeVp.x - 2 * offset.x) / (float)sizeVp.x;
+    p.yo = (float)(bufferSize.y - sizeVp.y - 2 * offset.y) / (float)sizeVp.y;
+}
+
+//------------------------------------------------------------------------
+// Converts a triangle area threshold in pixels to the units of
+// CRParams::minArea, rounding up. Shared with the CPU rasterizer.
+//------------------------------------------------------------------------
+
+static inline S32 minTriangleAreaToSubpixels(float pixels)
+{
+    F32 area = pixels * (F32)(2 * CR_SUBPIXEL_SQR);
+    if (!(area > 0.f))
+        return 0; // Also catches NaN.
+    if (area >= (F32)(1 << 30))
+        return 1 << 30; // Larger than any triangle on the fast path.
+    S32 res = (S32)area;
+    return ((F32)res < area) ? res + 1 : res;
+}
+
 //------------------------------------------------------------------------
 }
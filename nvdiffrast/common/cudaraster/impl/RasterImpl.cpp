@@ -10,6 +10,7 @@
 #include "PrivateDefs.hpp"
 #include "Constants.hpp"
 #include "RasterImpl.hpp"
+#include "../../profiler.h"
 #ifdef USE_ROCM
 #include <hip/hip_runtime.h>
 #else
@@ -30,6 +31,7 @@ using std::max;
 // Kernel prototypes and variables.
 
 void triangleSetupKernel (const CRParams p);
+void triangleSetupKernelU16(const CRParams p);
 void binRasterKernel     (const CRParams p);
 void coarseRasterKernel  (const CRParams p);
 void fineRasterKernel    (const CRParams p);
@@ -38,20 +40,30 @@ void fineRasterKernel    (const CRParams p);
 
 RasterImpl::RasterImpl(void)
 :   m_renderModeFlags       (0),
+    m_minArea               (0),
     m_deferredClear         (false),
     m_clearColor            (0),
     m_vertexPtr             (NULL),
     m_indexPtr              (NULL),
+    m_shortIndices          (false),
+    m_vertexMtxPtr          (NULL),
     m_numVertices           (0),
     m_numTriangles          (0),
+    m_instanceRange         (0, CR_S32_MAX),
     m_bufferSizesReported   (0),
 
+    m_deferredStatus        (RasterPlanner::Status_Success),
+    m_lastFullSlot          (0),
+    m_intermediateValid     (false),
+    m_reservedBatchSize     (0),
+
     m_numImages             (0),
     m_bufferSizePixels      (0, 0),
     m_bufferSizeVp          (0, 0),
     m_sizePixels            (0, 0),
     m_sizeVp                (0, 0),
     m_offsetPixels          (0, 0),
+    m_numVpTiles            (1, 1),
     m_sizeBins              (0, 0),
     m_numBins               (0),
     m_sizeTiles             (0, 0),
@@ -60,12 +72,10 @@ RasterImpl::RasterImpl(void)
     m_numSMs                (1),
     m_numCoarseBlocksPerSM  (1),
     m_numFineBlocksPerSM    (1),
-    m_numFineWarpsPerBlock  (1),
-
-    m_maxSubtris            (1),
-    m_maxBinSegs            (1),
-    m_maxTileSegs           (1)
+    m_numFineWarpsPerBlock  (1)
 {
+    memset(&m_reservedCaps, 0, sizeof(m_reservedCaps));
+
     // Query relevant device attributes.
 #ifdef USE_ROCM
     int currentDevice = 0;
@@ -83,6 +93,7 @@ RasterImpl::RasterImpl(void)
     // Setup functions.
 
     NVDR_CHECK_CUDA_ERROR(hipFuncSetCacheConfig((void*)triangleSetupKernel, hipFuncCachePreferShared));
+    NVDR_CHECK_CUDA_ERROR(hipFuncSetCacheConfig((void*)triangleSetupKernelU16, hipFuncCachePreferShared));
     NVDR_CHECK_CUDA_ERROR(hipFuncSetCacheConfig((void*)binRasterKernel,     hipFuncCachePreferShared));
     NVDR_CHECK_CUDA_ERROR(hipFuncSetCacheConfig((void*)coarseRasterKernel,  hipFuncCachePreferShared));
     NVDR_CHECK_CUDA_ERROR(hipFuncSetCacheConfig((void*)fineRasterKernel,    hipFuncCachePreferShared));
@@ -99,6 +110,7 @@ RasterImpl::RasterImpl(void)
     // Setup functions.
 
     NVDR_CHECK_CUDA_ERROR(cudaFuncSetCacheConfig((void*)triangleSetupKernel, cudaFuncCachePreferShared));
+    NVDR_CHECK_CUDA_ERROR(cudaFuncSetCacheConfig((void*)triangleSetupKernelU16, cudaFuncCachePreferShared));
     NVDR_CHECK_CUDA_ERROR(cudaFuncSetCacheConfig((void*)binRasterKernel,     cudaFuncCachePreferShared));
     NVDR_CHECK_CUDA_ERROR(cudaFuncSetCacheConfig((void*)coarseRasterKernel,  cudaFuncCachePreferShared));
     NVDR_CHECK_CUDA_ERROR(cudaFuncSetCacheConfig((void*)fineRasterKernel,    cudaFuncCachePreferShared));
@@ -109,23 +121,56 @@ RasterImpl::RasterImpl(void)
 
 RasterImpl::~RasterImpl(void)
 {
-    // Empty.
+    for (int i=0; i < (int)m_pending.size(); i++)
+    {
+        if (!m_pending[i].event)
+            continue;
+#ifdef USE_ROCM
+        hipEventDestroy((hipEvent_t)m_pending[i].event); // Don't throw an exception.
+#else
+        cudaEventDestroy((cudaEvent_t)m_pending[i].event); // Don't throw an exception.
+#endif
+    }
 }
 
 //------------------------------------------------------------------------
 
 void RasterImpl::setBufferSize(Vec3i size)
 {
+    // Pending draws refer to the current buffers.
+    if (m_planner.getNumPending())
+        m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
+
     // Internal buffer width and height must be divisible by tile size.
     int w = (size.x + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
     int h = (size.y + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
 
+    if (size.z != m_numImages)
+        m_intermediateValid = false;
+
     m_bufferSizePixels = Vec2i(w, h);
     m_bufferSizeVp     = Vec2i(size.x, size.y);
     m_numImages        = size.z;
 
-    m_colorBuffer.reset(w * h * size.z * sizeof(U32));
-    m_depthBuffer.reset(w * h * size.z * sizeof(U32));
+    m_colorBuffer.grow(w * h * size.z * sizeof(U32));
+    m_depthBuffer.grow(w * h * size.z * sizeof(U32));
+}
+
+//------------------------------------------------------------------------
+
+void RasterImpl::setAllocators(Allocator& device, Allocator& host)
+{
+    // Pending draws refer to the current buffers.
+    if (m_planner.getNumPending())
+        m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
+
+    Buffer* buffers[] = { &m_colorBuffer, &m_depthBuffer, &m_peelBuffer, &m_crAtomics, &m_crImageParamsExtra, &m_triSubtris, &m_triHeader, &m_triData,
+        &m_binFirstSeg, &m_binTotal, &m_binSegData, &m_binSegNext, &m_binSegCount, &m_activeTiles, &m_tileFirstSeg, &m_tileSegData, &m_tileSegNext, &m_tileSegCount };
+    for (int i=0; i < CR_ARRAY_SIZE(buffers); i++)
+        buffers[i]->setAllocator(device);
+    m_crAtomicsHost.setAllocator(host);
+    m_crImageParamsHost.setAllocator(host);
+    m_intermediateValid = false;
 }
 
 //------------------------------------------------------------------------
@@ -135,6 +180,21 @@ void RasterImpl::setViewport(Vec2i size, Vec2i offset)
     // Offset must be divisible by tile size.
     NVDR_CHECK((offset.x & (CR_TILE_SIZE - 1)) == 0 && (offset.y & (CR_TILE_SIZE - 1)) == 0, "invalid viewport offset");
 
+    // Split into viewport tiles if too large. All tiles have the same size, the last ones may extend
+    // past the buffer.
+    Vec2i numTiles(1, 1), tileSize(0, 0);
+    getViewportTiling(size, numTiles, tileSize);
+    if (numTiles.x > 1) size.x = tileSize.x;
+    if (numTiles.y > 1) size.y = tileSize.y;
+
+    // Pending draws refer to the per-image layout of the current tiling.
+    if (numTiles.x != m_numVpTiles.x || numTiles.y != m_numVpTiles.y)
+    {
+        if (m_planner.getNumPending())
+            m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
+        m_intermediateValid = false;
+    }
+
     // Round internal viewport size to multiples of tile size.
     int w = (size.x + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
     int h = (size.y + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
@@ -142,6 +202,7 @@ void RasterImpl::setViewport(Vec2i size, Vec2i offset)
     m_sizePixels    = Vec2i(w, h);
     m_offsetPixels  = offset;
     m_sizeVp        = Vec2i(size.x, size.y);
+    m_numVpTiles    = numTiles;
     m_sizeTiles.x   = m_sizePixels.x >> CR_TILE_LOG2;
     m_sizeTiles.y   = m_sizePixels.y >> CR_TILE_LOG2;
     m_numTiles      = m_sizeTiles.x * m_sizeTiles.y;
@@ -150,8 +211,14 @@ void RasterImpl::setViewport(Vec2i size, Vec2i offset)
     m_numBins       = m_sizeBins.x * m_sizeBins.y;
 }
 
+//------------------------------------------------------------------------
+
 void RasterImpl::swapDepthAndPeel(void)
 {
+    // Pending draws refer to the current buffers.
+    if (m_planner.getNumPending())
+        m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
+
     m_peelBuffer.reset(m_depthBuffer.getSize()); // Ensure equal size and valid pointer.
 
     void* tmp = m_depthBuffer.getPtr();
@@ -165,162 +232,84 @@ bool RasterImpl::drawTriangles(const Vec2i* ranges, bool peel, STREAM stream)
 {
     bool instanceMode = (!ranges);
 
-    int maxSubtrisSlack     = 4096;     // x 81B    = 324KB
-    int maxBinSegsSlack     = 256;      // x 2137B  = 534KB
-    int maxTileSegsSlack    = 4096;     // x 136B   = 544KB
+    // No split of the workload helps if the smallest buffers of one image exceed the budget.
+    NVDR_CHECK(m_planner.fitsBudget(m_numBins, m_numTiles), "memory budget too small for the intermediate buffers of a single image at this viewport size");
+
+    // Peeling reuses the setup, bin and coarse results of the previous draw. These must be final
+    // and intact, otherwise run all stages.
+    if (peel && m_planner.getNumPending())
+        m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
+    peel = peel && m_intermediateValid;
 
-    // Resize atomics as needed.
-    m_crAtomics    .grow(m_numImages * sizeof(CRAtomics));
-    m_crAtomicsHost.grow(m_numImages * sizeof(CRAtomics));
+    // Make room for another pending draw.
+    if (m_planner.getNumPending() == CR_MAX_PENDING_DRAWS)
+        m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
 
-    // Size of these buffers doesn't depend on input.
-    m_binFirstSeg  .grow(m_numImages * CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32));
-    m_binTotal     .grow(m_numImages * CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32));
-    m_activeTiles  .grow(m_numImages * CR_MAXTILES_SQR * sizeof(S32));
-    m_tileFirstSeg .grow(m_numImages * CR_MAXTILES_SQR * sizeof(S32));
+    // Viewport tiles are drawn as separate images, consecutive per output image.
+    int numImages = getNumDrawImages();
 
-    // Construct per-image parameters and determine worst-case buffer sizes.
-    m_crImageParamsHost.grow(m_numImages * sizeof(CRImageParams));
-    CRImageParams* imageParams = (CRImageParams*)m_crImageParamsHost.getPtr();
-    for (int i=0; i < m_numImages; i++)
+    // Resize atomics as needed. Host-side copies are kept per slot until resolved.
+    m_crAtomics    .grow(numImages * sizeof(CRAtomics));
+    m_crAtomicsHost.grow(CR_MAX_PENDING_DRAWS * numImages * sizeof(CRAtomics));
+
+    // Construct per-image parameters.
+    int slot = m_planner.getNumPending();
+    m_crImageParamsHost.grow(CR_MAX_PENDING_DRAWS * numImages * sizeof(CRImageParams));
+    CRImageParams* imageParams = (CRImageParams*)m_crImageParamsHost.getPtr() + slot * numImages;
+    for (int j=0; j < numImages; j++)
     {
-        CRImageParams& ip = imageParams[i];
+        CRImageParams& ip = imageParams[j];
+        setImageTile(ip, j, m_numVpTiles);
+        int i = ip.imageIdx;
 
         int roundSize  = CR_BIN_WARPS * 32;
         int minBatches = CR_BIN_STREAMS_SIZE * 2;
         int maxRounds  = 32;
 
-        ip.triOffset = instanceMode ? 0 : ranges[i].x;
-        ip.triCount  = instanceMode ? m_numTriangles : ranges[i].y;
+        ip.triOffset = instanceMode ? m_instanceRange.x : ranges[i].x;
+        ip.triCount  = instanceMode ? min(m_instanceRange.y, m_numTriangles - m_instanceRange.x) : ranges[i].y;
         ip.binBatchSize = min(max(ip.triCount / (roundSize * minBatches), 1), maxRounds) * roundSize;
-
-        m_maxSubtris  = max(m_maxSubtris,  min(ip.triCount + maxSubtrisSlack, CR_MAXSUBTRIS_SIZE));
-        m_maxBinSegs  = max(m_maxBinSegs,  max(m_numBins * CR_BIN_STREAMS_SIZE, (ip.triCount - 1) / CR_BIN_SEG_SIZE + 1) + maxBinSegsSlack);
-        m_maxTileSegs = max(m_maxTileSegs, max(m_numTiles, (ip.triCount - 1) / CR_TILE_SEG_SIZE + 1) + maxTileSegsSlack);
-    }
-
-    // Retry until successful.
-
-    for (;;)
-    {
-        // Allocate buffers.
-        m_triSubtris.reset(m_numImages * m_maxSubtris * sizeof(U8));
-        m_triHeader .reset(m_numImages * m_maxSubtris * sizeof(CRTriangleHeader));
-        m_triData   .reset(m_numImages * m_maxSubtris * sizeof(CRTriangleData));
-
-        m_binSegData .reset(m_numImages * m_maxBinSegs * CR_BIN_SEG_SIZE * sizeof(S32));
-        m_binSegNext .reset(m_numImages * m_maxBinSegs * sizeof(S32));
-        m_binSegCount.reset(m_numImages * m_maxBinSegs * sizeof(S32));
-
-        m_tileSegData .reset(m_numImages * m_maxTileSegs * CR_TILE_SEG_SIZE * sizeof(S32));
-        m_tileSegNext .reset(m_numImages * m_maxTileSegs * sizeof(S32));
-        m_tileSegCount.reset(m_numImages * m_maxTileSegs * sizeof(S32));
-
-        // Report if buffers grow from last time.
-        size_t sizesTotal = getTotalBufferSizes();
-        if (sizesTotal > m_bufferSizesReported)
-        {
-            size_t sizesMB = ((sizesTotal - 1) >> 20) + 1; // Round up.
-            sizesMB = ((sizesMB + 9) / 10) * 10; // 10MB granularity enough in this day and age.
-            LOG(INFO) << "Internal buffers grown to " << sizesMB << " MB";
-            m_bufferSizesReported = sizesMB << 20;
-        }
-
-        // Launch stages. Blocks until everything is done.
-        launchStages(instanceMode, peel, stream);
-
-        // Peeling iteration cannot fail, so no point checking things further.
-        if (peel)
-            break;
-
-        // Atomics after coarse stage are now available.
-        CRAtomics* atomics = (CRAtomics*)m_crAtomicsHost.getPtr();
-
-        // Success?
-        bool failed = false;
-        for (int i=0; i < m_numImages; i++)
-        {
-            const CRAtomics& a = atomics[i];
-            failed = failed || (a.numSubtris > m_maxSubtris) || (a.numBinSegs > m_maxBinSegs) || (a.numTileSegs > m_maxTileSegs);
-        }
-        if (!failed)
-            break; // Success!
-
-        // If we were already at maximum capacity, no can do.
-        if (m_maxSubtris == CR_MAXSUBTRIS_SIZE)
-            return false;
-
-        // Enlarge buffers and try again.
-        for (int i=0; i < m_numImages; i++)
-        {
-            const CRAtomics& a = atomics[i];
-            m_maxSubtris  = max(m_maxSubtris,  min(a.numSubtris + maxSubtrisSlack, CR_MAXSUBTRIS_SIZE));
-            m_maxBinSegs  = max(m_maxBinSegs,  a.numBinSegs + maxBinSegsSlack);
-            m_maxTileSegs = max(m_maxTileSegs, a.numTileSegs + maxTileSegsSlack);
-        }
     }
+    S64 numTasks = setTaskOffsets(imageParams, numImages, instanceMode);
+    NVDR_CHECK(numTasks <= 0x7fffffff, "total number of triangles over all ranges exceeds 2^31-1");
 
-    m_deferredClear = false;
-    return true; // Success.
-}
-
-//------------------------------------------------------------------------
-
-size_t RasterImpl::getTotalBufferSizes(void) const
-{
-    return
-        m_colorBuffer.getSize() + m_depthBuffer.getSize() + // Don't include atomics and image params.
-        m_triSubtris.getSize() + m_triHeader.getSize() + m_triData.getSize() +
-        m_binFirstSeg.getSize() + m_binTotal.getSize() + m_binSegData.getSize() + m_binSegNext.getSize() + m_binSegCount.getSize() +
-        m_activeTiles.getSize() + m_tileFirstSeg.getSize() + m_tileSegData.getSize() + m_tileSegNext.getSize() + m_tileSegCount.getSize();
-}
-
-//------------------------------------------------------------------------
-
-void RasterImpl::launchStages(bool instanceMode, bool peel, STREAM stream)
-{
-    CRImageParams* imageParams = (CRImageParams*)m_crImageParamsHost.getPtr();
-
-    // Unless peeling, initialize atomics to mostly zero.
-    CRAtomics* atomics = (CRAtomics*)m_crAtomicsHost.getPtr();
-    if (!peel)
+    // Copy per-image parameters if there are more than fits in launch parameter block.
+    if (!peel && numImages > CR_EMBED_IMAGE_PARAMS)
     {
-        memset(atomics, 0, m_numImages * sizeof(CRAtomics));
-        for (int i=0; i < m_numImages; i++)
-            atomics[i].numSubtris = imageParams[i].triCount;
-    }
-
-    // Copy to device. If peeling, this is the state after coarse raster launch on first iteration.
+        m_crImageParamsExtra.grow(CR_MAX_PENDING_DRAWS * numImages * sizeof(CRImageParams));
 #ifdef USE_ROCM
-    NVDR_CHECK_CUDA_ERROR(hipMemcpyAsync(m_crAtomics.getPtr(), atomics, m_numImages * sizeof(CRAtomics), hipMemcpyHostToDevice, stream));
+        NVDR_CHECK_CUDA_ERROR(hipMemcpyAsync(m_crImageParamsExtra.getPtr(slot * numImages * sizeof(CRImageParams)), imageParams, numImages * sizeof(CRImageParams), hipMemcpyHostToDevice, stream));
 #else
-    NVDR_CHECK_CUDA_ERROR(cudaMemcpyAsync(m_crAtomics.getPtr(), atomics, m_numImages * sizeof(CRAtomics), cudaMemcpyHostToDevice, stream));
+        NVDR_CHECK_CUDA_ERROR(cudaMemcpyAsync(m_crImageParamsExtra.getPtr(slot * numImages * sizeof(CRImageParams)), imageParams, numImages * sizeof(CRImageParams), cudaMemcpyHostToDevice, stream));
 #endif
+    }
+
+    // When peeling, restore the atomics as they were after the coarse stage of the draw being reused.
+    if (peel && slot != m_lastFullSlot)
+        memcpy((void*)getAtomics(slot), getAtomics(m_lastFullSlot), numImages * sizeof(CRAtomics));
 
-    // Copy per-image parameters if there are more than fits in launch parameter block and we haven't done it already.
-    if (!peel && m_numImages > CR_EMBED_IMAGE_PARAMS)
+    // Capture the draw state.
+    if ((int)m_pending.size() <= slot)
     {
-        int numImageParamsExtra = m_numImages - CR_EMBED_IMAGE_PARAMS;
-        m_crImageParamsExtra.grow(numImageParamsExtra * sizeof(CRImageParams));
-#ifdef USE_ROCM
-        NVDR_CHECK_CUDA_ERROR(hipMemcpyAsync(m_crImageParamsExtra.getPtr(), imageParams + CR_EMBED_IMAGE_PARAMS, numImageParamsExtra * sizeof(CRImageParams), hipMemcpyHostToDevice, stream));
-#else
-        NVDR_CHECK_CUDA_ERROR(cudaMemcpyAsync(m_crImageParamsExtra.getPtr(), imageParams + CR_EMBED_IMAGE_PARAMS, numImageParamsExtra * sizeof(CRImageParams), cudaMemcpyHostToDevice, stream));
-#endif
+        m_pending.resize(slot + 1);
+        m_pending[slot].event = NULL;
     }
+    PendingDraw& d = m_pending[slot];
+    d.peel   = peel;
+    d.stream = stream;
 
-    // Set global parameters.
-    CRParams p;
+    CRParams& p = d.params;
     {
-        p.atomics           = (CRAtomics*)m_crAtomics.getPtr();
-        p.numImages         = m_numImages;
-        p.totalCount        = 0; // Only relevant in range mode.
+        p.numImages         = numImages;
+        p.totalCount        = 0; // Only relevant in range mode, set at launch.
+        p.taskBase          = 0;
         p.instanceMode      = instanceMode ? 1 : 0;
 
         p.numVertices       = m_numVertices;
         p.numTriangles      = m_numTriangles;
         p.vertexBuffer      = m_vertexPtr;
         p.indexBuffer       = m_indexPtr;
+        p.vertexMtx         = instanceMode ? m_vertexMtxPtr : NULL;
 
         p.widthPixels       = m_sizePixels.x;
         p.heightPixels      = m_sizePixels.y;
@@ -330,47 +319,194 @@ void RasterImpl::launchStages(bool instanceMode, bool peel, STREAM stream)
         p.heightBins        = m_sizeBins.y;
         p.numBins           = m_numBins;
 
-        p.xs                = (float)m_bufferSizeVp.x / (float)m_sizeVp.x;
-        p.ys                = (float)m_bufferSizeVp.y / (float)m_sizeVp.y;
-        p.xo                = (float)(m_bufferSizeVp.x - m_sizeVp.x - 2 * m_offsetPixels.x) / (float)m_sizeVp.x;
-        p.yo                = (float)(m_bufferSizeVp.y - m_sizeVp.y - 2 * m_offsetPixels.y) / (float)m_sizeVp.y;
+        setViewportTransform(p, m_bufferSizeVp, m_sizeVp, m_offsetPixels);
 
         p.widthTiles        = m_sizeTiles.x;
         p.heightTiles       = m_sizeTiles.y;
         p.numTiles          = m_numTiles;
 
         p.renderModeFlags   = m_renderModeFlags;
+        p.minArea           = m_minArea;
         p.deferredClear     = m_deferredClear ? 1 : 0;
         p.clearColor        = m_clearColor;
         p.clearDepth        = CR_DEPTH_MAX;
 
-        p.maxSubtris        = m_maxSubtris;
-        p.maxBinSegs        = m_maxBinSegs;
-        p.maxTileSegs       = m_maxTileSegs;
-
-        p.triSubtris        = m_triSubtris.getPtr();
-        p.triHeader         = m_triHeader.getPtr();
-        p.triData           = m_triData.getPtr();
-        p.binSegData        = m_binSegData.getPtr();
-        p.binSegNext        = m_binSegNext.getPtr();
-        p.binSegCount       = m_binSegCount.getPtr();
-        p.binFirstSeg       = m_binFirstSeg.getPtr();
-        p.binTotal          = m_binTotal.getPtr();
-        p.tileSegData       = m_tileSegData.getPtr();
-        p.tileSegNext       = m_tileSegNext.getPtr();
-        p.tileSegCount      = m_tileSegCount.getPtr();
-        p.activeTiles       = m_activeTiles.getPtr();
-        p.tileFirstSeg      = m_tileFirstSeg.getPtr();
+        p.strideX           = m_bufferSizePixels.x;
+        p.strideY           = m_bufferSizePixels.y;
 
         size_t byteOffset = ((size_t)m_offsetPixels.x + (size_t)m_offsetPixels.y * (size_t)p.strideX) * sizeof(U32);
         p.colorBuffer       = m_colorBuffer.getPtr(byteOffset);
         p.depthBuffer       = m_depthBuffer.getPtr(byteOffset);
         p.peelBuffer        = (m_renderModeFlags & CudaRaster::RenderModeFlag_EnableDepthPeeling) ? m_peelBuffer.getPtr(byteOffset) : 0;
-        p.strideX           = m_bufferSizePixels.x;
-        p.strideY           = m_bufferSizePixels.y;
+    }
+
+    // Choose capacities and launch. Does not wait for anything.
+    m_planner.submit(*this, imageParams, numImages, m_sizePixels, m_numBins, m_numTiles, peel);
+    if (!peel)
+        m_lastFullSlot = slot;
+
+    m_deferredClear = false;
+    return m_deferredStatus != RasterPlanner::Status_Overflow;
+}
+
+//------------------------------------------------------------------------
 
-        memcpy(&p.imageParamsFirst, imageParams, min(m_numImages, CR_EMBED_IMAGE_PARAMS) * sizeof(CRImageParams));
-        p.imageParamsExtra  = (CRImageParams*)m_crImageParamsExtra.getPtr();
+int RasterImpl::resolve(void)
+{
+    NVDR_PROFILE_RANGE("cr/resolve");
+    int status = max(m_deferredStatus, (int)m_planner.resolve(*this));
+    m_deferredStatus = RasterPlanner::Status_Success;
+    return status;
+}
+
+//------------------------------------------------------------------------
+
+void RasterImpl::setMemoryBudget(size_t bytes)
+{
+    // Pending draws refer to the current buffers.
+    if (m_planner.getNumPending())
+        m_deferredStatus = max(m_deferredStatus, (int)m_planner.resolve(*this));
+
+    // Start over so that buffers grown earlier don't count against the budget.
+    m_planner.setMemoryBudget(bytes);
+    if (bytes && getIntermediateBufferSizes() > bytes)
+    {
+        Buffer* buffers[] = { &m_triSubtris, &m_triHeader, &m_triData, &m_binFirstSeg, &m_binTotal, &m_binSegData, &m_binSegNext, &m_binSegCount,
+            &m_activeTiles, &m_tileFirstSeg, &m_tileSegData, &m_tileSegNext, &m_tileSegCount };
+        for (int i=0; i < CR_ARRAY_SIZE(buffers); i++)
+            buffers[i]->reset(0);
+        m_intermediateValid = false;
+    }
+}
+
+//------------------------------------------------------------------------
+
+size_t RasterImpl::getTotalBufferSizes(void) const
+{
+    return m_colorBuffer.getSize() + m_depthBuffer.getSize() + getIntermediateBufferSizes(); // Don't include atomics and image params.
+}
+
+size_t RasterImpl::getIntermediateBufferSizes(void) const
+{
+    return
+        m_triSubtris.getSize() + m_triHeader.getSize() + m_triData.getSize() +
+        m_binFirstSeg.getSize() + m_binTotal.getSize() + m_binSegData.getSize() + m_binSegNext.getSize() + m_binSegCount.getSize() +
+        m_activeTiles.getSize() + m_tileFirstSeg.getSize() + m_tileSegData.getSize() + m_tileSegNext.getSize() + m_tileSegCount.getSize();
+}
+
+//------------------------------------------------------------------------
+
+void RasterImpl::reserve(const CRCapacities& caps, int batchSize)
+{
+    // Allocate buffers. These only grow, so steady-state draws don't allocate.
+    size_t sizesBefore = getTotalBufferSizes();
+    size_t n = batchSize;
+
+    Buffer* buffers[] = { &m_triSubtris, &m_triHeader, &m_triData, &m_binFirstSeg, &m_binTotal, &m_binSegData, &m_binSegNext, &m_binSegCount,
+        &m_activeTiles, &m_tileFirstSeg, &m_tileSegData, &m_tileSegNext, &m_tileSegCount };
+    size_t sizes[] =
+    {
+        n * caps.maxSubtris * sizeof(U8),
+        n * caps.maxSubtris * sizeof(CRTriangleHeader),
+        n * caps.maxSubtris * sizeof(CRTriangleData),
+        n * CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32),
+        n * CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32),
+        n * caps.maxBinSegs * CR_BIN_SEG_SIZE * sizeof(S32),
+        n * caps.maxBinSegs * sizeof(S32),
+        n * caps.maxBinSegs * sizeof(S32),
+        n * CR_MAXTILES_SQR * sizeof(S32),
+        n * CR_MAXTILES_SQR * sizeof(S32),
+        n * caps.maxTileSegs * CR_TILE_SEG_SIZE * sizeof(S32),
+        n * caps.maxTileSegs * sizeof(S32),
+        n * caps.maxTileSegs * sizeof(S32),
+    };
+
+    // Under a memory budget, grow to exact sizes. If the buffers kept from earlier draws would
+    // exceed the budget together with the grown ones, reallocate all of them to exact size.
+    size_t budget = m_planner.getMemoryBudget();
+    size_t kept = 0;
+    for (int i=0; i < CR_ARRAY_SIZE(buffers); i++)
+        kept += max(buffers[i]->getSize(), sizes[i]);
+    for (int i=0; i < CR_ARRAY_SIZE(buffers); i++)
+    {
+        if (!budget)
+            buffers[i]->grow(sizes[i]);
+        else if (kept > budget || sizes[i] > buffers[i]->getSize())
+            buffers[i]->reset(sizes[i]);
+    }
+
+    // Contents are gone if anything was reallocated, and unusable if the per-image layout changed.
+    size_t sizesTotal = getTotalBufferSizes();
+    if (sizesTotal != sizesBefore || memcmp(&caps, &m_reservedCaps, sizeof(CRCapacities)) || batchSize != m_reservedBatchSize)
+        m_intermediateValid = false;
+    m_reservedCaps = caps;
+    m_reservedBatchSize = batchSize;
+
+    // Report if buffers grow from last time.
+    if (sizesTotal > m_bufferSizesReported)
+    {
+        size_t sizesMB = ((sizesTotal - 1) >> 20) + 1; // Round up.
+        sizesMB = ((sizesMB + 9) / 10) * 10; // 10MB granularity enough in this day and age.
+        LOG(INFO) << "Internal buffers grown to " << sizesMB << " MB";
+        m_bufferSizesReported = sizesMB << 20;
+    }
+}
+
+//------------------------------------------------------------------------
+
+void RasterImpl::launch(int slot, int firstImage, int numImages, const CRCapacities& caps, int bufferImage)
+{
+    PendingDraw& d = m_pending[slot];
+    STREAM stream = d.stream;
+    bool peel = d.peel;
+    const CRImageParams* imageParams = (const CRImageParams*)m_crImageParamsHost.getPtr() + slot * getNumDrawImages() + firstImage;
+    CRAtomics* atomics = (CRAtomics*)getAtomics(slot) + firstImage;
+
+    // Unless peeling, initialize atomics to mostly zero.
+    if (!peel)
+    {
+        memset(atomics, 0, numImages * sizeof(CRAtomics));
+        for (int i=0; i < numImages; i++)
+            atomics[i].numSubtris = imageParams[i].triCount;
+    }
+
+    // Copy to device. If peeling, this is the state after coarse raster launch on first iteration.
+#ifdef USE_ROCM
+    NVDR_CHECK_CUDA_ERROR(hipMemcpyAsync(m_crAtomics.getPtr(firstImage * sizeof(CRAtomics)), atomics, numImages * sizeof(CRAtomics), hipMemcpyHostToDevice, stream));
+#else
+    NVDR_CHECK_CUDA_ERROR(cudaMemcpyAsync(m_crAtomics.getPtr(firstImage * sizeof(CRAtomics)), atomics, numImages * sizeof(CRAtomics), cudaMemcpyHostToDevice, stream));
+#endif
+
+    // Set parameters for the run of images. Per-image data lives at bufferImage onwards in the intermediate
+    // buffers. Output images and instances are located through the image params.
+    CRParams p = d.params;
+    {
+        size_t b            = bufferImage;
+
+        p.atomics           = (CRAtomics*)m_crAtomics.getPtr(firstImage * sizeof(CRAtomics));
+        p.numImages         = numImages;
+
+        p.maxSubtris        = caps.maxSubtris;
+        p.maxBinSegs        = caps.maxBinSegs;
+        p.maxTileSegs       = caps.maxTileSegs;
+
+        p.triSubtris        = m_triSubtris  .getPtr(b * caps.maxSubtris * sizeof(U8));
+        p.triHeader         = m_triHeader   .getPtr(b * caps.maxSubtris * sizeof(CRTriangleHeader));
+        p.triData           = m_triData     .getPtr(b * caps.maxSubtris * sizeof(CRTriangleData));
+        p.binSegData        = m_binSegData  .getPtr(b * caps.maxBinSegs * CR_BIN_SEG_SIZE * sizeof(S32));
+        p.binSegNext        = m_binSegNext  .getPtr(b * caps.maxBinSegs * sizeof(S32));
+        p.binSegCount       = m_binSegCount .getPtr(b * caps.maxBinSegs * sizeof(S32));
+        p.binFirstSeg       = m_binFirstSeg .getPtr(b * CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32));
+        p.binTotal          = m_binTotal    .getPtr(b * CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32));
+        p.tileSegData       = m_tileSegData .getPtr(b * caps.maxTileSegs * CR_TILE_SEG_SIZE * sizeof(S32));
+        p.tileSegNext       = m_tileSegNext .getPtr(b * caps.maxTileSegs * sizeof(S32));
+        p.tileSegCount      = m_tileSegCount.getPtr(b * caps.maxTileSegs * sizeof(S32));
+        p.activeTiles       = m_activeTiles .getPtr(b * CR_MAXTILES_SQR * sizeof(S32));
+        p.tileFirstSeg      = m_tileFirstSeg.getPtr(b * CR_MAXTILES_SQR * sizeof(S32));
+
+
+        memcpy(&p.imageParamsFirst, imageParams, min(numImages, CR_EMBED_IMAGE_PARAMS) * sizeof(CRImageParams));
+        p.imageParamsExtra  = (CRImageParams*)m_crImageParamsExtra.getPtr((slot * getNumDrawImages() + firstImage + CR_EMBED_IMAGE_PARAMS) * sizeof(CRImageParams));
     }
 
     // Setup block sizes.
@@ -379,37 +515,63 @@ void RasterImpl::launchStages(bool instanceMode, bool peel, STREAM stream)
     dim3 crBlock(32, CR_COARSE_WARPS);
     dim3 frBlock(32, m_numFineWarpsPerBlock);
     void* args[] = {&p};
+    void* setupKernel = m_shortIndices ? (void*)triangleSetupKernelU16 : (void*)triangleSetupKernel;
 
     // Launch stages from setup to coarse and copy atomics to host only if this is not a single-tile peeling iteration.
     if (!peel)
     {
-        if (instanceMode)
+        ProfileRange setupRange("cr/setup", (void*)stream);
+        if (p.instanceMode)
         {
-            int setupBlocks = (m_numTriangles - 1) / (32 * CR_SETUP_WARPS) + 1;
-            NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)triangleSetupKernel, dim3(setupBlocks, 1, m_numImages), dim3(32, CR_SETUP_WARPS), args, 0, stream));
+            int setupBlocks = (max(imageParams[0].triCount, 1) - 1) / (32 * CR_SETUP_WARPS) + 1; // Same for all instances.
+            NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(setupKernel, dim3(setupBlocks, 1, numImages), dim3(32, CR_SETUP_WARPS), args, 0, stream));
         }
         else
         {
-            for (int i=0; i < m_numImages; i++)
-                p.totalCount += imageParams[i].triCount;
+            setTaskRange(p, imageParams, numImages);
             int setupBlocks = (p.totalCount - 1) / (32 * CR_SETUP_WARPS) + 1;
-            NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)triangleSetupKernel, dim3(setupBlocks, 1, 1), dim3(32, CR_SETUP_WARPS), args, 0, stream));
+            NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(setupKernel, dim3(setupBlocks, 1, 1), dim3(32, CR_SETUP_WARPS), args, 0, stream));
         }
-        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)binRasterKernel, dim3(CR_BIN_STREAMS_SIZE, 1, m_numImages), brBlock, args, 0, stream));
-        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)coarseRasterKernel, dim3(m_numSMs * m_numCoarseBlocksPerSM, 1, m_numImages), crBlock, args, 0, stream));
+        setupRange.end();
+
+        ProfileRange binRange("cr/bin", (void*)stream);
+        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)binRasterKernel, dim3(CR_BIN_STREAMS_SIZE, 1, numImages), brBlock, args, 0, stream));
+        binRange.end();
+
+        ProfileRange coarseRange("cr/coarse", (void*)stream);
+        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)coarseRasterKernel, dim3(m_numSMs * m_numCoarseBlocksPerSM, 1, numImages), crBlock, args, 0, stream));
+        coarseRange.end();
+
 #ifdef USE_ROCM
-        NVDR_CHECK_CUDA_ERROR(hipMemcpyAsync(m_crAtomicsHost.getPtr(), m_crAtomics.getPtr(), sizeof(CRAtomics) * m_numImages, hipMemcpyDeviceToHost, stream));
+        NVDR_CHECK_CUDA_ERROR(hipMemcpyAsync(atomics, p.atomics, sizeof(CRAtomics) * numImages, hipMemcpyDeviceToHost, stream));
+        if (!d.event)
+            NVDR_CHECK_CUDA_ERROR(hipEventCreateWithFlags((hipEvent_t*)&d.event, hipEventDisableTiming));
+        NVDR_CHECK_CUDA_ERROR(hipEventRecord((hipEvent_t)d.event, stream));
 #else
-        NVDR_CHECK_CUDA_ERROR(cudaMemcpyAsync(m_crAtomicsHost.getPtr(), m_crAtomics.getPtr(), sizeof(CRAtomics) * m_numImages, cudaMemcpyDeviceToHost, stream));
+        NVDR_CHECK_CUDA_ERROR(cudaMemcpyAsync(atomics, p.atomics, sizeof(CRAtomics) * numImages, cudaMemcpyDeviceToHost, stream));
+        if (!d.event)
+            NVDR_CHECK_CUDA_ERROR(cudaEventCreateWithFlags((cudaEvent_t*)&d.event, cudaEventDisableTiming));
+        NVDR_CHECK_CUDA_ERROR(cudaEventRecord((cudaEvent_t)d.event, stream));
 #endif
+
+        // A run over all images leaves complete intermediate results for peeling.
+        m_intermediateValid = (numImages == getNumDrawImages());
     }
 
-    // Fine rasterizer is launched always.
-    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)fineRasterKernel, dim3(m_numSMs * m_numFineBlocksPerSM, 1, m_numImages), frBlock, args, 0, stream));
+    // Fine rasterizer is launched always. Nothing waits for it here.
+    NVDR_PROFILE_DEVICE_RANGE("cr/fine", stream);
+    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)fineRasterKernel, dim3(m_numSMs * m_numFineBlocksPerSM, 1, numImages), frBlock, args, 0, stream));
+}
+
+//------------------------------------------------------------------------
+
+void RasterImpl::wait(int slot)
+{
+    // Waits for the atomics readback only, later work in the stream keeps running.
 #ifdef USE_ROCM
-    NVDR_CHECK_CUDA_ERROR(hipStreamSynchronize(stream));
+    NVDR_CHECK_CUDA_ERROR(hipEventSynchronize((hipEvent_t)m_pending[slot].event));
 #else
-    NVDR_CHECK_CUDA_ERROR(cudaStreamSynchronize(stream));
+    NVDR_CHECK_CUDA_ERROR(cudaEventSynchronize((cudaEvent_t)m_pending[slot].event));
 #endif
 }
 
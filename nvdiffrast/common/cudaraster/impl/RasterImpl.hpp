@@ -9,44 +9,90 @@
 #pragma once
 #include "PrivateDefs.hpp"
 #include "Buffer.hpp"
+#include "RasterPlanner.hpp"
 #include "../CudaRaster.hpp"
+#include <vector>
 
 namespace CR
 {
 //------------------------------------------------------------------------
 
-class RasterImpl
+class RasterImpl : private RasterBackend
 {
 public:
 					        RasterImpl				(void);
 					        ~RasterImpl				(void);
 
+    void                    setAllocators           (Allocator& device, Allocator& host); // Releases all buffers.
     void                    setBufferSize           (Vec3i size);
-    void                    setViewport             (Vec2i size, Vec2i offset);
+    void                    setViewport             (Vec2i size, Vec2i offset); // Split into tiles if larger than CR_MAXVIEWPORT_SIZE.
     void                    setRenderModeFlags      (U32 flags) { m_renderModeFlags = flags; }
+    void                    setMinTriangleArea      (float pixels) { m_minArea = minTriangleAreaToSubpixels(pixels); }
     void                    deferredClear           (U32 color) { m_deferredClear = true; m_clearColor = color; }
     void                    setVertexBuffer         (void* ptr, int numVertices) { m_vertexPtr = ptr; m_numVertices = numVertices; } // GPU pointer.
-    void                    setIndexBuffer          (void* ptr, int numTriangles) { m_indexPtr = ptr; m_numTriangles = numTriangles; } // GPU pointer.
+    void                    setIndexBuffer          (void* ptr, int numTriangles, bool shortIndices) { m_indexPtr = ptr; m_numTriangles = numTriangles; m_shortIndices = shortIndices; } // GPU pointer.
+    void                    setVertexTransforms     (const void* ptr) { m_vertexMtxPtr = ptr; } // GPU pointer.
+    void                    setInstanceRange        (int offset, int count) { m_instanceRange = Vec2i(offset, count); }
     bool                    drawTriangles           (const Vec2i* ranges, bool peel, STREAM stream);
+    int                     resolve                 (void);
+    void                    setCapacityPercentile   (float percentile) { m_planner.getPredictor().setPercentile(percentile); }
+    const RasterPlanner::Stats& getCapacityStats    (void) const { return m_planner.getStats(); }
+    void                    resetCapacityStats      (void) { m_planner.resetStats(); }
+    void                    setMemoryBudget         (size_t bytes);
+    const std::vector<RasterPlanner::ImageStats>& getImageStats(void) const { return m_planner.getImageStats(); }
+    void                    resetImageStats         (void) { m_planner.resetImageStats(); }
+    int                     getNumImages            (void) const { return m_numImages; }
+    int                     getNumViewportTiles     (void) const { return m_numVpTiles.x * m_numVpTiles.y; } // Drawn images per output image.
     void*                   getColorBuffer          (void) { return m_colorBuffer.getPtr(); } // GPU pointer.
     void*                   getDepthBuffer          (void) { return m_depthBuffer.getPtr(); } // GPU pointer.
     void                    swapDepthAndPeel        (void);
     size_t                  getTotalBufferSizes     (void) const;
+    size_t                  getIntermediateBufferSizes(void) const;
 
 private:
-    void                    launchStages            (bool instanceMode, bool peel, STREAM stream);
+    // Stage backend for the planner.
+
+    void                    reserve                 (const CRCapacities& caps, int batchSize);
+    void                    launch                  (int slot, int firstImage, int numImages, const CRCapacities& caps, int bufferImage);
+    void                    wait                    (int slot);
+    const CRAtomics*        getAtomics              (int slot) { return (CRAtomics*)m_crAtomicsHost.getPtr() + slot * getNumDrawImages(); }
+    int                     getNumDrawImages        (void) const { return m_numImages * getNumViewportTiles(); }
+
+    // Draw state captured at submission, so that images can be rendered again later.
+
+    struct PendingDraw
+    {
+        CRParams            params;                 // Everything except per-run pointers, capacities and image params.
+        bool                peel;
+        STREAM              stream;
+        void*               event;                  // Signaled when the atomics are on the host. Created on first use.
+    };
 
     // State.
 
     unsigned int            m_renderModeFlags;
+    S32                     m_minArea;              // In the units of CRParams::minArea.
     bool                    m_deferredClear;
     unsigned int            m_clearColor;
     void*                   m_vertexPtr;
     void*                   m_indexPtr;
+    bool                    m_shortIndices;         // 16-bit unsigned instead of 32-bit indices.
+    const void*             m_vertexMtxPtr;         // Per-image vertex transforms, instance mode only.
     int                     m_numVertices;          // Input buffer size.
     int                     m_numTriangles;         // Input buffer size.
+    Vec2i                   m_instanceRange;        // Offset and count of triangles drawn per instance.
     size_t                  m_bufferSizesReported;  // Previously reported buffer sizes.
 
+    // Sizing and retry.
+
+    RasterPlanner           m_planner;
+    std::vector<PendingDraw> m_pending;             // Per slot.
+    int                     m_deferredStatus;       // Result of implicit resolves, reported by the next resolve().
+    int                     m_lastFullSlot;         // Slot of latest draw that ran all stages.
+    bool                    m_intermediateValid;    // Intermediate buffers hold the results of the latest draw for all images.
+    CRCapacities            m_reservedCaps;         // Per-image layout of intermediate buffers.
+    int                     m_reservedBatchSize;    // Images that intermediate buffers hold.
+
     // Surfaces.
 
     Buffer                  m_colorBuffer;
@@ -56,8 +102,9 @@ private:
     Vec2i                   m_bufferSizePixels;     // Internal buffer size.
     Vec2i                   m_bufferSizeVp;         // Total viewport size.
     Vec2i                   m_sizePixels;           // Internal size at which all computation is done, buffers reserved, etc.
-    Vec2i                   m_sizeVp;               // Size to which output will be cropped outside, determines viewport size.
+    Vec2i                   m_sizeVp;               // Size to which output will be cropped outside, determines viewport size. Of one tile if tiled.
     Vec2i                   m_offsetPixels;         // Viewport offset for tiled rendering.
+    Vec2i                   m_numVpTiles;           // Viewport tiles, m_sizeVp apart.
     Vec2i                   m_sizeBins;
     S32                     m_numBins;
     Vec2i                   m_sizeTiles;
@@ -73,9 +120,9 @@ private:
     // Global intermediate buffers. Individual images have offsets to these.
 
     Buffer                  m_crAtomics;
-    HostBuffer              m_crAtomicsHost;
-    HostBuffer              m_crImageParamsHost;
-    Buffer                  m_crImageParamsExtra;
+    HostBuffer              m_crAtomicsHost;        // Per slot.
+    HostBuffer              m_crImageParamsHost;    // Per slot.
+    Buffer                  m_crImageParamsExtra;   // Per slot, all images.
     Buffer                  m_triSubtris;
     Buffer                  m_triHeader;
     Buffer                  m_triData;
@@ -89,12 +136,6 @@ private:
     Buffer                  m_tileSegData;
     Buffer                  m_tileSegNext;
     Buffer                  m_tileSegCount;
-
-    // Actual buffer sizes.
-
-    S32                     m_maxSubtris;
-    S32                     m_maxBinSegs;
-    S32                     m_maxTileSegs;
 };
 
 //------------------------------------------------------------------------
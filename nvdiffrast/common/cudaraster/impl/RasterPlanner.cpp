@@ -0,0 +1,291 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "RasterPlanner.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace CR;
+using std::min;
+using std::max;
+
+//------------------------------------------------------------------------
+
+static const int c_maxSubtrisSlack  = 4096;     // x 81B    = 324KB
+static const int c_maxBinSegsSlack  = 256;      // x 2137B  = 534KB
+static const int c_maxTileSegsSlack = 4096;     // x 136B   = 544KB
+
+//------------------------------------------------------------------------
+
+RasterPlanner::RasterPlanner(void)
+:   m_budget    (0),
+    m_batchSize (1),
+    m_numPending(0)
+{
+    m_caps.maxSubtris  = 1;
+    m_caps.maxBinSegs  = 1;
+    m_caps.maxTileSegs = 1;
+    resetStats();
+}
+
+void RasterPlanner::resetStats(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//------------------------------------------------------------------------
+
+size_t RasterPlanner::getImageBytes(const CRCapacities& caps)
+{
+    // Must match the buffers reserved by the backend.
+    return
+        (size_t)caps.maxSubtris  * (sizeof(U8) + sizeof(CRTriangleHeader) + sizeof(CRTriangleData)) +
+        (size_t)caps.maxBinSegs  * (CR_BIN_SEG_SIZE + 2) * sizeof(S32) +
+        (size_t)caps.maxTileSegs * (CR_TILE_SEG_SIZE + 2) * sizeof(S32) +
+        (size_t)CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * 2 * sizeof(S32) +
+        (size_t)CR_MAXTILES_SQR * 2 * sizeof(S32);
+}
+
+size_t RasterPlanner::getMinImageBytes(int numBins, int numTiles)
+{
+    // Every bin stream and every tile needs at least one segment.
+    CRCapacities lo = { 1, numBins * CR_BIN_STREAMS_SIZE, numTiles };
+    return getImageBytes(lo);
+}
+
+void RasterPlanner::clampToBudget(CRCapacities& caps, size_t budget, int numBins, int numTiles)
+{
+    size_t bytes = getImageBytes(caps);
+    if (!budget || bytes <= budget)
+        return;
+
+    // Shrink everything above the minimum by the same factor. Bytes are linear in capacities, so rounding down stays within budget.
+    CRCapacities lo = { 1, numBins * CR_BIN_STREAMS_SIZE, numTiles };
+    size_t fixed = getMinImageBytes(numBins, numTiles);
+    double f = (budget > fixed && bytes > fixed) ? (double)(budget - fixed) / (double)(bytes - fixed) : 0.0;
+    caps.maxSubtris  = lo.maxSubtris  + (S32)(max(caps.maxSubtris  - lo.maxSubtris,  0) * f);
+    caps.maxBinSegs  = lo.maxBinSegs  + (S32)(max(caps.maxBinSegs  - lo.maxBinSegs,  0) * f);
+    caps.maxTileSegs = lo.maxTileSegs + (S32)(max(caps.maxTileSegs - lo.maxTileSegs, 0) * f);
+}
+
+int RasterPlanner::getBatchSize(const CRCapacities& caps, size_t budget, int numImages)
+{
+    if (!budget)
+        return numImages;
+    size_t fit = budget / getImageBytes(caps);
+    return (int)min<size_t>(max<size_t>(fit, 1), numImages);
+}
+
+//------------------------------------------------------------------------
+
+void RasterPlanner::launchRuns(RasterBackend& backend, int slot, int firstImage, int numImages)
+{
+    // Batches share the intermediate buffers and run one after another in the stream. If all images fit,
+    // each image has its own place so that the results stay around for peeling.
+    bool batched = (m_batchSize < m_draws[slot].numImages);
+    for (int i=firstImage; i < firstImage + numImages; i += m_batchSize)
+    {
+        int count = min(m_batchSize, firstImage + numImages - i);
+        backend.launch(slot, i, count, m_caps, batched ? 0 : i);
+    }
+}
+
+void RasterPlanner::relaunch(RasterBackend& backend, int slot, const std::vector<U8>& flags)
+{
+    // Render the runs of flagged images again with current capacities.
+    Draw& d = m_draws[slot];
+    for (int i=0; i < d.numImages;)
+    {
+        if (!flags[i])
+        {
+            i++;
+            continue;
+        }
+        int first = i;
+        while (i < d.numImages && flags[i])
+        {
+            m_imageStats[i].numRetries++;
+            d.imageCaps[i++] = m_caps;
+        }
+        launchRuns(backend, slot, first, i - first);
+    }
+}
+
+//------------------------------------------------------------------------
+
+int RasterPlanner::submit(RasterBackend& backend, const CRImageParams* imageParams, int numImages, Vec2i sizePixels, int numBins, int numTiles, bool peel)
+{
+    int slot = m_numPending++;
+    if ((int)m_draws.size() < m_numPending)
+        m_draws.resize(m_numPending);
+
+    Draw& d = m_draws[slot];
+    d.peel      = peel;
+    d.numImages = numImages;
+
+    // Choose buffer sizes. Peeling reuses earlier results.
+    if (!peel)
+    {
+        d.key.width     = sizePixels.x;
+        d.key.height    = sizePixels.y;
+        d.key.numImages = numImages;
+        d.key.triCount  = 0;
+        for (int i=0; i < numImages; i++)
+            d.key.triCount = max(d.key.triCount, imageParams[i].triCount);
+
+        CRCapacities demand;
+        d.predicted = m_predictor.predict(demand, d.key);
+        if (d.predicted)
+        {
+            // Same slack as when growing after an overflow.
+            m_caps.maxSubtris  = min(demand.maxSubtris + c_maxSubtrisSlack, CR_MAXSUBTRIS_SIZE);
+            m_caps.maxBinSegs  = max(numBins * CR_BIN_STREAMS_SIZE, demand.maxBinSegs) + c_maxBinSegsSlack;
+            m_caps.maxTileSegs = max(numTiles, demand.maxTileSegs) + c_maxTileSegsSlack;
+        }
+        else
+        {
+            // Unseen shape, determine worst-case buffer sizes from the triangle counts.
+            for (int i=0; i < numImages; i++)
+            {
+                const CRImageParams& ip = imageParams[i];
+                m_caps.maxSubtris  = max(m_caps.maxSubtris,  min(ip.triCount + c_maxSubtrisSlack, CR_MAXSUBTRIS_SIZE));
+                m_caps.maxBinSegs  = max(m_caps.maxBinSegs,  max(numBins * CR_BIN_STREAMS_SIZE, (ip.triCount - 1) / CR_BIN_SEG_SIZE + 1) + c_maxBinSegsSlack);
+                m_caps.maxTileSegs = max(m_caps.maxTileSegs, max(numTiles, (ip.triCount - 1) / CR_TILE_SEG_SIZE + 1) + c_maxTileSegsSlack);
+            }
+        }
+
+        // Fit the budget, in batches if needed.
+        clampToBudget(m_caps, m_budget, numBins, numTiles);
+        m_batchSize = getBatchSize(m_caps, m_budget, numImages);
+        backend.reserve(m_caps, m_batchSize);
+    }
+
+    // Launch all images without waiting. Peeling only happens when the intermediate buffers hold all images.
+    d.imageCaps.assign(numImages, m_caps);
+    if (peel)
+        backend.launch(slot, 0, numImages, m_caps, 0);
+    else
+        launchRuns(backend, slot, 0, numImages);
+    return slot;
+}
+
+//------------------------------------------------------------------------
+
+RasterPlanner::Status RasterPlanner::resolve(RasterBackend& backend)
+{
+    Status status = Status_Success;
+    m_stale.clear();
+    for (int slot=0; slot < m_numPending; slot++)
+    {
+        // Peeling iteration cannot fail, so no point checking things further. Nothing before it is
+        // rendered again, since it is submitted only when nothing is pending.
+        Draw& d = m_draws[slot];
+        if (d.peel)
+            continue;
+
+        if ((int)m_imageStats.size() < d.numImages)
+        {
+            ImageStats zero;
+            memset(&zero, 0, sizeof(zero));
+            m_imageStats.resize(d.numImages, zero);
+        }
+
+        // Images that an earlier draw rendered again were cleared or overwritten by it, so this
+        // draw must be rendered on top of them again as well.
+        bool retried = false;
+        bool overflowed = false;
+        m_stale.resize(max((int)m_stale.size(), d.numImages), 0);
+        for (int i=0; i < d.numImages && !retried; i++)
+            retried = (m_stale[i] != 0);
+        if (retried)
+        {
+            m_batchSize = getBatchSize(m_caps, m_budget, d.numImages);
+            backend.reserve(m_caps, m_batchSize);
+            relaunch(backend, slot, m_stale);
+        }
+
+        // Retry until successful.
+        for (;;)
+        {
+            // Atomics after coarse stage.
+            backend.wait(slot);
+            const CRAtomics* atomics = backend.getAtomics(slot);
+
+            // Find overflowed images and enlarge capacities to fit them.
+            m_failed.assign(d.numImages, 0);
+            bool failed = false;
+            bool atMax  = false;
+            for (int i=0; i < d.numImages; i++)
+            {
+                const CRAtomics&    a = atomics[i];
+                const CRCapacities& c = d.imageCaps[i];
+                if (a.numSubtris <= c.maxSubtris && a.numBinSegs <= c.maxBinSegs && a.numTileSegs <= c.maxTileSegs)
+                    continue;
+
+                m_failed[i] = 1;
+                failed = true;
+                atMax  = atMax || (c.maxSubtris == CR_MAXSUBTRIS_SIZE);
+                m_caps.maxSubtris  = max(m_caps.maxSubtris,  min(a.numSubtris + c_maxSubtrisSlack, CR_MAXSUBTRIS_SIZE));
+                m_caps.maxBinSegs  = max(m_caps.maxBinSegs,  a.numBinSegs + c_maxBinSegsSlack);
+                m_caps.maxTileSegs = max(m_caps.maxTileSegs, a.numTileSegs + c_maxTileSegsSlack);
+            }
+            if (!failed)
+                break; // Success!
+
+            // If we were already at maximum capacity or the budget doesn't allow growing, no can do.
+            if (m_budget && getImageBytes(m_caps) > m_budget)
+                atMax = true;
+            if (atMax)
+            {
+                status = Status_Overflow;
+                break;
+            }
+
+            // Enlarge buffers and render the runs of overflowed images again. Later draws must follow.
+            status = max(status, Status_Retried);
+            retried = true;
+            overflowed = true;
+            m_batchSize = getBatchSize(m_caps, m_budget, d.numImages);
+            backend.reserve(m_caps, m_batchSize);
+            relaunch(backend, slot, m_failed);
+            for (int i=0; i < d.numImages; i++)
+                m_stale[i] |= m_failed[i];
+        }
+
+        // Learn the demand of the draw.
+        const CRAtomics* atomics = backend.getAtomics(slot);
+        CRCapacities demand = {0, 0, 0};
+        for (int i=0; i < d.numImages; i++)
+        {
+            const CRAtomics& a = atomics[i];
+            demand.maxSubtris  = max(demand.maxSubtris,  a.numSubtris);
+            demand.maxBinSegs  = max(demand.maxBinSegs,  a.numBinSegs);
+            demand.maxTileSegs = max(demand.maxTileSegs, a.numTileSegs);
+
+            ImageStats& is = m_imageStats[i];
+            is.numSubtris       += a.numSubtris;
+            is.numBinSegs       += a.numBinSegs;
+            is.numTileSegs      += a.numTileSegs;
+            is.numActiveTiles   += a.numActiveTiles;
+            is.caps.maxSubtris  = max(is.caps.maxSubtris,  d.imageCaps[i].maxSubtris);
+            is.caps.maxBinSegs  = max(is.caps.maxBinSegs,  d.imageCaps[i].maxBinSegs);
+            is.caps.maxTileSegs = max(is.caps.maxTileSegs, d.imageCaps[i].maxTileSegs);
+        }
+        m_predictor.record(d.key, demand);
+
+        m_stats.numDraws        += 1;
+        m_stats.numRetried      += retried ? 1 : 0;
+        m_stats.numPredicted    += d.predicted ? 1 : 0;
+        m_stats.numMispredicted += (d.predicted && overflowed) ? 1 : 0;
+    }
+
+    m_numPending = 0;
+    return status;
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+// Copyright (c) 2009-2022, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "PrivateDefs.hpp"
+#include "CapacityPredictor.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace CR
+{
+//------------------------------------------------------------------------
+
+#define CR_MAX_PENDING_DRAWS    64      // Draws that can be in flight before an implicit resolve.
+
+//------------------------------------------------------------------------
+// Stage backend driven by RasterPlanner. RasterImpl implements this with
+// kernel launches on a stream, and any host-side stand-in that produces
+// CRAtomics can be used in its place. Draws are identified by their slot
+// in the queue of pending draws. Intermediate buffers hold a batch of
+// images, and a run of images is placed at bufferImage in them.
+//------------------------------------------------------------------------
+
+class RasterBackend
+{
+public:
+    virtual                 ~RasterBackend          (void) {}
+    virtual void            reserve                 (const CRCapacities& caps, int batchSize) = 0;                                              // Size intermediate buffers for caps per image, for batchSize images.
+    virtual void            launch                  (int slot, int firstImage, int numImages, const CRCapacities& caps, int bufferImage) = 0;  // Enqueue stages for a run of images, then an asynchronous readback of their atomics unless peeling.
+    virtual void            wait                    (int slot) = 0;                                                             // Block until the atomics of the latest launch of the slot have reached the host.
+    virtual const CRAtomics* getAtomics             (int slot) = 0;                                                             // Host copy of the atomics of all images of the slot.
+};
+
+//------------------------------------------------------------------------
+// Buffer sizing and overflow retry as a host-side state machine. A draw is
+// launched with speculatively chosen capacities as soon as it is submitted.
+// resolve() later inspects the atomics of each pending draw, and renders
+// only the overflowed images again with enlarged capacities. The later
+// pending draws of those images are rendered again as well, as the retry
+// clears or overwrites their results. Capacities come from the predictor
+// for workload shapes seen before, and from the triangle counts otherwise.
+// A peeling draw reuses the intermediate results of the draw before it,
+// and must be submitted with nothing pending.
+//
+// With a memory budget, capacities are clamped so that the intermediate
+// buffers of one image fit, and the images of a draw are rendered in
+// batches that fit together. An image that needs more than the budget
+// allows reports an overflow, same as at maximum capacity. A budget below
+// the smallest buffers of one image cannot be met by any split of the
+// workload, and draws must not be submitted with it.
+//------------------------------------------------------------------------
+
+class RasterPlanner
+{
+public:
+    enum Status
+    {
+        Status_Success = 0,         // No overflow.
+        Status_Retried,             // Some images overflowed and were rendered again successfully.
+        Status_Overflow,            // Some images overflowed at maximum capacity.
+    };
+
+    struct Stats
+    {
+        S64                 numDraws;               // Resolved draws, excluding peeling.
+        S64                 numRetried;             // Draws that had to be rendered again.
+        S64                 numPredicted;           // Draws sized by the predictor.
+        S64                 numMispredicted;        // Predicted draws that overflowed.
+    };
+
+    struct ImageStats
+    {
+        S64                 numSubtris;             // Atomics summed over resolved draws, excluding peeling.
+        S64                 numBinSegs;
+        S64                 numTileSegs;
+        S64                 numActiveTiles;
+        S32                 numRetries;             // Times the image was rendered again.
+        CRCapacities        caps;                   // Largest capacities the image was rendered with.
+    };
+
+                            RasterPlanner           (void);
+
+    int                     submit                  (RasterBackend& backend, const CRImageParams* imageParams, int numImages, Vec2i sizePixels, int numBins, int numTiles, bool peel); // Returns the slot of the draw.
+    Status                  resolve                 (RasterBackend& backend);
+    int                     getNumPending           (void) const { return m_numPending; }
+    const CRCapacities&     getCapacities           (void) const { return m_caps; }
+    int                     getBatchSize            (void) const { return m_batchSize; }
+    void                    setMemoryBudget         (size_t bytes) { m_budget = bytes; } // Intermediate buffer bytes, 0 = unlimited.
+    size_t                  getMemoryBudget         (void) const { return m_budget; }
+    bool                    fitsBudget              (int numBins, int numTiles) const { return !m_budget || m_budget >= getMinImageBytes(numBins, numTiles); } // Smallest buffers of one image fit.
+    CapacityPredictor&      getPredictor            (void) { return m_predictor; }
+    const Stats&            getStats                (void) const { return m_stats; }
+    void                    resetStats              (void);
+    const std::vector<ImageStats>& getImageStats    (void) const { return m_imageStats; } // Grows to the largest number of images drawn.
+    void                    resetImageStats         (void) { m_imageStats.clear(); }
+
+    static size_t           getImageBytes           (const CRCapacities& caps); // Intermediate buffer bytes per image.
+    static size_t           getMinImageBytes        (int numBins, int numTiles); // Bytes per image at the smallest usable capacities.
+    static void             clampToBudget           (CRCapacities& caps, size_t budget, int numBins, int numTiles);
+    static int              getBatchSize            (const CRCapacities& caps, size_t budget, int numImages);
+
+private:
+    void                    launchRuns              (RasterBackend& backend, int slot, int firstImage, int numImages); // Split into batches.
+    void                    relaunch                (RasterBackend& backend, int slot, const std::vector<U8>& flags); // Runs of flagged images with current capacities.
+
+    struct Draw
+    {
+        bool                        peel;
+        int                         numImages;
+        CapacityPredictor::Key      key;
+        bool                        predicted;
+        std::vector<CRCapacities>   imageCaps;      // Capacities of the latest launch of each image.
+    };
+
+    CRCapacities            m_caps;                 // Capacities of the latest launch.
+    size_t                  m_budget;
+    int                     m_batchSize;            // Images that fit in the intermediate buffers at the latest reservation.
+    CapacityPredictor       m_predictor;
+    Stats                   m_stats;
+    std::vector<ImageStats> m_imageStats;
+    std::vector<Draw>       m_draws;                // Pending draws in submission order.
+    int                     m_numPending;
+    std::vector<U8>         m_failed;               // Overflow flag per image, scratch for resolve().
+    std::vector<U8>         m_stale;                // Per image, rendered again by an earlier draw in resolve().
+};
+
+//------------------------------------------------------------------------
+} // namespace CR
@@ -23,6 +23,20 @@ __device__ __inline__ void snapTriangle(
     hi = make_int2(max_max(p0.x, p1.x, p2.x), max_max(p0.y, p1.y, p2.y));
 }
 
+//------------------------------------------------------------------------
+// Row-major matrix times column vector, with the multiply-adds spelled out
+// so that all implementations produce the same positions.
+
+__device__ __inline__ float4 transformVertex(const float4* m, float4 v)
+{
+    float4 r0 = m[0], r1 = m[1], r2 = m[2], r3 = m[3];
+    return make_float4(
+        fmaf(r0.x, v.x, fmaf(r0.y, v.y, fmaf(r0.z, v.z, r0.w * v.w))),
+        fmaf(r1.x, v.x, fmaf(r1.y, v.y, fmaf(r1.z, v.z, r1.w * v.w))),
+        fmaf(r2.x, v.x, fmaf(r2.y, v.y, fmaf(r2.z, v.z, r2.w * v.w))),
+        fmaf(r3.x, v.x, fmaf(r3.y, v.y, fmaf(r3.z, v.z, r3.w * v.w))));
+}
+
 //------------------------------------------------------------------------
 
 __device__ __inline__ U32 cover8x8_selectFlips(S32 dx, S32 dy) // 10 instr
@@ -42,9 +56,9 @@ __device__ __inline__ U32 cover8x8_selectFlips(S32 dx, S32 dy) // 10 instr
 __device__ __inline__ bool prepareTriangle(
     const CRParams& p,
     int2 p0, int2 p1, int2 p2, int2 lo, int2 hi,
-    int2& d1, int2& d2, S32& area)
+    int2& d1, int2& d2, S32& area, S32 minArea)
 {
-    // Backfacing or degenerate => cull.
+    // Backfacing, frontfacing, degenerate or too small => cull.
 
     d1 = make_int2(p1.x - p0.x, p1.y - p0.y);
     d2 = make_int2(p2.x - p0.x, p2.y - p0.y);
@@ -56,6 +70,12 @@ __device__ __inline__ bool prepareTriangle(
     if (area < 0 && (p.renderModeFlags & CudaRaster::RenderModeFlag_EnableBackfaceCulling) != 0)
         return false; // Backfacing.
 
+    if (area > 0 && (p.renderModeFlags & CudaRaster::RenderModeFlag_EnableFrontfaceCulling) != 0)
+        return false; // Frontfacing.
+
+    if (::abs(area) < minArea)
+        return false; // Too small.
+
     // AABB falls between samples => cull.
 
     int sampleSize = 1 << CR_SUBPIXEL_LOG2;
@@ -178,6 +198,7 @@ __device__ __inline__ void setupTriangle(
 
 //------------------------------------------------------------------------
 
+template <class IndexT>
 __device__ __inline__ void triangleSetupImpl(const CRParams p)
 {
     __shared__ F32 s_bary[CR_SETUP_WARPS * 32][18];
@@ -190,21 +211,15 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
     if (p.instanceMode)
     {
         imageIdx = blockIdx.z;
-        if (taskIdx >= p.numTriangles)
+        if (taskIdx >= getImageParams(p, imageIdx).triCount)
             return;
     }
     else
     {
-        while (imageIdx < p.numImages)
-        {
-            int count = getImageParams(p, imageIdx).triCount;
-            if (taskIdx < count)
-                break;
-            taskIdx -= count;
-            imageIdx += 1;
-        }
-        if (imageIdx == p.numImages)
+        if (taskIdx >= p.totalCount)
             return;
+        imageIdx = findImageForTask(p, taskIdx);
+        taskIdx -= getImageParams(p, imageIdx).taskOffset - p.taskBase;
     }
 
     // Per-image data structures.
@@ -212,16 +227,14 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
     const CRImageParams& ip = getImageParams(p, imageIdx);
     CRAtomics& atomics = p.atomics[imageIdx];
 
-    const int*          indexBuffer = (const int*)p.indexBuffer;
+    const IndexT*       indexBuffer = (const IndexT*)p.indexBuffer;
     U8*                 triSubtris  = (U8*)p.triSubtris               + imageIdx * p.maxSubtris;
     CRTriangleHeader*   triHeader   = (CRTriangleHeader*)p.triHeader  + imageIdx * p.maxSubtris;
     CRTriangleData*     triData     = (CRTriangleData*)p.triData      + imageIdx * p.maxSubtris;
 
     // Determine triangle index.
 
-    int triIdx = taskIdx;
-    if (!p.instanceMode)
-        triIdx += ip.triOffset;
+    int triIdx = taskIdx + ip.triOffset;
 
     // Read vertex indices.
 
@@ -250,21 +263,34 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
     // Read vertex positions.
 
     const float4* vertexBuffer = (const float4*)p.vertexBuffer;
-    if (p.instanceMode)
-        vertexBuffer += p.numVertices * imageIdx; // Instance offset.
+    if (p.instanceMode && !p.vertexMtx)
+        vertexBuffer += (size_t)p.numVertices * ip.imageIdx; // Instance offset.
 
     float4 v0 = vertexBuffer[vidx.x];
     float4 v1 = vertexBuffer[vidx.y];
     float4 v2 = vertexBuffer[vidx.z];
 
-    // Adjust vertex positions according to current viewport size and offset.
+    // Shared vertices => apply the transform of the image.
+
+    if (p.vertexMtx)
+    {
+        const float4* m = (const float4*)p.vertexMtx + 4 * ip.imageIdx;
+        v0 = transformVertex(m, v0);
+        v1 = transformVertex(m, v1);
+        v2 = transformVertex(m, v2);
+    }
+
+    // Adjust vertex positions according to current viewport size and offset. Viewport tiles are one
+    // viewport size apart, i.e., two units in normalized device coordinates.
 
-    v0.x = v0.x * p.xs + v0.w * p.xo;
-    v0.y = v0.y * p.ys + v0.w * p.yo;
-    v1.x = v1.x * p.xs + v1.w * p.xo;
-    v1.y = v1.y * p.ys + v1.w * p.yo;
-    v2.x = v2.x * p.xs + v2.w * p.xo;
-    v2.y = v2.y * p.ys + v2.w * p.yo;
+    F32 xo = p.xo - 2.f * (F32)ip.vpTileX;
+    F32 yo = p.yo - 2.f * (F32)ip.vpTileY;
+    v0.x = v0.x * p.xs + v0.w * xo;
+    v0.y = v0.y * p.ys + v0.w * yo;
+    v1.x = v1.x * p.xs + v1.w * xo;
+    v1.y = v1.y * p.ys + v1.w * yo;
+    v2.x = v2.x * p.xs + v2.w * xo;
+    v2.y = v2.y * p.ys + v2.w * yo;
 
     // Outside view frustum => cull.
 
@@ -302,7 +328,7 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
         {
             int2 d1, d2;
             S32 area;
-            bool res = prepareTriangle(p, p0, p1, p2, lo, hi, d1, d2, area);
+            bool res = prepareTriangle(p, p0, p1, p2, lo, hi, d1, d2, area, p.minArea);
             triSubtris[taskIdx] = res ? 1 : 0;
 
             if (res)
@@ -324,7 +350,8 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
     float4 od2 = make_float4(v2.x - v0.x, v2.y - v0.y, v2.z - v0.z, v2.w - v0.w);
     int numVerts = clipTriangleWithFrustum(bary, &ov0.x, &v1.x, &v2.x, &od1.x, &od2.x);
 
-    // Count non-culled subtriangles.
+    // Count non-culled subtriangles. The area threshold applies to whole triangles
+    // only, as culling a part of a clipped triangle would leave a hole.
 
     v0.x = ov0.x + od1.x * bary[0] + od2.x * bary[1];
     v0.y = ov0.y + od1.y * bary[0] + od2.y * bary[1];
@@ -349,7 +376,7 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
         S32 area;
 
         snapTriangle(p, v0, v1, v2, p0, p1, p2, rcpW, lo, hi);
-        if (prepareTriangle(p, p0, p1, p2, lo, hi, d1, d2, area))
+        if (prepareTriangle(p, p0, p1, p2, lo, hi, d1, d2, area, 0))
             numSubtris++;
 
         v1 = v2;
@@ -383,7 +410,7 @@ __device__ __inline__ void triangleSetupImpl(const CRParams p)
         S32 area;
 
         snapTriangle(p, v0, v1, v2, p0, p1, p2, rcpW, lo, hi);
-        if (prepareTriangle(p, p0, p1, p2, lo, hi, d1, d2, area))
+        if (prepareTriangle(p, p0, p1, p2, lo, hi, d1, d2, area, 0))
         {
             setupTriangle(
                 p,
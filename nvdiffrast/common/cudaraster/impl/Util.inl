@@ -263,11 +263,6 @@ __device__ __inline__ U64   cover8x8_generateMask_noLUT (S32 curr, S32 dx, S32 d
 
 template <class T> __device__ __inline__ void sortShared(T* ptr, int numItems); // Assumes that numItems <= threadsInBlock. Must sync before & after the call.
 
-__device__ __inline__ const CRImageParams& getImageParams(const CRParams& p, int idx)
-{
-    return (idx < CR_EMBED_IMAGE_PARAMS) ? p.imageParamsFirst[idx] : p.imageParamsExtra[idx - CR_EMBED_IMAGE_PARAMS];
-}
-
 //------------------------------------------------------------------------
 
 __device__ __inline__ int clipPolygonWithPlane(F32* baryOut, const F32* baryIn, int numIn, F32 v0, F32 v1, F32 v2)
@@ -32,7 +32,10 @@ using namespace tensorflow::shape_inference;
 // PyTorch.
 
 #ifdef NVDR_TORCH
-#if !(defined(__CUDACC__) || defined(USE_ROCM))
+#if defined(NVDR_CPU_ONLY)
+#include <torch/extension.h>
+#include <pybind11/numpy.h>
+#elif !(defined(__CUDACC__) || defined(USE_ROCM))
 #include <torch/extension.h>
 #include <ATen/cuda/CUDAContext.h>
 #include <ATen/cuda/CUDAUtils.h>
@@ -9,10 +9,52 @@
 #include "common.h"
 #include "interpolate.h"
 
+//------------------------------------------------------------------------
+// Rasterizer output access. Compact output has fp16 barycentrics and bary
+// differentials, and the triangle ids in a separate int32 plane.
+
+static __forceinline__ __device__ int loadRaster(const InterpolateKernelParams& p, int pidx, float2& r)
+{
+    if (p.rastTri)
+    {
+        load_storage(r, (const __half*)p.rast + 2 * pidx);
+        return p.rastTri[pidx] - 1;
+    }
+    float4 r4 = ((const float4*)p.rast)[pidx];
+    r = make_float2(r4.x, r4.y);
+    return float_to_triidx(r4.w) - 1;
+}
+
+static __forceinline__ __device__ float4 loadRasterDB(const InterpolateKernelParams& p, int pidx)
+{
+    float4 db;
+    if (p.rastTri)
+        load_storage(db, (const __half*)p.rastDB + 4 * pidx);
+    else
+        db = ((const float4*)p.rastDB)[pidx];
+    return db;
+}
+
+static __forceinline__ __device__ void storeGradRaster(const InterpolateKernelParams& p, int pidx, float gb0, float gb1)
+{
+    if (p.rastTri)
+        store_storage((__half*)p.gradRaster + 2 * pidx, make_float2(gb0, gb1));
+    else
+        ((float4*)p.gradRaster)[pidx] = make_float4(gb0, gb1, 0.f, 0.f);
+}
+
+static __forceinline__ __device__ void storeGradRasterDB(const InterpolateKernelParams& p, int pidx, float4 gdb)
+{
+    if (p.rastTri)
+        store_storage((__half*)p.gradRasterDB + 4 * pidx, gdb);
+    else
+        ((float4*)p.gradRasterDB)[pidx] = gdb;
+}
+
 //------------------------------------------------------------------------
 // Forward kernel.
 
-template <bool ENABLE_DA>
+template <class IndexT, class S, bool ENABLE_DA>
 static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const InterpolateKernelParams p)
 {
     // Calculate pixel position.
@@ -29,12 +71,12 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
     int pidx = px + p.width * (py + p.height * pz);
 
     // Output ptrs.
-    float* out = p.out + pidx * p.numAttr;
-    float2* outDA = ENABLE_DA ? (((float2*)p.outDA) + pidx * p.numDiffAttr) : 0;
+    S* out = ((S*)p.out) + pidx * p.numAttr;
+    S* outDA = ENABLE_DA ? (((S*)p.outDA) + 2 * pidx * p.numDiffAttr) : 0;
 
     // Fetch rasterizer output.
-    float4 r = ((float4*)p.rast)[pidx];
-    int triIdx = float_to_triidx(r.w) - 1;
+    float2 r;
+    int triIdx = loadRaster(p, pidx, r);
     bool triValid = (triIdx >= 0 && triIdx < p.numTriangles);
 
     // If no geometry in entire warp, zero the output and exit.
@@ -43,17 +85,18 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
     if (all_sync(s_ballot, ~0u, !triValid, IP_FWD_MAX_KERNEL_BLOCK_WIDTH))
     {
         for (int i=0; i < p.numAttr; i++)
-            out[i] = 0.f;
+            store_storage(&out[i], 0.f);
         if (ENABLE_DA)
             for (int i=0; i < p.numDiffAttr; i++)
-                outDA[i] = make_float2(0.f, 0.f);
+                store_storage(&outDA[2 * i], make_float2(0.f, 0.f));
         return;
     }
 
     // Fetch vertex indices.
-    int vi0 = triValid ? p.tri[triIdx * 3 + 0] : 0;
-    int vi1 = triValid ? p.tri[triIdx * 3 + 1] : 0;
-    int vi2 = triValid ? p.tri[triIdx * 3 + 2] : 0;
+    const IndexT* tri = (const IndexT*)p.tri;
+    int vi0 = triValid ? tri[triIdx * 3 + 0] : 0;
+    int vi1 = triValid ? tri[triIdx * 3 + 1] : 0;
+    int vi2 = triValid ? tri[triIdx * 3 + 2] : 0;
 
     // Bail out if corrupt indices.
     if (vi0 < 0 || vi0 >= p.numVertices ||
@@ -70,9 +113,9 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
     }
 
     // Pointers to attributes.
-    const float* a0 = p.attr + vi0 * p.numAttr;
-    const float* a1 = p.attr + vi1 * p.numAttr;
-    const float* a2 = p.attr + vi2 * p.numAttr;
+    const S* a0 = ((const S*)p.attr) + vi0 * p.numAttr;
+    const S* a1 = ((const S*)p.attr) + vi1 * p.numAttr;
+    const S* a2 = ((const S*)p.attr) + vi2 * p.numAttr;
 
     // Barys. If no triangle, force all to zero -> output is zero.
     float b0 = triValid ? r.x : 0.f;
@@ -81,7 +124,7 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
 
     // Interpolate and write attributes.
     for (int i=0; i < p.numAttr; i++)
-        out[i] = b0*a0[i] + b1*a1[i] + b2*a2[i];
+        store_storage(&out[i], b0*storage_to_float(a0[i]) + b1*storage_to_float(a1[i]) + b2*storage_to_float(a2[i]));
 
     // No diff attrs? Exit.
     if (!ENABLE_DA)
@@ -90,7 +133,7 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
     // Read bary pixel differentials if we have a triangle.
     float4 db = make_float4(0.f, 0.f, 0.f, 0.f);
     if (triValid)
-        db = ((float4*)p.rastDB)[pidx];
+        db = loadRasterDB(p, pidx);
 
     // Unpack a bit.
     float dudx = db.x;
@@ -111,9 +154,9 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
         float dsdy = 0.f;
         if (j >= 0 && j < p.numAttr)
         {
-            float s0 = a0[j];
-            float s1 = a1[j];
-            float s2 = a2[j];
+            float s0 = storage_to_float(a0[j]);
+            float s1 = storage_to_float(a1[j]);
+            float s2 = storage_to_float(a2[j]);
             float dsdu = s0 - s2;
             float dsdv = s1 - s2;
             dsdx = dudx*dsdu + dvdx*dsdv;
@@ -121,18 +164,28 @@ static __forceinline__ __device__ void InterpolateFwdKernelTemplate(const Interp
         }
 
         // Write.
-        outDA[i] = make_float2(dsdx, dsdy);
+        store_storage(&outDA[2 * i], make_float2(dsdx, dsdy));
     }
 }
 
 // Template specializations.
-__global__ void InterpolateFwdKernel  (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<false>(p); }
-__global__ void InterpolateFwdKernelDa(const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<true>(p); }
+__global__ void InterpolateFwdKernel         (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<int,            float,         false>(p); }
+__global__ void InterpolateFwdKernelDa       (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<int,            float,         true >(p); }
+__global__ void InterpolateFwdKernelU16      (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<unsigned short, float,         false>(p); }
+__global__ void InterpolateFwdKernelDaU16    (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<unsigned short, float,         true >(p); }
+__global__ void InterpolateFwdKernelF16      (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<int,            __half,        false>(p); }
+__global__ void InterpolateFwdKernelDaF16    (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<int,            __half,        true >(p); }
+__global__ void InterpolateFwdKernelU16F16   (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<unsigned short, __half,        false>(p); }
+__global__ void InterpolateFwdKernelDaU16F16 (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<unsigned short, __half,        true >(p); }
+__global__ void InterpolateFwdKernelBF16     (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<int,            nvdr_bfloat16, false>(p); }
+__global__ void InterpolateFwdKernelDaBF16   (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<int,            nvdr_bfloat16, true >(p); }
+__global__ void InterpolateFwdKernelU16BF16  (const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<unsigned short, nvdr_bfloat16, false>(p); }
+__global__ void InterpolateFwdKernelDaU16BF16(const InterpolateKernelParams p) { InterpolateFwdKernelTemplate<unsigned short, nvdr_bfloat16, true >(p); }
 
 //------------------------------------------------------------------------
 // Gradient kernel.
 
-template <bool ENABLE_DA>
+template <class IndexT, class S, bool ENABLE_DA>
 static __forceinline__ __device__ void InterpolateGradKernelTemplate(const InterpolateKernelParams p)
 {
     // Temporary space for coalesced atomics.
@@ -150,20 +203,21 @@ static __forceinline__ __device__ void InterpolateGradKernelTemplate(const Inter
     int pidx = px + p.width * (py + p.height * pz);
 
     // Fetch triangle ID. If none, output zero bary/db gradients and exit.
-    float4 r = ((float4*)p.rast)[pidx];
-    int triIdx = float_to_triidx(r.w) - 1;
+    float2 r;
+    int triIdx = loadRaster(p, pidx, r);
     if (triIdx < 0 || triIdx >= p.numTriangles)
     {
-        ((float4*)p.gradRaster)[pidx] = make_float4(0.f, 0.f, 0.f, 0.f);
+        storeGradRaster(p, pidx, 0.f, 0.f);
         if (ENABLE_DA)
-            ((float4*)p.gradRasterDB)[pidx] = make_float4(0.f, 0.f, 0.f, 0.f);
+            storeGradRasterDB(p, pidx, make_float4(0.f, 0.f, 0.f, 0.f));
         return;
     }
 
     // Fetch vertex indices.
-    int vi0 = p.tri[triIdx * 3 + 0];
-    int vi1 = p.tri[triIdx * 3 + 1];
-    int vi2 = p.tri[triIdx * 3 + 2];
+    const IndexT* tri = (const IndexT*)p.tri;
+    int vi0 = tri[triIdx * 3 + 0];
+    int vi1 = tri[triIdx * 3 + 1];
+    int vi2 = tri[triIdx * 3 + 2];
 
     // Bail out if corrupt indices.
     if (vi0 < 0 || vi0 >= p.numVertices ||
@@ -183,10 +237,10 @@ static __forceinline__ __device__ void InterpolateGradKernelTemplate(const Inter
     CA_SET_GROUP(triIdx, IP_GRAD_MAX_KERNEL_BLOCK_WIDTH);
 
     // Pointers to inputs.
-    const float* a0 = p.attr + vi0 * p.numAttr;
-    const float* a1 = p.attr + vi1 * p.numAttr;
-    const float* a2 = p.attr + vi2 * p.numAttr;
-    const float* pdy = p.dy + pidx * p.numAttr;
+    const S* a0 = ((const S*)p.attr) + vi0 * p.numAttr;
+    const S* a1 = ((const S*)p.attr) + vi1 * p.numAttr;
+    const S* a2 = ((const S*)p.attr) + vi2 * p.numAttr;
+    const S* pdy = ((const S*)p.dy) + pidx * p.numAttr;
 
     // Pointers to outputs.
     float* ga0 = p.gradAttr + vi0 * p.numAttr;
@@ -203,10 +257,10 @@ static __forceinline__ __device__ void InterpolateGradKernelTemplate(const Inter
     // Loop over attributes and accumulate attribute gradients.
     for (int i=0; i < p.numAttr; i++)
     {
-        float y = pdy[i];
-        float s0 = a0[i];
-        float s1 = a1[i];
-        float s2 = a2[i];
+        float y = storage_to_float(pdy[i]);
+        float s0 = storage_to_float(a0[i]);
+        float s1 = storage_to_float(a1[i]);
+        float s2 = storage_to_float(a2[i]);
         gb0 += y * (s0 - s2);
         gb1 += y * (s1 - s2);
         caAtomicAdd(ga0 + i, b0 * y);
@@ -215,21 +269,21 @@ static __forceinline__ __device__ void InterpolateGradKernelTemplate(const Inter
     }
 
     // Write the bary gradients.
-    ((float4*)p.gradRaster)[pidx] = make_float4(gb0, gb1, 0.f, 0.f);
+    storeGradRaster(p, pidx, gb0, gb1);
 
     // If pixel differentials disabled, we're done.
     if (!ENABLE_DA)
         return;
 
     // Calculate gradients based on attribute pixel differentials.
-    const float2* dda = ((float2*)p.dda) + pidx * p.numDiffAttr;
+    const S* dda = ((const S*)p.dda) + 2 * pidx * p.numDiffAttr;
     float gdudx = 0.f;
     float gdudy = 0.f;
     float gdvdx = 0.f;
     float gdvdy = 0.f;
 
     // Read bary pixel differentials.
-    float4 db = ((float4*)p.rastDB)[pidx];
+    float4 db = loadRasterDB(p, pidx);
     float dudx = db.x;
     float dudy = db.y;
     float dvdx = db.z;
@@ -245,13 +299,14 @@ static __forceinline__ __device__ void InterpolateGradKernelTemplate(const Inter
         // Check that index is valid.
         if (j >= 0 && j < p.numAttr)
         {
-            float2 dsdxy = dda[i];
+            float2 dsdxy;
+            load_storage(dsdxy, &dda[2 * i]);
             float dsdx = dsdxy.x;
             float dsdy = dsdxy.y;
 
-            float s0 = a0[j];
-            float s1 = a1[j];
-            float s2 = a2[j];
+            float s0 = storage_to_float(a0[j]);
+            float s1 = storage_to_float(a1[j]);
+            float s2 = storage_to_float(a2[j]);
 
             // Gradients of db.
             float dsdu = s0 - s2;
@@ -271,11 +326,21 @@ static __forceinline__ __device__ void InterpolateGradKernelTemplate(const Inter
     }
 
     // Write.
-    ((float4*)p.gradRasterDB)[pidx] = make_float4(gdudx, gdudy, gdvdx, gdvdy);
+    storeGradRasterDB(p, pidx, make_float4(gdudx, gdudy, gdvdx, gdvdy));
 }
 
 // Template specializations.
-__global__ void InterpolateGradKernel  (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<false>(p); }
-__global__ void InterpolateGradKernelDa(const InterpolateKernelParams p) { InterpolateGradKernelTemplate<true>(p); }
+__global__ void InterpolateGradKernel         (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<int,            float,         false>(p); }
+__global__ void InterpolateGradKernelDa       (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<int,            float,         true >(p); }
+__global__ void InterpolateGradKernelU16      (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<unsigned short, float,         false>(p); }
+__global__ void InterpolateGradKernelDaU16    (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<unsigned short, float,         true >(p); }
+__global__ void InterpolateGradKernelF16      (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<int,            __half,        false>(p); }
+__global__ void InterpolateGradKernelDaF16    (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<int,            __half,        true >(p); }
+__global__ void InterpolateGradKernelU16F16   (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<unsigned short, __half,        false>(p); }
+__global__ void InterpolateGradKernelDaU16F16 (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<unsigned short, __half,        true >(p); }
+__global__ void InterpolateGradKernelBF16     (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<int,            nvdr_bfloat16, false>(p); }
+__global__ void InterpolateGradKernelDaBF16   (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<int,            nvdr_bfloat16, true >(p); }
+__global__ void InterpolateGradKernelU16BF16  (const InterpolateKernelParams p) { InterpolateGradKernelTemplate<unsigned short, nvdr_bfloat16, false>(p); }
+__global__ void InterpolateGradKernelDaU16BF16(const InterpolateKernelParams p) { InterpolateGradKernelTemplate<unsigned short, nvdr_bfloat16, true >(p); }
 
 //------------------------------------------------------------------------
@@ -22,17 +22,18 @@
 
 struct InterpolateKernelParams
 {
-    const int*      tri;                            // Incoming triangle buffer.
-    const float*    attr;                           // Incoming attribute buffer.
-    const float*    rast;                           // Incoming rasterizer output buffer.
-    const float*    rastDB;                         // Incoming rasterizer output buffer for bary derivatives.
-    const float*    dy;                             // Incoming attribute gradients.
-    const float*    dda;                            // Incoming attr diff gradients.
-    float*          out;                            // Outgoing interpolated attributes.
-    float*          outDA;                          // Outgoing texcoord major axis lengths.
-    float*          gradAttr;                       // Outgoing attribute gradients.
-    float*          gradRaster;                     // Outgoing rasterizer gradients.
-    float*          gradRasterDB;                   // Outgoing rasterizer bary diff gradients.
+    const void*     tri;                            // Incoming triangle buffer, int32 or uint16 indices.
+    const void*     attr;                           // Incoming attribute buffer, in the storage type.
+    const void*     rast;                           // Incoming rasterizer output buffer, float4 or compact barycentrics.
+    const int*      rastTri;                        // Incoming triangle ids of compact rasterizer output, NULL if rast is float4.
+    const void*     rastDB;                         // Incoming rasterizer output buffer for bary derivatives.
+    const void*     dy;                             // Incoming attribute gradients, in the storage type.
+    const void*     dda;                            // Incoming attr diff gradients, in the storage type.
+    void*           out;                            // Outgoing interpolated attributes, in the storage type.
+    void*           outDA;                          // Outgoing texcoord major axis lengths, in the storage type.
+    float*          gradAttr;                       // Outgoing attribute gradients, always fp32.
+    void*           gradRaster;                     // Outgoing rasterizer gradients, in the layout of rast.
+    void*           gradRasterDB;                   // Outgoing rasterizer bary diff gradients, in the layout of rastDB.
     int             numTriangles;                   // Number of triangles.
     int             numVertices;                    // Number of vertices.
     int             numAttr;                        // Number of total vertex attributes.
@@ -42,8 +43,21 @@ struct InterpolateKernelParams
     int             depth;                          // Minibatch size.
     int             attrBC;                         // 0=normal, 1=attr is broadcast.
     int             instance_mode;                  // 0=normal, 1=instance mode.
+    int             tri_u16;                        // 1 if triangle indices are uint16. Cuda kernels have specializations instead.
     int             diff_attrs_all;                 // 0=normal, 1=produce pixel differentials for all attributes.
     int             diffAttrs[IP_MAX_DIFF_ATTRS];   // List of attributes to differentiate.
 };
 
 //------------------------------------------------------------------------
+// CPU implementation. Takes the same params as the CUDA kernels, with all
+// pointers in host memory and all attribute data in fp32. The CUDA kernels
+// are templated on the attribute storage type instead, see NVDR_STORAGE_*.
+// Compact rasterizer output is likewise read as fp32 on the CPU, see
+// RasterizeCudaFwdShaderParams for the layout.
+// Rows are distributed over the pool.
+
+class ThreadPool;
+void InterpolateCpuFwd (const InterpolateKernelParams& p, bool enableDA, ThreadPool& pool);
+void InterpolateCpuGrad(const InterpolateKernelParams& p, bool enableDA, ThreadPool& pool); // gradAttr must be zeroed.
+
+//------------------------------------------------------------------------
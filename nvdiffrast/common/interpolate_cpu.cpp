@@ -0,0 +1,514 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "common.h"
+#include "interpolate.h"
+#include "cpuisa.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Channel loops. The device compiler contracts the multiply-adds of the
+// Cuda kernel into fma instructions, so every variant evaluates them as
+// fma(b2, a2, fma(b0, a0, b1*a1)) to reproduce the GPU results exactly.
+
+typedef void (*InterpolateChannelsFunc)(float* out, const float* a0, const float* a1, const float* a2, float b0, float b1, float b2, int n);
+typedef void (*DiffChannelsFunc)(float* outDA, const float* a0, const float* a1, const float* a2, float dudx, float dudy, float dvdx, float dvdy, int n);
+
+static void interpolateChannels_scalar(float* out, const float* a0, const float* a1, const float* a2, float b0, float b1, float b2, int n)
+{
+    for (int i=0; i < n; i++)
+        out[i] = fmaf(b2, a2[i], fmaf(b0, a0[i], b1 * a1[i]));
+}
+
+static void diffChannels_scalar(float* outDA, const float* a0, const float* a1, const float* a2, float dudx, float dudy, float dvdx, float dvdy, int n)
+{
+    for (int i=0; i < n; i++)
+    {
+        float dsdu = a0[i] - a2[i];
+        float dsdv = a1[i] - a2[i];
+        outDA[2*i+0] = fmaf(dudx, dsdu, dvdx * dsdv);
+        outDA[2*i+1] = fmaf(dudy, dsdu, dvdy * dsdv);
+    }
+}
+
+#if NVDR_CPU_X86
+
+//------------------------------------------------------------------------
+// AVX2 + FMA, 8 channels per iteration.
+
+NVDR_CPU_AVX2 static void interpolateChannels_avx2(float* out, const float* a0, const float* a1, const float* a2, float b0, float b1, float b2, int n)
+{
+    __m256 vb0 = _mm256_set1_ps(b0);
+    __m256 vb1 = _mm256_set1_ps(b1);
+    __m256 vb2 = _mm256_set1_ps(b2);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 t = _mm256_mul_ps(vb1, _mm256_loadu_ps(a1 + i));
+        t = _mm256_fmadd_ps(vb0, _mm256_loadu_ps(a0 + i), t);
+        t = _mm256_fmadd_ps(vb2, _mm256_loadu_ps(a2 + i), t);
+        _mm256_storeu_ps(out + i, t);
+    }
+    for (; i < n; i++)
+        out[i] = fmaf(b2, a2[i], fmaf(b0, a0[i], b1 * a1[i]));
+}
+
+NVDR_CPU_AVX2 static void diffChannels_avx2(float* outDA, const float* a0, const float* a1, const float* a2, float dudx, float dudy, float dvdx, float dvdy, int n)
+{
+    __m256 vdudx = _mm256_set1_ps(dudx);
+    __m256 vdudy = _mm256_set1_ps(dudy);
+    __m256 vdvdx = _mm256_set1_ps(dvdx);
+    __m256 vdvdy = _mm256_set1_ps(dvdy);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 s2   = _mm256_loadu_ps(a2 + i);
+        __m256 dsdu = _mm256_sub_ps(_mm256_loadu_ps(a0 + i), s2);
+        __m256 dsdv = _mm256_sub_ps(_mm256_loadu_ps(a1 + i), s2);
+        __m256 dsdx = _mm256_fmadd_ps(vdudx, dsdu, _mm256_mul_ps(vdvdx, dsdv));
+        __m256 dsdy = _mm256_fmadd_ps(vdudy, dsdu, _mm256_mul_ps(vdvdy, dsdv));
+
+        // Interleave into (dsdx, dsdy) pairs.
+        __m256 lo = _mm256_unpacklo_ps(dsdx, dsdy);
+        __m256 hi = _mm256_unpackhi_ps(dsdx, dsdy);
+        _mm256_storeu_ps(outDA + 2*i + 0, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(outDA + 2*i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    for (; i < n; i++)
+    {
+        float dsdu = a0[i] - a2[i];
+        float dsdv = a1[i] - a2[i];
+        outDA[2*i+0] = fmaf(dudx, dsdu, dvdx * dsdv);
+        outDA[2*i+1] = fmaf(dudy, dsdu, dvdy * dsdv);
+    }
+}
+
+//------------------------------------------------------------------------
+// AVX-512, 16 channels per iteration with a masked tail.
+
+NVDR_CPU_AVX512 static void interpolateChannels_avx512(float* out, const float* a0, const float* a1, const float* a2, float b0, float b1, float b2, int n)
+{
+    __m512 vb0 = _mm512_set1_ps(b0);
+    __m512 vb1 = _mm512_set1_ps(b1);
+    __m512 vb2 = _mm512_set1_ps(b2);
+    for (int i=0; i < n; i += 16)
+    {
+        __mmask16 m = (__mmask16)((n - i) >= 16 ? 0xffffu : ((1u << (n - i)) - 1u));
+        __m512 t = _mm512_mul_ps(vb1, _mm512_maskz_loadu_ps(m, a1 + i));
+        t = _mm512_fmadd_ps(vb0, _mm512_maskz_loadu_ps(m, a0 + i), t);
+        t = _mm512_fmadd_ps(vb2, _mm512_maskz_loadu_ps(m, a2 + i), t);
+        _mm512_mask_storeu_ps(out + i, m, t);
+    }
+}
+
+NVDR_CPU_AVX512 static void diffChannels_avx512(float* outDA, const float* a0, const float* a1, const float* a2, float dudx, float dudy, float dvdx, float dvdy, int n)
+{
+    __m512 vdudx = _mm512_set1_ps(dudx);
+    __m512 vdudy = _mm512_set1_ps(dudy);
+    __m512 vdvdx = _mm512_set1_ps(dvdx);
+    __m512 vdvdy = _mm512_set1_ps(dvdy);
+    __m512i idxLo = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    __m512i idxHi = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    for (int i=0; i < n; i += 16)
+    {
+        int c = std::min(n - i, 16);
+        __mmask16 m   = (__mmask16)(c >= 16 ? 0xffffu : ((1u << c) - 1u));
+        __mmask16 mLo = (__mmask16)(c >= 8  ? 0xffffu : ((1u << (2*c)) - 1u));
+        __mmask16 mHi = (__mmask16)(c <= 8  ? 0u : (c >= 16 ? 0xffffu : ((1u << (2*c - 16)) - 1u)));
+
+        __m512 s2   = _mm512_maskz_loadu_ps(m, a2 + i);
+        __m512 dsdu = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a0 + i), s2);
+        __m512 dsdv = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a1 + i), s2);
+        __m512 dsdx = _mm512_fmadd_ps(vdudx, dsdu, _mm512_mul_ps(vdvdx, dsdv));
+        __m512 dsdy = _mm512_fmadd_ps(vdudy, dsdu, _mm512_mul_ps(vdvdy, dsdv));
+
+        // Interleave into (dsdx, dsdy) pairs.
+        _mm512_mask_storeu_ps(outDA + 2*i +  0, mLo, _mm512_permutex2var_ps(dsdx, idxLo, dsdy));
+        _mm512_mask_storeu_ps(outDA + 2*i + 16, mHi, _mm512_permutex2var_ps(dsdx, idxHi, dsdy));
+    }
+}
+
+#endif // NVDR_CPU_X86
+
+//------------------------------------------------------------------------
+// Per-row shader. Same semantics as InterpolateFwdKernelTemplate.
+
+template <bool ENABLE_DA>
+static void InterpolateCpuFwdRow(const InterpolateKernelParams& p, int py, int pz, InterpolateChannelsFunc interpolateChannels, DiffChannelsFunc diffChannels)
+{
+    for (int px=0; px < p.width; px++)
+    {
+        // Pixel index.
+        int pidx = px + p.width * (py + p.height * pz);
+
+        // Output ptrs.
+        float* out   = (float*)p.out + (size_t)pidx * p.numAttr;
+        float* outDA = ENABLE_DA ? ((float*)p.outDA + (size_t)pidx * p.numDiffAttr * 2) : 0;
+
+        // Fetch rasterizer output. Zero the output if there is no triangle.
+        const float* r = (const float*)p.rast + pidx * (p.rastTri ? 2 : 4);
+        int triIdx = (p.rastTri ? p.rastTri[pidx] : float_to_triidx_host(r[3])) - 1;
+        if (triIdx < 0 || triIdx >= p.numTriangles)
+        {
+            std::fill(out, out + p.numAttr, 0.f);
+            if (ENABLE_DA)
+                std::fill(outDA, outDA + p.numDiffAttr * 2, 0.f);
+            continue;
+        }
+
+        // Fetch vertex indices.
+        int vi0 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 0);
+        int vi1 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 1);
+        int vi2 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 2);
+
+        // Bail out if corrupt indices.
+        if (vi0 < 0 || vi0 >= p.numVertices ||
+            vi1 < 0 || vi1 >= p.numVertices ||
+            vi2 < 0 || vi2 >= p.numVertices)
+            continue;
+
+        // In instance mode, adjust vertex indices by minibatch index unless broadcasting.
+        if (p.instance_mode && !p.attrBC)
+        {
+            vi0 += pz * p.numVertices;
+            vi1 += pz * p.numVertices;
+            vi2 += pz * p.numVertices;
+        }
+
+        // Pointers to attributes.
+        const float* a0 = (const float*)p.attr + (size_t)vi0 * p.numAttr;
+        const float* a1 = (const float*)p.attr + (size_t)vi1 * p.numAttr;
+        const float* a2 = (const float*)p.attr + (size_t)vi2 * p.numAttr;
+
+        // Interpolate and write attributes.
+        float b0 = r[0];
+        float b1 = r[1];
+        float b2 = 1.f - r[0] - r[1];
+        interpolateChannels(out, a0, a1, a2, b0, b1, b2, p.numAttr);
+
+        // No diff attrs? Done.
+        if (!ENABLE_DA)
+            continue;
+
+        // Read bary pixel differentials.
+        const float* db = (const float*)p.rastDB + pidx * 4;
+        float dudx = db[0];
+        float dudy = db[1];
+        float dvdx = db[2];
+        float dvdy = db[3];
+
+        // All attributes are contiguous, use the vector loop.
+        if (p.diff_attrs_all)
+        {
+            diffChannels(outDA, a0, a1, a2, dudx, dudy, dvdx, dvdy, p.numDiffAttr);
+            continue;
+        }
+
+        // Calculate the pixel differentials of chosen attributes.
+        for (int i=0; i < p.numDiffAttr; i++)
+        {
+            // Input attribute index.
+            int j = p.diffAttrs[i];
+            if (j < 0)
+                j += p.numAttr; // Python-style negative indices.
+
+            // Zero output if invalid index.
+            float dsdx = 0.f;
+            float dsdy = 0.f;
+            if (j >= 0 && j < p.numAttr)
+            {
+                float dsdu = a0[j] - a2[j];
+                float dsdv = a1[j] - a2[j];
+                dsdx = fmaf(dudx, dsdu, dvdx * dsdv);
+                dsdy = fmaf(dudy, dsdu, dvdy * dsdv);
+            }
+
+            // Write.
+            outDA[2*i+0] = dsdx;
+            outDA[2*i+1] = dsdy;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// Entry point. Rows of the minibatch are distributed over the pool.
+
+void InterpolateCpuFwd(const InterpolateKernelParams& p, bool enableDA, ThreadPool& pool)
+{
+    // Choose channel loops.
+    InterpolateChannelsFunc interpolateChannels = interpolateChannels_scalar;
+    DiffChannelsFunc        diffChannels        = diffChannels_scalar;
+#if NVDR_CPU_X86
+    CpuIsa isa = getCpuIsa();
+    if (isa >= CpuIsa_AVX512)
+    {
+        interpolateChannels = interpolateChannels_avx512;
+        diffChannels        = diffChannels_avx512;
+    }
+    else if (isa >= CpuIsa_AVX2)
+    {
+        interpolateChannels = interpolateChannels_avx2;
+        diffChannels        = diffChannels_avx2;
+    }
+#endif
+
+    // Run.
+    int height = p.height;
+    int rows   = height * p.depth;
+    int grain  = std::max(1, rows / (pool.getNumThreads() * 4));
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            if (enableDA)
+                InterpolateCpuFwdRow<true> (p, i % height, i / height, interpolateChannels, diffChannels);
+            else
+                InterpolateCpuFwdRow<false>(p, i % height, i / height, interpolateChannels, diffChannels);
+        }
+    });
+}
+
+//------------------------------------------------------------------------
+// Gradient accumulation. Instead of scattering into gradAttr with atomics,
+// each worker adds into a private, sparse copy that only holds the vertex
+// blocks it has touched. The copies are then merged block by block with a
+// pairwise tree over the workers, so the result matches the Cuda op up to
+// the order of the floating point additions.
+
+#define IP_CPU_GRAD_BLOCK_VERTICES 64
+
+struct InterpolateCpuGradAccum
+{
+    std::vector<int>    blockOfs;   // Offset of each vertex block in data, or -1 if not touched.
+    std::vector<float>  data;       // Gradient storage for the touched blocks.
+
+    void touch(int vi, int numAttr)
+    {
+        int b = vi / IP_CPU_GRAD_BLOCK_VERTICES;
+        if (blockOfs[b] < 0)
+        {
+            blockOfs[b] = (int)data.size();
+            data.resize(data.size() + IP_CPU_GRAD_BLOCK_VERTICES * numAttr, 0.f);
+        }
+    }
+
+    float* get(int vi, int numAttr) // Valid until the next touch().
+    {
+        return &data[blockOfs[vi / IP_CPU_GRAD_BLOCK_VERTICES] + (vi % IP_CPU_GRAD_BLOCK_VERTICES) * numAttr];
+    }
+};
+
+//------------------------------------------------------------------------
+// Per-row gradient shader. Same semantics as InterpolateGradKernelTemplate.
+
+template <bool ENABLE_DA>
+static void InterpolateCpuGradRow(const InterpolateKernelParams& p, int py, int pz, InterpolateCpuGradAccum& acc)
+{
+    for (int px=0; px < p.width; px++)
+    {
+        // Pixel index.
+        int pidx = px + p.width * (py + p.height * pz);
+
+        // Fetch triangle ID. If none, output zero bary/db gradients and skip.
+        int rastStride = p.rastTri ? 2 : 4; // Compact output has only the barycentrics here.
+        const float* r = (const float*)p.rast + pidx * rastStride;
+        float* gr = (float*)p.gradRaster + pidx * rastStride;
+        float* grdb = ENABLE_DA ? ((float*)p.gradRasterDB + pidx * 4) : 0;
+        int triIdx = (p.rastTri ? p.rastTri[pidx] : float_to_triidx_host(r[3])) - 1;
+        if (triIdx < 0 || triIdx >= p.numTriangles)
+        {
+            std::fill(gr, gr + rastStride, 0.f);
+            if (ENABLE_DA)
+                grdb[0] = grdb[1] = grdb[2] = grdb[3] = 0.f;
+            continue;
+        }
+
+        // Fetch vertex indices.
+        int vi0 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 0);
+        int vi1 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 1);
+        int vi2 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 2);
+
+        // Bail out if corrupt indices.
+        if (vi0 < 0 || vi0 >= p.numVertices ||
+            vi1 < 0 || vi1 >= p.numVertices ||
+            vi2 < 0 || vi2 >= p.numVertices)
+            continue;
+
+        // In instance mode, adjust vertex indices by minibatch index unless broadcasting.
+        if (p.instance_mode && !p.attrBC)
+        {
+            vi0 += pz * p.numVertices;
+            vi1 += pz * p.numVertices;
+            vi2 += pz * p.numVertices;
+        }
+
+        // Pointers to inputs.
+        const float* a0 = (const float*)p.attr + (size_t)vi0 * p.numAttr;
+        const float* a1 = (const float*)p.attr + (size_t)vi1 * p.numAttr;
+        const float* a2 = (const float*)p.attr + (size_t)vi2 * p.numAttr;
+        const float* pdy = (const float*)p.dy + (size_t)pidx * p.numAttr;
+
+        // Pointers to private accumulators.
+        acc.touch(vi0, p.numAttr);
+        acc.touch(vi1, p.numAttr);
+        acc.touch(vi2, p.numAttr);
+        float* ga0 = acc.get(vi0, p.numAttr);
+        float* ga1 = acc.get(vi1, p.numAttr);
+        float* ga2 = acc.get(vi2, p.numAttr);
+
+        // Barys and bary gradient accumulators.
+        float b0 = r[0];
+        float b1 = r[1];
+        float b2 = 1.f - r[0] - r[1];
+        float gb0 = 0.f;
+        float gb1 = 0.f;
+
+        // Loop over attributes and accumulate attribute gradients.
+        for (int i=0; i < p.numAttr; i++)
+        {
+            float y = pdy[i];
+            float s0 = a0[i];
+            float s1 = a1[i];
+            float s2 = a2[i];
+            gb0 = fmaf(y, s0 - s2, gb0);
+            gb1 = fmaf(y, s1 - s2, gb1);
+            ga0[i] += b0 * y;
+            ga1[i] += b1 * y;
+            ga2[i] += b2 * y;
+        }
+
+        // Write the bary gradients.
+        std::fill(gr, gr + rastStride, 0.f);
+        gr[0] = gb0;
+        gr[1] = gb1;
+
+        // If pixel differentials disabled, we're done.
+        if (!ENABLE_DA)
+            continue;
+
+        // Calculate gradients based on attribute pixel differentials.
+        const float* dda = (const float*)p.dda + (size_t)pidx * p.numDiffAttr * 2;
+        float gdudx = 0.f;
+        float gdudy = 0.f;
+        float gdvdx = 0.f;
+        float gdvdy = 0.f;
+
+        // Read bary pixel differentials.
+        const float* db = (const float*)p.rastDB + pidx * 4;
+        float dudx = db[0];
+        float dudy = db[1];
+        float dvdx = db[2];
+        float dvdy = db[3];
+
+        for (int i=0; i < p.numDiffAttr; i++)
+        {
+            // Input attribute index.
+            int j = p.diff_attrs_all ? i : p.diffAttrs[i];
+            if (j < 0)
+                j += p.numAttr; // Python-style negative indices.
+
+            // Check that index is valid.
+            if (j >= 0 && j < p.numAttr)
+            {
+                float dsdx = dda[2*i+0];
+                float dsdy = dda[2*i+1];
+
+                float s0 = a0[j];
+                float s1 = a1[j];
+                float s2 = a2[j];
+
+                // Gradients of db.
+                float dsdu = s0 - s2;
+                float dsdv = s1 - s2;
+                gdudx = fmaf(dsdu, dsdx, gdudx);
+                gdudy = fmaf(dsdu, dsdy, gdudy);
+                gdvdx = fmaf(dsdv, dsdx, gdvdx);
+                gdvdy = fmaf(dsdv, dsdy, gdvdy);
+
+                // Gradients of attributes.
+                float du = fmaf(dsdx, dudx, dsdy * dudy);
+                float dv = fmaf(dsdx, dvdx, dsdy * dvdy);
+                ga0[j] += du;
+                ga1[j] += dv;
+                ga2[j] += -du - dv;
+            }
+        }
+
+        // Write.
+        grdb[0] = gdudx;
+        grdb[1] = gdudy;
+        grdb[2] = gdvdx;
+        grdb[3] = gdvdy;
+    }
+}
+
+//------------------------------------------------------------------------
+// Gradient entry point. gradAttr must be zero-initialized by the caller.
+
+void InterpolateCpuGrad(const InterpolateKernelParams& p, bool enableDA, ThreadPool& pool)
+{
+    // Size of the attribute gradient buffer in vertices.
+    int numGradVertices = (p.instance_mode && !p.attrBC) ? p.numVertices * p.depth : p.numVertices;
+    int numBlocks       = (numGradVertices + IP_CPU_GRAD_BLOCK_VERTICES - 1) / IP_CPU_GRAD_BLOCK_VERTICES;
+    int blockFloats     = IP_CPU_GRAD_BLOCK_VERTICES * p.numAttr;
+
+    // Private accumulators, one per worker.
+    int numThreads = pool.getNumThreads();
+    std::vector<InterpolateCpuGradAccum> accums(numThreads);
+    for (int i=0; i < numThreads; i++)
+        accums[i].blockOfs.assign(numBlocks, -1);
+
+    // Accumulate over image rows.
+    int height = p.height;
+    int rows   = height * p.depth;
+    int grain  = std::max(1, rows / (numThreads * 4));
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int threadIdx)
+    {
+        InterpolateCpuGradAccum& acc = accums[threadIdx];
+        for (int i = begin; i < end; i++)
+        {
+            if (enableDA)
+                InterpolateCpuGradRow<true> (p, i % height, i / height, acc);
+            else
+                InterpolateCpuGradRow<false>(p, i % height, i / height, acc);
+        }
+    });
+
+    // Merge the accumulators of each vertex block with a pairwise tree and write the result.
+    pool.parallelFor(0, numBlocks, 16, [&](int begin, int end, int)
+    {
+        std::vector<float*> src(numThreads);
+        for (int b = begin; b < end; b++)
+        {
+            int n = 0;
+            for (int t=0; t < numThreads; t++)
+                if (accums[t].blockOfs[b] >= 0)
+                    src[n++] = &accums[t].data[accums[t].blockOfs[b]];
+            if (!n)
+                continue; // Untouched, leave at zero.
+
+            for (int stride = 1; stride < n; stride *= 2)
+            for (int t = 0; t + stride < n; t += 2 * stride)
+            {
+                float* dst = src[t];
+                const float* add = src[t + stride];
+                for (int i=0; i < blockFloats; i++)
+                    dst[i] += add[i];
+            }
+
+            // Last block may be partial.
+            int numFloats = std::min(IP_CPU_GRAD_BLOCK_VERTICES, numGradVertices - b * IP_CPU_GRAD_BLOCK_VERTICES) * p.numAttr;
+            memcpy(p.gradAttr + (size_t)b * blockFloats, src[0], numFloats * sizeof(float));
+        }
+    });
+}
+
+//------------------------------------------------------------------------
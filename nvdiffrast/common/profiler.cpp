@@ -0,0 +1,324 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "framework.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+//------------------------------------------------------------------------
+
+static thread_local int  s_depth   = 0;        // Open ranges on this thread.
+static thread_local bool s_sampled = false;    // Outermost range on this thread is recorded.
+static thread_local int  s_tid     = -1;       // Index of this thread in traces.
+static std::atomic<int>  s_numThreads(0);
+
+//------------------------------------------------------------------------
+
+Profiler& Profiler::get(void)
+{
+    static Profiler s_profiler;
+    return s_profiler;
+}
+
+Profiler::Profiler(void)
+:   m_enabled   (false),
+    m_counter   (0),
+    m_rate      (NVDR_PROFILE_RATE_ONE),
+    m_ringNext  (0),
+    m_ringCount (0),
+    m_random    (1)
+{
+    // empty
+}
+
+Profiler::~Profiler(void)
+{
+    // Events are intentionally leaked, the runtime may already be gone at exit.
+}
+
+//------------------------------------------------------------------------
+
+void Profiler::enable(double sampleRate)
+{
+    if (sampleRate <= 0.0)
+    {
+        m_enabled.store(false);
+        return;
+    }
+    double rate = std::floor(std::min(sampleRate, 1.0) * (double)NVDR_PROFILE_RATE_ONE + .5);
+    m_rate.store(std::max((unsigned long long)rate, 1ull)); // Tiny rates still record now and then.
+    m_enabled.store(true);
+}
+
+void Profiler::reset(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pollDevice(true);
+    m_ring.clear();
+    m_ringNext  = 0;
+    m_ringCount = 0;
+    m_aggregates.clear();
+}
+
+double Profiler::now(void)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------
+
+bool Profiler::enterRange(void)
+{
+    if (s_depth++ == 0)
+    {
+        s_sampled = isProfileSampled(m_counter.fetch_add(1, std::memory_order_relaxed), m_rate.load(std::memory_order_relaxed));
+        if (s_sampled && s_tid < 0)
+            s_tid = s_numThreads.fetch_add(1);
+
+        // Pick up finished device ranges without waiting.
+        if (s_sampled)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            pollDevice(false);
+        }
+    }
+    return s_sampled;
+}
+
+void Profiler::leaveRange(void)
+{
+    s_depth--;
+}
+
+void Profiler::recordHost(const char* name, double beginUs, double endUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    commit(name, s_tid, beginUs, endUs - beginUs);
+}
+
+void Profiler::commit(const char* name, int tid, double beginUs, double durUs)
+{
+    // Trace ring.
+    if (m_ring.empty())
+        m_ring.resize(NVDR_PROFILE_RING_SIZE);
+    Record& r = m_ring[m_ringNext];
+    r.name    = name;
+    r.tid     = tid;
+    r.beginUs = beginUs;
+    r.durUs   = durUs;
+    m_ringNext  = (m_ringNext + 1) % NVDR_PROFILE_RING_SIZE;
+    m_ringCount = std::min(m_ringCount + 1, (size_t)NVDR_PROFILE_RING_SIZE);
+
+    // Aggregate with reservoir sampling of durations.
+    Aggregate& a = m_aggregates[name];
+    a.count   += 1;
+    a.totalUs += durUs;
+    a.maxUs    = std::max(a.maxUs, durUs);
+    if ((int)a.reservoir.size() < NVDR_PROFILE_RESERVOIR)
+        a.reservoir.push_back((float)durUs);
+    else
+    {
+        m_random = m_random * 1664525u + 1013904223u;
+        unsigned long long k = ((unsigned long long)m_random * (unsigned long long)a.count) >> 32;
+        if (k < NVDR_PROFILE_RESERVOIR)
+            a.reservoir[k] = (float)durUs;
+    }
+}
+
+//------------------------------------------------------------------------
+// Device ranges. Errors are ignored and the range dropped, profiling must
+// not make an op fail.
+
+#ifndef NVDR_CPU_ONLY
+
+void* Profiler::acquireEvent(void)
+{
+    if (!m_freeEvents.empty())
+    {
+        void* e = m_freeEvents.back();
+        m_freeEvents.pop_back();
+        return e;
+    }
+    cudaEvent_t e = NULL;
+    if (cudaEventCreate(&e) != cudaSuccess)
+        return NULL;
+    return (void*)e;
+}
+
+void* Profiler::beginDevice(void* stream)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int device = 0;
+    if (cudaGetDevice(&device) != cudaSuccess)
+        return NULL;
+
+    // Device times are placed on the host timeline relative to a reference event. Establishing it
+    // waits for the stream once per device.
+    if (!m_deviceRef.count(device))
+    {
+        void* ref = acquireEvent();
+        if (!ref || cudaEventRecord((cudaEvent_t)ref, (cudaStream_t)stream) != cudaSuccess || cudaEventSynchronize((cudaEvent_t)ref) != cudaSuccess)
+            return NULL;
+        m_deviceRef[device] = std::make_pair(ref, now());
+    }
+
+    void* e = acquireEvent();
+    if (!e || cudaEventRecord((cudaEvent_t)e, (cudaStream_t)stream) != cudaSuccess)
+        return NULL;
+    return e;
+}
+
+void Profiler::endDevice(const char* name, void* token, void* stream)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DeviceRange r;
+    r.name       = name;
+    r.beginEvent = token;
+    r.endEvent   = acquireEvent();
+    if (cudaGetDevice(&r.device) != cudaSuccess || !r.endEvent || cudaEventRecord((cudaEvent_t)r.endEvent, (cudaStream_t)stream) != cudaSuccess)
+    {
+        m_freeEvents.push_back(token);
+        if (r.endEvent)
+            m_freeEvents.push_back(r.endEvent);
+        return;
+    }
+    m_pending.push_back(r);
+}
+
+void Profiler::pollDevice(bool wait)
+{
+    // Ranges complete roughly in submission order, stop at the first one in flight.
+    size_t numDone = 0;
+    for (; numDone < m_pending.size(); numDone++)
+    {
+        DeviceRange& r = m_pending[numDone];
+        cudaError_t status = wait ? cudaEventSynchronize((cudaEvent_t)r.endEvent) : cudaEventQuery((cudaEvent_t)r.endEvent);
+        if (status == cudaErrorNotReady)
+            break;
+
+        float beginMs = 0.f, durMs = 0.f;
+        const std::pair<void*, double>& ref = m_deviceRef[r.device];
+        if (status == cudaSuccess &&
+            cudaEventElapsedTime(&beginMs, (cudaEvent_t)ref.first, (cudaEvent_t)r.beginEvent) == cudaSuccess &&
+            cudaEventElapsedTime(&durMs, (cudaEvent_t)r.beginEvent, (cudaEvent_t)r.endEvent) == cudaSuccess)
+            commit(r.name, -1 - r.device, ref.second + 1000.0 * beginMs, 1000.0 * durMs);
+
+        m_freeEvents.push_back(r.beginEvent);
+        m_freeEvents.push_back(r.endEvent);
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + numDone);
+}
+
+#else // NVDR_CPU_ONLY
+
+// Builds without Cuda have no device ranges.
+void* Profiler::acquireEvent(void)                                      { return NULL; }
+void* Profiler::beginDevice(void*)                                      { return NULL; }
+void  Profiler::endDevice(const char*, void*, void*)                    {}
+void  Profiler::pollDevice(bool)                                        {}
+
+#endif // NVDR_CPU_ONLY
+
+//------------------------------------------------------------------------
+
+static double percentileOf(std::vector<float>& v, double q)
+{
+    size_t k = std::min((size_t)(q * (double)(v.size() - 1) + .5), v.size() - 1);
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+std::map<std::string, ProfileStats> Profiler::getStats(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pollDevice(true);
+
+    std::map<std::string, ProfileStats> stats;
+    for (std::map<std::string, Aggregate>::const_iterator it = m_aggregates.begin(); it != m_aggregates.end(); ++it)
+    {
+        const Aggregate& a = it->second;
+        std::vector<float> v = a.reservoir;
+        ProfileStats& s = stats[it->first];
+        s.count   = a.count;
+        s.totalUs = a.totalUs;
+        s.meanUs  = a.totalUs / (double)a.count;
+        s.p50Us   = percentileOf(v, .50);
+        s.p90Us   = percentileOf(v, .90);
+        s.p99Us   = percentileOf(v, .99);
+        s.maxUs   = a.maxUs;
+    }
+    return stats;
+}
+
+bool Profiler::writeChromeTrace(const char* path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pollDevice(true);
+
+    FILE* f = fopen(path, "w");
+    if (!f)
+        return false;
+
+    // Complete events ("X") in microseconds, host threads and devices as separate tracks.
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (std::map<int, std::pair<void*, double> >::const_iterator it = m_deviceRef.begin(); it != m_deviceRef.end(); ++it, first = false)
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"GPU %d\"}}", first ? "" : ",\n", -1 - it->first, it->first);
+    size_t oldest = (m_ringNext + NVDR_PROFILE_RING_SIZE - m_ringCount) % NVDR_PROFILE_RING_SIZE;
+    for (size_t i=0; i < m_ringCount; i++, first = false)
+    {
+        const Record& r = m_ring[(oldest + i) % NVDR_PROFILE_RING_SIZE];
+        fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            first ? "" : ",\n", r.name, r.tid < 0 ? "device" : "host", r.tid, r.beginUs, r.durUs);
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
+
+//------------------------------------------------------------------------
+
+ProfileRange::ProfileRange(const char* name)
+:   m_name      (name),
+    m_open      (Profiler::get().isEnabled()),
+    m_record    (m_open && Profiler::get().enterRange()),
+    m_device    (false),
+    m_beginUs   (m_record ? Profiler::now() : 0.0),
+    m_stream    (NULL),
+    m_token     (NULL)
+{
+    // empty
+}
+
+ProfileRange::ProfileRange(const char* name, void* stream)
+:   m_name      (name),
+    m_open      (Profiler::get().isEnabled()),
+    m_record    (m_open && Profiler::get().enterRange()),
+    m_device    (true),
+    m_beginUs   (0.0),
+    m_stream    (stream),
+    m_token     (m_record ? Profiler::get().beginDevice(stream) : NULL)
+{
+    // empty
+}
+
+void ProfileRange::end(void)
+{
+    if (!m_open)
+        return;
+    if (m_record && !m_device)
+        Profiler::get().recordHost(m_name, m_beginUs, Profiler::now());
+    if (m_token)
+        Profiler::get().endDevice(m_name, m_token, m_stream);
+    Profiler::get().leaveRange();
+    m_open = false;
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,157 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Opt-in timing of named ranges.
+//
+// Host ranges are timed with a monotonic clock. Device ranges bracket the
+// work enqueued on a stream with timing events, which are read back
+// lazily so that recording never waits for the GPU. Sampling is decided
+// at the outermost range of each host thread, so an op call is recorded
+// either with all of its stages or not at all. While disabled, a range
+// costs one relaxed atomic load.
+//
+// Recent ranges are kept in a ring buffer for Chrome trace export, and
+// per-name aggregates keep a bounded reservoir of durations for the
+// percentiles. Range names must be string literals.
+
+#define NVDR_PROFILE_RING_SIZE      (1 << 18)   // Records kept for trace export.
+#define NVDR_PROFILE_RESERVOIR      4096        // Durations kept per name for percentiles.
+#define NVDR_PROFILE_RATE_ONE       (1ull << 32) // Sample rate 1.0 in fixed point.
+
+// Outermost range number index is recorded if floor((index+1)*rate) >
+// floor(index*rate), with rate in units of 1/NVDR_PROFILE_RATE_ONE. This
+// records the given fraction of ranges, evenly spread. Wrapping the index
+// at 2^32 shifts both products by a whole multiple of 2^32, so the result
+// is unchanged and the products can't overflow.
+static inline bool isProfileSampled(unsigned long long index, unsigned long long rate)
+{
+    if (rate >= NVDR_PROFILE_RATE_ONE)
+        return true;
+    unsigned long long n = index & 0xffffffffull;
+    return ((n + 1) * rate >> 32) != ((n * rate) >> 32);
+}
+
+struct ProfileStats
+{
+    long long               count;              // Recorded ranges.
+    double                  totalUs;
+    double                  meanUs;
+    double                  p50Us;              // Percentiles over a sample of up to NVDR_PROFILE_RESERVOIR ranges.
+    double                  p90Us;
+    double                  p99Us;
+    double                  maxUs;
+};
+
+class Profiler
+{
+public:
+    static Profiler&        get                 (void);
+
+    void                    enable              (double sampleRate);    // Fraction of outermost ranges to record, 0 = disabled.
+    bool                    isEnabled           (void) const { return m_enabled.load(std::memory_order_relaxed); }
+    void                    reset               (void);                 // Drop records and aggregates.
+    bool                    writeChromeTrace    (const char* path);     // Waits for pending device ranges. Returns false if the file could not be written.
+    std::map<std::string, ProfileStats> getStats(void);                 // Waits for pending device ranges.
+
+    // Used by ProfileRange.
+
+    bool                    enterRange          (void);                 // Returns true if the range is to be recorded.
+    void                    leaveRange          (void);
+    static double           now                 (void);                 // Host clock in microseconds.
+    void                    recordHost          (const char* name, double beginUs, double endUs);
+    void*                   beginDevice         (void* stream);         // Returns an opaque token, or NULL on failure.
+    void                    endDevice           (const char* name, void* token, void* stream);
+
+private:
+                            Profiler            (void);
+                            ~Profiler           (void);
+                            Profiler            (const Profiler&); // forbidden
+    Profiler&               operator=           (const Profiler&); // forbidden
+
+    struct Record
+    {
+        const char*         name;
+        int                 tid;                // Host thread index, or -1 - device index for device ranges.
+        double              beginUs;
+        double              durUs;
+    };
+
+    struct Aggregate
+    {
+        long long           count;
+        double              totalUs;
+        double              maxUs;
+        std::vector<float>  reservoir;
+    };
+
+    struct DeviceRange
+    {
+        const char*         name;
+        int                 device;
+        void*               beginEvent;
+        void*               endEvent;
+    };
+
+    void                    commit              (const char* name, int tid, double beginUs, double durUs); // Needs m_mutex.
+    void                    pollDevice          (bool wait);    // Needs m_mutex.
+    void*                   acquireEvent        (void);         // Needs m_mutex.
+
+    std::atomic<bool>       m_enabled;
+    std::atomic<unsigned long long> m_counter;  // Outermost ranges seen, for sampling.
+    std::atomic<unsigned long long> m_rate;     // Fraction of outermost ranges to record, see isProfileSampled().
+
+    std::mutex              m_mutex;
+    std::vector<Record>     m_ring;             // Chrome trace records, oldest overwritten.
+    size_t                  m_ringNext;
+    size_t                  m_ringCount;
+    std::map<std::string, Aggregate> m_aggregates;
+    unsigned int            m_random;           // Reservoir sampling state.
+    std::vector<DeviceRange> m_pending;         // In submission order.
+    std::vector<void*>      m_freeEvents;
+    std::map<int, std::pair<void*, double> > m_deviceRef; // Reference event and its host time per device.
+};
+
+//------------------------------------------------------------------------
+// Scoped range. A stream makes it a device range that times the work
+// enqueued on the stream while the range is open.
+
+class ProfileRange
+{
+public:
+                            ProfileRange        (const char* name);
+                            ProfileRange        (const char* name, void* stream);
+                            ~ProfileRange       (void) { end(); }
+    void                    end                 (void);         // Close before going out of scope.
+
+private:
+                            ProfileRange        (const ProfileRange&); // forbidden
+    ProfileRange&           operator=           (const ProfileRange&); // forbidden
+
+    const char*             m_name;
+    bool                    m_open;             // Counted in the nesting depth.
+    bool                    m_record;
+    bool                    m_device;
+    double                  m_beginUs;
+    void*                   m_stream;
+    void*                   m_token;            // Device range in flight.
+};
+
+#define NVDR_PROFILE_CONCAT_(A, B) A##B
+#define NVDR_PROFILE_CONCAT(A, B) NVDR_PROFILE_CONCAT_(A, B)
+#define NVDR_PROFILE_RANGE(NAME) ProfileRange NVDR_PROFILE_CONCAT(_nvdr_profile_range_, __LINE__)(NAME)
+#define NVDR_PROFILE_DEVICE_RANGE(NAME, STREAM) ProfileRange NVDR_PROFILE_CONCAT(_nvdr_profile_range_, __LINE__)(NAME, (void*)(STREAM))
+
+//------------------------------------------------------------------------
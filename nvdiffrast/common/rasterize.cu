@@ -12,7 +12,8 @@
 //------------------------------------------------------------------------
 // Cuda forward rasterizer pixel shader kernel.
 
-__global__ void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams p)
+template <class IndexT>
+static __forceinline__ __device__ void RasterizeCudaFwdShaderKernelTemplate(const RasterizeCudaFwdShaderParams p)
 {
     // Calculate pixel position.
     int px = blockIdx.x * blockDim.x + threadIdx.x;
@@ -30,15 +31,24 @@ __global__ void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams
     if (triIdx < 0 || triIdx >= p.numTriangles)
     {
         // No or corrupt triangle.
+        if (p.out_tri)
+        {
+            store_storage((__half*)p.out + 2 * pidx_out, make_float2(0.f, 0.f)); // Clear out.
+            store_storage((__half*)p.out_db + 4 * pidx_out, make_float4(0.f, 0.f, 0.f, 0.f)); // Clear out_db.
+            p.out_zw[pidx_out] = 0.f;
+            p.out_tri[pidx_out] = 0;
+            return;
+        }
         ((float4*)p.out)[pidx_out] = make_float4(0.0, 0.0, 0.0, 0.0); // Clear out.
         ((float4*)p.out_db)[pidx_out] = make_float4(0.0, 0.0, 0.0, 0.0); // Clear out_db.
         return;
     }
 
     // Fetch vertex indices.
-    int vi0 = p.tri[triIdx * 3 + 0];
-    int vi1 = p.tri[triIdx * 3 + 1];
-    int vi2 = p.tri[triIdx * 3 + 2];
+    const IndexT* tri = (const IndexT*)p.tri;
+    int vi0 = tri[triIdx * 3 + 0];
+    int vi1 = tri[triIdx * 3 + 1];
+    int vi2 = tri[triIdx * 3 + 2];
 
     // Bail out if vertex indices are corrupt.
     if (vi0 < 0 || vi0 >= p.numVertices ||
@@ -46,8 +56,8 @@ __global__ void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams
         vi2 < 0 || vi2 >= p.numVertices)
         return;
 
-    // In instance mode, adjust vertex indices by minibatch index.
-    if (p.instance_mode)
+    // In instance mode, adjust vertex indices by minibatch index unless the images share the vertices.
+    if (p.instance_mode && !p.mtx)
     {
         vi0 += pz * p.numVertices;
         vi1 += pz * p.numVertices;
@@ -59,6 +69,15 @@ __global__ void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams
     float4 p1 = ((float4*)p.pos)[vi1];
     float4 p2 = ((float4*)p.pos)[vi2];
 
+    // Transform shared vertices to clip space.
+    if (p.mtx)
+    {
+        const float* m = p.mtx + 16 * pz;
+        p0 = xfm_pos(m, p0);
+        p1 = xfm_pos(m, p1);
+        p2 = xfm_pos(m, p2);
+    }
+
     // Evaluate edge functions.
     float fx = p.xs * (float)px + p.xo;
     float fy = p.ys * (float)py + p.yo;
@@ -89,8 +108,15 @@ __global__ void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams
     b1 = fminf(fmaxf(b1, 0.0f), 1.0f);
     zw = fmaxf(fminf(zw, 1.f), -1.f);
 
-    // Emit output.
-    ((float4*)p.out)[pidx_out] = make_float4(b0, b1, zw, triidx_to_float(triIdx + 1));
+    // Emit output. The compact layout keeps the triangle index as an integer.
+    if (p.out_tri)
+    {
+        store_storage((__half*)p.out + 2 * pidx_out, make_float2(b0, b1));
+        p.out_zw[pidx_out] = zw;
+        p.out_tri[pidx_out] = triIdx + 1;
+    }
+    else
+        ((float4*)p.out)[pidx_out] = make_float4(b0, b1, zw, triidx_to_float(triIdx + 1));
 
     // Calculate bary pixel differentials.
     float dfxdx = p.xs * iw;
@@ -109,13 +135,20 @@ __global__ void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams
     float dvdy = dfydy * (b1 * datdy - da1dy);
 
     // Emit bary pixel differentials.
-    ((float4*)p.out_db)[pidx_out] = make_float4(dudx, dudy, dvdx, dvdy);
+    if (p.out_tri)
+        store_storage((__half*)p.out_db + 4 * pidx_out, make_float4(dudx, dudy, dvdx, dvdy));
+    else
+        ((float4*)p.out_db)[pidx_out] = make_float4(dudx, dudy, dvdx, dvdy);
 }
 
+// Template specializations.
+__global__ void RasterizeCudaFwdShaderKernel   (const RasterizeCudaFwdShaderParams p) { RasterizeCudaFwdShaderKernelTemplate<int>(p); }
+__global__ void RasterizeCudaFwdShaderKernelU16(const RasterizeCudaFwdShaderParams p) { RasterizeCudaFwdShaderKernelTemplate<unsigned short>(p); }
+
 //------------------------------------------------------------------------
 // Gradient Cuda kernel.
 
-template <bool ENABLE_DB>
+template <class IndexT, bool ENABLE_DB>
 static __forceinline__ __device__ void RasterizeGradKernelTemplate(const RasterizeGradParams p)
 {
     // Temporary space for coalesced atomics.
@@ -132,10 +165,24 @@ static __forceinline__ __device__ void RasterizeGradKernelTemplate(const Rasteri
     // Pixel index.
     int pidx = px + p.width * (py + p.height * pz);
 
-    // Read triangle idx and dy.
-    float2 dy  = ((float2*)p.dy)[pidx * 2];
-    float4 ddb = ENABLE_DB ? ((float4*)p.ddb)[pidx] : make_float4(0.f, 0.f, 0.f, 0.f);
-    int triIdx = float_to_triidx(((float*)p.out)[pidx * 4 + 3]) - 1;
+    // Read triangle idx and dy. Compact output has fp16 gradients and an integer triangle idx.
+    float2 dy;
+    float4 ddb = make_float4(0.f, 0.f, 0.f, 0.f);
+    int triIdx;
+    if (p.out_tri)
+    {
+        load_storage(dy, (const __half*)p.dy + 2 * pidx);
+        if (ENABLE_DB)
+            load_storage(ddb, (const __half*)p.ddb + 4 * pidx);
+        triIdx = p.out_tri[pidx] - 1;
+    }
+    else
+    {
+        dy = ((float2*)p.dy)[pidx * 2];
+        if (ENABLE_DB)
+            ddb = ((float4*)p.ddb)[pidx];
+        triIdx = float_to_triidx(p.out[pidx * 4 + 3]) - 1;
+    }
 
     // Exit if nothing to do.
     if (triIdx < 0 || triIdx >= p.numTriangles)
@@ -148,9 +195,10 @@ static __forceinline__ __device__ void RasterizeGradKernelTemplate(const Rasteri
         return; // All incoming gradients are +0/-0.
 
     // Fetch vertex indices.
-    int vi0 = p.tri[triIdx * 3 + 0];
-    int vi1 = p.tri[triIdx * 3 + 1];
-    int vi2 = p.tri[triIdx * 3 + 2];
+    const IndexT* tri = (const IndexT*)p.tri;
+    int vi0 = tri[triIdx * 3 + 0];
+    int vi1 = tri[triIdx * 3 + 1];
+    int vi2 = tri[triIdx * 3 + 2];
 
     // Bail out if vertex indices are corrupt.
     if (vi0 < 0 || vi0 >= p.numVertices ||
@@ -158,8 +206,8 @@ static __forceinline__ __device__ void RasterizeGradKernelTemplate(const Rasteri
         vi2 < 0 || vi2 >= p.numVertices)
         return;
 
-    // In instance mode, adjust vertex indices by minibatch index.
-    if (p.instance_mode)
+    // In instance mode, adjust vertex indices by minibatch index unless the images share the vertices.
+    if (p.instance_mode && !p.mtx)
     {
         vi0 += pz * p.numVertices;
         vi1 += pz * p.numVertices;
@@ -169,10 +217,18 @@ static __forceinline__ __device__ void RasterizeGradKernelTemplate(const Rasteri
     // Initialize coalesced atomics.
     CA_SET_GROUP(triIdx, RAST_GRAD_MAX_KERNEL_BLOCK_WIDTH);        
 
-    // Fetch vertex positions.
+    // Fetch vertex positions. Shared vertices are transformed to clip space, keeping the originals for the gradients.
     float4 p0 = ((float4*)p.pos)[vi0];
     float4 p1 = ((float4*)p.pos)[vi1];
     float4 p2 = ((float4*)p.pos)[vi2];
+    float4 v0 = p0, v1 = p1, v2 = p2;
+    const float* m = p.mtx ? p.mtx + 16 * pz : 0;
+    if (m)
+    {
+        p0 = xfm_pos(m, v0);
+        p1 = xfm_pos(m, v1);
+        p2 = xfm_pos(m, v2);
+    }
 
     // Evaluate edge functions.
     float fx = p.xs * (float)px + p.xo;
@@ -267,13 +323,33 @@ static __forceinline__ __device__ void RasterizeGradKernelTemplate(const Rasteri
     }
 
     // Accumulate using coalesced atomics.
-    caAtomicAdd3_xyw(p.grad + 4 * vi0, gp0x, gp0y, gp0w);
-    caAtomicAdd3_xyw(p.grad + 4 * vi1, gp1x, gp1y, gp1w);
-    caAtomicAdd3_xyw(p.grad + 4 * vi2, gp2x, gp2y, gp2w);
+    if (!m)
+    {
+        caAtomicAdd3_xyw(p.grad + 4 * vi0, gp0x, gp0y, gp0w);
+        caAtomicAdd3_xyw(p.grad + 4 * vi1, gp1x, gp1y, gp1w);
+        caAtomicAdd3_xyw(p.grad + 4 * vi2, gp2x, gp2y, gp2w);
+        return;
+    }
+
+    // Shared vertices: chain rule through the transform, M^T g for the vertices and g v^T for the matrix.
+    caAtomicAdd4(p.grad + 4 * vi0, xfm_grad_t(m, gp0x, gp0y, gp0w));
+    caAtomicAdd4(p.grad + 4 * vi1, xfm_grad_t(m, gp1x, gp1y, gp1w));
+    caAtomicAdd4(p.grad + 4 * vi2, xfm_grad_t(m, gp2x, gp2y, gp2w));
+
+    // All pixels of the block are in the same image, so the matrix gradients coalesce by image instead of triangle.
+    {
+        CA_SET_GROUP(pz, RAST_GRAD_MAX_KERNEL_BLOCK_WIDTH);
+        float* gm = p.gradMtx + 16 * pz;
+        caAtomicAdd4(gm + 0,  gp0x * v0 + gp1x * v1 + gp2x * v2);
+        caAtomicAdd4(gm + 4,  gp0y * v0 + gp1y * v1 + gp2y * v2);
+        caAtomicAdd4(gm + 12, gp0w * v0 + gp1w * v1 + gp2w * v2);
+    }
 }
 
 // Template specializations.
-__global__ void RasterizeGradKernel  (const RasterizeGradParams p) { RasterizeGradKernelTemplate<false>(p); }
-__global__ void RasterizeGradKernelDb(const RasterizeGradParams p) { RasterizeGradKernelTemplate<true>(p); }
+__global__ void RasterizeGradKernel     (const RasterizeGradParams p) { RasterizeGradKernelTemplate<int, false>(p); }
+__global__ void RasterizeGradKernelDb   (const RasterizeGradParams p) { RasterizeGradKernelTemplate<int, true>(p); }
+__global__ void RasterizeGradKernelU16  (const RasterizeGradParams p) { RasterizeGradKernelTemplate<unsigned short, false>(p); }
+__global__ void RasterizeGradKernelDbU16(const RasterizeGradParams p) { RasterizeGradKernelTemplate<unsigned short, true>(p); }
 
 //------------------------------------------------------------------------
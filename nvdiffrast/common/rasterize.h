@@ -16,16 +16,27 @@
 #define RAST_GRAD_MAX_KERNEL_BLOCK_WIDTH  8
 #define RAST_GRAD_MAX_KERNEL_BLOCK_HEIGHT 8
 
+//------------------------------------------------------------------------
+// Compact output layout. Instead of the float4 main output (u, v, z/w,
+// triidx_to_float(triIdx + 1)), the barycentrics are stored as fp16x2,
+// z/w in an fp32 plane and triIdx + 1 in an int32 plane, i.e., 12 bytes
+// per pixel instead of 16. Bary pixel differentials are fp16x4 and the
+// gradients follow the same layout. The CPU paths use fp32 in place of
+// fp16, the torch wrappers convert.
+
 //------------------------------------------------------------------------
 // CUDA forward rasterizer shader kernel params.
 
 struct RasterizeCudaFwdShaderParams
 {
     const float*    pos;            // Vertex positions.
-    const int*      tri;            // Triangle indices.
+    const float*    mtx;            // Per-image transforms of shared positions, or NULL.
+    const void*     tri;            // Triangle indices, int32 or uint16.
     const int*      in_idx;         // Triangle idx buffer from rasterizer.
-    float*          out;            // Main output buffer.
-    float*          out_db;         // Bary pixel gradient output buffer.
+    void*           out;            // Main output buffer, float4 or compact barycentrics.
+    void*           out_db;         // Bary pixel gradient output buffer, fp16x4 in compact mode.
+    float*          out_zw;         // Depth plane of compact output.
+    int*            out_tri;        // Triangle id plane of compact output, NULL if out is float4.
     int             numTriangles;   // Number of triangles.
     int             numVertices;    // Number of vertices.
     int             width_in;       // Input image width.
@@ -34,6 +45,7 @@ struct RasterizeCudaFwdShaderParams
     int             height_out;     // Output image height.
     int             depth;          // Size of minibatch.
     int             instance_mode;  // 1 if in instance rendering mode.
+    int             tri_u16;        // 1 if triangle indices are uint16. Cuda kernels have specializations instead.
     float           xs, xo, ys, yo; // Pixel position to clip-space x, y transform.
 };
 
@@ -43,18 +55,36 @@ struct RasterizeCudaFwdShaderParams
 struct RasterizeGradParams
 {
     const float*    pos;            // Incoming position buffer.
-    const int*      tri;            // Incoming triangle buffer.
-    const float*    out;            // Rasterizer output buffer.
-    const float*    dy;             // Incoming gradients of rasterizer output buffer.
-    const float*    ddb;            // Incoming gradients of bary diff output buffer.
+    const float*    mtx;            // Per-image transforms of shared positions, or NULL.
+    const void*     tri;            // Incoming triangle buffer, int32 or uint16 indices.
+    const float*    out;            // Rasterizer output buffer, NULL in compact mode.
+    const int*      out_tri;        // Triangle id plane of compact output, NULL if out is float4.
+    const void*     dy;             // Incoming gradients of rasterizer output buffer, in the same layout.
+    const void*     ddb;            // Incoming gradients of bary diff output buffer, in the same layout.
     float*          grad;           // Outgoing position gradients.
+    float*          gradMtx;        // Outgoing transform gradients if mtx is set.
     int             numTriangles;   // Number of triangles.
     int             numVertices;    // Number of vertices.
     int             width;          // Image width.
     int             height;         // Image height.
     int             depth;          // Size of minibatch.
     int             instance_mode;  // 1 if in instance rendering mode.
+    int             tri_u16;        // 1 if triangle indices are uint16. Cuda kernels have specializations instead.
     float           xs, xo, ys, yo; // Pixel position to clip-space x, y transform.
 };
 
 //------------------------------------------------------------------------
+// CPU forward rasterizer shader. Takes the same params as the CUDA kernel,
+// with all pointers in host memory. Rows are distributed over the pool.
+
+class ThreadPool;
+void RasterizeCpuFwdShader(const RasterizeCudaFwdShaderParams& p, ThreadPool& pool);
+
+//------------------------------------------------------------------------
+// CPU gradient. Takes the same params as the CUDA gradient kernels, with
+// ddb set to NULL when bary differential gradients are disabled. The grad
+// and gradMtx buffers must be zeroed.
+
+void RasterizeCpuGrad(const RasterizeGradParams& p, ThreadPool& pool);
+
+//------------------------------------------------------------------------
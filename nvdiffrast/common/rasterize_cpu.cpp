@@ -0,0 +1,656 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "common.h"
+#include "rasterize.h"
+#include "threadpool.h"
+#include "cpuisa.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+//------------------------------------------------------------------------
+// CPU forward rasterizer pixel shader. Same math as RasterizeCudaFwdShaderKernel.
+// The device compiler contracts multiply-adds into fma instructions, so they
+// are spelled out here with fmaf() to reproduce the GPU results exactly.
+
+static void RasterizeCpuFwdShaderRow(const RasterizeCudaFwdShaderParams& p, int py, int pz)
+{
+    for (int px=0; px < p.width_out; px++)
+    {
+        // Pixel indices.
+        int pidx_in  = px + p.width_in  * (py + p.height_in  * pz);
+        int pidx_out = px + p.width_out * (py + p.height_out * pz);
+        int outStride = p.out_tri ? 2 : 4; // Compact output has only the barycentrics here.
+        float* out    = (float*)p.out    + pidx_out * outStride;
+        float* out_db = (float*)p.out_db + pidx_out * 4;
+
+        // Fetch triangle idx.
+        int triIdx = p.in_idx[pidx_in] - 1;
+        if (triIdx < 0 || triIdx >= p.numTriangles)
+        {
+            // No or corrupt triangle.
+            std::fill(out, out + outStride, 0.f); // Clear out.
+            out_db[0] = out_db[1] = out_db[2] = out_db[3] = 0.f; // Clear out_db.
+            if (p.out_tri)
+            {
+                p.out_zw[pidx_out] = 0.f;
+                p.out_tri[pidx_out] = 0;
+            }
+            continue;
+        }
+
+        // Fetch vertex indices.
+        int vi0 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 0);
+        int vi1 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 1);
+        int vi2 = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 2);
+
+        // Bail out if vertex indices are corrupt.
+        if (vi0 < 0 || vi0 >= p.numVertices ||
+            vi1 < 0 || vi1 >= p.numVertices ||
+            vi2 < 0 || vi2 >= p.numVertices)
+            continue;
+
+        // In instance mode, adjust vertex indices by minibatch index unless the images share the vertices.
+        if (p.instance_mode && !p.mtx)
+        {
+            vi0 += pz * p.numVertices;
+            vi1 += pz * p.numVertices;
+            vi2 += pz * p.numVertices;
+        }
+
+        // Fetch vertex positions, transforming shared vertices to clip space.
+        const float* p0 = p.pos + vi0 * 4;
+        const float* p1 = p.pos + vi1 * 4;
+        const float* p2 = p.pos + vi2 * 4;
+        float t0[4], t1[4], t2[4];
+        if (p.mtx)
+        {
+            const float* m = p.mtx + 16 * pz;
+            xfm_pos_host(m, p0, t0);
+            xfm_pos_host(m, p1, t1);
+            xfm_pos_host(m, p2, t2);
+            p0 = t0, p1 = t1, p2 = t2;
+        }
+
+        // Evaluate edge functions.
+        float fx = fmaf(p.xs, (float)px, p.xo);
+        float fy = fmaf(p.ys, (float)py, p.yo);
+        float p0x = fmaf(-fx, p0[3], p0[0]);
+        float p0y = fmaf(-fy, p0[3], p0[1]);
+        float p1x = fmaf(-fx, p1[3], p1[0]);
+        float p1y = fmaf(-fy, p1[3], p1[1]);
+        float p2x = fmaf(-fx, p2[3], p2[0]);
+        float p2y = fmaf(-fy, p2[3], p2[1]);
+        float a0 = fmaf(p1x, p2y, -(p1y*p2x));
+        float a1 = fmaf(p2x, p0y, -(p2y*p0x));
+        float a2 = fmaf(p0x, p1y, -(p0y*p1x));
+
+        // Perspective correct, normalized barycentrics.
+        float iw = 1.f / (a0 + a1 + a2);
+        float b0 = a0 * iw;
+        float b1 = a1 * iw;
+
+        // Compute z/w for depth buffer.
+        float z = fmaf(p2[2], a2, fmaf(p0[2], a0, p1[2] * a1));
+        float w = fmaf(p2[3], a2, fmaf(p0[3], a0, p1[3] * a1));
+        float zw = z / w;
+
+        // Clamps to avoid NaNs.
+        b0 = fminf(fmaxf(b0, 0.0f), 1.0f);
+        b1 = fminf(fmaxf(b1, 0.0f), 1.0f);
+        zw = fmaxf(fminf(zw, 1.f), -1.f);
+
+        // Emit output.
+        out[0] = b0;
+        out[1] = b1;
+        if (p.out_tri)
+        {
+            p.out_zw[pidx_out] = zw;
+            p.out_tri[pidx_out] = triIdx + 1;
+        }
+        else
+        {
+            out[2] = zw;
+            out[3] = triidx_to_float_host(triIdx + 1);
+        }
+
+        // Calculate bary pixel differentials.
+        float dfxdx = p.xs * iw;
+        float dfydy = p.ys * iw;
+        float da0dx = fmaf(p2[1], p1[3], -(p1[1]*p2[3]));
+        float da0dy = fmaf(p1[0], p2[3], -(p2[0]*p1[3]));
+        float da1dx = fmaf(p0[1], p2[3], -(p2[1]*p0[3]));
+        float da1dy = fmaf(p2[0], p0[3], -(p0[0]*p2[3]));
+        float da2dx = fmaf(p1[1], p0[3], -(p0[1]*p1[3]));
+        float da2dy = fmaf(p0[0], p1[3], -(p1[0]*p0[3]));
+        float datdx = da0dx + da1dx + da2dx;
+        float datdy = da0dy + da1dy + da2dy;
+        float dudx = dfxdx * fmaf(b0, datdx, -da0dx);
+        float dudy = dfydy * fmaf(b0, datdy, -da0dy);
+        float dvdx = dfxdx * fmaf(b1, datdx, -da1dx);
+        float dvdy = dfydy * fmaf(b1, datdy, -da1dy);
+
+        // Emit bary pixel differentials.
+        out_db[0] = dudx;
+        out_db[1] = dudy;
+        out_db[2] = dvdx;
+        out_db[3] = dvdy;
+    }
+}
+
+void RasterizeCpuFwdShader(const RasterizeCudaFwdShaderParams& p, ThreadPool& pool)
+{
+    int height = p.height_out;
+    pool.parallelFor(0, height * p.depth, 16, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+            RasterizeCpuFwdShaderRow(p, i % height, i / height);
+    });
+}
+
+//------------------------------------------------------------------------
+// CPU gradient. Same math as RasterizeGradKernelTemplate, evaluated for
+// eight pixels of a row at a time in SIMD lanes when AVX2 is available.
+// Multiply-adds are not fused, so the scalar and SIMD paths agree bit for
+// bit. Position gradients go to private per-worker buffers of touched
+// vertex blocks that are reduced at the end. With shared vertices, the
+// clip-space gradients are taken through the transform of the image as
+// they are accumulated.
+
+#define RAST_CPU_GRAD_BLOCK_VERTICES 256
+#define RAST_CPU_GRAD_LANES          8
+
+struct RasterizeCpuGradAccum
+{
+    std::vector<int>    blockOfs;   // Offset of each vertex block in data, or -1 if not touched.
+    std::vector<float>  data;       // Gradient storage for the touched blocks, four floats per vertex.
+    std::vector<float>  mtxData;    // Transform gradients, 16 floats per image. Only with shared vertices.
+    const float*        pos;        // Shared vertex positions.
+    const float*        mtx;        // Transform of the current image, or NULL if vertices are not shared.
+    float*              gradMtx;    // Transform gradient of the current image.
+
+    void setImage(const RasterizeGradParams& p, int pz)
+    {
+        pos     = p.pos;
+        mtx     = p.mtx ? p.mtx + 16 * pz : NULL;
+        gradMtx = p.mtx ? &mtxData[16 * pz] : NULL;
+    }
+
+    void touch(int vi)
+    {
+        int b = vi / RAST_CPU_GRAD_BLOCK_VERTICES;
+        if (blockOfs[b] < 0)
+        {
+            blockOfs[b] = (int)data.size();
+            data.resize(data.size() + RAST_CPU_GRAD_BLOCK_VERTICES * 4, 0.f);
+        }
+    }
+
+    void add(int vi, float gx, float gy, float gw)
+    {
+        touch(vi);
+        float* g = &data[blockOfs[vi / RAST_CPU_GRAD_BLOCK_VERTICES] + (vi % RAST_CPU_GRAD_BLOCK_VERTICES) * 4];
+        if (!mtx)
+        {
+            g[0] += gx;
+            g[1] += gy;
+            g[3] += gw;
+            return;
+        }
+
+        // Shared vertices: M^T g for the vertex and g v^T for the matrix.
+        float gv[4];
+        xfm_grad_t_host(mtx, gx, gy, gw, gv);
+        const float* v = pos + 4 * vi;
+        for (int i=0; i < 4; i++)
+        {
+            g[i] += gv[i];
+            gradMtx[i +  0] += gx * v[i];
+            gradMtx[i +  4] += gy * v[i];
+            gradMtx[i + 12] += gw * v[i];
+        }
+    }
+};
+
+// Clip-space position of a vertex, transformed if the vertices are shared.
+static inline void RasterizeCpuGradFetch(const RasterizeGradParams& p, int vi, int pz, float* out)
+{
+    if (p.mtx)
+        xfm_pos_host(p.mtx + 16 * pz, p.pos + 4 * vi, out);
+    else
+        memcpy(out, p.pos + 4 * vi, 4 * sizeof(float));
+}
+
+// Incoming bary gradients of a pixel. The compact layout has only (u, v).
+static inline const float* RasterizeCpuGradDy(const RasterizeGradParams& p, int pidx)
+{
+    return (const float*)p.dy + pidx * (p.out_tri ? 2 : 4);
+}
+
+// Pixel setup shared by both paths. Returns false if the pixel has nothing to contribute.
+template <bool ENABLE_DB>
+static inline bool RasterizeCpuGradSetup(const RasterizeGradParams& p, int px, int py, int pz, int* vi)
+{
+    int pidx = px + p.width * (py + p.height * pz);
+
+    // Exit if nothing to do.
+    int triIdx = (p.out_tri ? p.out_tri[pidx] : float_to_triidx_host(p.out[pidx * 4 + 3])) - 1;
+    if (triIdx < 0 || triIdx >= p.numTriangles)
+        return false; // No or corrupt triangle.
+    const int* dy = (const int*)RasterizeCpuGradDy(p, pidx);
+    int grad_all_dy = dy[0] | dy[1]; // Bitwise OR of all incoming gradients.
+    int grad_all_ddb = 0;
+    if (ENABLE_DB)
+    {
+        const int* ddb = (const int*)p.ddb + pidx * 4;
+        grad_all_ddb = ddb[0] | ddb[1] | ddb[2] | ddb[3];
+    }
+    if (((grad_all_dy | grad_all_ddb) << 1) == 0)
+        return false; // All incoming gradients are +0/-0.
+
+    // Fetch vertex indices.
+    vi[0] = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 0);
+    vi[1] = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 1);
+    vi[2] = tri_index_host(p.tri, p.tri_u16, triIdx * 3 + 2);
+
+    // Bail out if vertex indices are corrupt.
+    if (vi[0] < 0 || vi[0] >= p.numVertices ||
+        vi[1] < 0 || vi[1] >= p.numVertices ||
+        vi[2] < 0 || vi[2] >= p.numVertices)
+        return false;
+
+    // In instance mode, adjust vertex indices by minibatch index unless the images share the vertices.
+    if (p.instance_mode && !p.mtx)
+    {
+        vi[0] += pz * p.numVertices;
+        vi[1] += pz * p.numVertices;
+        vi[2] += pz * p.numVertices;
+    }
+    return true;
+}
+
+template <bool ENABLE_DB>
+static void RasterizeCpuGradRow_scalar(const RasterizeGradParams& p, int py, int pz, RasterizeCpuGradAccum& acc)
+{
+    acc.setImage(p, pz);
+    for (int px=0; px < p.width; px++)
+    {
+        int vi[3];
+        if (!RasterizeCpuGradSetup<ENABLE_DB>(p, px, py, pz, vi))
+            continue;
+
+        // Read dy and ddb.
+        int pidx = px + p.width * (py + p.height * pz);
+        const float* dy = RasterizeCpuGradDy(p, pidx);
+        float dyx = dy[0];
+        float dyy = dy[1];
+        float ddb[4] = {0.f, 0.f, 0.f, 0.f};
+        int grad_all_ddb = 0;
+        if (ENABLE_DB)
+        {
+            const int* ddbi = (const int*)p.ddb + pidx * 4;
+            grad_all_ddb = ddbi[0] | ddbi[1] | ddbi[2] | ddbi[3];
+            memcpy(ddb, ddbi, sizeof(ddb));
+        }
+
+        // Fetch vertex positions.
+        float p0[4], p1[4], p2[4];
+        RasterizeCpuGradFetch(p, vi[0], pz, p0);
+        RasterizeCpuGradFetch(p, vi[1], pz, p1);
+        RasterizeCpuGradFetch(p, vi[2], pz, p2);
+
+        // Evaluate edge functions.
+        float fx = p.xs * (float)px + p.xo;
+        float fy = p.ys * (float)py + p.yo;
+        float p0x = p0[0] - fx * p0[3];
+        float p0y = p0[1] - fy * p0[3];
+        float p1x = p1[0] - fx * p1[3];
+        float p1y = p1[1] - fy * p1[3];
+        float p2x = p2[0] - fx * p2[3];
+        float p2y = p2[1] - fy * p2[3];
+        float a0 = p1x*p2y - p1y*p2x;
+        float a1 = p2x*p0y - p2y*p0x;
+        float a2 = p0x*p1y - p0y*p1x;
+
+        // Compute inverse area with epsilon.
+        float at = a0 + a1 + a2;
+        float ep = copysignf(1e-6f, at); // ~1 pixel in 1k x 1k image.
+        float iw = 1.f / (at + ep);
+
+        // Perspective correct, normalized barycentrics.
+        float b0 = a0 * iw;
+        float b1 = a1 * iw;
+
+        // Position gradients.
+        float gb0  = dyx * iw;
+        float gb1  = dyy * iw;
+        float gbb  = gb0 * b0 + gb1 * b1;
+        float gp0x = gbb * (p2y - p1y) - gb1 * p2y;
+        float gp1x = gbb * (p0y - p2y) + gb0 * p2y;
+        float gp2x = gbb * (p1y - p0y) - gb0 * p1y + gb1 * p0y;
+        float gp0y = gbb * (p1x - p2x) + gb1 * p2x;
+        float gp1y = gbb * (p2x - p0x) - gb0 * p2x;
+        float gp2y = gbb * (p0x - p1x) + gb0 * p1x - gb1 * p0x;
+        float gp0w = -fx * gp0x - fy * gp0y;
+        float gp1w = -fx * gp1x - fy * gp1y;
+        float gp2w = -fx * gp2x - fy * gp2y;
+
+        // Bary differential gradients.
+        if (ENABLE_DB && (grad_all_ddb << 1) != 0)
+        {
+            float dfxdX = p.xs * iw;
+            float dfydY = p.ys * iw;
+            ddb[0] *= dfxdX;
+            ddb[1] *= dfydY;
+            ddb[2] *= dfxdX;
+            ddb[3] *= dfydY;
+
+            float da0dX = p1[1] * p2[3] - p2[1] * p1[3];
+            float da1dX = p2[1] * p0[3] - p0[1] * p2[3];
+            float da2dX = p0[1] * p1[3] - p1[1] * p0[3];
+            float da0dY = p2[0] * p1[3] - p1[0] * p2[3];
+            float da1dY = p0[0] * p2[3] - p2[0] * p0[3];
+            float da2dY = p1[0] * p0[3] - p0[0] * p1[3];
+            float datdX = da0dX + da1dX + da2dX;
+            float datdY = da0dY + da1dY + da2dY;
+
+            float x01 = p0[0] - p1[0];
+            float x12 = p1[0] - p2[0];
+            float x20 = p2[0] - p0[0];
+            float y01 = p0[1] - p1[1];
+            float y12 = p1[1] - p2[1];
+            float y20 = p2[1] - p0[1];
+            float w01 = p0[3] - p1[3];
+            float w12 = p1[3] - p2[3];
+            float w20 = p2[3] - p0[3];
+
+            float a0p1 = fy * p2[0] - fx * p2[1];
+            float a0p2 = fx * p1[1] - fy * p1[0];
+            float a1p0 = fx * p2[1] - fy * p2[0];
+            float a1p2 = fy * p0[0] - fx * p0[1];
+
+            float wdudX = 2.f * b0 * datdX - da0dX;
+            float wdudY = 2.f * b0 * datdY - da0dY;
+            float wdvdX = 2.f * b1 * datdX - da1dX;
+            float wdvdY = 2.f * b1 * datdY - da1dY;
+
+            float c0  = iw * (ddb[0] * wdudX + ddb[1] * wdudY + ddb[2] * wdvdX + ddb[3] * wdvdY);
+            float cx  = c0 * fx - ddb[0] * b0 - ddb[2] * b1;
+            float cy  = c0 * fy - ddb[1] * b0 - ddb[3] * b1;
+            float cxy = iw * (ddb[0] * datdX + ddb[1] * datdY);
+            float czw = iw * (ddb[2] * datdX + ddb[3] * datdY);
+
+            gp0x += c0 * y12 - cy * w12              + czw * p2y                                                + ddb[3] * p2[3];
+            gp1x += c0 * y20 - cy * w20 - cxy * p2y                               - ddb[1] * p2[3];
+            gp2x += c0 * y01 - cy * w01 + cxy * p1y  - czw * p0y                  + ddb[1] * p1[3]                - ddb[3] * p0[3];
+            gp0y += cx * w12 - c0 * x12              - czw * p2x                                 - ddb[2] * p2[3];
+            gp1y += cx * w20 - c0 * x20 + cxy * p2x               + ddb[0] * p2[3];
+            gp2y += cx * w01 - c0 * x01 - cxy * p1x  + czw * p0x  - ddb[0] * p1[3]                + ddb[2] * p0[3];
+            gp0w += cy * x12 - cx * y12              - czw * a1p0                                + ddb[2] * p2[1] - ddb[3] * p2[0];
+            gp1w += cy * x20 - cx * y20 - cxy * a0p1              - ddb[0] * p2[1] + ddb[1] * p2[0];
+            gp2w += cy * x01 - cx * y01 - cxy * a0p2 - czw * a1p2 + ddb[0] * p1[1] - ddb[1] * p1[0] - ddb[2] * p0[1] + ddb[3] * p0[0];
+        }
+
+        // Accumulate.
+        acc.add(vi[0], gp0x, gp0y, gp0w);
+        acc.add(vi[1], gp1x, gp1y, gp1w);
+        acc.add(vi[2], gp2x, gp2y, gp2w);
+    }
+}
+
+#if NVDR_CPU_X86
+NVDR_CPU_AVX2 static inline __m256 add8(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+NVDR_CPU_AVX2 static inline __m256 sub8(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+NVDR_CPU_AVX2 static inline __m256 mul8(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+NVDR_CPU_AVX2 static inline __m256 neg8(__m256 a)           { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+
+template <bool ENABLE_DB>
+NVDR_CPU_AVX2 static void RasterizeCpuGradRow_avx2(const RasterizeGradParams& p, int py, int pz, RasterizeCpuGradAccum& acc)
+{
+    const int L = RAST_CPU_GRAD_LANES;
+    alignas(32) float in[16][L]; // Vertex positions xyw, pixel x, dy and ddb per lane.
+    alignas(32) float res[9][L];
+    int vi[L][3];
+
+    acc.setImage(p, pz);
+    float fy_s = p.ys * (float)py + p.yo;
+    __m256 fy = _mm256_set1_ps(fy_s);
+    for (int px0=0; px0 < p.width; px0 += L)
+    {
+        // Gather the active pixels into lanes.
+        int lanes = 0;
+        for (int j=0; j < L && px0 + j < p.width; j++)
+        {
+            int px = px0 + j;
+            if (!RasterizeCpuGradSetup<ENABLE_DB>(p, px, py, pz, vi[lanes]))
+                continue;
+            int pidx = px + p.width * (py + p.height * pz);
+            for (int k=0; k < 3; k++)
+            {
+                float pv[4];
+                RasterizeCpuGradFetch(p, vi[lanes][k], pz, pv);
+                in[3*k+0][lanes] = pv[0];
+                in[3*k+1][lanes] = pv[1];
+                in[3*k+2][lanes] = pv[3];
+            }
+            in[9][lanes]  = p.xs * (float)px + p.xo;
+            const float* dy = RasterizeCpuGradDy(p, pidx);
+            in[10][lanes] = dy[0];
+            in[11][lanes] = dy[1];
+            for (int k=0; k < 4; k++)
+                in[12 + k][lanes] = ENABLE_DB ? ((const float*)p.ddb)[pidx * 4 + k] : 0.f;
+            lanes++;
+        }
+        if (!lanes)
+            continue;
+
+        // Unused lanes get a harmless degenerate triangle with no incoming gradients.
+        for (int j = lanes; j < L; j++)
+            for (int k=0; k < 16; k++)
+                in[k][j] = (k == 2 || k == 5 || k == 8) ? 1.f : 0.f;
+
+        __m256 p0x_ = _mm256_load_ps(in[0]), p0y_ = _mm256_load_ps(in[1]), p0w_ = _mm256_load_ps(in[2]);
+        __m256 p1x_ = _mm256_load_ps(in[3]), p1y_ = _mm256_load_ps(in[4]), p1w_ = _mm256_load_ps(in[5]);
+        __m256 p2x_ = _mm256_load_ps(in[6]), p2y_ = _mm256_load_ps(in[7]), p2w_ = _mm256_load_ps(in[8]);
+        __m256 fx   = _mm256_load_ps(in[9]);
+        __m256 dyx  = _mm256_load_ps(in[10]);
+        __m256 dyy  = _mm256_load_ps(in[11]);
+
+        // Evaluate edge functions.
+        __m256 p0x = sub8(p0x_, mul8(fx, p0w_));
+        __m256 p0y = sub8(p0y_, mul8(fy, p0w_));
+        __m256 p1x = sub8(p1x_, mul8(fx, p1w_));
+        __m256 p1y = sub8(p1y_, mul8(fy, p1w_));
+        __m256 p2x = sub8(p2x_, mul8(fx, p2w_));
+        __m256 p2y = sub8(p2y_, mul8(fy, p2w_));
+        __m256 a0 = sub8(mul8(p1x, p2y), mul8(p1y, p2x));
+        __m256 a1 = sub8(mul8(p2x, p0y), mul8(p2y, p0x));
+        __m256 a2 = sub8(mul8(p0x, p1y), mul8(p0y, p1x));
+
+        // Compute inverse area with epsilon.
+        __m256 at = add8(add8(a0, a1), a2);
+        __m256 ep = _mm256_or_ps(_mm256_and_ps(at, _mm256_set1_ps(-0.f)), _mm256_set1_ps(1e-6f));
+        __m256 iw = _mm256_div_ps(_mm256_set1_ps(1.f), add8(at, ep));
+
+        // Perspective correct, normalized barycentrics.
+        __m256 b0 = mul8(a0, iw);
+        __m256 b1 = mul8(a1, iw);
+
+        // Position gradients.
+        __m256 gb0  = mul8(dyx, iw);
+        __m256 gb1  = mul8(dyy, iw);
+        __m256 gbb  = add8(mul8(gb0, b0), mul8(gb1, b1));
+        __m256 gp0x = sub8(mul8(gbb, sub8(p2y, p1y)), mul8(gb1, p2y));
+        __m256 gp1x = add8(mul8(gbb, sub8(p0y, p2y)), mul8(gb0, p2y));
+        __m256 gp2x = add8(sub8(mul8(gbb, sub8(p1y, p0y)), mul8(gb0, p1y)), mul8(gb1, p0y));
+        __m256 gp0y = add8(mul8(gbb, sub8(p1x, p2x)), mul8(gb1, p2x));
+        __m256 gp1y = sub8(mul8(gbb, sub8(p2x, p0x)), mul8(gb0, p2x));
+        __m256 gp2y = sub8(add8(mul8(gbb, sub8(p0x, p1x)), mul8(gb0, p1x)), mul8(gb1, p0x));
+        __m256 gp0w = sub8(mul8(neg8(fx), gp0x), mul8(fy, gp0y));
+        __m256 gp1w = sub8(mul8(neg8(fx), gp1x), mul8(fy, gp1y));
+        __m256 gp2w = sub8(mul8(neg8(fx), gp2x), mul8(fy, gp2y));
+
+        // Bary differential gradients, only in lanes with nonzero ddb.
+        if (ENABLE_DB)
+        {
+            __m256 ddbx = _mm256_load_ps(in[12]);
+            __m256 ddby = _mm256_load_ps(in[13]);
+            __m256 ddbz = _mm256_load_ps(in[14]);
+            __m256 ddbw = _mm256_load_ps(in[15]);
+            __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+            __m256 any = _mm256_and_ps(_mm256_or_ps(_mm256_or_ps(ddbx, ddby), _mm256_or_ps(ddbz, ddbw)), absMask);
+            __m256 mask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_castps_si256(any), _mm256_setzero_si256()));
+            if (!_mm256_testz_ps(mask, mask))
+            {
+                __m256 dfxdX = mul8(_mm256_set1_ps(p.xs), iw);
+                __m256 dfydY = mul8(_mm256_set1_ps(p.ys), iw);
+                ddbx = mul8(ddbx, dfxdX);
+                ddby = mul8(ddby, dfydY);
+                ddbz = mul8(ddbz, dfxdX);
+                ddbw = mul8(ddbw, dfydY);
+
+                __m256 da0dX = sub8(mul8(p1y_, p2w_), mul8(p2y_, p1w_));
+                __m256 da1dX = sub8(mul8(p2y_, p0w_), mul8(p0y_, p2w_));
+                __m256 da2dX = sub8(mul8(p0y_, p1w_), mul8(p1y_, p0w_));
+                __m256 da0dY = sub8(mul8(p2x_, p1w_), mul8(p1x_, p2w_));
+                __m256 da1dY = sub8(mul8(p0x_, p2w_), mul8(p2x_, p0w_));
+                __m256 da2dY = sub8(mul8(p1x_, p0w_), mul8(p0x_, p1w_));
+                __m256 datdX = add8(add8(da0dX, da1dX), da2dX);
+                __m256 datdY = add8(add8(da0dY, da1dY), da2dY);
+
+                __m256 x01 = sub8(p0x_, p1x_);
+                __m256 x12 = sub8(p1x_, p2x_);
+                __m256 x20 = sub8(p2x_, p0x_);
+                __m256 y01 = sub8(p0y_, p1y_);
+                __m256 y12 = sub8(p1y_, p2y_);
+                __m256 y20 = sub8(p2y_, p0y_);
+                __m256 w01 = sub8(p0w_, p1w_);
+                __m256 w12 = sub8(p1w_, p2w_);
+                __m256 w20 = sub8(p2w_, p0w_);
+
+                __m256 a0p1 = sub8(mul8(fy, p2x_), mul8(fx, p2y_));
+                __m256 a0p2 = sub8(mul8(fx, p1y_), mul8(fy, p1x_));
+                __m256 a1p0 = sub8(mul8(fx, p2y_), mul8(fy, p2x_));
+                __m256 a1p2 = sub8(mul8(fy, p0x_), mul8(fx, p0y_));
+
+                __m256 two = _mm256_set1_ps(2.f);
+                __m256 wdudX = sub8(mul8(mul8(two, b0), datdX), da0dX);
+                __m256 wdudY = sub8(mul8(mul8(two, b0), datdY), da0dY);
+                __m256 wdvdX = sub8(mul8(mul8(two, b1), datdX), da1dX);
+                __m256 wdvdY = sub8(mul8(mul8(two, b1), datdY), da1dY);
+
+                __m256 c0  = mul8(iw, add8(add8(add8(mul8(ddbx, wdudX), mul8(ddby, wdudY)), mul8(ddbz, wdvdX)), mul8(ddbw, wdvdY)));
+                __m256 cx  = sub8(sub8(mul8(c0, fx), mul8(ddbx, b0)), mul8(ddbz, b1));
+                __m256 cy  = sub8(sub8(mul8(c0, fy), mul8(ddby, b0)), mul8(ddbw, b1));
+                __m256 cxy = mul8(iw, add8(mul8(ddbx, datdX), mul8(ddby, datdY)));
+                __m256 czw = mul8(iw, add8(mul8(ddbz, datdX), mul8(ddbw, datdY)));
+
+                __m256 e0x = add8(add8(sub8(mul8(c0, y12), mul8(cy, w12)), mul8(czw, p2y)), mul8(ddbw, p2w_));
+                __m256 e1x = sub8(sub8(sub8(mul8(c0, y20), mul8(cy, w20)), mul8(cxy, p2y)), mul8(ddby, p2w_));
+                __m256 e2x = sub8(add8(sub8(add8(sub8(mul8(c0, y01), mul8(cy, w01)), mul8(cxy, p1y)), mul8(czw, p0y)), mul8(ddby, p1w_)), mul8(ddbw, p0w_));
+                __m256 e0y = sub8(sub8(sub8(mul8(cx, w12), mul8(c0, x12)), mul8(czw, p2x)), mul8(ddbz, p2w_));
+                __m256 e1y = add8(add8(sub8(mul8(cx, w20), mul8(c0, x20)), mul8(cxy, p2x)), mul8(ddbx, p2w_));
+                __m256 e2y = add8(sub8(add8(sub8(sub8(mul8(cx, w01), mul8(c0, x01)), mul8(cxy, p1x)), mul8(czw, p0x)), mul8(ddbx, p1w_)), mul8(ddbz, p0w_));
+                __m256 e0w = sub8(add8(sub8(sub8(mul8(cy, x12), mul8(cx, y12)), mul8(czw, a1p0)), mul8(ddbz, p2y_)), mul8(ddbw, p2x_));
+                __m256 e1w = add8(sub8(sub8(sub8(mul8(cy, x20), mul8(cx, y20)), mul8(cxy, a0p1)), mul8(ddbx, p2y_)), mul8(ddby, p2x_));
+                __m256 e2w = add8(sub8(sub8(add8(sub8(sub8(sub8(mul8(cy, x01), mul8(cx, y01)), mul8(cxy, a0p2)), mul8(czw, a1p2)), mul8(ddbx, p1y_)), mul8(ddby, p1x_)), mul8(ddbz, p0y_)), mul8(ddbw, p0x_));
+
+                gp0x = _mm256_blendv_ps(gp0x, add8(gp0x, e0x), mask);
+                gp1x = _mm256_blendv_ps(gp1x, add8(gp1x, e1x), mask);
+                gp2x = _mm256_blendv_ps(gp2x, add8(gp2x, e2x), mask);
+                gp0y = _mm256_blendv_ps(gp0y, add8(gp0y, e0y), mask);
+                gp1y = _mm256_blendv_ps(gp1y, add8(gp1y, e1y), mask);
+                gp2y = _mm256_blendv_ps(gp2y, add8(gp2y, e2y), mask);
+                gp0w = _mm256_blendv_ps(gp0w, add8(gp0w, e0w), mask);
+                gp1w = _mm256_blendv_ps(gp1w, add8(gp1w, e1w), mask);
+                gp2w = _mm256_blendv_ps(gp2w, add8(gp2w, e2w), mask);
+            }
+        }
+
+        // Scatter the active lanes.
+        _mm256_store_ps(res[0], gp0x); _mm256_store_ps(res[1], gp0y); _mm256_store_ps(res[2], gp0w);
+        _mm256_store_ps(res[3], gp1x); _mm256_store_ps(res[4], gp1y); _mm256_store_ps(res[5], gp1w);
+        _mm256_store_ps(res[6], gp2x); _mm256_store_ps(res[7], gp2y); _mm256_store_ps(res[8], gp2w);
+        for (int j=0; j < lanes; j++)
+            for (int k=0; k < 3; k++)
+                acc.add(vi[j][k], res[3*k+0][j], res[3*k+1][j], res[3*k+2][j]);
+    }
+}
+#endif
+
+void RasterizeCpuGrad(const RasterizeGradParams& p, ThreadPool& pool)
+{
+    // Select row function.
+    bool enableDb = (p.ddb != NULL);
+    void (*rowFunc)(const RasterizeGradParams&, int, int, RasterizeCpuGradAccum&) = enableDb ? RasterizeCpuGradRow_scalar<true> : RasterizeCpuGradRow_scalar<false>;
+#if NVDR_CPU_X86
+    if (getCpuIsa() >= CpuIsa_AVX2)
+        rowFunc = enableDb ? RasterizeCpuGradRow_avx2<true> : RasterizeCpuGradRow_avx2<false>;
+#endif
+
+    // Size of the position gradient buffer in vertices.
+    int numGradVertices = (p.instance_mode && !p.mtx) ? p.numVertices * p.depth : p.numVertices;
+    int numBlocks       = (numGradVertices + RAST_CPU_GRAD_BLOCK_VERTICES - 1) / RAST_CPU_GRAD_BLOCK_VERTICES;
+    int blockFloats     = RAST_CPU_GRAD_BLOCK_VERTICES * 4;
+
+    // Private accumulators, one per worker.
+    int numThreads = pool.getNumThreads();
+    std::vector<RasterizeCpuGradAccum> accums(numThreads);
+    for (int i=0; i < numThreads; i++)
+    {
+        accums[i].blockOfs.assign(numBlocks, -1);
+        accums[i].mtxData.assign(p.mtx ? 16 * p.depth : 0, 0.f);
+    }
+
+    // Process rows.
+    int rows  = p.height * p.depth;
+    int grain = std::max(1, rows / (numThreads * 4));
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int threadIdx)
+    {
+        for (int i = begin; i < end; i++)
+            rowFunc(p, i % p.height, i / p.height, accums[threadIdx]);
+    });
+
+    // Merge the accumulators of each vertex block with a pairwise tree and write the result.
+    pool.parallelFor(0, numBlocks, 16, [&](int begin, int end, int)
+    {
+        std::vector<float*> src(numThreads);
+        for (int b = begin; b < end; b++)
+        {
+            int n = 0;
+            for (int t=0; t < numThreads; t++)
+                if (accums[t].blockOfs[b] >= 0)
+                    src[n++] = &accums[t].data[accums[t].blockOfs[b]];
+            if (!n)
+                continue; // Untouched, leave at zero.
+
+            for (int stride = 1; stride < n; stride *= 2)
+            for (int t = 0; t + stride < n; t += 2 * stride)
+            {
+                float* dst = src[t];
+                const float* add = src[t + stride];
+                for (int i=0; i < blockFloats; i++)
+                    dst[i] += add[i];
+            }
+
+            // Last block may be partial.
+            int numFloats = std::min(RAST_CPU_GRAD_BLOCK_VERTICES, numGradVertices - b * RAST_CPU_GRAD_BLOCK_VERTICES) * 4;
+            memcpy(p.grad + (size_t)b * blockFloats, src[0], numFloats * sizeof(float));
+        }
+    });
+
+    // Sum the transform gradients.
+    if (p.mtx)
+        for (int t=0; t < numThreads; t++)
+            for (int i=0; i < 16 * p.depth; i++)
+                p.gradMtx[i] += accums[t].mtxData[i];
+}
+
+//------------------------------------------------------------------------
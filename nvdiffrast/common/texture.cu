@@ -595,17 +595,25 @@ static __device__ __forceinline__ void calculateMipLevel(int& level0, int& level
 //------------------------------------------------------------------------
 // Texel fetch and accumulator helpers that understand cube map corners.
 
-template<class T>
-static __device__ __forceinline__ void fetchQuad(T& a00, T& a10, T& a01, T& a11, const float* pIn, int4 tc, bool corner)
+template<class T, class S>
+static __device__ __forceinline__ T fetchTexel(const S* pIn, int tc)
+{
+    T a;
+    load_storage(a, &pIn[tc]);
+    return a;
+}
+
+template<class T, class S>
+static __device__ __forceinline__ void fetchQuad(T& a00, T& a10, T& a01, T& a11, const S* pIn, int4 tc, bool corner)
 {
     // For invalid cube map uv, tc will be all negative, and all texel values will be zero.
     if (corner)
     {
         T avg = zero_value<T>();
-        if (tc.x >= 0) avg += (a00 = *((const T*)&pIn[tc.x]));
-        if (tc.y >= 0) avg += (a10 = *((const T*)&pIn[tc.y]));
-        if (tc.z >= 0) avg += (a01 = *((const T*)&pIn[tc.z]));
-        if (tc.w >= 0) avg += (a11 = *((const T*)&pIn[tc.w]));
+        if (tc.x >= 0) avg += (a00 = fetchTexel<T>(pIn, tc.x));
+        if (tc.y >= 0) avg += (a10 = fetchTexel<T>(pIn, tc.y));
+        if (tc.z >= 0) avg += (a01 = fetchTexel<T>(pIn, tc.z));
+        if (tc.w >= 0) avg += (a11 = fetchTexel<T>(pIn, tc.w));
         avg *= 0.33333333f;
         if (tc.x < 0) a00 = avg;
         if (tc.y < 0) a10 = avg;
@@ -614,10 +622,10 @@ static __device__ __forceinline__ void fetchQuad(T& a00, T& a10, T& a01, T& a11,
     }
     else
     {
-        a00 = (tc.x >= 0) ? *((const T*)&pIn[tc.x]) : zero_value<T>();
-        a10 = (tc.y >= 0) ? *((const T*)&pIn[tc.y]) : zero_value<T>();
-        a01 = (tc.z >= 0) ? *((const T*)&pIn[tc.z]) : zero_value<T>();
-        a11 = (tc.w >= 0) ? *((const T*)&pIn[tc.w]) : zero_value<T>();
+        a00 = (tc.x >= 0) ? fetchTexel<T>(pIn, tc.x) : zero_value<T>();
+        a10 = (tc.y >= 0) ? fetchTexel<T>(pIn, tc.y) : zero_value<T>();
+        a01 = (tc.z >= 0) ? fetchTexel<T>(pIn, tc.z) : zero_value<T>();
+        a11 = (tc.w >= 0) ? fetchTexel<T>(pIn, tc.w) : zero_value<T>();
     }
 }
 
@@ -649,7 +657,7 @@ static __device__ __forceinline__ void accumQuad(float4 c, float* pOut, int leve
 //------------------------------------------------------------------------
 // Mip builder kernel.
 
-template<class T, int C>
+template<class T, int C, class S>
 static __forceinline__ __device__ void MipBuildKernelTemplate(const TextureKernelParams p)
 {
     // Sizes.
@@ -669,8 +677,8 @@ static __forceinline__ __device__ void MipBuildKernelTemplate(const TextureKerne
     int pidx_out = p.channels * (px + sz_out.x * (py + sz_out.y * pz));
 
     // Input and output pointers.
-    const float* pin = p.tex[p.mipLevelOut - 1];
-    float* pout = (float*)p.tex[p.mipLevelOut];
+    const S* pin = (const S*)p.tex[p.mipLevelOut - 1];
+    S* pout = (S*)p.tex[p.mipLevelOut];
 
     // Special case: Input texture height or width is 1.
     if (sz_in.x == 1 || sz_in.y == 1)
@@ -680,13 +688,14 @@ static __forceinline__ __device__ void MipBuildKernelTemplate(const TextureKerne
 
         for (int i=0; i < p.channels; i += C)
         {
-            T v0 = *((const T*)&pin[pidx_in0 + i]);
-            T v1 = *((const T*)&pin[pidx_in1 + i]);
+            T v0, v1;
+            load_storage(v0, &pin[pidx_in0 + i]);
+            load_storage(v1, &pin[pidx_in1 + i]);
             T avg = .5f * (v0 + v1);
 #if TEX_DEBUG_MIP_RETAIN_VARIANCE
             avg = (avg - .5f) * 1.41421356f + .5f;
 #endif
-            *((T*)&pout[pidx_out + i]) = avg;
+            store_storage(&pout[pidx_out + i], avg);
         }
 
         return;
@@ -694,27 +703,34 @@ static __forceinline__ __device__ void MipBuildKernelTemplate(const TextureKerne
 
     for (int i=0; i < p.channels; i += C)
     {
-        T v0 = *((const T*)&pin[pidx_in0 + i]);
-        T v1 = *((const T*)&pin[pidx_in0 + i + p.channels]);
-        T v2 = *((const T*)&pin[pidx_in1 + i]);
-        T v3 = *((const T*)&pin[pidx_in1 + i + p.channels]);
+        T v0, v1, v2, v3;
+        load_storage(v0, &pin[pidx_in0 + i]);
+        load_storage(v1, &pin[pidx_in0 + i + p.channels]);
+        load_storage(v2, &pin[pidx_in1 + i]);
+        load_storage(v3, &pin[pidx_in1 + i + p.channels]);
         T avg = .25f * (v0 + v1 + v2 + v3);
 #if TEX_DEBUG_MIP_RETAIN_VARIANCE
         avg = (avg - .5f) * 2.f + .5f;
 #endif
-        *((T*)&pout[pidx_out + i]) = avg;
+        store_storage(&pout[pidx_out + i], avg);
     }
 }
 
 // Template specializations.
-__global__ void MipBuildKernel1(const TextureKernelParams p) { MipBuildKernelTemplate<float,  1>(p); }
-__global__ void MipBuildKernel2(const TextureKernelParams p) { MipBuildKernelTemplate<float2, 2>(p); }
-__global__ void MipBuildKernel4(const TextureKernelParams p) { MipBuildKernelTemplate<float4, 4>(p); }
+__global__ void MipBuildKernel1    (const TextureKernelParams p) { MipBuildKernelTemplate<float,  1, float>(p); }
+__global__ void MipBuildKernel2    (const TextureKernelParams p) { MipBuildKernelTemplate<float2, 2, float>(p); }
+__global__ void MipBuildKernel4    (const TextureKernelParams p) { MipBuildKernelTemplate<float4, 4, float>(p); }
+__global__ void MipBuildKernel1F16 (const TextureKernelParams p) { MipBuildKernelTemplate<float,  1, __half>(p); }
+__global__ void MipBuildKernel2F16 (const TextureKernelParams p) { MipBuildKernelTemplate<float2, 2, __half>(p); }
+__global__ void MipBuildKernel4F16 (const TextureKernelParams p) { MipBuildKernelTemplate<float4, 4, __half>(p); }
+__global__ void MipBuildKernel1BF16(const TextureKernelParams p) { MipBuildKernelTemplate<float,  1, nvdr_bfloat16>(p); }
+__global__ void MipBuildKernel2BF16(const TextureKernelParams p) { MipBuildKernelTemplate<float2, 2, nvdr_bfloat16>(p); }
+__global__ void MipBuildKernel4BF16(const TextureKernelParams p) { MipBuildKernelTemplate<float4, 4, nvdr_bfloat16>(p); }
 
 //------------------------------------------------------------------------
 // Forward kernel.
 
-template <class T, int C, bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
+template <class T, int C, class S, bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
 static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKernelParams p)
 {
     // Calculate pixel position.
@@ -729,7 +745,7 @@ static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKer
     int pidx = px + p.imgWidth * (py + p.imgHeight * pz);
 
     // Output ptr.
-    float* pOut = p.out + pidx * p.channels;
+    S* pOut = (S*)p.out + pidx * p.channels;
 
     // Get UV.
     float3 uv;
@@ -743,11 +759,11 @@ static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKer
     {
         int tc = indexTextureNearest<CUBE_MODE>(p, uv, tz);
         tc *= p.channels;
-        const float* pIn = p.tex[0];
+        const S* pIn = (const S*)p.tex[0];
 
         // Copy if valid tc, otherwise output zero.
         for (int i=0; i < p.channels; i += C)
-            *((T*)&pOut[i]) = (tc >= 0) ? *((const T*)&pIn[tc + i]) : zero_value<T>();
+            store_storage(&pOut[i], (tc >= 0) ? fetchTexel<T>(pIn, tc + i) : zero_value<T>());
 
         return; // Exit.
     }
@@ -761,7 +777,7 @@ static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKer
     // Get texel indices and pointer for level 0.
     int4 tc0 = make_int4(0, 0, 0, 0);
     float2 uv0 = indexTextureLinear<CUBE_MODE>(p, uv, tz, tc0, level0);
-    const float* pIn0 = p.tex[level0];
+    const S* pIn0 = (const S*)p.tex[level0];
     bool corner0 = CUBE_MODE && ((tc0.x | tc0.y | tc0.z | tc0.w) < 0);
     tc0 *= p.channels;
 
@@ -773,7 +789,7 @@ static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKer
         {
             T a00, a10, a01, a11;
             fetchQuad<T>(a00, a10, a01, a11, pIn0, tc0, corner0);
-            *((T*)&pOut[i]) = bilerp(a00, a10, a01, a11, uv0);
+            store_storage(&pOut[i], bilerp(a00, a10, a01, a11, uv0));
         }
         return; // Exit.
     }
@@ -781,7 +797,7 @@ static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKer
     // Get texel indices and pointer for level 1.
     int4 tc1 = make_int4(0, 0, 0, 0);
     float2 uv1 = indexTextureLinear<CUBE_MODE>(p, uv, tz, tc1, level1);
-    const float* pIn1 = p.tex[level1];
+    const S* pIn1 = (const S*)p.tex[level1];
     bool corner1 = CUBE_MODE && ((tc1.x | tc1.y | tc1.z | tc1.w) < 0);
     tc1 *= p.channels;
 
@@ -803,47 +819,119 @@ static __forceinline__ __device__ void TextureFwdKernelTemplate(const TextureKer
         }
 
         // Write.
-        *((T*)&pOut[i]) = a;
+        store_storage(&pOut[i], a);
     }
 }
 
 // Template specializations.
-__global__ void TextureFwdKernelNearest1                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, false, false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureFwdKernelNearest2                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, false, false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureFwdKernelNearest4                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, false, false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureFwdKernelLinear1                     (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, false, false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureFwdKernelLinear2                     (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, false, false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureFwdKernelLinear4                     (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, false, false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureFwdKernelLinearMipmapNearest1        (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelLinearMipmapNearest2        (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelLinearMipmapNearest4        (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelLinearMipmapLinear1         (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelLinearMipmapLinear2         (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelLinearMipmapLinear4         (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeNearest1                (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, true,  false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeNearest2                (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, true,  false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeNearest4                (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, true,  false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinear1                 (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, true,  false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinear2                 (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, true,  false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinear4                 (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, true,  false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapNearest1    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapNearest2    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapNearest4    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapLinear1     (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapLinear2     (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapLinear4     (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelLinearMipmapNearestBO1      (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelLinearMipmapNearestBO2      (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelLinearMipmapNearestBO4      (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelLinearMipmapLinearBO1       (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelLinearMipmapLinearBO2       (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelLinearMipmapLinearBO4       (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapNearestBO1  (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapNearestBO2  (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapNearestBO4  (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapLinearBO1   (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapLinearBO2   (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureFwdKernelCubeLinearMipmapLinearBO4   (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelNearest1                       (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelNearest2                       (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelNearest4                       (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelLinear1                        (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinear2                        (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinear4                        (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest1           (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest2           (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest4           (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear1            (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear2            (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear4            (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeNearest1                   (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeNearest2                   (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeNearest4                   (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinear1                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinear2                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinear4                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest1       (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest2       (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest4       (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear1        (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear2        (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear4        (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO1         (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO2         (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO4         (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO1          (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO2          (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO4          (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO1     (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO2     (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO4     (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO1      (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO2      (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO4      (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelNearest1F16                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelNearest2F16                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelNearest4F16                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelLinear1F16                     (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinear2F16                     (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinear4F16                     (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest1F16        (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest2F16        (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest4F16        (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear1F16         (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear2F16         (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear4F16         (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeNearest1F16                (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeNearest2F16                (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeNearest4F16                (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinear1F16                 (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinear2F16                 (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinear4F16                 (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest1F16    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest2F16    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest4F16    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear1F16     (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear2F16     (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear4F16     (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO1F16      (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO2F16      (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO4F16      (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO1F16       (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO2F16       (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO4F16       (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO1F16  (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO2F16  (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO4F16  (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO1F16   (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, __half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO2F16   (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, __half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO4F16   (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, __half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelNearest1BF16                   (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelNearest2BF16                   (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelNearest4BF16                   (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelLinear1BF16                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinear2BF16                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinear4BF16                    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest1BF16       (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest2BF16       (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearest4BF16       (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear1BF16        (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear2BF16        (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinear4BF16        (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeNearest1BF16               (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeNearest2BF16               (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeNearest4BF16               (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinear1BF16                (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinear2BF16                (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinear4BF16                (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest1BF16   (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest2BF16   (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearest4BF16   (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear1BF16    (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear2BF16    (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinear4BF16    (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO1BF16     (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO2BF16     (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapNearestBO4BF16     (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO1BF16      (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO2BF16      (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelLinearMipmapLinearBO4BF16      (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO1BF16 (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO2BF16 (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapNearestBO4BF16 (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO1BF16  (const TextureKernelParams p) { TextureFwdKernelTemplate<float,  1, nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO2BF16  (const TextureKernelParams p) { TextureFwdKernelTemplate<float2, 2, nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureFwdKernelCubeLinearMipmapLinearBO4BF16  (const TextureKernelParams p) { TextureFwdKernelTemplate<float4, 4, nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
 
 //------------------------------------------------------------------------
 // Gradient mip puller kernel.
@@ -910,7 +998,7 @@ __global__ void MipGradKernel4(const TextureKernelParams p) { MipGradKernelTempl
 //------------------------------------------------------------------------
 // Gradient kernel.
 
-template <bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
+template <class S, bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
 static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKernelParams p)
 {
     // Temporary space for coalesced atomics.
@@ -929,24 +1017,32 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
     int pidx = px + p.imgWidth * (py + p.imgHeight * pz);
 
     // Early exit if output gradients are zero.
-    const float* pDy = p.dy + pidx * p.channels;
+    const S* pDy = (const S*)p.dy + pidx * p.channels;
     unsigned int dmax = 0u;
     if ((p.channels & 3) == 0)
     {
         for (int i=0; i < p.channels; i += 4)
         {
-            uint4 dy = *((const uint4*)&pDy[i]);
-            dmax |= (dy.x | dy.y | dy.z | dy.w);
+            if (sizeof(S) == 4)
+            {
+                uint4 dy = *((const uint4*)&pDy[i]);
+                dmax |= (dy.x | dy.y | dy.z | dy.w);
+            }
+            else
+            {
+                uint2 dy = *((const uint2*)&pDy[i]);
+                dmax |= (dy.x | dy.y);
+            }
         }
     }
     else
     {
         for (int i=0; i < p.channels; i++)
-            dmax |= __float_as_uint(pDy[i]);
+            dmax |= (sizeof(S) == 4) ? *((const unsigned int*)&pDy[i]) : *((const unsigned short*)&pDy[i]);
     }
 
-    // Store zeros and exit.
-    if (__uint_as_float(dmax) == 0.f)
+    // Store zeros and exit. Sign bits are masked so that negative zeros count as zero.
+    if (!(dmax & ((sizeof(S) == 4) ? 0x7fffffffu : 0x7fff7fffu)))
     {
         if (CUBE_MODE)
         {
@@ -998,7 +1094,7 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
 
         // Accumulate texture gradients.
         for (int i=0; i < p.channels; i++)
-            caAtomicAddTexture(pOut, 0, tc + i, pDy[i], TEX_GRAD_MAX_KERNEL_BLOCK_WIDTH);
+            caAtomicAddTexture(pOut, 0, tc + i, storage_to_float(pDy[i]), TEX_GRAD_MAX_KERNEL_BLOCK_WIDTH);
 
         return; // Exit.
     }
@@ -1018,7 +1114,7 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
     // Get texel indices and pointers for level 0.
     int4 tc0 = make_int4(0, 0, 0, 0);
     float2 uv0 = indexTextureLinear<CUBE_MODE>(p, uv, tz, tc0, level0);
-    const float* pIn0 = p.tex[level0];
+    const S* pIn0 = (const S*)p.tex[level0];
     float* pOut0 = p.gradTex[level0];
     bool corner0 = CUBE_MODE && ((tc0.x | tc0.y | tc0.z | tc0.w) < 0);
     tc0 *= p.channels;
@@ -1040,7 +1136,7 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
     {
         for (int i=0; i < p.channels; i++, tc0 += 1)
         {
-            float dy = pDy[i];
+            float dy = storage_to_float(pDy[i]);
             accumQuad(tw0 * dy, pOut0, level0, tc0, corner0, CA_TEMP, CA_SYNC_TEMP);
 
             float a00, a10, a01, a11;
@@ -1065,7 +1161,7 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
     // Get texel indices and pointers for level 1.
     int4 tc1 = make_int4(0, 0, 0, 0);
     float2 uv1 = indexTextureLinear<CUBE_MODE>(p, uv, tz, tc1, level1);
-    const float* pIn1 = p.tex[level1];
+    const S* pIn1 = (const S*)p.tex[level1];
     float* pOut1 = p.gradTex[level1];
     bool corner1 = CUBE_MODE && ((tc1.x | tc1.y | tc1.z | tc1.w) < 0);
     tc1 *= p.channels;
@@ -1085,7 +1181,7 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
     // Trilinear mode.
     for (int i=0; i < p.channels; i++, tc0 += 1, tc1 += 1)
     {
-        float dy = pDy[i];
+        float dy = storage_to_float(pDy[i]);
         float dy0 = (1.f - flevel) * dy;
         accumQuad(tw0 * dy0, pOut0, level0, tc0, corner0, CA_TEMP, CA_SYNC_TEMP);
 
@@ -1149,17 +1245,41 @@ static __forceinline__ __device__ void TextureGradKernelTemplate(const TextureKe
 }
 
 // Template specializations.
-__global__ void TextureGradKernelNearest                    (const TextureKernelParams p) { TextureGradKernelTemplate<false, false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureGradKernelLinear                     (const TextureKernelParams p) { TextureGradKernelTemplate<false, false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureGradKernelLinearMipmapNearest        (const TextureKernelParams p) { TextureGradKernelTemplate<false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureGradKernelLinearMipmapLinear         (const TextureKernelParams p) { TextureGradKernelTemplate<false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureGradKernelCubeNearest                (const TextureKernelParams p) { TextureGradKernelTemplate<true,  false, TEX_MODE_NEAREST>(p); }
-__global__ void TextureGradKernelCubeLinear                 (const TextureKernelParams p) { TextureGradKernelTemplate<true,  false, TEX_MODE_LINEAR>(p); }
-__global__ void TextureGradKernelCubeLinearMipmapNearest    (const TextureKernelParams p) { TextureGradKernelTemplate<true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureGradKernelCubeLinearMipmapLinear     (const TextureKernelParams p) { TextureGradKernelTemplate<true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureGradKernelLinearMipmapNearestBO      (const TextureKernelParams p) { TextureGradKernelTemplate<false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureGradKernelLinearMipmapLinearBO       (const TextureKernelParams p) { TextureGradKernelTemplate<false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
-__global__ void TextureGradKernelCubeLinearMipmapNearestBO  (const TextureKernelParams p) { TextureGradKernelTemplate<true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
-__global__ void TextureGradKernelCubeLinearMipmapLinearBO   (const TextureKernelParams p) { TextureGradKernelTemplate<true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelNearest                       (const TextureKernelParams p) { TextureGradKernelTemplate<float,         false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureGradKernelLinear                        (const TextureKernelParams p) { TextureGradKernelTemplate<float,         false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureGradKernelLinearMipmapNearest           (const TextureKernelParams p) { TextureGradKernelTemplate<float,         false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelLinearMipmapLinear            (const TextureKernelParams p) { TextureGradKernelTemplate<float,         false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelCubeNearest                   (const TextureKernelParams p) { TextureGradKernelTemplate<float,         true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinear                    (const TextureKernelParams p) { TextureGradKernelTemplate<float,         true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapNearest       (const TextureKernelParams p) { TextureGradKernelTemplate<float,         true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapLinear        (const TextureKernelParams p) { TextureGradKernelTemplate<float,         true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelLinearMipmapNearestBO         (const TextureKernelParams p) { TextureGradKernelTemplate<float,         false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelLinearMipmapLinearBO          (const TextureKernelParams p) { TextureGradKernelTemplate<float,         false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapNearestBO     (const TextureKernelParams p) { TextureGradKernelTemplate<float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapLinearBO      (const TextureKernelParams p) { TextureGradKernelTemplate<float,         true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelNearestF16                    (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureGradKernelLinearF16                     (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureGradKernelLinearMipmapNearestF16        (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelLinearMipmapLinearF16         (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelCubeNearestF16                (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearF16                 (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapNearestF16    (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapLinearF16     (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelLinearMipmapNearestBOF16      (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelLinearMipmapLinearBOF16       (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapNearestBOF16  (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapLinearBOF16   (const TextureKernelParams p) { TextureGradKernelTemplate<__half,        true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelNearestBF16                   (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, false, false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureGradKernelLinearBF16                    (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, false, false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureGradKernelLinearMipmapNearestBF16       (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelLinearMipmapLinearBF16        (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelCubeNearestBF16               (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, true,  false, TEX_MODE_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearBF16                (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, true,  false, TEX_MODE_LINEAR>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapNearestBF16   (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapLinearBF16    (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelLinearMipmapNearestBOBF16     (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelLinearMipmapLinearBOBF16      (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapNearestBOBF16 (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>(p); }
+__global__ void TextureGradKernelCubeLinearMipmapLinearBOBF16  (const TextureKernelParams p) { TextureGradKernelTemplate<nvdr_bfloat16, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>(p); }
 
 //------------------------------------------------------------------------
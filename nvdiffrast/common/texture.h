@@ -38,13 +38,13 @@
 
 struct TextureKernelParams
 {
-    const float*    tex[TEX_MAX_MIP_LEVEL];         // Incoming texture buffer with mip levels.
+    const void*     tex[TEX_MAX_MIP_LEVEL];         // Incoming texture buffer with mip levels, in the storage type.
     const float*    uv;                             // Incoming texcoord buffer.
     const float*    uvDA;                           // Incoming uv pixel diffs or NULL.
     const float*    mipLevelBias;                   // Incoming mip level bias or NULL.
-    const float*    dy;                             // Incoming output gradient.
-    float*          out;                            // Outgoing texture data.
-    float*          gradTex[TEX_MAX_MIP_LEVEL];     // Outgoing texture gradients with mip levels.
+    const void*     dy;                             // Incoming output gradient, in the storage type.
+    void*           out;                            // Outgoing texture data, in the storage type.
+    float*          gradTex[TEX_MAX_MIP_LEVEL];     // Outgoing texture gradients with mip levels, always fp32.
     float*          gradUV;                         // Outgoing texcoord gradient.
     float*          gradUVDA;                       // Outgoing texcoord pixel differential gradient.
     float*          gradMipLevelBias;               // Outgoing mip level bias gradient.
@@ -62,6 +62,7 @@ struct TextureKernelParams
     int             n;                              // Minibatch size.
     int             mipLevelMax;                    // Maximum mip level index. Zero if mips disabled.
     int             mipLevelOut;                    // Mip level being calculated in builder kernel.
+    int             texType;                        // One of the NVDR_STORAGE_ constants for tex, out and dy.
 };
 
 //------------------------------------------------------------------------
@@ -76,3 +77,15 @@ int calculateMipInfo(NVDR_CTX_ARGS, TextureKernelParams& p, int* mipOffsets);
 #define mipLevelSize(p, i) make_int2(((p).texWidth >> (i)) > 1 ? ((p).texWidth >> (i)) : 1, ((p).texHeight >> (i)) > 1 ? ((p).texHeight >> (i)) : 1)
 
 //------------------------------------------------------------------------
+// CPU implementation. Takes the same params as the CUDA kernels, with all
+// pointers in host memory. Image rows are distributed over the pool. Data
+// is always fp32, texType only makes the mip builder round its output like
+// the kernels would store it.
+
+class ThreadPool;
+void TextureCpuBuildMip (const TextureKernelParams& p, ThreadPool& pool); // Fills levels 1..mipLevelMax.
+void TextureCpuFwd      (const TextureKernelParams& p, ThreadPool& pool);
+void TextureCpuGrad     (const TextureKernelParams& p, ThreadPool& pool); // gradTex must be zeroed.
+void TextureCpuMipGrad  (const TextureKernelParams& p, ThreadPool& pool); // Pulls level 1..mipLevelMax gradients into level 0.
+
+//------------------------------------------------------------------------
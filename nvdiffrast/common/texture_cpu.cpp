@@ -0,0 +1,1530 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "common.h"
+#include "texture.h"
+#include "cpuisa.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+//------------------------------------------------------------------------
+// Texel vectors. TexVec<C> plays the role of float, float2 and float4 in
+// the Cuda kernels. The four-wide variant keeps a whole texel in an SSE
+// register so that quad fetches and bilinear blends run on vectors.
+
+template<int C> struct TexVec
+{
+    float v[C];
+    static TexVec   load    (const float* p)   { TexVec r; for (int i=0; i < C; i++) r.v[i] = p[i]; return r; }
+    static TexVec   zero    (void)             { TexVec r; for (int i=0; i < C; i++) r.v[i] = 0.f; return r; }
+    void            store   (float* p) const   { for (int i=0; i < C; i++) p[i] = v[i]; }
+    TexVec  operator+   (const TexVec& b) const { TexVec r; for (int i=0; i < C; i++) r.v[i] = v[i] + b.v[i]; return r; }
+    TexVec  operator-   (const TexVec& b) const { TexVec r; for (int i=0; i < C; i++) r.v[i] = v[i] - b.v[i]; return r; }
+    TexVec  operator*   (float b) const         { TexVec r; for (int i=0; i < C; i++) r.v[i] = v[i] * b; return r; }
+};
+
+#if NVDR_CPU_X86
+template<> struct TexVec<4>
+{
+    __m128 v;
+    static TexVec   load    (const float* p)   { TexVec r; r.v = _mm_loadu_ps(p); return r; }
+    static TexVec   zero    (void)             { TexVec r; r.v = _mm_setzero_ps(); return r; }
+    void            store   (float* p) const   { _mm_storeu_ps(p, v); }
+    TexVec  operator+   (const TexVec& b) const { TexVec r; r.v = _mm_add_ps(v, b.v); return r; }
+    TexVec  operator-   (const TexVec& b) const { TexVec r; r.v = _mm_sub_ps(v, b.v); return r; }
+    TexVec  operator*   (float b) const         { TexVec r; r.v = _mm_mul_ps(v, _mm_set1_ps(b)); return r; }
+};
+#endif
+
+template<int C> static inline TexVec<C> operator*(float a, const TexVec<C>& b) { return b * a; }
+template<class T> static inline T lerp  (const T& a, const T& b, float c) { return a + c * (b - a); }
+template<class T> static inline T bilerp(const T& a, const T& b, const T& c, const T& d, float ex, float ey) { return lerp(lerp(a, b, ex), lerp(c, d, ex), ey); }
+
+//------------------------------------------------------------------------
+// Host versions of the device intrinsics used by the texture kernels.
+
+static inline int float2int_rd(float x)
+{
+    // Saturating like the device conversion, NaN becomes zero.
+    if (!(x > -2147483648.f))
+        return (x != x) ? 0 : INT_MIN;
+    if (x >= 2147483648.f)
+        return INT_MAX;
+    return (int)floorf(x);
+}
+
+static inline float frcp_rz(float x)
+{
+    // Correctly rounded reciprocal, stepped toward zero if it was rounded up in magnitude.
+    float r = 1.f / x;
+    if (std::isfinite(r) && fabs((double)r * (double)x) > 1.0)
+        r = nextafterf(r, 0.f);
+    return r;
+}
+
+static inline float flipsign(float x, unsigned int s)
+{
+    unsigned int u;
+    memcpy(&u, &x, 4);
+    u ^= s;
+    memcpy(&x, &u, 4);
+    return x;
+}
+
+static inline void mipLevelSizeHost(const TextureKernelParams& p, int i, int& w, int& h)
+{
+    w = ((p.texWidth  >> i) > 1) ? (p.texWidth  >> i) : 1;
+    h = ((p.texHeight >> i) > 1) ? (p.texHeight >> i) : 1;
+}
+
+//------------------------------------------------------------------------
+// Cube map wrapping for smooth filtering across edges and corners. Same
+// tables and logic as in texture.cu.
+
+static const uint32_t c_cubeWrapMask1[48] =
+{
+    0x1530a440, 0x1133a550, 0x6103a110, 0x1515aa44, 0x6161aa11, 0x40154a04, 0x44115a05, 0x04611a01,
+    0x2630a440, 0x2233a550, 0x5203a110, 0x2626aa44, 0x5252aa11, 0x40264a04, 0x44225a05, 0x04521a01,
+    0x32608064, 0x3366a055, 0x13062091, 0x32328866, 0x13132299, 0x50320846, 0x55330a55, 0x05130219,
+    0x42508064, 0x4455a055, 0x14052091, 0x42428866, 0x14142299, 0x60420846, 0x66440a55, 0x06140219,
+    0x5230a044, 0x5533a055, 0x1503a011, 0x5252aa44, 0x1515aa11, 0x40520a44, 0x44550a55, 0x04150a11,
+    0x6130a044, 0x6633a055, 0x2603a011, 0x6161aa44, 0x2626aa11, 0x40610a44, 0x44660a55, 0x04260a11,
+};
+
+static const uint8_t c_cubeWrapMask2[48] =
+{
+    0x26, 0x33, 0x11, 0x05, 0x00, 0x09, 0x0c, 0x04, 0x04, 0x00, 0x00, 0x05, 0x00, 0x81, 0xc0, 0x40,
+    0x02, 0x03, 0x09, 0x00, 0x0a, 0x00, 0x00, 0x02, 0x64, 0x30, 0x90, 0x55, 0xa0, 0x99, 0xcc, 0x64,
+    0x24, 0x30, 0x10, 0x05, 0x00, 0x01, 0x00, 0x00, 0x06, 0x03, 0x01, 0x05, 0x00, 0x89, 0xcc, 0x44,
+};
+
+static void wrapCubeMap(int* tcOut, int face, int ix0, int ix1, int iy0, int iy1, int w)
+{
+    // Calculate case number.
+    int cx = (ix0 < 0) ? 0 : (ix1 >= w) ? 2 : 1;
+    int cy = (iy0 < 0) ? 0 : (iy1 >= w) ? 6 : 3;
+    int c = cx + cy;
+    if (c >= 5)
+        c--;
+    c = (face << 3) + c;
+
+    // Compute coordinates and faces.
+    unsigned int m = c_cubeWrapMask1[c];
+    int x0 = (m >>  0) & 3; x0 = (x0 == 0) ? 0 : (x0 == 1) ? ix0 : iy0;
+    int x1 = (m >>  2) & 3; x1 = (x1 == 0) ? 0 : (x1 == 1) ? ix1 : iy0;
+    int x2 = (m >>  4) & 3; x2 = (x2 == 0) ? 0 : (x2 == 1) ? ix0 : iy1;
+    int x3 = (m >>  6) & 3; x3 = (x3 == 0) ? 0 : (x3 == 1) ? ix1 : iy1;
+    int y0 = (m >>  8) & 3; y0 = (y0 == 0) ? 0 : (y0 == 1) ? ix0 : iy0;
+    int y1 = (m >> 10) & 3; y1 = (y1 == 0) ? 0 : (y1 == 1) ? ix1 : iy0;
+    int y2 = (m >> 12) & 3; y2 = (y2 == 0) ? 0 : (y2 == 1) ? ix0 : iy1;
+    int y3 = (m >> 14) & 3; y3 = (y3 == 0) ? 0 : (y3 == 1) ? ix1 : iy1;
+    int f0 = ((m >> 16) & 15) - 1;
+    int f1 = ((m >> 20) & 15) - 1;
+    int f2 = ((m >> 24) & 15) - 1;
+    int f3 = ((m >> 28)     ) - 1;
+
+    // Flips.
+    unsigned int f = c_cubeWrapMask2[c];
+    int w1 = w - 1;
+    if (f & 0x01) x0 = w1 - x0;
+    if (f & 0x02) x1 = w1 - x1;
+    if (f & 0x04) x2 = w1 - x2;
+    if (f & 0x08) x3 = w1 - x3;
+    if (f & 0x10) y0 = w1 - y0;
+    if (f & 0x20) y1 = w1 - y1;
+    if (f & 0x40) y2 = w1 - y2;
+    if (f & 0x80) y3 = w1 - y3;
+
+    // Done.
+    tcOut[0] = x0 + (y0 + f0 * w) * w;
+    tcOut[1] = x1 + (y1 + f1 * w) * w;
+    tcOut[2] = x2 + (y2 + f2 * w) * w;
+    tcOut[3] = x3 + (y3 + f3 * w) * w;
+}
+
+//------------------------------------------------------------------------
+// Cube map indexing.
+
+// Map a 3D lookup vector into (s,t) face coordinates (returned in first
+// two parameters) and face index.
+static int indexCubeMap(float& x, float& y, float z)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float az = fabsf(z);
+    int idx;
+    float c;
+    if (az > fmaxf(ax, ay)) { idx = 4; c = z; }
+    else if (ay > ax)       { idx = 2; c = y; y = z; }
+    else                    { idx = 0; c = x; x = z; }
+    if (c < 0.f) idx += 1;
+    float m = frcp_rz(fabsf(c)) * .5;
+    float m0 = flipsign(m, (0x21u >> idx) << 31);
+    float m1 = (idx != 2) ? -m : m;
+    x = x * m0 + .5;
+    y = y * m1 + .5;
+    if (!std::isfinite(x) || !std::isfinite(y))
+        return -1; // Invalid uv.
+    x = fminf(fmaxf(x, 0.f), 1.f);
+    y = fminf(fmaxf(y, 0.f), 1.f);
+    return idx;
+}
+
+// Based on dA/d{s,t}, compute dA/d{x,y,z} at a given 3D lookup vector.
+static void indexCubeMapGrad(float* res, const float* uv, float gu, float gv)
+{
+    float ax = fabsf(uv[0]);
+    float ay = fabsf(uv[1]);
+    float az = fabsf(uv[2]);
+    int idx;
+    float c;
+    float c0 = gu;
+    float c1 = gv;
+    if (az > fmaxf(ax, ay)) { idx = 0x10; c = uv[2]; c0 *= uv[0]; c1 *= uv[1]; }
+    else if (ay > ax)       { idx = 0x04; c = uv[1]; c0 *= uv[0]; c1 *= uv[2]; }
+    else                    { idx = 0x01; c = uv[0]; c0 *= uv[2]; c1 *= uv[1]; }
+    if (c < 0.f) idx += idx;
+    float m = frcp_rz(fabsf(c));
+    c0 = (idx & 0x34) ? -c0 : c0;
+    c1 = (idx & 0x2e) ? -c1 : c1;
+    float gl = (c0 + c1) * m;
+    float gx = (idx & 0x03) ? gl : (idx & 0x20) ? -gu : gu;
+    float gy = (idx & 0x0c) ? gl : -gv;
+    float gz = (idx & 0x30) ? gl : (idx & 0x03) ? gu : gv;
+    gz = (idx & 0x09) ? -gz : gz;
+    float s = m * .5f;
+    res[0] = gx * s;
+    res[1] = gy * s;
+    res[2] = gz * s;
+    if (!std::isfinite(res[0]) || !std::isfinite(res[1]) || !std::isfinite(res[2]))
+        res[0] = res[1] = res[2] = 0.f; // Invalid uv.
+}
+
+// Based on dL/d(d{s,t}/s{X,Y}), compute dL/d(d{x,y,z}/d{X,Y}). This is just two
+// indexCubeMapGrad() functions rolled together.
+static void indexCubeMapGrad4(const float* uv, const float* dw, float* g0, float* g1)
+{
+    float ax = fabsf(uv[0]);
+    float ay = fabsf(uv[1]);
+    float az = fabsf(uv[2]);
+    int idx;
+    float c, c0, c1;
+    if (az > fmaxf(ax, ay)) { idx = 0x10; c = uv[2]; c0 = uv[0]; c1 = uv[1]; }
+    else if (ay > ax)       { idx = 0x04; c = uv[1]; c0 = uv[0]; c1 = uv[2]; }
+    else                    { idx = 0x01; c = uv[0]; c0 = uv[2]; c1 = uv[1]; }
+    if (c < 0.f) idx += idx;
+    float m = frcp_rz(fabsf(c));
+    c0 = (idx & 0x34) ? -c0 : c0;
+    c1 = (idx & 0x2e) ? -c1 : c1;
+    float gl0 = (dw[0] * c0 + dw[2] * c1) * m;
+    float gl1 = (dw[1] * c0 + dw[3] * c1) * m;
+    float gx0 = (idx & 0x03) ? gl0 : (idx & 0x20) ? -dw[0] : dw[0];
+    float gx1 = (idx & 0x03) ? gl1 : (idx & 0x20) ? -dw[1] : dw[1];
+    float gy0 = (idx & 0x0c) ? gl0 : -dw[2];
+    float gy1 = (idx & 0x0c) ? gl1 : -dw[3];
+    float gz0 = (idx & 0x30) ? gl0 : (idx & 0x03) ? dw[0] : dw[2];
+    float gz1 = (idx & 0x30) ? gl1 : (idx & 0x03) ? dw[1] : dw[3];
+    if (idx & 0x09)
+    {
+        gz0 = -gz0;
+        gz1 = -gz1;
+    }
+    float s = m * .5f;
+    g0[0] = gx0 * s; g0[1] = gy0 * s; g0[2] = gz0 * s;
+    g1[0] = gx1 * s; g1[1] = gy1 * s; g1[2] = gz1 * s;
+    for (int i=0; i < 3; i++)
+    {
+        if (!std::isfinite(g0[i]) || !std::isfinite(g1[i]))
+        {
+            g0[0] = g0[1] = g0[2] = 0.f; // Invalid uv.
+            g1[0] = g1[1] = g1[2] = 0.f;
+            break;
+        }
+    }
+}
+
+// Compute d{s,t}/d{X,Y} based on d{x,y,z}/d{X,Y} at a given 3D lookup vector.
+// Result is (ds/dX, ds/dY, dt/dX, dt/dY).
+static void indexCubeMapGradST(float* res, const float* uv, const float* dvdX_, const float* dvdY_)
+{
+    float dvdX[3] = { dvdX_[0], dvdX_[1], dvdX_[2] };
+    float dvdY[3] = { dvdY_[0], dvdY_[1], dvdY_[2] };
+    float ax = fabsf(uv[0]);
+    float ay = fabsf(uv[1]);
+    float az = fabsf(uv[2]);
+    int idx;
+    float c, gu, gv;
+    if (az > fmaxf(ax, ay)) { idx = 0x10; c = uv[2]; gu = uv[0]; gv = uv[1]; }
+    else if (ay > ax)       { idx = 0x04; c = uv[1]; gu = uv[0]; gv = uv[2]; }
+    else                    { idx = 0x01; c = uv[0]; gu = uv[2]; gv = uv[1]; }
+    if (c < 0.f) idx += idx;
+    if (idx & 0x09)
+    {
+        dvdX[2] = -dvdX[2];
+        dvdY[2] = -dvdY[2];
+    }
+    float m = frcp_rz(fabsf(c));
+    float dm = m * .5f;
+    float mm = m * dm;
+    gu *= (idx & 0x34) ? -mm : mm;
+    gv *= (idx & 0x2e) ? -mm : mm;
+
+    if (idx & 0x03)
+    {
+        res[0] = gu * dvdX[0] + dm * dvdX[2];
+        res[1] = gu * dvdY[0] + dm * dvdY[2];
+        res[2] = gv * dvdX[0] - dm * dvdX[1];
+        res[3] = gv * dvdY[0] - dm * dvdY[1];
+    }
+    else if (idx & 0x0c)
+    {
+        res[0] = gu * dvdX[1] + dm * dvdX[0];
+        res[1] = gu * dvdY[1] + dm * dvdY[0];
+        res[2] = gv * dvdX[1] + dm * dvdX[2];
+        res[3] = gv * dvdY[1] + dm * dvdY[2];
+    }
+    else // (idx & 0x30)
+    {
+        res[0] = gu * dvdX[2] + copysignf(dm, c) * dvdX[0];
+        res[1] = gu * dvdY[2] + copysignf(dm, c) * dvdY[0];
+        res[2] = gv * dvdX[2] - dm * dvdX[1];
+        res[3] = gv * dvdY[2] - dm * dvdY[1];
+    }
+
+    if (!std::isfinite(res[0]) || !std::isfinite(res[1]) || !std::isfinite(res[2]) || !std::isfinite(res[3]))
+        res[0] = res[1] = res[2] = res[3] = 0.f;
+}
+
+// Compute d(d{s,t}/d{X,Y})/d{x,y,z}, i.e., how the pixel derivatives of 2D face
+// coordinates change w.r.t. 3D texture coordinate vector. Row j of the 3x4
+// result matrix is stored at d[4*j], columns as in the Cuda version:
+//   |  d(ds/dX)/dx  d(ds/dY)/dx  d(dt/dX)/dx  d(dt/dY)/dx  |
+//   |  d(ds/dX)/dy  d(ds/dY)/dy  d(dt/dX)/dy  d(dt/dY)/dy  |
+//   |  d(ds/dX)/dz  d(ds/dY)/dz  d(dt/dX)/dz  d(dt/dY)/dz  |
+static void indexCubeMapGrad2(const float* uv, const float* dvdX_, const float* dvdY_, float* d)
+{
+    float dvdX[3] = { dvdX_[0], dvdX_[1], dvdX_[2] };
+    float dvdY[3] = { dvdY_[0], dvdY_[1], dvdY_[2] };
+    float* dx = d;
+    float* dy = d + 4;
+    float* dz = d + 8;
+    float ax = fabsf(uv[0]);
+    float ay = fabsf(uv[1]);
+    float az = fabsf(uv[2]);
+    int idx;
+    float c, gu, gv;
+    if (az > fmaxf(ax, ay)) { idx = 0x10; c = uv[2]; gu = uv[0]; gv = uv[1]; }
+    else if (ay > ax)       { idx = 0x04; c = uv[1]; gu = uv[0]; gv = uv[2]; }
+    else                    { idx = 0x01; c = uv[0]; gu = uv[2]; gv = uv[1]; }
+    if (c < 0.f) idx += idx;
+
+    if (idx & 0x09)
+    {
+        dvdX[2] = -dvdX[2];
+        dvdY[2] = -dvdY[2];
+    }
+
+    float m = frcp_rz(c);
+    float dm = -m * fabsf(m) * .5;
+    float mm = m * m * .5;
+    float mu = (idx & 0x34) ? -mm : mm;
+    float mv = (idx & 0x2e) ? -mm : mm;
+    gu *= -2.0 * m * mu;
+    gv *= -2.0 * m * mv;
+
+    if (idx & 0x03)
+    {
+        dx[0] = gu * dvdX[0] + dm * dvdX[2];
+        dx[1] = gu * dvdY[0] + dm * dvdY[2];
+        dx[2] = gv * dvdX[0] - dm * dvdX[1];
+        dx[3] = gv * dvdY[0] - dm * dvdY[1];
+        dy[0] = 0.f;
+        dy[1] = 0.f;
+        dy[2] = mv * dvdX[0];
+        dy[3] = mv * dvdY[0];
+        dz[0] = mu * dvdX[0];
+        dz[1] = mu * dvdY[0];
+        dz[2] = 0.f;
+        dz[3] = 0.f;
+    }
+    else if (idx & 0x0c)
+    {
+        dx[0] = mu * dvdX[1];
+        dx[1] = mu * dvdY[1];
+        dx[2] = 0.f;
+        dx[3] = 0.f;
+        dy[0] = gu * dvdX[1] + dm * dvdX[0];
+        dy[1] = gu * dvdY[1] + dm * dvdY[0];
+        dy[2] = gv * dvdX[1] + dm * dvdX[2];
+        dy[3] = gv * dvdY[1] + dm * dvdY[2];
+        dz[0] = 0.f;
+        dz[1] = 0.f;
+        dz[2] = mv * dvdX[1];
+        dz[3] = mv * dvdY[1];
+    }
+    else // (idx & 0x30)
+    {
+        dx[0] = mu * dvdX[2];
+        dx[1] = mu * dvdY[2];
+        dx[2] = 0.f;
+        dx[3] = 0.f;
+        dy[0] = 0.f;
+        dy[1] = 0.f;
+        dy[2] = mv * dvdX[2];
+        dy[3] = mv * dvdY[2];
+        dz[0] = gu * dvdX[2] - fabsf(dm) * dvdX[0];
+        dz[1] = gu * dvdY[2] - fabsf(dm) * dvdY[0];
+        dz[2] = gv * dvdX[2] - dm * dvdX[1];
+        dz[3] = gv * dvdY[2] - dm * dvdY[1];
+    }
+}
+
+//------------------------------------------------------------------------
+// General texture indexing.
+
+template <bool CUBE_MODE>
+static int indexTextureNearest(const TextureKernelParams& p, const float* uv, int tz)
+{
+    int w = p.texWidth;
+    int h = p.texHeight;
+    float u = uv[0];
+    float v = uv[1];
+
+    // Cube map indexing.
+    if (CUBE_MODE)
+    {
+        // No wrap. Fold face index into tz right away.
+        int idx = indexCubeMap(u, v, uv[2]); // Rewrites u, v.
+        if (idx < 0)
+            return -1; // Invalid uv.
+        tz = 6 * tz + idx;
+    }
+    else
+    {
+        // Handle boundary.
+        if (p.boundaryMode == TEX_BOUNDARY_MODE_WRAP)
+        {
+            u = u - (float)float2int_rd(u);
+            v = v - (float)float2int_rd(v);
+        }
+    }
+
+    u = u * (float)w;
+    v = v * (float)h;
+
+    int iu = float2int_rd(u);
+    int iv = float2int_rd(v);
+
+    // In zero boundary mode, return texture address -1.
+    if (!CUBE_MODE && p.boundaryMode == TEX_BOUNDARY_MODE_ZERO)
+    {
+        if (iu < 0 || iu >= w || iv < 0 || iv >= h)
+            return -1;
+    }
+
+    // Otherwise clamp and calculate the coordinate properly.
+    iu = std::min(std::max(iu, 0), w-1);
+    iv = std::min(std::max(iv, 0), h-1);
+    return iu + w * (iv + tz * h);
+}
+
+template <bool CUBE_MODE>
+static void indexTextureLinear(const TextureKernelParams& p, const float* uv, int tz, int* tcOut, float& fu, float& fv, int level)
+{
+    // Mip level size.
+    int w, h;
+    mipLevelSizeHost(p, level, w, h);
+
+    // Compute texture-space u, v.
+    float u = uv[0];
+    float v = uv[1];
+    bool clampU = false;
+    bool clampV = false;
+
+    // Cube map indexing.
+    int face = 0;
+    if (CUBE_MODE)
+    {
+        // Neither clamp or wrap.
+        face = indexCubeMap(u, v, uv[2]); // Rewrites u, v.
+        if (face < 0)
+        {
+            tcOut[0] = tcOut[1] = tcOut[2] = tcOut[3] = -1; // Invalid uv.
+            fu = fv = 0.f;
+            return;
+        }
+        u = u * (float)w - 0.5f;
+        v = v * (float)h - 0.5f;
+    }
+    else
+    {
+        if (p.boundaryMode == TEX_BOUNDARY_MODE_WRAP)
+        {
+            // Wrap.
+            u = u - (float)float2int_rd(u);
+            v = v - (float)float2int_rd(v);
+        }
+
+        // Move to texel space.
+        u = u * (float)w - 0.5f;
+        v = v * (float)h - 0.5f;
+
+        if (p.boundaryMode == TEX_BOUNDARY_MODE_CLAMP)
+        {
+            // Clamp to center of edge texels.
+            u = fminf(fmaxf(u, 0.f), w - 1.f);
+            v = fminf(fmaxf(v, 0.f), h - 1.f);
+            clampU = (u == 0.f || u == w - 1.f);
+            clampV = (v == 0.f || v == h - 1.f);
+        }
+    }
+
+    // Compute texel coordinates and weights.
+    int iu0 = float2int_rd(u);
+    int iv0 = float2int_rd(v);
+    int iu1 = (int)((unsigned int)iu0 + (clampU ? 0u : 1u)); // Ensure zero u/v gradients with clamped.
+    int iv1 = (int)((unsigned int)iv0 + (clampV ? 0u : 1u));
+    fu = u - (float)iu0;
+    fv = v - (float)iv0;
+
+    // Cube map wrapping.
+    bool cubeWrap = CUBE_MODE && (iu0 < 0 || iv0 < 0 || iu1 >= w || iv1 >= h);
+    if (cubeWrap)
+    {
+        wrapCubeMap(tcOut, face, iu0, iu1, iv0, iv1, w);
+        for (int i=0; i < 4; i++)
+            tcOut[i] += 6 * tz * w * h; // Bring in tz.
+        return; // Done.
+    }
+
+    // Fold cube map face into tz.
+    if (CUBE_MODE)
+        tz = 6 * tz + face;
+
+    // Wrap overflowing texel indices.
+    if (!CUBE_MODE && p.boundaryMode == TEX_BOUNDARY_MODE_WRAP)
+    {
+        if (iu0 < 0) iu0 += w;
+        if (iv0 < 0) iv0 += h;
+        if (iu1 >= w) iu1 -= w;
+        if (iv1 >= h) iv1 -= h;
+    }
+
+    // Coordinates with tz folded in.
+    int iu0z = iu0 + tz * w * h;
+    int iu1z = iu1 + tz * w * h;
+    tcOut[0] = iu0z + w * iv0;
+    tcOut[1] = iu1z + w * iv0;
+    tcOut[2] = iu0z + w * iv1;
+    tcOut[3] = iu1z + w * iv1;
+
+    // Invalidate texture addresses outside unit square if we are in zero mode.
+    if (!CUBE_MODE && p.boundaryMode == TEX_BOUNDARY_MODE_ZERO)
+    {
+        bool iu0_out = (iu0 < 0 || iu0 >= w);
+        bool iu1_out = (iu1 < 0 || iu1 >= w);
+        bool iv0_out = (iv0 < 0 || iv0 >= h);
+        bool iv1_out = (iv1 < 0 || iv1 >= h);
+        if (iu0_out || iv0_out) tcOut[0] = -1;
+        if (iu1_out || iv0_out) tcOut[1] = -1;
+        if (iu0_out || iv1_out) tcOut[2] = -1;
+        if (iu1_out || iv1_out) tcOut[3] = -1;
+    }
+}
+
+//------------------------------------------------------------------------
+// Mip level calculation.
+
+template <bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
+static void calculateMipLevel(int& level0, int& level1, float& flevel, const TextureKernelParams& p, int pidx, const float* uv, float* pdw, float* pdfdv)
+{
+    // Do nothing if mips not in use.
+    if (FILTER_MODE == TEX_MODE_NEAREST || FILTER_MODE == TEX_MODE_LINEAR)
+        return;
+
+    // Determine mip level based on UV pixel derivatives. If no derivatives are given (mip level bias only), leave as zero.
+    if (!BIAS_ONLY)
+    {
+        // Get pixel derivatives of texture coordinates.
+        float uvDA[4];
+        float dvdX[3], dvdY[3]; // Gradients use these later.
+        if (CUBE_MODE)
+        {
+            // Fetch and map d{x,y,z}/d{X,Y} into d{s,t}/d{X,Y}.
+            const float* d = p.uvDA + 6 * pidx;
+            dvdX[0] = d[0]; dvdX[1] = d[2]; dvdX[2] = d[4]; // d{x,y,z}/dX
+            dvdY[0] = d[1]; dvdY[1] = d[3]; dvdY[2] = d[5]; // d{x,y,z}/dY
+            indexCubeMapGradST(uvDA, uv, dvdX, dvdY);
+        }
+        else
+        {
+            // Fetch.
+            const float* d = p.uvDA + 4 * pidx;
+            uvDA[0] = d[0];
+            uvDA[1] = d[1];
+            uvDA[2] = d[2];
+            uvDA[3] = d[3];
+        }
+
+        // Scaling factors.
+        float uscl = p.texWidth;
+        float vscl = p.texHeight;
+
+        // d[s,t]/d[X,Y].
+        float dsdx = uvDA[0] * uscl;
+        float dsdy = uvDA[1] * uscl;
+        float dtdx = uvDA[2] * vscl;
+        float dtdy = uvDA[3] * vscl;
+
+        // Calculate footprint axis lengths.
+        float A = dsdx*dsdx + dtdx*dtdx;
+        float B = dsdy*dsdy + dtdy*dtdy;
+        float C = dsdx*dsdy + dtdx*dtdy;
+        float l2b = 0.5 * (A + B);
+        float l2n = 0.25 * (A-B)*(A-B) + C*C;
+        float l2a = sqrtf(l2n);
+        float lenMajorSqr = l2b + l2a;
+
+        // Footprint vs. mip level gradient.
+        if (pdw && FILTER_MODE == TEX_MODE_LINEAR_MIPMAP_LINEAR)
+        {
+            float dw   = 0.72134752f / (l2n + l2a * l2b); // Constant is 0.5/ln(2).
+            float AB   = dw * .5f * (A - B);
+            float Cw   = dw * C;
+            float l2aw = dw * l2a;
+            float d_f_dw[4];
+            d_f_dw[0] = uscl * (dsdx * (l2aw + AB) + dsdy * Cw); // d_f_ddsdX
+            d_f_dw[1] = uscl * (dsdy * (l2aw - AB) + dsdx * Cw); // d_f_ddsdY
+            d_f_dw[2] = vscl * (dtdx * (l2aw + AB) + dtdy * Cw); // d_f_ddtdX
+            d_f_dw[3] = vscl * (dtdy * (l2aw - AB) + dtdx * Cw); // d_f_ddtdY
+            bool finite = true;
+            for (int i=0; i < 4; i++)
+                finite = finite && std::isfinite(d_f_dw[i]);
+
+            // In cube maps, there is also a texture coordinate vs. mip level gradient.
+            // Only output nonzero vectors if both are free of inf/Nan garbage.
+            float d_f_dv[3] = { 0.f, 0.f, 0.f };
+            if (CUBE_MODE)
+            {
+                float d[12];
+                indexCubeMapGrad2(uv, dvdX, dvdY, d);
+                for (int j=0; j < 3; j++)
+                {
+                    for (int i=0; i < 4; i++)
+                        d_f_dv[j] += d[4 * j + i] * d_f_dw[i];
+                    finite = finite && std::isfinite(d_f_dv[j]);
+                }
+            }
+
+            for (int i=0; i < 4; i++)
+                pdw[i] = finite ? d_f_dw[i] : 0.f;
+            if (CUBE_MODE)
+                for (int j=0; j < 3; j++)
+                    pdfdv[j] = finite ? d_f_dv[j] : 0.f;
+        }
+
+        // Finally, calculate mip level.
+        flevel = .5f * log2f(lenMajorSqr); // May be inf/NaN, but clamp fixes it.
+    }
+
+    // Bias the mip level and clamp.
+    if (p.mipLevelBias)
+        flevel += p.mipLevelBias[pidx];
+    flevel = fminf(fmaxf(flevel, 0.f), (float)p.mipLevelMax);
+
+    // Calculate levels depending on filter mode.
+    level0 = float2int_rd(flevel);
+
+    // Leave everything else at zero if flevel == 0 (magnification) or when in linear-mipmap-nearest mode.
+    if (FILTER_MODE == TEX_MODE_LINEAR_MIPMAP_LINEAR && flevel > 0.f)
+    {
+        level1 = std::min(level0 + 1, p.mipLevelMax);
+        flevel -= level0; // Fractional part. Zero if clamped on last level.
+    }
+}
+
+//------------------------------------------------------------------------
+// Texel fetch helper that understands cube map corners.
+
+template<int C>
+static inline void fetchQuad(TexVec<C>& a00, TexVec<C>& a10, TexVec<C>& a01, TexVec<C>& a11, const float* pIn, const int* tc, bool corner)
+{
+    typedef TexVec<C> T;
+
+    // For invalid cube map uv, tc will be all negative, and all texel values will be zero.
+    if (corner)
+    {
+        T avg = T::zero();
+        if (tc[0] >= 0) avg = avg + (a00 = T::load(&pIn[tc[0]]));
+        if (tc[1] >= 0) avg = avg + (a10 = T::load(&pIn[tc[1]]));
+        if (tc[2] >= 0) avg = avg + (a01 = T::load(&pIn[tc[2]]));
+        if (tc[3] >= 0) avg = avg + (a11 = T::load(&pIn[tc[3]]));
+        avg = avg * 0.33333333f;
+        if (tc[0] < 0) a00 = avg;
+        if (tc[1] < 0) a10 = avg;
+        if (tc[2] < 0) a01 = avg;
+        if (tc[3] < 0) a11 = avg;
+    }
+    else
+    {
+        a00 = (tc[0] >= 0) ? T::load(&pIn[tc[0]]) : T::zero();
+        a10 = (tc[1] >= 0) ? T::load(&pIn[tc[1]]) : T::zero();
+        a01 = (tc[2] >= 0) ? T::load(&pIn[tc[2]]) : T::zero();
+        a11 = (tc[3] >= 0) ? T::load(&pIn[tc[3]]) : T::zero();
+    }
+}
+
+//------------------------------------------------------------------------
+// Mip builder. Same averaging as MipBuildKernelTemplate, for a span of
+// texels on one output row.
+
+template<int C>
+static void TextureCpuBuildMipSpan(const TextureKernelParams& p, int level, int px0, int px1, int py, int pz)
+{
+    typedef TexVec<C> T;
+
+    // Sizes.
+    int win, hin, wout, hout;
+    mipLevelSizeHost(p, level - 1, win, hin);
+    mipLevelSizeHost(p, level, wout, hout);
+
+    // Input and output pointers.
+    const float* pin = (const float*)p.tex[level - 1];
+    float* pout = (float*)p.tex[level];
+
+    for (int px=px0; px < px1; px++)
+    {
+        // Pixel indices.
+        int pidx_in0 = p.channels * (((px + win * py) << 1) + (pz * win * hin));
+        int pidx_in1 = pidx_in0 + p.channels * win; // Next pixel down.
+        int pidx_out = p.channels * (px + wout * (py + hout * pz));
+
+        // Special case: Input texture height or width is 1.
+        if (win == 1 || hin == 1)
+        {
+            if (hin == 1)
+                pidx_in1 = pidx_in0 + p.channels; // Next pixel on the right.
+
+            for (int i=0; i < p.channels; i += C)
+            {
+                T v0 = T::load(&pin[pidx_in0 + i]);
+                T v1 = T::load(&pin[pidx_in1 + i]);
+                T avg = .5f * (v0 + v1);
+                avg.store(&pout[pidx_out + i]);
+            }
+            continue;
+        }
+
+        for (int i=0; i < p.channels; i += C)
+        {
+            T v0 = T::load(&pin[pidx_in0 + i]);
+            T v1 = T::load(&pin[pidx_in0 + i + p.channels]);
+            T v2 = T::load(&pin[pidx_in1 + i]);
+            T v3 = T::load(&pin[pidx_in1 + i + p.channels]);
+            T avg = .25f * (v0 + v1 + v2 + v3);
+            avg.store(&pout[pidx_out + i]);
+        }
+    }
+
+    // Round to the storage type so that the next level is built from the same values as in the kernels.
+    if (p.texType != NVDR_STORAGE_F32)
+    {
+        float* prow = pout + p.channels * (px0 + wout * (py + hout * pz));
+        for (int i=0; i < (px1 - px0) * p.channels; i++)
+            prow[i] = storage_round_host(prow[i], p.texType);
+    }
+}
+
+//------------------------------------------------------------------------
+// Forward shader, one image row per call.
+
+template <int C, bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
+static void TextureCpuFwdRow(const TextureKernelParams& p, int py, int pz)
+{
+    typedef TexVec<C> T;
+    int tz = (p.texDepth == 1) ? 0 : pz;
+
+    for (int px=0; px < p.imgWidth; px++)
+    {
+        // Pixel index.
+        int pidx = px + p.imgWidth * (py + p.imgHeight * pz);
+
+        // Output ptr.
+        float* pOut = (float*)p.out + (size_t)pidx * p.channels;
+
+        // Get UV.
+        float uv[3];
+        if (CUBE_MODE)
+        {
+            uv[0] = p.uv[3 * pidx + 0];
+            uv[1] = p.uv[3 * pidx + 1];
+            uv[2] = p.uv[3 * pidx + 2];
+        }
+        else
+        {
+            uv[0] = p.uv[2 * pidx + 0];
+            uv[1] = p.uv[2 * pidx + 1];
+            uv[2] = 0.f;
+        }
+
+        // Nearest mode.
+        if (FILTER_MODE == TEX_MODE_NEAREST)
+        {
+            int tc = indexTextureNearest<CUBE_MODE>(p, uv, tz);
+            tc *= p.channels;
+            const float* pIn = (const float*)p.tex[0];
+
+            // Copy if valid tc, otherwise output zero.
+            for (int i=0; i < p.channels; i += C)
+                ((tc >= 0) ? T::load(&pIn[tc + i]) : T::zero()).store(&pOut[i]);
+
+            continue;
+        }
+
+        // Calculate mip level. In 'linear' mode these will all stay zero.
+        float  flevel = 0.f; // Fractional level.
+        int    level0 = 0;   // Discrete level 0.
+        int    level1 = 0;   // Discrete level 1.
+        calculateMipLevel<CUBE_MODE, BIAS_ONLY, FILTER_MODE>(level0, level1, flevel, p, pidx, uv, NULL, NULL);
+
+        // Get texel indices and pointer for level 0.
+        int tc0[4] = {0, 0, 0, 0};
+        float u0, v0;
+        indexTextureLinear<CUBE_MODE>(p, uv, tz, tc0, u0, v0, level0);
+        const float* pIn0 = (const float*)p.tex[level0];
+        bool corner0 = CUBE_MODE && ((tc0[0] | tc0[1] | tc0[2] | tc0[3]) < 0);
+        for (int j=0; j < 4; j++)
+            tc0[j] *= p.channels;
+
+        // Bilinear fetch.
+        if (FILTER_MODE == TEX_MODE_LINEAR || FILTER_MODE == TEX_MODE_LINEAR_MIPMAP_NEAREST)
+        {
+            // Interpolate.
+            for (int i=0; i < p.channels; i += C)
+            {
+                T a00, a10, a01, a11;
+                fetchQuad<C>(a00, a10, a01, a11, pIn0 + i, tc0, corner0);
+                bilerp(a00, a10, a01, a11, u0, v0).store(&pOut[i]);
+            }
+            continue;
+        }
+
+        // Get texel indices and pointer for level 1.
+        int tc1[4] = {0, 0, 0, 0};
+        float u1, v1;
+        indexTextureLinear<CUBE_MODE>(p, uv, tz, tc1, u1, v1, level1);
+        const float* pIn1 = (const float*)p.tex[level1];
+        bool corner1 = CUBE_MODE && ((tc1[0] | tc1[1] | tc1[2] | tc1[3]) < 0);
+        for (int j=0; j < 4; j++)
+            tc1[j] *= p.channels;
+
+        // Trilinear fetch.
+        for (int i=0; i < p.channels; i += C)
+        {
+            // First level.
+            T a00, a10, a01, a11;
+            fetchQuad<C>(a00, a10, a01, a11, pIn0 + i, tc0, corner0);
+            T a = bilerp(a00, a10, a01, a11, u0, v0);
+
+            // Second level unless in magnification mode.
+            if (flevel > 0.f)
+            {
+                T b00, b10, b01, b11;
+                fetchQuad<C>(b00, b10, b01, b11, pIn1 + i, tc1, corner1);
+                T b = bilerp(b00, b10, b01, b11, u1, v1);
+                a = lerp(a, b, flevel); // Interpolate between levels.
+            }
+
+            // Write.
+            a.store(&pOut[i]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// Variant selection. Same indexing as the Cuda kernel tables in
+// torch_texture.cpp: filter mode, cube mode, bias-only mode, vector width.
+
+typedef void (*TextureCpuRowFunc)(const TextureKernelParams& p, int py, int pz);
+
+static int textureCpuChannelDivIdx(const TextureKernelParams& p)
+{
+    if (!(p.channels & 3))
+        return 2;  // Channel count divisible by 4.
+    else if (!(p.channels & 1))
+        return 1;  // Channel count divisible by 2.
+    return 0;
+}
+
+static int textureCpuFuncIdx(const TextureKernelParams& p)
+{
+    int func_idx = p.filterMode;
+    if (p.boundaryMode == TEX_BOUNDARY_MODE_CUBE)
+        func_idx += TEX_MODE_COUNT; // Cube variant.
+    if (p.enableMip && !p.uvDA)
+        func_idx += TEX_MODE_COUNT * 2; // Bias-only variant.
+    return func_idx;
+}
+
+// The mip pyramid is built in a single sweep over base level tiles. Each
+// tile is sized to stay in L2 and is downsampled through every level
+// whose texel footprint fits inside it, reading back the level it has just
+// written. Only the few levels coarser than a tile are built afterwards,
+// level by level. Extents halve exactly (see calculateMipInfo), so level
+// texel footprints are powers of two that never straddle a tile.
+
+#define TEX_CPU_MIP_TILE_BYTES      (1 << 18)   // Target base level tile size.
+
+void TextureCpuBuildMip(const TextureKernelParams& p, ThreadPool& pool)
+{
+    typedef void (*MipBuildSpanFunc)(const TextureKernelParams& p, int level, int px0, int px1, int py, int pz);
+    static const MipBuildSpanFunc func_tbl[3] = { TextureCpuBuildMipSpan<1>, TextureCpuBuildMipSpan<2>, TextureCpuBuildMipSpan<4> };
+    MipBuildSpanFunc func = func_tbl[textureCpuChannelDivIdx(p)];
+    if (p.mipLevelMax < 1)
+        return;
+
+    // Tile size: largest power-of-two square within the byte budget, clamped
+    // to the texture and widened along the other axis if clamped.
+    int tileTexels = std::max(1, TEX_CPU_MIP_TILE_BYTES / (int)(p.channels * sizeof(float)));
+    int side = 1;
+    while (side * side * 4 <= tileTexels)
+        side <<= 1;
+    int tw = std::min(side, p.texWidth);
+    int th = 1;
+    while (th * 2 * tw <= tileTexels)
+        th <<= 1;
+    th = std::min(th, p.texHeight);
+    if (th == p.texHeight)
+    {
+        // Short texture, trade height for width.
+        while (tw * 2 * th <= tileTexels && tw < p.texWidth)
+            tw <<= 1;
+        tw = std::min(tw, p.texWidth);
+    }
+
+    // Last level whose texel footprint fits inside a tile.
+    int tileLevels = 0;
+    for (int level=1; level <= p.mipLevelMax; level++)
+    {
+        int w, h;
+        mipLevelSizeHost(p, level, w, h);
+        if (p.texWidth / w > tw || p.texHeight / h > th)
+            break;
+        tileLevels = level;
+    }
+
+    // Tiled sweep.
+    int depth  = p.texDepth * ((p.boundaryMode == TEX_BOUNDARY_MODE_CUBE) ? 6 : 1);
+    int tilesX = (p.texWidth  + tw - 1) / tw;
+    int tilesY = (p.texHeight + th - 1) / th;
+    pool.run(tilesX * tilesY * depth, [&](int taskIdx, int)
+    {
+        int x0 = (taskIdx % tilesX) * tw;
+        int y0 = ((taskIdx / tilesX) % tilesY) * th;
+        int pz = taskIdx / (tilesX * tilesY);
+        int x1 = std::min(x0 + tw, p.texWidth);
+        int y1 = std::min(y0 + th, p.texHeight);
+        for (int level=1; level <= tileLevels; level++)
+        {
+            // Tile region in this level.
+            int w, h;
+            mipLevelSizeHost(p, level, w, h);
+            int sx = p.texWidth / w;
+            int sy = p.texHeight / h;
+            for (int py = y0 / sy; py < y1 / sy; py++)
+                func(p, level, x0 / sx, x1 / sx, py, pz);
+        }
+    });
+
+    // Remaining coarse levels depend on several tiles.
+    for (int level=tileLevels+1; level <= p.mipLevelMax; level++)
+    {
+        int w, h;
+        mipLevelSizeHost(p, level, w, h);
+        int rows  = h * depth;
+        int grain = std::max(1, rows / (pool.getNumThreads() * 4));
+        pool.parallelFor(0, rows, grain, [&](int begin, int end, int)
+        {
+            for (int i = begin; i < end; i++)
+                func(p, level, 0, w, i % h, i / h);
+        });
+    }
+}
+
+void TextureCpuFwd(const TextureKernelParams& p, ThreadPool& pool)
+{
+    static const TextureCpuRowFunc func_tbl[TEX_MODE_COUNT * 2 * 2 * 3] = {
+        TextureCpuFwdRow<1, false, false, TEX_MODE_NEAREST>,
+        TextureCpuFwdRow<2, false, false, TEX_MODE_NEAREST>,
+        TextureCpuFwdRow<4, false, false, TEX_MODE_NEAREST>,
+        TextureCpuFwdRow<1, false, false, TEX_MODE_LINEAR>,
+        TextureCpuFwdRow<2, false, false, TEX_MODE_LINEAR>,
+        TextureCpuFwdRow<4, false, false, TEX_MODE_LINEAR>,
+        TextureCpuFwdRow<1, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<2, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<4, false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<1, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<2, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<4, false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<1, true,  false, TEX_MODE_NEAREST>,
+        TextureCpuFwdRow<2, true,  false, TEX_MODE_NEAREST>,
+        TextureCpuFwdRow<4, true,  false, TEX_MODE_NEAREST>,
+        TextureCpuFwdRow<1, true,  false, TEX_MODE_LINEAR>,
+        TextureCpuFwdRow<2, true,  false, TEX_MODE_LINEAR>,
+        TextureCpuFwdRow<4, true,  false, TEX_MODE_LINEAR>,
+        TextureCpuFwdRow<1, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<2, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<4, true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<1, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<2, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<4, true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        TextureCpuFwdRow<1, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<2, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<4, false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<1, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<2, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<4, false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        TextureCpuFwdRow<1, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<2, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<4, true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuFwdRow<1, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<2, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuFwdRow<4, true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+    };
+    TextureCpuRowFunc func = func_tbl[textureCpuFuncIdx(p) * 3 + textureCpuChannelDivIdx(p)];
+
+    // Distribute image rows over the pool.
+    int height = p.imgHeight;
+    int rows   = height * p.n;
+    int grain  = std::max(1, rows / (pool.getNumThreads() * 4));
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+            func(p, i % height, i / height);
+    });
+}
+
+//------------------------------------------------------------------------
+// Gradient scatter without atomics. Every mip level is cut into square
+// tiles, and the tiles are dealt out round-robin to owner bins. The pixel
+// pass writes the per-pixel gradients directly and emits a splat record
+// into the bin of each tile its footprint touches. A footprint straddling
+// a tile border yields one record per bin, each with the mask of the quad
+// texels that bin owns. The owner pass then replays every bin on exactly
+// one thread, so grad_tex is only ever written by the owner of the texel.
+
+#define TEX_CPU_GRAD_TILE_LOG2      6           // Ownership tiles are 64x64 texels.
+#define TEX_CPU_GRAD_TASK_PIXELS    (1 << 14)   // Pixels per pixel pass task.
+#define TEX_CPU_GRAD_CHUNK_PIXELS   (1 << 20)   // Pixels per pixel pass / owner pass round. Bounds the splat storage.
+
+struct TexGradSplat
+{
+    int                 pidx;       // Pixel index.
+    short               level;      // Mip level.
+    short               mask;       // Quad texels owned by the bin, one bit per tc entry.
+    float               scale;      // Level weight that dy is multiplied with.
+};
+
+struct TexGradOwners
+{
+    int                 numBins;
+    int                 tileOfs     [TEX_MAX_MIP_LEVEL];
+    int                 tilesX      [TEX_MAX_MIP_LEVEL];
+    int                 tilesY      [TEX_MAX_MIP_LEVEL];
+    int                 width       [TEX_MAX_MIP_LEVEL];
+    int                 height      [TEX_MAX_MIP_LEVEL];
+
+    int binOf(int level, int tc) const
+    {
+        int w = width[level];
+        int h = height[level];
+        int x = tc % w;
+        int y = (tc / w) % h;
+        int z = tc / (w * h);
+        int tile = tileOfs[level] + (z * tilesY[level] + (y >> TEX_CPU_GRAD_TILE_LOG2)) * tilesX[level] + (x >> TEX_CPU_GRAD_TILE_LOG2);
+        return tile % numBins;
+    }
+
+    // Emit one record per distinct owner bin among the valid entries of tc.
+    void emit(std::vector<TexGradSplat>* bins, int pidx, int level, float scale, const int* tc, int n) const
+    {
+        int bin[4];
+        for (int i=0; i < n; i++)
+            bin[i] = (tc[i] >= 0) ? binOf(level, tc[i]) : -1;
+        for (int i=0; i < n; i++)
+        {
+            if (bin[i] < 0)
+                continue;
+            int mask = 0;
+            for (int j=i; j < n; j++)
+            {
+                if (bin[j] == bin[i])
+                {
+                    mask |= 1 << j;
+                    if (j > i)
+                        bin[j] = -1; // Handled by this record.
+                }
+            }
+            TexGradSplat s = { pidx, (short)level, (short)mask, scale };
+            bins[bin[i]].push_back(s);
+        }
+    }
+};
+
+// Pixel pass, one image row per call. Same math as TextureGradKernelTemplate
+// except that texture gradients are emitted as splats.
+
+template <bool CUBE_MODE, bool BIAS_ONLY, int FILTER_MODE>
+static void TextureCpuGradRow(const TextureKernelParams& p, int py, int pz, const TexGradOwners& owners, std::vector<TexGradSplat>* bins)
+{
+    int tz = (p.texDepth == 1) ? 0 : pz;
+
+    for (int px=0; px < p.imgWidth; px++)
+    {
+        // Pixel index.
+        int pidx = px + p.imgWidth * (py + p.imgHeight * pz);
+
+        // Early exit if output gradients are zero.
+        const float* pDy = (const float*)p.dy + (size_t)pidx * p.channels;
+        unsigned int dmax = 0u;
+        for (int i=0; i < p.channels; i++)
+        {
+            unsigned int u;
+            memcpy(&u, &pDy[i], 4);
+            dmax |= u;
+        }
+
+        // Store zeros and exit.
+        if ((dmax << 1) == 0u)
+        {
+            int uvSize = CUBE_MODE ? 3 : 2;
+            if (FILTER_MODE != TEX_MODE_NEAREST)
+                for (int i=0; i < uvSize; i++)
+                    p.gradUV[uvSize * pidx + i] = 0.f;
+            if (FILTER_MODE == TEX_MODE_LINEAR_MIPMAP_LINEAR)
+            {
+                if (p.gradUVDA)
+                    for (int i=0; i < 2 * uvSize; i++)
+                        p.gradUVDA[2 * uvSize * pidx + i] = 0.f;
+                if (p.gradMipLevelBias)
+                    p.gradMipLevelBias[pidx] = 0.f;
+            }
+            continue;
+        }
+
+        // Get UV.
+        float uv[3];
+        if (CUBE_MODE)
+        {
+            uv[0] = p.uv[3 * pidx + 0];
+            uv[1] = p.uv[3 * pidx + 1];
+            uv[2] = p.uv[3 * pidx + 2];
+        }
+        else
+        {
+            uv[0] = p.uv[2 * pidx + 0];
+            uv[1] = p.uv[2 * pidx + 1];
+            uv[2] = 0.f;
+        }
+
+        // Nearest mode - texture gradients only.
+        if (FILTER_MODE == TEX_MODE_NEAREST)
+        {
+            int tc = indexTextureNearest<CUBE_MODE>(p, uv, tz);
+            if (tc >= 0)
+                owners.emit(bins, pidx, 0, 1.f, &tc, 1);
+            continue;
+        }
+
+        // Calculate mip level. In 'linear' mode these will all stay zero.
+        float  dw[4] = { 0.f, 0.f, 0.f, 0.f };
+        float  dfdv[3] = { 0.f, 0.f, 0.f };
+        float  flevel = 0.f; // Fractional level.
+        int    level0 = 0;   // Discrete level 0.
+        int    level1 = 0;   // Discrete level 1.
+        calculateMipLevel<CUBE_MODE, BIAS_ONLY, FILTER_MODE>(level0, level1, flevel, p, pidx, uv, dw, dfdv);
+
+        // UV gradient accumulators.
+        float gu = 0.f;
+        float gv = 0.f;
+
+        // Get texel indices and pointer for level 0.
+        int tc0[4] = {0, 0, 0, 0};
+        float u0, v0;
+        indexTextureLinear<CUBE_MODE>(p, uv, tz, tc0, u0, v0, level0);
+        const float* pIn0 = (const float*)p.tex[level0];
+        bool corner0 = CUBE_MODE && ((tc0[0] | tc0[1] | tc0[2] | tc0[3]) < 0);
+
+        // Texture gradients for level 0.
+        bool trilinear = (FILTER_MODE == TEX_MODE_LINEAR_MIPMAP_LINEAR);
+        owners.emit(bins, pidx, level0, trilinear ? (1.f - flevel) : 1.f, tc0, 4);
+        for (int j=0; j < 4; j++)
+            tc0[j] *= p.channels;
+
+        // Attribute weights.
+        int w0, h0;
+        mipLevelSizeHost(p, level0, w0, h0);
+        float sclu0 = (float)w0;
+        float sclv0 = (float)h0;
+
+        // Bilinear mode - uv gradients.
+        if (!trilinear)
+        {
+            for (int i=0; i < p.channels; i++)
+            {
+                float dy = pDy[i];
+                TexVec<1> a00, a10, a01, a11;
+                fetchQuad<1>(a00, a10, a01, a11, pIn0 + i, tc0, corner0);
+                float ad = (a11.v[0] + a00.v[0] - a10.v[0] - a01.v[0]);
+                gu += dy * ((a10.v[0] - a00.v[0]) + v0 * ad) * sclu0;
+                gv += dy * ((a01.v[0] - a00.v[0]) + u0 * ad) * sclv0;
+            }
+
+            // Store UV gradients and exit.
+            if (CUBE_MODE)
+                indexCubeMapGrad(p.gradUV + 3 * pidx, uv, gu, gv);
+            else
+            {
+                p.gradUV[2 * pidx + 0] = gu;
+                p.gradUV[2 * pidx + 1] = gv;
+            }
+            continue;
+        }
+
+        // Accumulate fractional mip level gradient.
+        float df = 0; // dL/df.
+
+        // Get texel indices and pointer for level 1.
+        int tc1[4] = {0, 0, 0, 0};
+        float u1, v1;
+        indexTextureLinear<CUBE_MODE>(p, uv, tz, tc1, u1, v1, level1);
+        const float* pIn1 = (const float*)p.tex[level1];
+        bool corner1 = CUBE_MODE && ((tc1[0] | tc1[1] | tc1[2] | tc1[3]) < 0);
+
+        // Texture gradients for level 1 unless in magnification mode.
+        if (flevel > 0.f)
+            owners.emit(bins, pidx, level1, flevel, tc1, 4);
+        for (int j=0; j < 4; j++)
+            tc1[j] *= p.channels;
+
+        // Attribute weights.
+        int w1, h1;
+        mipLevelSizeHost(p, level1, w1, h1);
+        float sclu1 = (float)w1;
+        float sclv1 = (float)h1;
+
+        // Trilinear mode.
+        for (int i=0; i < p.channels; i++)
+        {
+            float dy = pDy[i];
+            float dy0 = (1.f - flevel) * dy;
+
+            // UV gradients for first level.
+            TexVec<1> a00, a10, a01, a11;
+            fetchQuad<1>(a00, a10, a01, a11, pIn0 + i, tc0, corner0);
+            float ad = (a11.v[0] + a00.v[0] - a10.v[0] - a01.v[0]);
+            gu += dy0 * ((a10.v[0] - a00.v[0]) + v0 * ad) * sclu0;
+            gv += dy0 * ((a01.v[0] - a00.v[0]) + u0 * ad) * sclv0;
+
+            // Second level unless in magnification mode.
+            if (flevel > 0.f)
+            {
+                // UV gradients for second level.
+                float dy1 = flevel * dy;
+                TexVec<1> b00, b10, b01, b11;
+                fetchQuad<1>(b00, b10, b01, b11, pIn1 + i, tc1, corner1);
+                float bd = (b11.v[0] + b00.v[0] - b10.v[0] - b01.v[0]);
+                gu += dy1 * ((b10.v[0] - b00.v[0]) + v1 * bd) * sclu1;
+                gv += dy1 * ((b01.v[0] - b00.v[0]) + u1 * bd) * sclv1;
+
+                // Mip level gradient.
+                float a = bilerp(a00, a10, a01, a11, u0, v0).v[0];
+                float b = bilerp(b00, b10, b01, b11, u1, v1).v[0];
+                df += (b-a) * dy;
+            }
+        }
+
+        // Store UV gradients.
+        if (CUBE_MODE)
+        {
+            indexCubeMapGrad(p.gradUV + 3 * pidx, uv, gu, gv);
+            for (int j=0; j < 3; j++)
+                p.gradUV[3 * pidx + j] += dfdv[j] * df;
+        }
+        else
+        {
+            p.gradUV[2 * pidx + 0] = gu;
+            p.gradUV[2 * pidx + 1] = gv;
+        }
+
+        // Store mip level bias gradient.
+        if (p.gradMipLevelBias)
+            p.gradMipLevelBias[pidx] = df;
+
+        // Store UV pixel differential gradients.
+        if (!BIAS_ONLY)
+        {
+            // Final gradients.
+            for (int j=0; j < 4; j++)
+                dw[j] *= df; // dL/(d{s,y}/d{X,Y}) = df/(d{s,y}/d{X,Y}) * dL/df.
+
+            // Store them.
+            if (CUBE_MODE)
+            {
+                // Remap from dL/(d{s,t}/s{X,Y}) to dL/(d{x,y,z}/d{X,Y}).
+                float g0[3], g1[3];
+                indexCubeMapGrad4(uv, dw, g0, g1);
+                for (int j=0; j < 3; j++)
+                {
+                    p.gradUVDA[6 * pidx + 2 * j + 0] = g0[j];
+                    p.gradUVDA[6 * pidx + 2 * j + 1] = g1[j];
+                }
+            }
+            else
+            {
+                for (int j=0; j < 4; j++)
+                    p.gradUVDA[4 * pidx + j] = dw[j];
+            }
+        }
+    }
+}
+
+// Owner pass. Recomputes the footprint of a splat and accumulates into the
+// texels selected by its mask, weighted like accumQuad() in texture.cu.
+
+template <bool CUBE_MODE, bool NEAREST>
+static void TextureCpuGradSplat(const TextureKernelParams& p, const TexGradSplat& s)
+{
+    // Pixel and layer.
+    int pidx = s.pidx;
+    int pz = pidx / (p.imgWidth * p.imgHeight);
+    int tz = (p.texDepth == 1) ? 0 : pz;
+    const float* pDy = (const float*)p.dy + (size_t)pidx * p.channels;
+    float* pOut = p.gradTex[s.level];
+
+    // Get UV.
+    float uv[3];
+    if (CUBE_MODE)
+    {
+        uv[0] = p.uv[3 * pidx + 0];
+        uv[1] = p.uv[3 * pidx + 1];
+        uv[2] = p.uv[3 * pidx + 2];
+    }
+    else
+    {
+        uv[0] = p.uv[2 * pidx + 0];
+        uv[1] = p.uv[2 * pidx + 1];
+        uv[2] = 0.f;
+    }
+
+    // Nearest mode.
+    if (NEAREST)
+    {
+        float* pt = pOut + (size_t)indexTextureNearest<CUBE_MODE>(p, uv, tz) * p.channels;
+        for (int i=0; i < p.channels; i++)
+            pt[i] += pDy[i];
+        return;
+    }
+
+    // Texel indices and weights.
+    int tc[4];
+    float fu, fv;
+    indexTextureLinear<CUBE_MODE>(p, uv, tz, tc, fu, fv, s.level);
+    float uv11 = fu * fv;
+    float uv10 = fu - uv11;
+    float uv01 = fv - uv11;
+    float uv00 = 1.f - fu - uv01;
+    float tw[4] = { uv00, uv10, uv01, uv11 };
+
+    // In a cube map corner, the weight of the missing texel is spread over the others.
+    bool corner = CUBE_MODE && ((tc[0] | tc[1] | tc[2] | tc[3]) < 0);
+    float twb = 0.f;
+    if (corner)
+        for (int j=0; j < 4; j++)
+            if (tc[j] < 0)
+                twb = tw[j];
+
+    // Accumulate owned texels.
+    for (int j=0; j < 4; j++)
+    {
+        if (!(s.mask & (1 << j)))
+            continue;
+
+        float* pt = pOut + (size_t)tc[j] * p.channels;
+        if (corner)
+        {
+            for (int i=0; i < p.channels; i++)
+            {
+                float dy = s.scale * pDy[i];
+                pt[i] += tw[j] * dy + (twb * dy) * 0.33333333f;
+            }
+        }
+        else
+        {
+            for (int i=0; i < p.channels; i++)
+                pt[i] += tw[j] * (s.scale * pDy[i]);
+        }
+    }
+}
+
+// Mip gradient puller, one base level row per call. Same as MipGradKernelTemplate.
+
+static void TextureCpuMipGradRow(const TextureKernelParams& p, int py, int pz, float* accum)
+{
+    for (int px=0; px < p.texWidth; px++)
+    {
+        // Clear the texel.
+        for (int i=0; i < p.channels; i++)
+            accum[i] = 0.f;
+
+        // Track texel position and accumulation weight over the mip stack.
+        int x = px;
+        int y = py;
+        float w = 1.f;
+
+        // Pull gradients from all levels.
+        int szx, szy; // Previous level size.
+        mipLevelSizeHost(p, 0, szx, szy);
+        for (int level=1; level <= p.mipLevelMax; level++)
+        {
+            // Weight decay depends on previous level size.
+            if (szx > 1) w *= .5f;
+            if (szy > 1) w *= .5f;
+
+            // Current level size and coordinates.
+            mipLevelSizeHost(p, level, szx, szy);
+            x >>= 1;
+            y >>= 1;
+
+            const float* pIn = p.gradTex[level] + (size_t)(x + szx * (y + szy * pz)) * p.channels;
+            for (int i=0; i < p.channels; i++)
+                accum[i] += pIn[i] * w;
+        }
+
+        // Add to main texture gradients.
+        float* pOut = p.gradTex[0] + (size_t)(px + p.texWidth * (py + p.texHeight * pz)) * p.channels;
+        for (int i=0; i < p.channels; i++)
+            pOut[i] += accum[i];
+    }
+}
+
+void TextureCpuGrad(const TextureKernelParams& p, ThreadPool& pool)
+{
+    typedef void (*GradRowFunc)(const TextureKernelParams& p, int py, int pz, const TexGradOwners& owners, std::vector<TexGradSplat>* bins);
+    typedef void (*GradSplatFunc)(const TextureKernelParams& p, const TexGradSplat& s);
+    static const GradRowFunc func_tbl[TEX_MODE_COUNT * 2 * 2] = {
+        TextureCpuGradRow<false, false, TEX_MODE_NEAREST>,
+        TextureCpuGradRow<false, false, TEX_MODE_LINEAR>,
+        TextureCpuGradRow<false, false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuGradRow<false, false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        TextureCpuGradRow<true,  false, TEX_MODE_NEAREST>,
+        TextureCpuGradRow<true,  false, TEX_MODE_LINEAR>,
+        TextureCpuGradRow<true,  false, TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuGradRow<true,  false, TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        NULL,
+        NULL,
+        TextureCpuGradRow<false, true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuGradRow<false, true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+        NULL,
+        NULL,
+        TextureCpuGradRow<true,  true,  TEX_MODE_LINEAR_MIPMAP_NEAREST>,
+        TextureCpuGradRow<true,  true,  TEX_MODE_LINEAR_MIPMAP_LINEAR>,
+    };
+    static const GradSplatFunc splat_func_tbl[4] = {
+        TextureCpuGradSplat<false, false>,
+        TextureCpuGradSplat<false, true>,
+        TextureCpuGradSplat<true,  false>,
+        TextureCpuGradSplat<true,  true>,
+    };
+    bool cube = (p.boundaryMode == TEX_BOUNDARY_MODE_CUBE);
+    GradRowFunc func = func_tbl[textureCpuFuncIdx(p)];
+    GradSplatFunc splat_func = splat_func_tbl[(cube ? 2 : 0) + (p.filterMode == TEX_MODE_NEAREST ? 1 : 0)];
+
+    // Tile layout of all levels that can receive gradients.
+    TexGradOwners owners;
+    int levels = p.enableMip ? p.mipLevelMax + 1 : 1;
+    int depth  = p.texDepth * (cube ? 6 : 1);
+    int tiles  = 0;
+    for (int i=0; i < levels; i++)
+    {
+        mipLevelSizeHost(p, i, owners.width[i], owners.height[i]);
+        owners.tilesX[i]  = (owners.width[i]  + (1 << TEX_CPU_GRAD_TILE_LOG2) - 1) >> TEX_CPU_GRAD_TILE_LOG2;
+        owners.tilesY[i]  = (owners.height[i] + (1 << TEX_CPU_GRAD_TILE_LOG2) - 1) >> TEX_CPU_GRAD_TILE_LOG2;
+        owners.tileOfs[i] = tiles;
+        tiles += owners.tilesX[i] * owners.tilesY[i] * depth;
+    }
+    owners.numBins = std::max(1, std::min(tiles, pool.getNumThreads() * 4));
+
+    // Image rows are processed in chunks of fixed-size tasks. Records are
+    // binned per task, and the owner replays the tasks in order, so the
+    // summation order does not depend on the thread count.
+    int height       = p.imgHeight;
+    int rows         = height * p.n;
+    int taskRows     = std::max(1, TEX_CPU_GRAD_TASK_PIXELS / p.imgWidth);
+    int chunkTasks   = std::max(1, TEX_CPU_GRAD_CHUNK_PIXELS / (taskRows * p.imgWidth));
+    int chunkRows    = taskRows * chunkTasks;
+    std::vector<std::vector<TexGradSplat> > bins((size_t)std::min(chunkTasks, (rows + taskRows - 1) / taskRows) * owners.numBins);
+
+    for (int chunkBegin = 0; chunkBegin < rows; chunkBegin += chunkRows)
+    {
+        int chunkEnd = std::min(chunkBegin + chunkRows, rows);
+        int numTasks = (chunkEnd - chunkBegin + taskRows - 1) / taskRows;
+
+        // Pixel pass.
+        pool.run(numTasks, [&](int taskIdx, int)
+        {
+            std::vector<TexGradSplat>* taskBins = &bins[(size_t)taskIdx * owners.numBins];
+            int begin = chunkBegin + taskIdx * taskRows;
+            int end   = std::min(begin + taskRows, chunkEnd);
+            for (int i = begin; i < end; i++)
+                func(p, i % height, i / height, owners, taskBins);
+        });
+
+        // Owner pass.
+        pool.run(owners.numBins, [&](int binIdx, int)
+        {
+            for (int t=0; t < numTasks; t++)
+            {
+                std::vector<TexGradSplat>& b = bins[(size_t)t * owners.numBins + binIdx];
+                for (size_t i=0; i < b.size(); i++)
+                    splat_func(p, b[i]);
+                b.clear();
+            }
+        });
+    }
+}
+
+void TextureCpuMipGrad(const TextureKernelParams& p, ThreadPool& pool)
+{
+    // Every base level texel pulls from its own ancestors, no conflicts.
+    int depth = p.texDepth * ((p.boundaryMode == TEX_BOUNDARY_MODE_CUBE) ? 6 : 1);
+    int rows  = p.texHeight * depth;
+    int grain = std::max(1, rows / (pool.getNumThreads() * 4));
+    pool.parallelFor(0, rows, grain, [&](int begin, int end, int)
+    {
+        std::vector<float> accum(p.channels);
+        for (int i = begin; i < end; i++)
+            TextureCpuMipGradRow(p, i % p.texHeight, i / p.texHeight, &accum[0]);
+    });
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,194 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "threadpool.h"
+
+//------------------------------------------------------------------------
+
+// Workers of the pools whose tasks this thread is executing, innermost
+// first. Nested calls into one of them run inline as that worker.
+
+struct ThreadPoolFrame;
+static thread_local const ThreadPoolFrame* s_frame = NULL;
+
+struct ThreadPoolFrame
+{
+    const ThreadPool*       pool;
+    int                     threadIdx;
+    const ThreadPoolFrame*  outer;
+
+    ThreadPoolFrame(const ThreadPool* pool_, int threadIdx_) : pool(pool_), threadIdx(threadIdx_), outer(s_frame) { s_frame = this; }
+    ~ThreadPoolFrame(void) { s_frame = outer; }
+};
+
+//------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(int numThreads)
+:   m_numThreads    (numThreads),
+    m_generation    (0),
+    m_numActive     (0),
+    m_quit          (false),
+    m_func          (NULL),
+    m_numTasks      (0),
+    m_nextTask      (0)
+{
+    if (m_numThreads <= 0)
+        m_numThreads = (int)std::thread::hardware_concurrency();
+    if (m_numThreads <= 0)
+        m_numThreads = 1;
+
+    // Worker 0 is the thread that calls run().
+    for (int i=1; i < m_numThreads; i++)
+        m_workers.push_back(std::thread(&ThreadPool::workerMain, this, i));
+}
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wakeCond.notify_all();
+    for (size_t i=0; i < m_workers.size(); i++)
+        m_workers[i].join();
+}
+
+//------------------------------------------------------------------------
+
+ThreadPool& ThreadPool::getGlobal(void)
+{
+    static ThreadPool s_pool;
+    return s_pool;
+}
+
+//------------------------------------------------------------------------
+
+void ThreadPool::executeTasks(int threadIdx)
+{
+    ThreadPoolFrame frame(this, threadIdx);
+    for (;;)
+    {
+        int taskIdx = m_nextTask.fetch_add(1, std::memory_order_relaxed);
+        if (taskIdx >= m_numTasks)
+            break;
+
+        try
+        {
+            (*m_func)(taskIdx, threadIdx);
+        }
+        catch (...)
+        {
+            // Record the first failure and drain the remaining tasks.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_exception)
+                m_exception = std::current_exception();
+            m_nextTask.store(m_numTasks, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ThreadPool::workerMain(int threadIdx)
+{
+    unsigned long long seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCond.wait(lock, [&]{ return m_quit || m_generation != seen; });
+            if (m_quit)
+                return;
+            seen = m_generation;
+        }
+
+        executeTasks(threadIdx);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_numActive == 0)
+                m_doneCond.notify_one();
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+
+void ThreadPool::run(int numTasks, const TaskFunc& func)
+{
+    if (numTasks <= 0)
+        return;
+
+    // Nested calls run inline on the calling worker. The worker index is kept
+    // so that the caller's per-worker scratch memory stays private.
+    for (const ThreadPoolFrame* f = s_frame; f; f = f->outer)
+    {
+        if (f->pool == this)
+        {
+            for (int i=0; i < numTasks; i++)
+                func(i, f->threadIdx);
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+
+    // Small jobs, single-threaded pools and calls from inside the tasks of
+    // another pool run inline as worker 0.
+    if (numTasks == 1 || m_numThreads == 1 || s_frame)
+    {
+        ThreadPoolFrame frame(this, 0);
+        for (int i=0; i < numTasks; i++)
+            func(i, 0);
+        return;
+    }
+
+    // Publish the job and wake up the workers.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func      = &func;
+        m_numTasks  = numTasks;
+        m_exception = std::exception_ptr();
+        m_nextTask.store(0, std::memory_order_relaxed);
+        m_numActive = (int)m_workers.size();
+        m_generation++;
+    }
+    m_wakeCond.notify_all();
+
+    // Participate as worker 0, then wait for the others to drain.
+    executeTasks(0);
+    std::exception_ptr exception;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCond.wait(lock, [&]{ return m_numActive == 0; });
+        m_func = NULL;
+        exception = m_exception;
+        m_exception = std::exception_ptr();
+    }
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+//------------------------------------------------------------------------
+
+void ThreadPool::parallelFor(int begin, int end, int grain, const RangeFunc& func)
+{
+    if (end <= begin)
+        return;
+    if (grain < 1)
+        grain = 1;
+
+    int numTasks = (end - begin + grain - 1) / grain;
+    run(numTasks, [&](int taskIdx, int threadIdx)
+    {
+        int lo = begin + taskIdx * grain;
+        int hi = (end - lo < grain) ? end : lo + grain;
+        func(lo, hi, threadIdx);
+    });
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Persistent worker pool for the CPU code paths.
+//
+// A job consists of numTasks independent tasks that are handed out
+// dynamically to the workers, so uneven task costs balance out. The
+// calling thread participates as worker 0 and run() blocks until every
+// task has finished. Each task is given the index of the worker that
+// executes it, so that callers can keep per-worker scratch memory without
+// locking. Calls made from inside a task run inline on the calling worker
+// and keep its worker index.
+
+class ThreadPool
+{
+public:
+    typedef std::function<void(int taskIdx, int threadIdx)>        TaskFunc;
+    typedef std::function<void(int begin, int end, int threadIdx)> RangeFunc;
+
+                            ThreadPool          (int numThreads = 0);   // Zero = one worker per hardware thread.
+                            ~ThreadPool         (void);
+
+    int                     getNumThreads       (void) const { return m_numThreads; }
+    void                    run                 (int numTasks, const TaskFunc& func);
+    void                    parallelFor         (int begin, int end, int grain, const RangeFunc& func); // Splits [begin, end) into chunks of at most grain items.
+
+    static ThreadPool&      getGlobal           (void); // Shared pool for ops that are not tied to a context.
+
+private:
+                            ThreadPool          (const ThreadPool&); // forbidden
+    ThreadPool&             operator=           (const ThreadPool&); // forbidden
+
+    void                    workerMain          (int threadIdx);
+    void                    executeTasks        (int threadIdx);
+
+    int                     m_numThreads;
+    std::vector<std::thread> m_workers;
+
+    std::mutex              m_runMutex;         // Serializes concurrent run() calls from different host threads.
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeCond;
+    std::condition_variable m_doneCond;
+    unsigned long long      m_generation;       // Incremented for every job.
+    int                     m_numActive;        // Workers that have not yet finished the current job.
+    bool                    m_quit;
+
+    const TaskFunc*         m_func;
+    int                     m_numTasks;
+    std::atomic<int>        m_nextTask;
+    std::exception_ptr      m_exception;        // First exception thrown by a task, rethrown by run().
+};
+
+//------------------------------------------------------------------------
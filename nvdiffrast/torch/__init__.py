@@ -6,5 +6,5 @@
 # distribution of this software and related documentation without an express
 # license agreement from NVIDIA CORPORATION is strictly prohibited.
 
-from .ops import RasterizeCudaContext, RasterizeGLContext, get_log_level, set_log_level, rasterize, DepthPeeler, interpolate, texture, texture_construct_mip, antialias, antialias_construct_topology_hash
-__all__ = ["RasterizeCudaContext", "RasterizeGLContext", "get_log_level", "set_log_level", "rasterize", "DepthPeeler", "interpolate", "texture", "texture_construct_mip", "antialias", "antialias_construct_topology_hash"]
+from .ops import RasterizeCudaContext, RasterizeCpuContext, RasterizeGLContext, get_log_level, set_log_level, set_profiling, profiling_stats, write_profiling_trace, rasterize, CompactRast, DepthPeeler, interpolate, texture, texture_construct_mip, antialias, antialias_construct_topology_hash
+__all__ = ["RasterizeCudaContext", "RasterizeCpuContext", "RasterizeGLContext", "get_log_level", "set_log_level", "set_profiling", "profiling_stats", "write_profiling_trace", "rasterize", "CompactRast", "DepthPeeler", "interpolate", "texture", "texture_construct_mip", "antialias", "antialias_construct_topology_hash"]
@@ -25,9 +25,13 @@ _cached_plugin = {}
 def _get_plugin(gl=False):
     assert isinstance(gl, bool)
 
+    # Without Cuda, build only the CPU code paths. This needs no Cuda toolkit.
+    cpu_only = (not gl) and (not torch.cuda.is_available())
+    plugin_key = 'gl' if gl else ('cpu' if cpu_only else 'cuda')
+
     # Return cached plugin if already loaded.
-    if _cached_plugin.get(gl, None) is not None:
-        return _cached_plugin[gl]
+    if _cached_plugin.get(plugin_key, None) is not None:
+        return _cached_plugin[plugin_key]
 
     # Make sure we can find the necessary compiler and libary binaries.
     if os.name == 'nt':
@@ -54,9 +58,13 @@ def _get_plugin(gl=False):
 
     # Compiler options.
     common_opts = ['-DNVDR_TORCH']
+    if cpu_only:
+        common_opts += ['-DNVDR_CPU_ONLY']
     cc_opts = []
     if os.name == 'nt':
         cc_opts += ['/wd4067', '/wd4624'] # Disable warnings in torch headers.
+    elif os.name == 'posix':
+        cc_opts += ['-ffp-contract=off'] # CPU ops place their fused multiply-adds explicitly to match the GPU results.
 
     # Linker options for the GL-interfacing plugin.
     ldflags = []
@@ -76,20 +84,55 @@ def _get_plugin(gl=False):
             'torch_bindings_gl.cpp',
             'torch_rasterize_gl.cpp',
         ]
+    elif cpu_only:
+        source_files = [
+            '../common/texture.cpp',
+            '../common/threadpool.cpp',
+            '../common/profiler.cpp',
+            '../common/cpuisa.cpp',
+            '../common/cpuraster/impl/CpuRaster.cpp',
+            '../common/cpuraster/impl/CpuCoverage.cpp',
+            '../common/cpuraster/impl/CpuRasterImpl.cpp',
+            '../common/rasterize_cpu.cpp',
+            '../common/interpolate_cpu.cpp',
+            '../common/texture_cpu.cpp',
+            '../common/antialias_cpu.cpp',
+            'torch_bindings.cpp',
+            'torch_rasterize.cpp',
+            'torch_rasterize_cpu.cpp',
+            'torch_interpolate.cpp',
+            'torch_texture.cpp',
+            'torch_antialias.cpp',
+        ]
     else:
         source_files = [
+            '../common/cudaraster/impl/Allocator.cpp',
             '../common/cudaraster/impl/Buffer.cpp',
+            '../common/cudaraster/impl/CapacityPredictor.cpp',
             '../common/cudaraster/impl/CudaRaster.cpp',
+            '../common/cudaraster/impl/DriverAllocator.cpp',
             '../common/cudaraster/impl/RasterImpl.cu',
             '../common/cudaraster/impl/RasterImpl.cpp',
+            '../common/cudaraster/impl/RasterPlanner.cpp',
             '../common/common.cpp',
             '../common/rasterize.cu',
             '../common/interpolate.cu',
             '../common/texture.cu',
             '../common/texture.cpp',
             '../common/antialias.cu',
+            '../common/threadpool.cpp',
+            '../common/profiler.cpp',
+            '../common/cpuisa.cpp',
+            '../common/cpuraster/impl/CpuRaster.cpp',
+            '../common/cpuraster/impl/CpuCoverage.cpp',
+            '../common/cpuraster/impl/CpuRasterImpl.cpp',
+            '../common/rasterize_cpu.cpp',
+            '../common/interpolate_cpu.cpp',
+            '../common/texture_cpu.cpp',
+            '../common/antialias_cpu.cpp',
             'torch_bindings.cpp',
             'torch_rasterize.cpp',
+            'torch_rasterize_cpu.cpp',
             'torch_interpolate.cpp',
             'torch_texture.cpp',
             'torch_antialias.cpp',
@@ -103,7 +146,7 @@ def _get_plugin(gl=False):
         logging.getLogger('nvdiffrast').warning("Warning: libGLEW is being loaded via LD_PRELOAD, and will probably conflict with the OpenGL plugin")
 
     # Try to detect if a stray lock file is left in cache directory and show a warning. This sometimes happens on Windows if the build is interrupted at just the right moment.
-    plugin_name = 'nvdiffrast_plugin' + ('_gl' if gl else '')
+    plugin_name = 'nvdiffrast_plugin' + ('_gl' if gl else '_cpu' if cpu_only else '')
     try:
         lock_fn = os.path.join(torch.utils.cpp_extension._get_build_directory(plugin_name, False), 'lock')
         if os.path.exists(lock_fn):
@@ -126,7 +169,7 @@ def _get_plugin(gl=False):
             pass
 
     # sync header files
-    if is_rocm:
+    if is_rocm and not cpu_only:
         cuda_raster_impl_dir = Path(Path(__file__).resolve().parent, "../common/cudaraster/impl")
         cuda_raster_dir = Path(Path(__file__).resolve().parent, "../common/cudaraster")
         hip_raster_impl_dir = Path(Path(__file__).resolve().parent, "../common/hipraster/impl")
@@ -155,11 +198,11 @@ def _get_plugin(gl=False):
     if is_rocm:
         cuda_opts += ['-DUSE_HIP', '-DGFX942_SUPPORTED']
 
-    torch.utils.cpp_extension.load(name=plugin_name, sources=source_paths, extra_cflags=common_opts+cc_opts, extra_cuda_cflags=common_opts+cuda_opts, extra_ldflags=ldflags, with_cuda=True, verbose=False)
+    torch.utils.cpp_extension.load(name=plugin_name, sources=source_paths, extra_cflags=common_opts+cc_opts, extra_cuda_cflags=common_opts+cuda_opts, extra_ldflags=ldflags, with_cuda=not cpu_only, verbose=False)
 
     # Import, cache, and return the compiled module.
-    _cached_plugin[gl] = importlib.import_module(plugin_name)
-    return _cached_plugin[gl]
+    _cached_plugin[plugin_key] = importlib.import_module(plugin_name)
+    return _cached_plugin[plugin_key]
 
 #----------------------------------------------------------------------------
 # Log level.
@@ -190,6 +233,56 @@ def set_log_level(level):
     '''
     _get_plugin().set_log_level(level)
 
+#----------------------------------------------------------------------------
+# Profiling.
+#----------------------------------------------------------------------------
+
+def set_profiling(sample_rate):
+    '''Enable or disable timing of op stages.
+
+    Each sampled op call records its host-side stages, such as input checks,
+    and the GPU time of the kernels it launches. Kernel times are read back
+    lazily, so profiling does not synchronize the GPU during the op. Profiling
+    is off by default, and costs a single flag test per stage while off.
+
+    Args:
+      sample_rate: Fraction of op calls to record. 1.0 records every call,
+                   0.0 disables profiling. Recorded calls are spread evenly,
+                   e.g., 0.3 records 3 of every 10 calls. Records made so far
+                   are kept.
+    '''
+    _get_plugin().profiler_enable(float(sample_rate))
+
+def profiling_stats(reset=False):
+    '''Get timing statistics of recorded stages.
+
+    Waits for the kernels of recorded op calls to finish. Percentiles are
+    computed from a random sample of up to 4096 durations per stage.
+
+    Args:
+      reset: If True, drop all records after reading them.
+
+    Returns:
+      Dictionary from stage name to a dictionary with keys `count`, `total_us`,
+      `mean_us`, `p50_us`, `p90_us`, `p99_us`, and `max_us`.
+    '''
+    stats = _get_plugin().profiler_stats()
+    if reset:
+        _get_plugin().profiler_reset()
+    return stats
+
+def write_profiling_trace(path):
+    '''Write recent stage records as a Chrome trace.
+
+    The file can be opened in chrome://tracing or Perfetto. Host threads and
+    GPUs are shown as separate tracks. Only the most recent records are kept.
+
+    Args:
+      path: Output file path.
+    '''
+    if not _get_plugin().profiler_write_trace(str(path)):
+        raise RuntimeError("could not write profiling trace to '%s'" % path)
+
 #----------------------------------------------------------------------------
 # CudaRaster state wrapper.
 #----------------------------------------------------------------------------
@@ -218,6 +311,152 @@ class RasterizeCudaContext:
         self.output_db = True
         self.active_depth_peeler = None
 
+    def allocator_stats(self, reset=False):
+        '''Return counters of internal buffer allocations made by the context.
+
+        Internal buffers are taken from the PyTorch caching allocator and only grow,
+        so a loop that repeats the same workload performs no allocations once warm.
+
+        Args:
+          reset (bool): Zero the counters after reading them.
+
+        Returns:
+          Dict with keys `num_allocs`, `num_releases`, `bytes_allocated`,
+          `bytes_in_use` and `peak_bytes_in_use`.
+        '''
+        stats = self.cpp_wrapper.allocator_stats()
+        if reset:
+            self.cpp_wrapper.reset_allocator_stats()
+        return stats
+
+    def set_capacity_percentile(self, percentile):
+        '''Set how internal buffers are sized for recurring workloads.
+
+        The context remembers the buffer demand of recent draws for each combination
+        of resolution, minibatch size and triangle count. Buffers for a known
+        combination are sized to the given percentile of that history, so that
+        lower values use less memory but cause more draws to be rendered twice.
+
+        Args:
+          percentile (float): Value in [0, 1]. Defaults to 1, i.e., the maximum.
+        '''
+        assert 0.0 <= percentile <= 1.0
+        self.cpp_wrapper.set_capacity_percentile(float(percentile))
+
+    def capacity_stats(self, reset=False):
+        '''Return counters of internal buffer sizing.
+
+        Args:
+          reset (bool): Zero the counters after reading them.
+
+        Overflows are detected after the GPU has finished the coarse stage of a
+        draw. Each `rasterize()` call waits for that before returning, so that
+        it can render overflowed images again into its outputs. The host thus
+        cannot queue work ahead of the GPU across calls, even when the sizing
+        is predicted correctly.
+
+        Returns:
+          Dict with keys `num_draws`, `num_retried`, `num_predicted` and
+          `num_mispredicted`. The misprediction rate is `num_mispredicted`
+          divided by `num_predicted`.
+        '''
+        stats = self.cpp_wrapper.capacity_stats()
+        if reset:
+            self.cpp_wrapper.reset_capacity_stats()
+        return stats
+
+    def set_memory_budget(self, budget):
+        '''Limit the memory used by internal buffers of the rasterizer.
+
+        The budget covers the intermediate buffers whose size depends on the
+        workload, i.e., everything except the output images. When set, the
+        images of a minibatch are rasterized in batches that fit the budget,
+        and images that do not fit alone have their triangles drawn in
+        several chunks (see `split_factor()`). This trades speed for a
+        predictable upper bound on memory use. Rasterization raises an error
+        if the budget is below what a single image needs at the smallest
+        buffer sizes, which depends on the resolution.
+
+        Args:
+          budget (int): Budget in bytes, or None/0 for no limit (default).
+        '''
+        budget = int(budget or 0)
+        assert budget >= 0
+        self.cpp_wrapper.set_memory_budget(budget)
+
+    def split_factor(self):
+        '''Return the number of chunks the triangles of each image were drawn in
+        by the latest rasterization in this context.
+
+        When an image produces more subtriangles or bin/tile segments than the
+        internal buffers can hold, its triangle range (or, in instanced mode,
+        the triangle list) is split into consecutive chunks that are rendered
+        one after another with depth testing between them. The split factor is
+        1 when no splitting was needed.
+
+        The split factor is known only after the overflow checks of the draw,
+        which `rasterize()` waits for before returning (see `capacity_stats()`).
+        When split, each chunk is also checked before the next one is drawn.
+        '''
+        return self.cpp_wrapper.split_factor
+
+    def image_stats(self):
+        '''Return per-image rasterizer statistics of the latest `rasterize()` call
+        in this context.
+
+        Counts are summed over viewport tiles and triangle chunks. Depth peeling
+        iterations after the first one reuse earlier results and report zeros.
+
+        Returns:
+          Dict of int64 CPU tensors. The following have shape [minibatch_size]:
+          `num_subtris`, `num_bin_segs`, `num_tile_segs` and `num_active_tiles`
+          are the pipeline counters, `num_retries` is how many times the image
+          was rendered again after an overflow, and `max_subtris`,
+          `max_bin_segs` and `max_tile_segs` are the buffer capacities it was
+          rendered with. Scalars `bytes_allocated` (internal buffers) and
+          `split_factor` (see `split_factor()`) describe the whole context.
+        '''
+        return _get_plugin().rasterize_stats_cuda(self.cpp_wrapper)
+
+#----------------------------------------------------------------------------
+# CpuRaster state wrapper.
+#----------------------------------------------------------------------------
+
+class RasterizeCpuContext:
+    def __init__(self, num_threads=None):
+        '''Create a new CPU rasterizer context.
+
+        The CPU rasterizer runs the same pipeline as the Cuda rasterizer on a pool
+        of worker threads, and produces bit-identical outputs for the same inputs.
+        All input tensors passed to `rasterize()` with this context must reside in
+        CPU memory, and the outputs are returned in CPU memory. When PyTorch has
+        no Cuda device available, nvdiffrast builds its CPU code paths only, which
+        requires a C++ compiler but no Cuda toolkit.
+
+        Args:
+          num_threads (Optional): Number of worker threads used by the context. If
+                                  not specified, a thread pool shared by all CPU
+                                  contexts with one worker per hardware thread is
+                                  used.
+        Returns:
+          The newly created CPU rasterizer context.
+        '''
+        assert num_threads is None or (isinstance(num_threads, int) and num_threads > 0)
+        self.cpp_wrapper = _get_plugin().RasterizeCpuStateWrapper(0 if num_threads is None else num_threads)
+        self.output_db = True
+        self.active_depth_peeler = None
+
+    def image_stats(self):
+        '''Return per-image rasterizer statistics of the latest `rasterize()` call
+        in this context.
+
+        Same keys as `RasterizeCudaContext.image_stats()` except `split_factor`.
+        The counters describe the structures the Cuda rasterizer would use for
+        the same input. Internal storage grows on demand, so `num_retries` and
+        the capacities are zero.
+        '''
+        return _get_plugin().rasterize_stats_cpu(self.cpp_wrapper)
+
 #----------------------------------------------------------------------------
 # GL state wrapper.
 #----------------------------------------------------------------------------
@@ -279,40 +518,120 @@ class RasterizeGLContext:
 # Rasterize.
 #----------------------------------------------------------------------------
 
+_cull_modes = {'none': 0, 'back': 1, 'front': 2}
+
+def _check_cull_args(glctx, cull_mode, cull_min_area):
+    assert cull_mode in _cull_modes, "cull_mode must be one of %s" % list(_cull_modes.keys())
+    cull_min_area = float(cull_min_area)
+    assert cull_min_area >= 0.0, "cull_min_area must be non-negative"
+    if isinstance(glctx, RasterizeGLContext) and (cull_mode != 'none' or cull_min_area > 0.0):
+        raise ValueError("Culling is not supported with RasterizeGLContext")
+    return _cull_modes[cull_mode], cull_min_area
+
+def _check_compact_arg(glctx, compact):
+    assert compact is True or compact is False
+    if isinstance(glctx, RasterizeGLContext) and compact:
+        raise ValueError("Compact output is not supported with RasterizeGLContext")
+    return compact
+
+class CompactRast:
+    '''Main output of `rasterize()` in the compact layout.
+
+    Holds three tensors of the same minibatch size and resolution as the
+    float4 output. `bary` has shape [minibatch_size, height, width, 2] and dtype
+    `torch.float16`, and contains the barycentrics (u, v). `zw` has shape
+    [minibatch_size, height, width] and dtype `torch.float32`, and contains z/w.
+    `tri_id` has shape [minibatch_size, height, width] and dtype `torch.int32`,
+    and contains triangle_id as an integer, with zero where there is no triangle.
+    Only `bary` is differentiable. Pass the object as-is to `interpolate()` and
+    `antialias()`.
+    '''
+    def __init__(self, bary, zw, tri_id):
+        self.bary = bary
+        self.zw = zw
+        self.tri_id = tri_id
+
+    @property
+    def shape(self):
+        return self.zw.shape
+
+    def to_float4(self):
+        '''Expand to the float4 layout (u, v, z/w, triangle_id) of `rasterize()`.
+        Triangle ids above 2^24 use the same float encoding as the float4 output.
+        Gradients are propagated into `bary`.'''
+        t = self.tri_id
+        t = torch.where(t <= 0x1000000, t.float(), (t + 0x4a800000).view(torch.float32))
+        return torch.cat([self.bary.float(), self.zw[..., None], t[..., None]], dim=-1)
+
+def _prepare_vertex_transforms(pos, mtx, gl=False):
+    '''Check per-image vertex transforms and bring pos to the form the plugin expects.
+    Returns (pos, mtx) with mtx as an empty tensor if not used. An OpenGL context has
+    no support for the transforms, so the vertices are transformed here instead.'''
+    if mtx is None:
+        return pos, torch.tensor([])
+    assert isinstance(mtx, torch.Tensor) and len(mtx.shape) == 3 and mtx.shape[1:] == (4, 4), "mtx must have shape [minibatch_size, 4, 4]"
+    assert len(pos.shape) == 2 and pos.shape[1] in (3, 4), "pos must have shape [num_vertices, 3] or [num_vertices, 4] when mtx is given"
+    if pos.shape[1] == 3:
+        pos = torch.nn.functional.pad(pos, (0, 1), value=1.0)
+    if gl:
+        return torch.matmul(pos, mtx.transpose(1, 2)).contiguous(), torch.tensor([])
+    return pos, mtx
+
 class _rasterize_func(torch.autograd.Function):
     @staticmethod
-    def forward(ctx, raster_ctx, pos, tri, resolution, ranges, grad_db, peeling_idx):
+    def forward(ctx, raster_ctx, pos, tri, resolution, ranges, grad_db, peeling_idx, cull_mode, cull_min_area, mtx, compact):
         if isinstance(raster_ctx, RasterizeGLContext):
             out, out_db = _get_plugin(gl=True).rasterize_fwd_gl(raster_ctx.cpp_wrapper, pos, tri, resolution, ranges, peeling_idx)
+        elif isinstance(raster_ctx, RasterizeCpuContext):
+            out, out_db, out_zw, out_tri = _get_plugin().rasterize_fwd_cpu(raster_ctx.cpp_wrapper, pos, tri, resolution, ranges, peeling_idx, cull_mode, cull_min_area, mtx, compact)
         else:
-            out, out_db = _get_plugin().rasterize_fwd_cuda(raster_ctx.cpp_wrapper, pos, tri, resolution, ranges, peeling_idx)
-        ctx.save_for_backward(pos, tri, out)
+            out, out_db, out_zw, out_tri = _get_plugin().rasterize_fwd_cuda(raster_ctx.cpp_wrapper, pos, tri, resolution, ranges, peeling_idx, cull_mode, cull_min_area, mtx, compact)
         ctx.saved_grad_db = grad_db
+        if compact:
+            # The gradient op only needs the triangle ids, the plugin tells the layouts apart by dtype.
+            ctx.mark_non_differentiable(out_zw, out_tri)
+            ctx.save_for_backward(pos, tri, out_tri, mtx)
+            return out, out_db, out_zw, out_tri
+        ctx.save_for_backward(pos, tri, out, mtx)
         return out, out_db
 
     @staticmethod
-    def backward(ctx, dy, ddb):
-        pos, tri, out = ctx.saved_tensors
+    def backward(ctx, dy, ddb, *_):
+        pos, tri, out, mtx = ctx.saved_tensors
         if ctx.saved_grad_db:
-            g_pos = _get_plugin().rasterize_grad_db(pos, tri, out, dy, ddb)
+            g_pos, g_mtx = _get_plugin().rasterize_grad_db(pos, tri, out, dy, ddb, mtx)
         else:
-            g_pos = _get_plugin().rasterize_grad(pos, tri, out, dy)
-        return None, g_pos, None, None, None, None, None
+            g_pos, g_mtx = _get_plugin().rasterize_grad(pos, tri, out, dy, mtx)
+        if not mtx.nelement():
+            g_mtx = None
+        return None, g_pos, None, None, None, None, None, None, None, g_mtx, None
+
+def _rasterize_output(result, compact):
+    if compact:
+        out, out_db, out_zw, out_tri = result
+        return CompactRast(out, out_zw, out_tri), out_db
+    return result
 
 # Op wrapper.
-def rasterize(glctx, pos, tri, resolution, ranges=None, grad_db=True):
+def rasterize(glctx, pos, tri, resolution, ranges=None, grad_db=True, cull_mode='none', cull_min_area=0.0, mtx=None, compact=False):
     '''Rasterize triangles.
 
     All input tensors must be contiguous and reside in GPU memory except for
     the `ranges` tensor that, if specified, has to reside in CPU memory. The
-    output tensors will be contiguous and reside in GPU memory.
+    output tensors will be contiguous and reside in GPU memory. With a
+    `RasterizeCpuContext`, all input and output tensors reside in CPU memory.
 
     Args:
-        glctx: Rasterizer context of type `RasterizeGLContext` or `RasterizeCudaContext`.
+        glctx: Rasterizer context of type `RasterizeGLContext`, `RasterizeCudaContext`,
+               or `RasterizeCpuContext`.
         pos: Vertex position tensor with dtype `torch.float32`. To enable range
              mode, this tensor should have a 2D shape [num_vertices, 4]. To enable
              instanced mode, use a 3D shape [minibatch_size, num_vertices, 4].
+             If `mtx` is given, shape is [num_vertices, 3] or [num_vertices, 4]
+             and the vertices are shared by all images. A missing w is taken as 1.
         tri: Triangle tensor with shape [num_triangles, 3] and dtype `torch.int32`.
+             Meshes with fewer than 65536 vertices may also use `torch.int16` or
+             `torch.uint16`, which is read as unsigned and halves index traffic.
         resolution: Output resolution as integer tuple (height, width).
         ranges: In range mode, tensor with shape [minibatch_size, 2] and dtype
                 `torch.int32`, specifying start indices and counts into `tri`.
@@ -320,6 +639,26 @@ def rasterize(glctx, pos, tri, resolution, ranges=None, grad_db=True):
         grad_db: Propagate gradients of image-space derivatives of barycentrics
                  into `pos` in backward pass. Ignored if using an OpenGL context that
                  was not configured to output image-space derivatives.
+        cull_mode: Facing-based triangle culling, one of 'none', 'back', or 'front'.
+                   Triangles that are counterclockwise in normalized device
+                   coordinates are front-facing. Triangles with zero area after
+                   snapping to the subpixel grid are always culled. Not supported
+                   with an OpenGL context.
+        cull_min_area: Cull triangles whose area after snapping is smaller than this
+                       many pixels. Triangles that cross the near or far plane, or
+                       extend far outside the viewport, are never culled by area.
+                       Not supported with an OpenGL context.
+        mtx: (Optional) Per-image transform tensor with shape [minibatch_size, 4, 4]
+             and dtype `torch.float32`. Enables instanced mode where image i is drawn
+             with clip-space positions mtx[i] @ pos, computed on the fly, and gradients
+             are propagated into both `pos` and `mtx`. Matrices are applied to column
+             vectors. Pass the same `pos` and `mtx` to `antialias()`, and `attr` with
+             shape [num_vertices, num_attributes] to `interpolate()`.
+        compact: Return the main output as a `CompactRast` with fp16 barycentrics
+                 and separate z/w and integer triangle id planes, 12 bytes per pixel
+                 instead of 16, and the image-space derivatives as `torch.float16`.
+                 The barycentrics and their gradients have about three decimal
+                 digits of precision. Not supported with an OpenGL context.
 
     Returns:
         A tuple of two tensors. The first output tensor has shape [minibatch_size,
@@ -328,14 +667,18 @@ def rasterize(glctx, pos, tri, resolution, ranges=None, grad_db=True):
         derivatives of barycentrics, the second output tensor will also have shape
         [minibatch_size, height, width, 4] and contain said derivatives in order
         (du/dX, du/dY, dv/dX, dv/dY). Otherwise it will be an empty tensor with shape
-        [minibatch_size, height, width, 0].
+        [minibatch_size, height, width, 0]. If `compact` is set, the first output is
+        a `CompactRast` instead.
     '''
-    assert isinstance(glctx, (RasterizeGLContext, RasterizeCudaContext))
+    assert isinstance(glctx, (RasterizeGLContext, RasterizeCudaContext, RasterizeCpuContext))
     assert grad_db is True or grad_db is False
     grad_db = grad_db and glctx.output_db
+    cull_mode, cull_min_area = _check_cull_args(glctx, cull_mode, cull_min_area)
+    compact = _check_compact_arg(glctx, compact)
 
     # Sanitize inputs.
     assert isinstance(pos, torch.Tensor) and isinstance(tri, torch.Tensor)
+    pos, mtx = _prepare_vertex_transforms(pos, mtx, gl=isinstance(glctx, RasterizeGLContext))
     resolution = tuple(resolution)
     if ranges is None:
         ranges = torch.empty(size=(0, 2), dtype=torch.int32, device='cpu')
@@ -347,14 +690,14 @@ def rasterize(glctx, pos, tri, resolution, ranges=None, grad_db=True):
         return RuntimeError("Cannot call rasterize() during depth peeling operation, use rasterize_next_layer() instead")
 
     # Instantiate the function.
-    return _rasterize_func.apply(glctx, pos, tri, resolution, ranges, grad_db, -1)
+    return _rasterize_output(_rasterize_func.apply(glctx, pos, tri, resolution, ranges, grad_db, -1, cull_mode, cull_min_area, mtx, compact), compact)
 
 #----------------------------------------------------------------------------
 # Depth peeler context manager for rasterizing multiple depth layers.
 #----------------------------------------------------------------------------
 
 class DepthPeeler:
-    def __init__(self, glctx, pos, tri, resolution, ranges=None, grad_db=True):
+    def __init__(self, glctx, pos, tri, resolution, ranges=None, grad_db=True, cull_mode='none', cull_min_area=0.0, mtx=None, compact=False):
         '''Create a depth peeler object for rasterizing multiple depth layers.
 
         Arguments are the same as in `rasterize()`.
@@ -362,12 +705,15 @@ class DepthPeeler:
         Returns:
           The newly created depth peeler.
         '''
-        assert isinstance(glctx, (RasterizeGLContext, RasterizeCudaContext))
+        assert isinstance(glctx, (RasterizeGLContext, RasterizeCudaContext, RasterizeCpuContext))
         assert grad_db is True or grad_db is False
         grad_db = grad_db and glctx.output_db
+        cull_mode, cull_min_area = _check_cull_args(glctx, cull_mode, cull_min_area)
+        compact = _check_compact_arg(glctx, compact)
 
         # Sanitize inputs as usual.
         assert isinstance(pos, torch.Tensor) and isinstance(tri, torch.Tensor)
+        pos, mtx = _prepare_vertex_transforms(pos, mtx, gl=isinstance(glctx, RasterizeGLContext))
         resolution = tuple(resolution)
         if ranges is None:
             ranges = torch.empty(size=(0, 2), dtype=torch.int32, device='cpu')
@@ -381,6 +727,10 @@ class DepthPeeler:
         self.resolution = resolution
         self.ranges = ranges
         self.grad_db = grad_db
+        self.cull_mode = cull_mode
+        self.cull_min_area = cull_min_area
+        self.mtx = mtx
+        self.compact = compact
         self.peeling_idx = None
 
     def __enter__(self):
@@ -401,6 +751,10 @@ class DepthPeeler:
         self.resolution = None
         self.ranges = None
         self.grad_db = None
+        self.cull_mode = None
+        self.cull_min_area = None
+        self.mtx = None
+        self.compact = None
         self.peeling_idx = None
         return None
 
@@ -415,9 +769,9 @@ class DepthPeeler:
         '''
         assert self.raster_ctx.active_depth_peeler is self
         assert self.peeling_idx >= 0
-        result = _rasterize_func.apply(self.raster_ctx, self.pos, self.tri, self.resolution, self.ranges, self.grad_db, self.peeling_idx)
+        result = _rasterize_func.apply(self.raster_ctx, self.pos, self.tri, self.resolution, self.ranges, self.grad_db, self.peeling_idx, self.cull_mode, self.cull_min_area, self.mtx, self.compact)
         self.peeling_idx += 1
-        return result
+        return _rasterize_output(result, self.compact)
 
 #----------------------------------------------------------------------------
 # Interpolate.
@@ -426,47 +780,51 @@ class DepthPeeler:
 # Output pixel differentials for at least some attributes.
 class _interpolate_func_da(torch.autograd.Function):
     @staticmethod
-    def forward(ctx, attr, rast, tri, rast_db, diff_attrs_all, diff_attrs_list):
-        out, out_da = _get_plugin().interpolate_fwd_da(attr, rast, tri, rast_db, diff_attrs_all, diff_attrs_list)
-        ctx.save_for_backward(attr, rast, tri, rast_db)
+    def forward(ctx, attr, rast, tri, rast_db, diff_attrs_all, diff_attrs_list, rast_tri):
+        out, out_da = _get_plugin().interpolate_fwd_da(attr, rast, tri, rast_db, diff_attrs_all, diff_attrs_list, rast_tri)
+        ctx.save_for_backward(attr, rast, tri, rast_db, rast_tri)
         ctx.saved_misc = diff_attrs_all, diff_attrs_list
         return out, out_da
 
     @staticmethod
     def backward(ctx, dy, dda):
-        attr, rast, tri, rast_db = ctx.saved_tensors
+        attr, rast, tri, rast_db, rast_tri = ctx.saved_tensors
         diff_attrs_all, diff_attrs_list = ctx.saved_misc
-        g_attr, g_rast, g_rast_db = _get_plugin().interpolate_grad_da(attr, rast, tri, dy, rast_db, dda, diff_attrs_all, diff_attrs_list)
-        return g_attr, g_rast, None, g_rast_db, None, None
+        g_attr, g_rast, g_rast_db = _get_plugin().interpolate_grad_da(attr, rast, tri, dy, rast_db, dda, diff_attrs_all, diff_attrs_list, rast_tri)
+        return g_attr, g_rast, None, g_rast_db, None, None, None
 
 # No pixel differential for any attribute.
 class _interpolate_func(torch.autograd.Function):
     @staticmethod
-    def forward(ctx, attr, rast, tri):
-        out, out_da = _get_plugin().interpolate_fwd(attr, rast, tri)
-        ctx.save_for_backward(attr, rast, tri)
+    def forward(ctx, attr, rast, tri, rast_tri):
+        out, out_da = _get_plugin().interpolate_fwd(attr, rast, tri, rast_tri)
+        ctx.save_for_backward(attr, rast, tri, rast_tri)
         return out, out_da
 
     @staticmethod
     def backward(ctx, dy, _):
-        attr, rast, tri = ctx.saved_tensors
-        g_attr, g_rast = _get_plugin().interpolate_grad(attr, rast, tri, dy)
-        return g_attr, g_rast, None
+        attr, rast, tri, rast_tri = ctx.saved_tensors
+        g_attr, g_rast = _get_plugin().interpolate_grad(attr, rast, tri, dy, rast_tri)
+        return g_attr, g_rast, None, None
 
 # Op wrapper.
 def interpolate(attr, rast, tri, rast_db=None, diff_attrs=None):
     """Interpolate vertex attributes.
 
     All input tensors must be contiguous and reside in GPU memory. The output tensors
-    will be contiguous and reside in GPU memory.
+    will be contiguous and reside in GPU memory. Alternatively, all input tensors
+    may reside in CPU memory, in which case the outputs are computed on the CPU and
+    returned in CPU memory.
 
     Args:
-        attr: Attribute tensor with dtype `torch.float32`. 
-              Shape is [num_vertices, num_attributes] in range mode, or 
+        attr: Attribute tensor with dtype `torch.float32`, `torch.float16` or `torch.bfloat16`.
+              Interpolation is done in 32-bit float regardless, and the outputs have the
+              same dtype as `attr`. Shape is [num_vertices, num_attributes] in range mode, or 
               [minibatch_size, num_vertices, num_attributes] in instanced mode.
               Broadcasting is supported along the minibatch axis.
-        rast: Main output tensor from `rasterize()`.
-        tri: Triangle tensor with shape [num_triangles, 3] and dtype `torch.int32`.
+        rast: Main output tensor from `rasterize()`, or a `CompactRast`.
+        tri: Triangle tensor with shape [num_triangles, 3] and dtype `torch.int32`,
+             or a 16-bit integer dtype as in `rasterize()`.
         rast_db: (Optional) Tensor containing image-space derivatives of barycentrics, 
                  i.e., the second output tensor from `rasterize()`. Enables computing
                  image-space derivatives of attributes.
@@ -495,6 +853,11 @@ def interpolate(attr, rast, tri, rast_db=None, diff_attrs=None):
     diff_attrs_all = int(diff_attrs == 'all')
     diff_attrs_list = [] if diff_attrs_all else diff_attrs
 
+    # Unpack compact rasterizer output. Interpolation reads only the barycentrics and triangle ids.
+    rast_tri = torch.tensor([])
+    if isinstance(rast, CompactRast):
+        rast, rast_tri = rast.bary, rast.tri_id
+
     # Check inputs.
     assert all(isinstance(x, torch.Tensor) for x in (attr, rast, tri))
     if diff_attrs:
@@ -502,9 +865,9 @@ def interpolate(attr, rast, tri, rast_db=None, diff_attrs=None):
 
     # Choose stub.
     if diff_attrs:
-        return _interpolate_func_da.apply(attr, rast, tri, rast_db, diff_attrs_all, diff_attrs_list)
+        return _interpolate_func_da.apply(attr, rast, tri, rast_db, diff_attrs_all, diff_attrs_list, rast_tri)
     else:
-        return _interpolate_func.apply(attr, rast, tri)
+        return _interpolate_func.apply(attr, rast, tri, rast_tri)
 
 #----------------------------------------------------------------------------
 # Texture
@@ -562,10 +925,14 @@ def texture(tex, uv, uv_da=None, mip_level_bias=None, mip=None, filter_mode='aut
     """Perform texture sampling.
 
     All input tensors must be contiguous and reside in GPU memory. The output tensor
-    will be contiguous and reside in GPU memory.
+    will be contiguous and reside in GPU memory. Alternatively, all input tensors
+    may reside in CPU memory, in which case the sampling is performed on the CPU
+    and the output is returned in CPU memory.
 
     Args:
-        tex: Texture tensor with dtype `torch.float32`. For 2D textures, must have shape
+        tex: Texture tensor with dtype `torch.float32`, `torch.float16` or `torch.bfloat16`.
+             Filtering is done in 32-bit float regardless, and the output has the same dtype
+             as `tex`. For 2D textures, must have shape
              [minibatch_size, tex_height, tex_width, tex_channels]. For cube map textures,
              must have shape [minibatch_size, 6, tex_height, tex_width, tex_channels] where
              tex_width and tex_height are equal. Note that `boundary_mode` must also be set
@@ -686,27 +1053,32 @@ def texture_construct_mip(tex, max_mip_level=None, cube_mode=False):
 
 class _antialias_func(torch.autograd.Function):
     @staticmethod
-    def forward(ctx, color, rast, pos, tri, topology_hash, pos_gradient_boost):
-        out, work_buffer = _get_plugin().antialias_fwd(color, rast, pos, tri, topology_hash)
-        ctx.save_for_backward(color, rast, pos, tri)
+    def forward(ctx, color, rast, pos, tri, topology_hash, pos_gradient_boost, mtx, rast_tri):
+        out, work_buffer = _get_plugin().antialias_fwd(color, rast, pos, tri, topology_hash, mtx, rast_tri)
+        ctx.save_for_backward(color, rast, pos, tri, mtx, rast_tri)
         ctx.saved_misc = pos_gradient_boost, work_buffer
         return out
 
     @staticmethod
     def backward(ctx, dy):
-        color, rast, pos, tri = ctx.saved_tensors
+        color, rast, pos, tri, mtx, rast_tri = ctx.saved_tensors
         pos_gradient_boost, work_buffer = ctx.saved_misc
-        g_color, g_pos = _get_plugin().antialias_grad(color, rast, pos, tri, dy, work_buffer)
+        g_color, g_pos, g_mtx = _get_plugin().antialias_grad(color, rast, pos, tri, dy, work_buffer, mtx, rast_tri)
         if pos_gradient_boost != 1.0:
             g_pos = g_pos * pos_gradient_boost
-        return g_color, None, g_pos, None, None, None
+            g_mtx = g_mtx * pos_gradient_boost
+        if not mtx.nelement():
+            g_mtx = None
+        return g_color, None, g_pos, None, None, None, g_mtx, None
 
 # Op wrapper.
-def antialias(color, rast, pos, tri, topology_hash=None, pos_gradient_boost=1.0):
+def antialias(color, rast, pos, tri, topology_hash=None, pos_gradient_boost=1.0, mtx=None):
     """Perform antialiasing.
 
     All input tensors must be contiguous and reside in GPU memory. The output tensor
-    will be contiguous and reside in GPU memory.
+    will be contiguous and reside in GPU memory. Alternatively, all input tensors
+    may reside in CPU memory, in which case the antialiasing is performed on the CPU
+    and the output is returned in CPU memory.
 
     Note that silhouette edge determination is based on vertex indices in the triangle
     tensor. For it to work properly, a vertex belonging to multiple triangles must be
@@ -717,29 +1089,42 @@ def antialias(color, rast, pos, tri, topology_hash=None, pos_gradient_boost=1.0)
     documentation.
 
     Args:
-        color: Input image to antialias with shape [minibatch_size, height, width, num_channels].
-        rast: Main output tensor from `rasterize()`.
+        color: Input image to antialias with shape [minibatch_size, height, width, num_channels]
+               and dtype `torch.float32`, `torch.float16` or `torch.bfloat16`.
+        rast: Main output tensor from `rasterize()`, or a `CompactRast`.
         pos: Vertex position tensor used in the rasterization operation.
-        tri: Triangle tensor used in the rasterization operation.
+        tri: Triangle tensor used in the rasterization operation. Any index dtype
+             accepted by `rasterize()` can be used.
         topology_hash: (Optional) Preconstructed topology hash for the triangle tensor. If not
                        specified, the topology hash is constructed internally and discarded afterwards.
-        pos_gradient_boost: (Optional) Multiplier for gradients propagated to `pos`.
+                       A hash constructed on another device is copied to the device of `tri`.
+        pos_gradient_boost: (Optional) Multiplier for gradients propagated to `pos`,
+                            and to `mtx` if given.
+        mtx: (Optional) Per-image transform tensor used in the rasterization operation.
 
     Returns:
-        A tensor containing the antialiased image with the same shape as `color` input tensor.
+        A tensor containing the antialiased image with the same shape and dtype as `color` input tensor.
     """
 
+    # Unpack compact rasterizer output. Antialiasing reads only the depths and triangle ids.
+    rast_tri = torch.tensor([])
+    if isinstance(rast, CompactRast):
+        rast, rast_tri = rast.zw, rast.tri_id
+
     # Check inputs.
     assert all(isinstance(x, torch.Tensor) for x in (color, rast, pos, tri))
+    pos, mtx = _prepare_vertex_transforms(pos, mtx)
 
     # Construct topology hash unless provided by user.
     if topology_hash is not None:
         assert isinstance(topology_hash, _get_plugin().TopologyHashWrapper)
+        if topology_hash.device != tri.device:
+            topology_hash = topology_hash.to(tri.device)
     else:
         topology_hash = _get_plugin().antialias_construct_topology_hash(tri)
 
     # Instantiate the function.
-    return _antialias_func.apply(color, rast, pos, tri, topology_hash, pos_gradient_boost)
+    return _antialias_func.apply(color, rast, pos, tri, topology_hash, pos_gradient_boost, mtx, rast_tri)
 
 # Topology hash precalculation for cases where the triangle array stays constant.
 def antialias_construct_topology_hash(tri):
@@ -750,11 +1135,13 @@ def antialias_construct_topology_hash(tri):
 
     Args:
         tri: Triangle tensor with shape [num_triangles, 3]. Must be contiguous and reside in
-             GPU memory.
+             GPU or CPU memory. On CPU, the hash is populated by all threads of the shared
+             thread pool.
 
     Returns:
         An opaque object containing the topology hash. This can be supplied in a call to 
-        `antialias()` in the `topology_hash` argument.
+        `antialias()` in the `topology_hash` argument. The hash has the same layout on CPU
+        and GPU, and can be moved between devices with its `to(device)` method.
     """
     assert isinstance(tri, torch.Tensor)
     return _get_plugin().antialias_construct_topology_hash(tri)
@@ -10,7 +10,9 @@
 #include "torch_types.h"
 #include "../common/common.h"
 #include "../common/antialias.h"
-#if USE_ROCM
+#include "../common/profiler.h"
+#include "../common/threadpool.h"
+#if defined(USE_ROCM) && !defined(NVDR_CPU_ONLY)
 #include <ATen/hip/impl/HIPGuardImplMasqueradingAsCUDA.h>
 #endif
 
@@ -24,29 +26,36 @@
 #endif
 
 void AntialiasFwdMeshKernel         (const AntialiasKernelParams p);
+void AntialiasFwdMeshKernelU16      (const AntialiasKernelParams p);
 void AntialiasFwdDiscontinuityKernel(const AntialiasKernelParams p);
 void AntialiasFwdAnalysisKernel     (const AntialiasKernelParams p);
+void AntialiasFwdAnalysisKernelU16  (const AntialiasKernelParams p);
 void AntialiasGradKernel            (const AntialiasKernelParams p);
+void AntialiasGradKernelU16         (const AntialiasKernelParams p);
 
 //------------------------------------------------------------------------
 // Topology hash construction.
 
 TopologyHashWrapper antialias_construct_topology_hash(torch::Tensor tri)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(tri));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("antialias_construct_topology_hash");
+    bool cpu = tri.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, tri);
     AntialiasKernelParams p = {}; // Initialize all fields to zero.
 
     // Check inputs.
-    NVDR_CHECK_DEVICE(tri);
+    ProfileRange checks("antialias_construct_topology_hash/checks");
+    NVDR_CHECK_DEVICE_OR_CPU(tri);
     NVDR_CHECK_CONTIGUOUS(tri);
-    NVDR_CHECK_I32(tri);
+    NVDR_CHECK_INDEX(tri);
     NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
+    checks.end();
 
     // Fill in kernel parameters.
     p.numTriangles = tri.size(0);
     p.numVertices = 0x7fffffff; // Let's not require vertex positions just to enable an error check.
-    p.tri = tri.data_ptr<int>();
+    p.tri = tri.data_ptr();
+    p.tri_u16 = nvdr_is_index16(tri);
 
     // Kernel parameters.
     p.allocTriangles = 64;
@@ -54,7 +63,7 @@ TopologyHashWrapper antialias_construct_topology_hash(torch::Tensor tri)
         p.allocTriangles <<= 1; // Must be power of two.
 
     // Construct the hash tensor and get pointer.
-    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kInt32).device(torch::kCUDA);
+    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kInt32).device(cpu ? torch::kCPU : torch::kCUDA);
     torch::Tensor ev_hash = torch::zeros({(uint64_t)p.allocTriangles * AA_HASH_ELEMENTS_PER_TRIANGLE(p.allocTriangles) * 4}, opts);
     p.evHash = (uint4*)(ev_hash.data_ptr<int>());
 
@@ -62,8 +71,18 @@ TopologyHashWrapper antialias_construct_topology_hash(torch::Tensor tri)
     NVDR_CHECK(!((uintptr_t)p.evHash & 15), "ev_hash internal tensor not aligned to int4");
 
     // Populate the hash.
-    void* args[] = {&p};
-    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)AntialiasFwdMeshKernel, (p.numTriangles - 1) / AA_MESH_KERNEL_THREADS_PER_BLOCK + 1, AA_MESH_KERNEL_THREADS_PER_BLOCK, args, 0, stream));
+    if (cpu)
+        AntialiasCpuConstructTopologyHash(p, ThreadPool::getGlobal());
+#ifndef NVDR_CPU_ONLY
+    else
+    {
+        void* args[] = {&p};
+        void* func = p.tri_u16 ? (void*)AntialiasFwdMeshKernelU16 : (void*)AntialiasFwdMeshKernel;
+        cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+        NVDR_PROFILE_DEVICE_RANGE("antialias_construct_topology_hash/kernel", stream);
+        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func, (p.numTriangles - 1) / AA_MESH_KERNEL_THREADS_PER_BLOCK + 1, AA_MESH_KERNEL_THREADS_PER_BLOCK, args, 0, stream));
+    }
+#endif
 
     // Return.
     TopologyHashWrapper hash_wrap;
@@ -74,26 +93,43 @@ TopologyHashWrapper antialias_construct_topology_hash(torch::Tensor tri)
 //------------------------------------------------------------------------
 // Forward op.
 
-std::tuple<torch::Tensor, torch::Tensor> antialias_fwd(torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, TopologyHashWrapper topology_hash_wrap)
+std::tuple<torch::Tensor, torch::Tensor> antialias_fwd(torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, TopologyHashWrapper topology_hash_wrap, torch::Tensor mtx, torch::Tensor rast_tri)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(color));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("antialias_fwd");
+    bool cpu = color.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, color);
     AntialiasKernelParams p = {}; // Initialize all fields to zero.
-    p.instance_mode = (pos.sizes().size() > 2) ? 1 : 0;
+    p.mtx = nvdr_get_vertex_transforms(pos, mtx, __func__); // Shared vertices with per-image transforms are handled in instance mode.
+    p.instance_mode = (pos.sizes().size() > 2 || p.mtx) ? 1 : 0;
+    p.rasterTri = nvdr_get_compact_tri_ids(rast, rast_tri, __func__); // Compact rasterizer output has the z/w plane in rast.
     torch::Tensor& topology_hash = topology_hash_wrap.ev_hash; // Unwrap.
 
     // Check inputs.
-    NVDR_CHECK_DEVICE(color, rast, pos, tri, topology_hash);
+    ProfileRange checks("antialias_fwd/checks");
+    NVDR_CHECK_DEVICE_OR_CPU(color, rast, pos, tri, topology_hash);
     NVDR_CHECK_CONTIGUOUS(color, rast, pos, tri, topology_hash);
-    NVDR_CHECK_F32(color, rast, pos);
-    NVDR_CHECK_I32(tri, topology_hash);
+    NVDR_CHECK_FLOAT(color);
+    NVDR_CHECK_F32(rast, pos);
+    NVDR_CHECK_INDEX(tri);
+    NVDR_CHECK_I32(topology_hash);
+    checks.end();
+
+    // Half precision colors are processed in fp32, as the kernels update the output with float atomics.
+    torch::ScalarType dtype = color.scalar_type();
+    if (dtype != torch::kFloat32)
+        color = color.to(torch::kFloat32);
 
     // Sanity checks.
     NVDR_CHECK(color.sizes().size() == 4 && color.size(0) > 0 && color.size(1) > 0 && color.size(2) > 0 && color.size(3) > 0, "color must have shape[>0, >0, >0, >0]");
-    NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == 4, "rast must have shape[>0, >0, >0, 4]");
+    if (p.rasterTri)
+        NVDR_CHECK(rast.sizes().size() == 3 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0, "rast must have shape[>0, >0, >0] in the compact layout");
+    else
+        NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == 4, "rast must have shape[>0, >0, >0, 4]");
     NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
     NVDR_CHECK(color.size(1) == rast.size(1) && color.size(2) == rast.size(2), "color and rast inputs must have same spatial dimensions");
-    if (p.instance_mode)
+    if (p.mtx)
+        NVDR_CHECK(rast.size(0) == color.size(0) && mtx.size(0) == color.size(0), "minibatch size mismatch between inputs color, rast, mtx");
+    else if (p.instance_mode)
     {
         NVDR_CHECK(pos.sizes().size() == 3 && pos.size(0) > 0 && pos.size(1) > 0 && pos.size(2) == 4, "pos must have shape [>0, >0, 4] or [>0, 4]");
         NVDR_CHECK(rast.size(0) == color.size(0) && pos.size(0) == color.size(0), "minibatch size mismatch between inputs color, rast, pos");
@@ -105,7 +141,7 @@ std::tuple<torch::Tensor, torch::Tensor> antialias_fwd(torch::Tensor color, torc
     }
 
     // Extract input dimensions.
-    p.numVertices  = pos.size(p.instance_mode ? 1 : 0);
+    p.numVertices  = pos.size(pos.sizes().size() > 2 ? 1 : 0);
     p.numTriangles = tri.size(0);
     p.n            = color.size(0);
     p.height       = color.size(1);
@@ -115,7 +151,8 @@ std::tuple<torch::Tensor, torch::Tensor> antialias_fwd(torch::Tensor color, torc
     // Get input pointers.
     p.color = color.data_ptr<float>();
     p.rasterOut = rast.data_ptr<float>();
-    p.tri = tri.data_ptr<int>();
+    p.tri = tri.data_ptr();
+    p.tri_u16 = nvdr_is_index16(tri);
     p.pos = pos.data_ptr<float>();
     p.evHash = (uint4*)(topology_hash.data_ptr<int>());
 
@@ -130,63 +167,99 @@ std::tuple<torch::Tensor, torch::Tensor> antialias_fwd(torch::Tensor color, torc
 
     // Allocate output tensors.
     torch::Tensor out = color.detach().clone(); // Use color as base.
-    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCUDA);
+    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(cpu ? torch::kCPU : torch::kCUDA);
     torch::Tensor work_buffer = torch::empty({p.n * p.width * p.height * 8 + 4}, opts); // 8 int for a maximum of two work items per pixel.
     p.output = out.data_ptr<float>();
     p.workBuffer = (int4*)(work_buffer.data_ptr<float>());
 
-    // Clear the work counters.
-    NVDR_CHECK_CUDA_ERROR(cudaMemsetAsync(p.workBuffer, 0, sizeof(int4), stream));
-
     // Verify that buffers are aligned to allow float2/float4 operations.
     NVDR_CHECK(!((uintptr_t)p.pos        & 15), "pos input tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.rasterOut  &  7), "raster_out input tensor not aligned to float2");
+    NVDR_CHECK(p.rasterTri || !((uintptr_t)p.rasterOut & 7), "raster_out input tensor not aligned to float2");
     NVDR_CHECK(!((uintptr_t)p.workBuffer & 15), "work_buffer internal tensor not aligned to int4");
     NVDR_CHECK(!((uintptr_t)p.evHash     & 15), "topology_hash internal tensor not aligned to int4");
 
+    // Run on the shared thread pool if on CPU. The work counters are set there.
+    if (cpu)
+    {
+        AntialiasCpuFwd(p, ThreadPool::getGlobal());
+        return std::tuple<torch::Tensor, torch::Tensor>(out.to(dtype), work_buffer);
+    }
+
+#ifndef NVDR_CPU_ONLY
+    // Clear the work counters.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_CHECK_CUDA_ERROR(cudaMemsetAsync(p.workBuffer, 0, sizeof(int4), stream));
+
     // Choose launch parameters for the discontinuity finder kernel and launch.
     void* args[] = {&p};
     dim3 blockSize(AA_DISCONTINUITY_KERNEL_BLOCK_WIDTH, AA_DISCONTINUITY_KERNEL_BLOCK_HEIGHT, 1);
     dim3 gridSize = getLaunchGridSize(blockSize, p.width, p.height, p.n);
+    ProfileRange discontinuityRange("antialias_fwd/discontinuity", (void*)stream);
     NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)AntialiasFwdDiscontinuityKernel, gridSize, blockSize, args, 0, stream));
+    discontinuityRange.end();
 
     // Determine optimum block size for the persistent analysis kernel and launch.
     int device = 0;
     int numCTA = 0;
     int numSM  = 0;
+    void* func = p.tri_u16 ? (void*)AntialiasFwdAnalysisKernelU16 : (void*)AntialiasFwdAnalysisKernel;
     NVDR_CHECK_CUDA_ERROR(cudaGetDevice(&device));
-    NVDR_CHECK_CUDA_ERROR(cudaOccupancyMaxActiveBlocksPerMultiprocessor(&numCTA, (void*)AntialiasFwdAnalysisKernel, AA_ANALYSIS_KERNEL_THREADS_PER_BLOCK, 0));
+    NVDR_CHECK_CUDA_ERROR(cudaOccupancyMaxActiveBlocksPerMultiprocessor(&numCTA, func, AA_ANALYSIS_KERNEL_THREADS_PER_BLOCK, 0));
     NVDR_CHECK_CUDA_ERROR(cudaDeviceGetAttribute(&numSM, cudaDevAttrMultiProcessorCount, device));
-    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)AntialiasFwdAnalysisKernel, numCTA * numSM, AA_ANALYSIS_KERNEL_THREADS_PER_BLOCK, args, 0, stream));
+    NVDR_PROFILE_DEVICE_RANGE("antialias_fwd/analysis", stream);
+    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func, numCTA * numSM, AA_ANALYSIS_KERNEL_THREADS_PER_BLOCK, args, 0, stream));
 
     // Return results.
-    return std::tuple<torch::Tensor, torch::Tensor>(out, work_buffer);
+    return std::tuple<torch::Tensor, torch::Tensor>(out.to(dtype), work_buffer);
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 //------------------------------------------------------------------------
 // Gradient op.
 
-std::tuple<torch::Tensor, torch::Tensor> antialias_grad(torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, torch::Tensor dy, torch::Tensor work_buffer)
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> antialias_grad(torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, torch::Tensor dy, torch::Tensor work_buffer, torch::Tensor mtx, torch::Tensor rast_tri)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(color));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("antialias_grad");
+    bool cpu = color.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, color);
     AntialiasKernelParams p = {}; // Initialize all fields to zero.
-    p.instance_mode = (pos.sizes().size() > 2) ? 1 : 0;
+    p.mtx = nvdr_get_vertex_transforms(pos, mtx, __func__); // Shared vertices with per-image transforms are handled in instance mode.
+    p.instance_mode = (pos.sizes().size() > 2 || p.mtx) ? 1 : 0;
+    p.rasterTri = nvdr_get_compact_tri_ids(rast, rast_tri, __func__); // Compact rasterizer output has the z/w plane in rast.
 
     // Check inputs.
-    NVDR_CHECK_DEVICE(color, rast, pos, tri, dy, work_buffer);
+    ProfileRange checks("antialias_grad/checks");
+    NVDR_CHECK_DEVICE_OR_CPU(color, rast, pos, tri, dy, work_buffer);
     NVDR_CHECK_CONTIGUOUS(color, rast, pos, tri, work_buffer);
-    NVDR_CHECK_F32(color, rast, pos, dy, work_buffer);
-    NVDR_CHECK_I32(tri);
+    NVDR_CHECK_FLOAT(color);
+    NVDR_CHECK_F32(rast, pos, work_buffer);
+    NVDR_CHECK_INDEX(tri);
+    NVDR_CHECK(dy.dtype() == color.dtype(), "dy must have the same dtype as color");
+    checks.end();
+
+    // Half precision colors are processed in fp32, see antialias_fwd().
+    torch::ScalarType dtype = color.scalar_type();
+    if (dtype != torch::kFloat32)
+    {
+        color = color.to(torch::kFloat32);
+        dy = dy.to(torch::kFloat32);
+    }
 
     // Sanity checks.
     NVDR_CHECK(dy.sizes().size() == 4 && dy.size(0) > 0 && dy.size(1) > 0 && dy.size(2) > 0 && dy.size(3) > 0, "dy must have shape[>0, >0, >0, >0]");
     NVDR_CHECK(color.sizes().size() == 4 && color.size(0) > 0 && color.size(1) > 0 && color.size(2) > 0 && color.size(3) > 0, "color must have shape[>0, >0, >0, >0]");
-    NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == 4, "raster_out must have shape[>0, >0, >0, 4]");
+    if (p.rasterTri)
+        NVDR_CHECK(rast.sizes().size() == 3 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0, "raster_out must have shape[>0, >0, >0] in the compact layout");
+    else
+        NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == 4, "raster_out must have shape[>0, >0, >0, 4]");
     NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
     NVDR_CHECK(color.size(1) == rast.size(1) && color.size(2) == rast.size(2), "color and raster_out inputs must have same spatial dimensions");
     NVDR_CHECK(color.size(1) == dy.size(1) && color.size(2) == dy.size(2) && color.size(3) == dy.size(3), "color and dy inputs must have same dimensions");
-    if (p.instance_mode)
+    if (p.mtx)
+        NVDR_CHECK(dy.size(0) == color.size(0) && rast.size(0) == color.size(0) && mtx.size(0) == color.size(0), "minibatch size mismatch between inputs dy, color, raster_out, mtx");
+    else if (p.instance_mode)
     {
         NVDR_CHECK(pos.sizes().size() == 3 && pos.size(0) > 0 && pos.size(1) > 0 && pos.size(2) == 4, "pos must have shape [>0, >0, 4] or [>0, 4]");
         NVDR_CHECK(rast.size(0) == color.size(0) && pos.size(0) == color.size(0), "minibatch size mismatch between inputs color, raster_out, pos");
@@ -200,7 +273,7 @@ std::tuple<torch::Tensor, torch::Tensor> antialias_grad(torch::Tensor color, tor
     }
 
     // Extract input dimensions.
-    p.numVertices  = pos.size(p.instance_mode ? 1 : 0);
+    p.numVertices  = pos.size(pos.sizes().size() > 2 ? 1 : 0);
     p.numTriangles = tri.size(0);
     p.n            = color.size(0);
     p.height       = color.size(1);
@@ -213,7 +286,8 @@ std::tuple<torch::Tensor, torch::Tensor> antialias_grad(torch::Tensor color, tor
     // Get input pointers.
     p.color = color.data_ptr<float>();
     p.rasterOut = rast.data_ptr<float>();
-    p.tri = tri.data_ptr<int>();
+    p.tri = tri.data_ptr();
+    p.tri_u16 = nvdr_is_index16(tri);
     p.pos = pos.data_ptr<float>();
     p.dy = dy_.data_ptr<float>();
     p.workBuffer = (int4*)(work_buffer.data_ptr<float>());
@@ -225,28 +299,44 @@ std::tuple<torch::Tensor, torch::Tensor> antialias_grad(torch::Tensor color, tor
     // Allocate output tensors.
     torch::Tensor grad_color = dy_.detach().clone(); // Use dy as base.
     torch::Tensor grad_pos = torch::zeros_like(pos);
+    torch::Tensor grad_mtx = p.mtx ? torch::zeros_like(mtx) : torch::empty({0}, pos.options());
     p.gradColor = grad_color.data_ptr<float>();
     p.gradPos = grad_pos.data_ptr<float>();
-
-    // Clear gradient kernel work counter.
-    NVDR_CHECK_CUDA_ERROR(cudaMemsetAsync(&p.workBuffer[0].y, 0, sizeof(int), stream));
+    p.gradMtx = p.mtx ? grad_mtx.data_ptr<float>() : NULL;
 
     // Verify that buffers are aligned to allow float2/float4 operations.
     NVDR_CHECK(!((uintptr_t)p.pos        & 15), "pos input tensor not aligned to float4");
     NVDR_CHECK(!((uintptr_t)p.workBuffer & 15), "work_buffer internal tensor not aligned to int4");
 
+    // Run on the shared thread pool if on CPU. Reuses the work items of the forward pass.
+    if (cpu)
+    {
+        AntialiasCpuGrad(p, ThreadPool::getGlobal());
+        return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>(grad_color.to(dtype), grad_pos, grad_mtx);
+    }
+
+#ifndef NVDR_CPU_ONLY
+    // Clear gradient kernel work counter.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_CHECK_CUDA_ERROR(cudaMemsetAsync(&p.workBuffer[0].y, 0, sizeof(int), stream));
+
     // Determine optimum block size for the gradient kernel and launch.
     void* args[] = {&p};
     int device = 0;
     int numCTA = 0;
     int numSM  = 0;
+    void* func = p.tri_u16 ? (void*)AntialiasGradKernelU16 : (void*)AntialiasGradKernel;
     NVDR_CHECK_CUDA_ERROR(cudaGetDevice(&device));
-    NVDR_CHECK_CUDA_ERROR(cudaOccupancyMaxActiveBlocksPerMultiprocessor(&numCTA, (void*)AntialiasGradKernel, AA_GRAD_KERNEL_THREADS_PER_BLOCK, 0));
+    NVDR_CHECK_CUDA_ERROR(cudaOccupancyMaxActiveBlocksPerMultiprocessor(&numCTA, func, AA_GRAD_KERNEL_THREADS_PER_BLOCK, 0));
     NVDR_CHECK_CUDA_ERROR(cudaDeviceGetAttribute(&numSM, cudaDevAttrMultiProcessorCount, device));
-    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)AntialiasGradKernel, numCTA * numSM, AA_GRAD_KERNEL_THREADS_PER_BLOCK, args, 0, stream));
+    NVDR_PROFILE_DEVICE_RANGE("antialias_grad/kernel", stream);
+    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func, numCTA * numSM, AA_GRAD_KERNEL_THREADS_PER_BLOCK, args, 0, stream));
 
     // Return results.
-    return std::tuple<torch::Tensor, torch::Tensor>(grad_color, grad_pos);
+    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>(grad_color.to(dtype), grad_pos, grad_mtx);
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 //------------------------------------------------------------------------
@@ -8,6 +8,11 @@
 
 #include "torch_common.inl"
 #include "torch_types.h"
+#include "../common/profiler.h"
+#ifndef NVDR_CPU_ONLY
+#include "../common/cudaraster/Allocator.hpp"
+#include "../common/cudaraster/CudaRaster.hpp"
+#endif
 #include <tuple>
 
 //------------------------------------------------------------------------
@@ -19,14 +24,20 @@
 #define OP_RETURN_TTTT  std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor>
 #define OP_RETURN_TTV   std::tuple<torch::Tensor, torch::Tensor, std::vector<torch::Tensor> >
 #define OP_RETURN_TTTTV std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vector<torch::Tensor> >
+#define OP_RETURN_STATS std::map<std::string, torch::Tensor>
 
-OP_RETURN_TT        rasterize_fwd_cuda                  (RasterizeCRStateWrapper& stateWrapper, torch::Tensor pos, torch::Tensor tri, std::tuple<int, int> resolution, torch::Tensor ranges, int peeling_idx);
-OP_RETURN_T         rasterize_grad                      (torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy);
-OP_RETURN_T         rasterize_grad_db                   (torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy, torch::Tensor ddb);
-OP_RETURN_TT        interpolate_fwd                     (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri);
-OP_RETURN_TT        interpolate_fwd_da                  (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor rast_db, bool diff_attrs_all, std::vector<int>& diff_attrs_vec);
-OP_RETURN_TT        interpolate_grad                    (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy);
-OP_RETURN_TTT       interpolate_grad_da                 (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy, torch::Tensor rast_db, torch::Tensor dda, bool diff_attrs_all, std::vector<int>& diff_attrs_vec);
+#ifndef NVDR_CPU_ONLY
+OP_RETURN_TTTT      rasterize_fwd_cuda                  (RasterizeCRStateWrapper& stateWrapper, torch::Tensor pos, torch::Tensor tri, std::tuple<int, int> resolution, torch::Tensor ranges, int peeling_idx, int cull_mode, float cull_min_area, torch::Tensor mtx, bool compact);
+OP_RETURN_STATS     rasterize_stats_cuda                (RasterizeCRStateWrapper& stateWrapper);
+#endif
+OP_RETURN_TTTT      rasterize_fwd_cpu                   (RasterizeCpuStateWrapper& stateWrapper, torch::Tensor pos, torch::Tensor tri, std::tuple<int, int> resolution, torch::Tensor ranges, int peeling_idx, int cull_mode, float cull_min_area, torch::Tensor mtx, bool compact);
+OP_RETURN_STATS     rasterize_stats_cpu                 (RasterizeCpuStateWrapper& stateWrapper);
+OP_RETURN_TT        rasterize_grad                      (torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy, torch::Tensor mtx);
+OP_RETURN_TT        rasterize_grad_db                   (torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy, torch::Tensor ddb, torch::Tensor mtx);
+OP_RETURN_TT        interpolate_fwd                     (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor rast_tri);
+OP_RETURN_TT        interpolate_fwd_da                  (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor rast_db, bool diff_attrs_all, std::vector<int>& diff_attrs_vec, torch::Tensor rast_tri);
+OP_RETURN_TT        interpolate_grad                    (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy, torch::Tensor rast_tri);
+OP_RETURN_TTT       interpolate_grad_da                 (torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy, torch::Tensor rast_db, torch::Tensor dda, bool diff_attrs_all, std::vector<int>& diff_attrs_vec, torch::Tensor rast_tri);
 TextureMipWrapper   texture_construct_mip               (torch::Tensor tex, int max_mip_level, bool cube_mode);
 OP_RETURN_T         texture_fwd                         (torch::Tensor tex, torch::Tensor uv, int filter_mode, int boundary_mode);
 OP_RETURN_T         texture_fwd_mip                     (torch::Tensor tex, torch::Tensor uv, torch::Tensor uv_da, torch::Tensor mip_level_bias, TextureMipWrapper mip_wrapper, std::vector<torch::Tensor> mip_stack, int filter_mode, int boundary_mode);
@@ -35,23 +46,61 @@ OP_RETURN_TT        texture_grad_linear                 (torch::Tensor tex, torc
 OP_RETURN_TTV       texture_grad_linear_mipmap_nearest  (torch::Tensor tex, torch::Tensor uv, torch::Tensor dy, torch::Tensor uv_da, torch::Tensor mip_level_bias, TextureMipWrapper mip_wrapper, std::vector<torch::Tensor> mip_stack, int filter_mode, int boundary_mode);
 OP_RETURN_TTTTV     texture_grad_linear_mipmap_linear   (torch::Tensor tex, torch::Tensor uv, torch::Tensor dy, torch::Tensor uv_da, torch::Tensor mip_level_bias, TextureMipWrapper mip_wrapper, std::vector<torch::Tensor> mip_stack, int filter_mode, int boundary_mode);
 TopologyHashWrapper antialias_construct_topology_hash   (torch::Tensor tri);
-OP_RETURN_TT        antialias_fwd                       (torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, TopologyHashWrapper topology_hash);
-OP_RETURN_TT        antialias_grad                      (torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, torch::Tensor dy, torch::Tensor work_buffer);
+OP_RETURN_TT        antialias_fwd                       (torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, TopologyHashWrapper topology_hash, torch::Tensor mtx, torch::Tensor rast_tri);
+OP_RETURN_TTT       antialias_grad                      (torch::Tensor color, torch::Tensor rast, torch::Tensor pos, torch::Tensor tri, torch::Tensor dy, torch::Tensor work_buffer, torch::Tensor mtx, torch::Tensor rast_tri);
 
 //------------------------------------------------------------------------
 
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
-    // State classes.
-    pybind11::class_<RasterizeCRStateWrapper>(m, "RasterizeCRStateWrapper").def(pybind11::init<int>());
+    // State classes. Builds without Cuda have no CudaRaster.
+#ifndef NVDR_CPU_ONLY
+    pybind11::class_<RasterizeCRStateWrapper>(m, "RasterizeCRStateWrapper").def(pybind11::init<int>())
+        .def("allocator_stats", [](const RasterizeCRStateWrapper& self) {
+            CR::AllocatorStats s = self.deviceAllocator->getStats();
+            return std::map<std::string, long long>{{"num_allocs", s.numAllocs}, {"num_releases", s.numReleases}, {"bytes_allocated", s.bytesAllocated}, {"bytes_in_use", s.bytesInUse}, {"peak_bytes_in_use", s.peakBytesInUse}};
+        }, "internal buffer allocation counters")
+        .def("reset_allocator_stats", [](RasterizeCRStateWrapper& self) { self.deviceAllocator->resetStats(); })
+        .def("set_capacity_percentile", [](RasterizeCRStateWrapper& self, float percentile) { self.cr->setCapacityPercentile(percentile); })
+        .def("capacity_stats", [](const RasterizeCRStateWrapper& self) {
+            CR::CapacityStats s = self.cr->getCapacityStats();
+            return std::map<std::string, long long>{{"num_draws", s.numDraws}, {"num_retried", s.numRetried}, {"num_predicted", s.numPredicted}, {"num_mispredicted", s.numMispredicted}};
+        }, "intermediate buffer sizing counters")
+        .def("reset_capacity_stats", [](RasterizeCRStateWrapper& self) { self.cr->resetCapacityStats(); })
+        .def("set_memory_budget", [](RasterizeCRStateWrapper& self, size_t bytes) { self.cr->setMemoryBudget(bytes); })
+        .def_readonly("split_factor", &RasterizeCRStateWrapper::splitFactor, "number of chunks the triangles were drawn in by the latest rasterization");
+#endif
+    pybind11::class_<RasterizeCpuStateWrapper>(m, "RasterizeCpuStateWrapper").def(pybind11::init<int>());
     pybind11::class_<TextureMipWrapper>(m, "TextureMipWrapper").def(pybind11::init<>());
-    pybind11::class_<TopologyHashWrapper>(m, "TopologyHashWrapper");
+    pybind11::class_<TopologyHashWrapper>(m, "TopologyHashWrapper")
+        .def_property_readonly("device", [](const TopologyHashWrapper& self) { return self.ev_hash.device(); })
+        .def("to", [](const TopologyHashWrapper& self, torch::Device device) { TopologyHashWrapper r; r.ev_hash = self.ev_hash.to(device); return r; }, "copy to another device, the layout is the same on CPU and GPU");
 
     // Plumbing to torch/c10 logging system.
     m.def("get_log_level", [](void)     { return FLAGS_caffe2_log_level;  }, "get log level");
     m.def("set_log_level", [](int level){ FLAGS_caffe2_log_level = level; }, "set log level");
 
+    // Stage timing.
+    m.def("profiler_enable",        [](double rate)             { Profiler::get().enable(rate); }, "set fraction of op calls to profile, 0 = off");
+    m.def("profiler_reset",         [](void)                    { Profiler::get().reset(); }, "drop profiling records");
+    m.def("profiler_write_trace",   [](const std::string& path) { return Profiler::get().writeChromeTrace(path.c_str()); }, "write profiling records as chrome trace");
+    m.def("profiler_stats", [](void) {
+        std::map<std::string, std::map<std::string, double> > r;
+        std::map<std::string, ProfileStats> stats = Profiler::get().getStats();
+        for (std::map<std::string, ProfileStats>::const_iterator it = stats.begin(); it != stats.end(); ++it)
+        {
+            const ProfileStats& s = it->second;
+            r[it->first] = std::map<std::string, double>{{"count", (double)s.count}, {"total_us", s.totalUs}, {"mean_us", s.meanUs}, {"p50_us", s.p50Us}, {"p90_us", s.p90Us}, {"p99_us", s.p99Us}, {"max_us", s.maxUs}};
+        }
+        return r;
+    }, "per-stage profiling statistics");
+
     // Ops.
+#ifndef NVDR_CPU_ONLY
     m.def("rasterize_fwd_cuda",                 &rasterize_fwd_cuda,                    "rasterize forward op (cuda)");
+    m.def("rasterize_stats_cuda",               &rasterize_stats_cuda,                  "per-image statistics of the latest rasterize forward op (cuda)");
+#endif
+    m.def("rasterize_fwd_cpu",                  &rasterize_fwd_cpu,                     "rasterize forward op (cpu)");
+    m.def("rasterize_stats_cpu",                &rasterize_stats_cpu,                   "per-image statistics of the latest rasterize forward op (cpu)");
     m.def("rasterize_grad",                     &rasterize_grad,                        "rasterize gradient op ignoring db gradients");
     m.def("rasterize_grad_db",                  &rasterize_grad_db,                     "rasterize gradient op with db gradients");
     m.def("interpolate_fwd",                    &interpolate_fwd,                       "interpolate forward op with attribute derivatives");
@@ -8,7 +8,10 @@
 
 #pragma once
 #include "../common/framework.h"
-#ifdef USE_ROCM
+#include "../common/common.h"
+#include <map>
+#include <string>
+#if defined(USE_ROCM) && !defined(NVDR_CPU_ONLY)
 #include <ATen/hip/HIPUtils.h>
 #endif
 
@@ -22,11 +25,103 @@
 
 #define NVDR_CHECK_DEVICE(...) do { TORCH_CHECK(at::cuda::check_device({__VA_ARGS__}), __func__, "(): Inputs " #__VA_ARGS__ " must reside on the same GPU device") } while(0)
 #define NVDR_CHECK_CPU(...) do { nvdr_check_cpu({__VA_ARGS__}, __func__, "(): Inputs " #__VA_ARGS__ " must reside on CPU"); } while(0)
+#define NVDR_CHECK_DEVICE_OR_CPU(...) do { TORCH_CHECK(nvdr_check_device_or_cpu({__VA_ARGS__}), __func__, "(): Inputs " #__VA_ARGS__ " must all reside on CPU or on the same GPU device") } while(0)
 #define NVDR_CHECK_CONTIGUOUS(...) do { nvdr_check_contiguous({__VA_ARGS__}, __func__, "(): Inputs " #__VA_ARGS__ " must be contiguous tensors"); } while(0)
 #define NVDR_CHECK_F32(...) do { nvdr_check_f32({__VA_ARGS__}, __func__, "(): Inputs " #__VA_ARGS__ " must be float32 tensors"); } while(0)
+#define NVDR_CHECK_FLOAT(...) do { nvdr_check_float({__VA_ARGS__}, __func__, "(): Inputs " #__VA_ARGS__ " must be float32, float16 or bfloat16 tensors"); } while(0)
 #define NVDR_CHECK_I32(...) do { nvdr_check_i32({__VA_ARGS__}, __func__, "(): Inputs " #__VA_ARGS__ " must be int32 tensors"); } while(0)
+#define NVDR_CHECK_INDEX(...) do { nvdr_check_index({__VA_ARGS__}, __func__, "(): Inputs " #__VA_ARGS__ " must be int32, int16 or uint16 tensors"); } while(0)
 inline void nvdr_check_cpu(at::ArrayRef<at::Tensor> ts,        const char* func, const char* err_msg) { for (const at::Tensor& t : ts) TORCH_CHECK(t.device().type() == c10::DeviceType::CPU, func, err_msg); }
+#ifndef NVDR_CPU_ONLY
+inline bool nvdr_check_device_or_cpu(at::ArrayRef<at::Tensor> ts)                      { if (ts.empty() || !ts[0].is_cpu()) return at::cuda::check_device(ts); for (const at::Tensor& t : ts) if (!t.is_cpu()) return false; return true; }
+#else
+inline bool nvdr_check_device_or_cpu(at::ArrayRef<at::Tensor> ts)                      { for (const at::Tensor& t : ts) if (!t.is_cpu()) return false; return true; } // Builds without Cuda take CPU tensors only.
+#endif
 inline void nvdr_check_contiguous(at::ArrayRef<at::Tensor> ts, const char* func, const char* err_msg) { for (const at::Tensor& t : ts) TORCH_CHECK(t.is_contiguous(), func, err_msg); }
 inline void nvdr_check_f32(at::ArrayRef<at::Tensor> ts,        const char* func, const char* err_msg) { for (const at::Tensor& t : ts) TORCH_CHECK(t.dtype() == torch::kFloat32, func, err_msg); }
+inline void nvdr_check_float(at::ArrayRef<at::Tensor> ts,      const char* func, const char* err_msg) { for (const at::Tensor& t : ts) TORCH_CHECK(t.dtype() == torch::kFloat32 || t.dtype() == torch::kHalf || t.dtype() == torch::kBFloat16, func, err_msg); }
+inline int  nvdr_storage_type(const at::Tensor& t)                                      { return (t.dtype() == torch::kHalf) ? NVDR_STORAGE_F16 : (t.dtype() == torch::kBFloat16) ? NVDR_STORAGE_BF16 : NVDR_STORAGE_F32; }
 inline void nvdr_check_i32(at::ArrayRef<at::Tensor> ts,        const char* func, const char* err_msg) { for (const at::Tensor& t : ts) TORCH_CHECK(t.dtype() == torch::kInt32, func, err_msg); }
+inline bool nvdr_is_index16(const at::Tensor& t)                                       { return t.element_size() == 2 && !t.is_floating_point() && !t.is_complex(); } // int16 or uint16, both read as uint16.
+inline void nvdr_check_index(at::ArrayRef<at::Tensor> ts,      const char* func, const char* err_msg) { for (const at::Tensor& t : ts) TORCH_CHECK(t.dtype() == torch::kInt32 || nvdr_is_index16(t), func, err_msg); }
+//------------------------------------------------------------------------
+
+//------------------------------------------------------------------------
+// Device guard for ops that take CPU or Cuda tensors. Builds without Cuda
+// compile out the device code paths of the ops, and their input checks
+// only accept CPU tensors.
+
+#ifndef NVDR_CPU_ONLY
+#define NVDR_DEVICE_GUARD(CPU, TENSOR) const at::cuda::OptionalCUDAGuard device_guard((CPU) ? c10::optional<c10::Device>() : device_of(TENSOR))
+#else
+#define NVDR_DEVICE_GUARD(CPU, TENSOR) do {} while(0)
+#endif
+#define NVDR_NO_CUDA_SUPPORT() TORCH_CHECK(false, __func__, "(): nvdiffrast was built without Cuda support")
+
+//------------------------------------------------------------------------
+// Per-image vertex transforms. An empty mtx tensor means none. Otherwise
+// pos holds shared [V, 4] positions and mtx one row-major 4x4 matrix per
+// image. Returns the matrix pointer, or NULL if none were given.
+//------------------------------------------------------------------------
+
+inline const float* nvdr_get_vertex_transforms(const torch::Tensor& pos, const torch::Tensor& mtx, const char* func)
+{
+    if (!mtx.defined() || !mtx.nbytes())
+        return NULL;
+    TORCH_CHECK(mtx.device() == pos.device(), func, "(): Inputs pos, mtx must reside on the same device");
+    TORCH_CHECK(mtx.is_contiguous() && mtx.dtype() == torch::kFloat32, func, "(): Input mtx must be a contiguous float32 tensor");
+    TORCH_CHECK(mtx.sizes().size() == 3 && mtx.size(0) > 0 && mtx.size(1) == 4 && mtx.size(2) == 4, func, "(): mtx must have shape [>0, 4, 4]");
+    TORCH_CHECK(pos.sizes().size() == 2 && pos.size(0) > 0 && pos.size(1) == 4, func, "(): pos must have shape [>0, 4] when mtx is given");
+    const float* ptr = mtx.data_ptr<float>();
+    TORCH_CHECK(!((uintptr_t)ptr & 15), func, "(): mtx input tensor not aligned to float4");
+    return ptr;
+}
+
+//------------------------------------------------------------------------
+// Compact rasterizer output, see rasterize.h. An empty rast_tri tensor means
+// rast is in the float4 layout. Otherwise rast_tri holds the int32 triangle
+// ids and rast one of the other planes, checked by the caller. Returns the
+// id pointer, or NULL if the output is not compact.
+//------------------------------------------------------------------------
+
+inline const int* nvdr_get_compact_tri_ids(const torch::Tensor& rast, const torch::Tensor& rast_tri, const char* func)
+{
+    if (!rast_tri.defined() || !rast_tri.nbytes())
+        return NULL;
+    TORCH_CHECK(rast_tri.device() == rast.device(), func, "(): Inputs rast, rast_tri must reside on the same device");
+    TORCH_CHECK(rast_tri.is_contiguous() && rast_tri.dtype() == torch::kInt32, func, "(): Input rast_tri must be a contiguous int32 tensor");
+    TORCH_CHECK(rast_tri.sizes().size() == 3 && rast.sizes().size() >= 3 && rast_tri.size(0) == rast.size(0) && rast_tri.size(1) == rast.size(1) && rast_tri.size(2) == rast.size(2), func, "(): rast_tri must have shape [minibatch_size, height, width] of rast");
+    return rast_tri.data_ptr<int>();
+}
+
+//------------------------------------------------------------------------
+// Per-image rasterizer statistics as a dict of int64 tensors on CPU. Works
+// with both CudaRaster and CpuRaster stats, which have the same fields.
+//------------------------------------------------------------------------
+
+template<class T> std::map<std::string, torch::Tensor> nvdr_image_stats_to_dict(const T* stats, int numImages, size_t bufferBytes)
+{
+    torch::Tensor t = torch::empty({8, numImages}, torch::TensorOptions().dtype(torch::kInt64).device(torch::kCPU));
+    int64_t* p = t.data_ptr<int64_t>();
+    for (int i=0; i < numImages; i++)
+    {
+        const T& s = stats[i];
+        p[0 * numImages + i] = s.numSubtris;
+        p[1 * numImages + i] = s.numBinSegs;
+        p[2 * numImages + i] = s.numTileSegs;
+        p[3 * numImages + i] = s.numActiveTiles;
+        p[4 * numImages + i] = s.numRetries;
+        p[5 * numImages + i] = s.maxSubtris;
+        p[6 * numImages + i] = s.maxBinSegs;
+        p[7 * numImages + i] = s.maxTileSegs;
+    }
+
+    std::map<std::string, torch::Tensor> d;
+    const char* names[] = { "num_subtris", "num_bin_segs", "num_tile_segs", "num_active_tiles", "num_retries", "max_subtris", "max_bin_segs", "max_tile_segs" };
+    for (int i=0; i < 8; i++)
+        d[names[i]] = t[i];
+    d["bytes_allocated"] = torch::tensor((int64_t)bufferBytes, torch::TensorOptions().dtype(torch::kInt64));
+    return d;
+}
+
 //------------------------------------------------------------------------
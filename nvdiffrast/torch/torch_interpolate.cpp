@@ -9,7 +9,9 @@
 #include "torch_common.inl"
 #include "../common/common.h"
 #include "../common/interpolate.h"
-#ifdef USE_ROCM
+#include "../common/profiler.h"
+#include "../common/threadpool.h"
+#if defined(USE_ROCM) && !defined(NVDR_CPU_ONLY)
 #include <ATen/hip/impl/HIPGuardImplMasqueradingAsCUDA.h>
 #endif
 
@@ -22,10 +24,30 @@
 #define LAUNCH_KERNEL cudaLaunchKernel
 #endif
 
-void InterpolateFwdKernel   (const InterpolateKernelParams p);
-void InterpolateFwdKernelDa (const InterpolateKernelParams p);
-void InterpolateGradKernel  (const InterpolateKernelParams p);
-void InterpolateGradKernelDa(const InterpolateKernelParams p);
+void InterpolateFwdKernel          (const InterpolateKernelParams p);
+void InterpolateFwdKernelDa        (const InterpolateKernelParams p);
+void InterpolateFwdKernelU16       (const InterpolateKernelParams p);
+void InterpolateFwdKernelDaU16     (const InterpolateKernelParams p);
+void InterpolateFwdKernelF16       (const InterpolateKernelParams p);
+void InterpolateFwdKernelDaF16     (const InterpolateKernelParams p);
+void InterpolateFwdKernelU16F16    (const InterpolateKernelParams p);
+void InterpolateFwdKernelDaU16F16  (const InterpolateKernelParams p);
+void InterpolateFwdKernelBF16      (const InterpolateKernelParams p);
+void InterpolateFwdKernelDaBF16    (const InterpolateKernelParams p);
+void InterpolateFwdKernelU16BF16   (const InterpolateKernelParams p);
+void InterpolateFwdKernelDaU16BF16 (const InterpolateKernelParams p);
+void InterpolateGradKernel         (const InterpolateKernelParams p);
+void InterpolateGradKernelDa       (const InterpolateKernelParams p);
+void InterpolateGradKernelU16      (const InterpolateKernelParams p);
+void InterpolateGradKernelDaU16    (const InterpolateKernelParams p);
+void InterpolateGradKernelF16      (const InterpolateKernelParams p);
+void InterpolateGradKernelDaF16    (const InterpolateKernelParams p);
+void InterpolateGradKernelU16F16   (const InterpolateKernelParams p);
+void InterpolateGradKernelDaU16F16 (const InterpolateKernelParams p);
+void InterpolateGradKernelBF16     (const InterpolateKernelParams p);
+void InterpolateGradKernelDaBF16   (const InterpolateKernelParams p);
+void InterpolateGradKernelU16BF16  (const InterpolateKernelParams p);
+void InterpolateGradKernelDaU16BF16(const InterpolateKernelParams p);
 
 //------------------------------------------------------------------------
 // Helper
@@ -48,32 +70,42 @@ static void set_diff_attrs(InterpolateKernelParams& p, bool diff_attrs_all, std:
 //------------------------------------------------------------------------
 // Forward op.
 
-std::tuple<torch::Tensor, torch::Tensor> interpolate_fwd_da(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor rast_db, bool diff_attrs_all, std::vector<int>& diff_attrs_vec)
+std::tuple<torch::Tensor, torch::Tensor> interpolate_fwd_da(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor rast_db, bool diff_attrs_all, std::vector<int>& diff_attrs_vec, torch::Tensor rast_tri)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(attr));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("interpolate_fwd");
+    bool cpu = attr.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, attr);
     InterpolateKernelParams p = {}; // Initialize all fields to zero.
     bool enable_da = (rast_db.defined()) && (diff_attrs_all || !diff_attrs_vec.empty());
     p.instance_mode = (attr.sizes().size() > 2) ? 1 : 0;
 
+    // Compact rasterizer output has fp16 barycentrics in rast and fp16 rast_db.
+    const int* rastTri = nvdr_get_compact_tri_ids(rast, rast_tri, __func__);
+    torch::ScalarType rastType = rastTri ? torch::kFloat16 : torch::kFloat32;
+    int rastChannels = rastTri ? 2 : 4;
+
     // Check inputs.
+    ProfileRange checks("interpolate_fwd/checks");
     if (enable_da)
     {
-        NVDR_CHECK_DEVICE(attr, rast, tri, rast_db);
+        NVDR_CHECK_DEVICE_OR_CPU(attr, rast, tri, rast_db);
         NVDR_CHECK_CONTIGUOUS(attr, rast, tri, rast_db);
-        NVDR_CHECK_F32(attr, rast, rast_db);
-        NVDR_CHECK_I32(tri);
+        NVDR_CHECK_FLOAT(attr);
+        NVDR_CHECK(rast.scalar_type() == rastType && rast_db.scalar_type() == rastType, "rast and rast_db must be float32, or float16 in the compact layout");
+        NVDR_CHECK_INDEX(tri);
     }
     else
     {
-        NVDR_CHECK_DEVICE(attr, rast, tri);
+        NVDR_CHECK_DEVICE_OR_CPU(attr, rast, tri);
         NVDR_CHECK_CONTIGUOUS(attr, rast, tri);
-        NVDR_CHECK_F32(attr, rast);
-        NVDR_CHECK_I32(tri);
+        NVDR_CHECK_FLOAT(attr);
+        NVDR_CHECK(rast.scalar_type() == rastType, "rast must be float32, or float16 in the compact layout");
+        NVDR_CHECK_INDEX(tri);
     }
+    checks.end();
 
     // Sanity checks.
-    NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == 4, "rast must have shape[>0, >0, >0, 4]");
+    NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == rastChannels, "rast must have shape[>0, >0, >0, 4], or [>0, >0, >0, 2] in the compact layout");
     NVDR_CHECK( tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
     NVDR_CHECK((attr.sizes().size() == 2 || attr.sizes().size() == 3) && attr.size(0) > 0 && attr.size(1) > 0 && (attr.sizes().size() == 2 || attr.size(2) > 0), "attr must have shape [>0, >0, >0] or [>0, >0]");
     if (p.instance_mode)
@@ -99,79 +131,123 @@ std::tuple<torch::Tensor, torch::Tensor> interpolate_fwd_da(torch::Tensor attr,
     else
         p.numDiffAttr = 0;
 
+    // Half precision attributes are upcast to fp32 on CPU, and outputs converted back.
+    torch::ScalarType dtype = attr.scalar_type();
+    int storage = nvdr_storage_type(attr);
+    if (cpu && storage != NVDR_STORAGE_F32)
+        attr = attr.to(torch::kFloat32);
+    if (cpu && rastTri)
+    {
+        rast = rast.to(torch::kFloat32);
+        if (enable_da)
+            rast_db = rast_db.to(torch::kFloat32);
+    }
+
     // Get input pointers.
-    p.attr = attr.data_ptr<float>();
-    p.rast = rast.data_ptr<float>();
-    p.tri = tri.data_ptr<int>();
-    p.rastDB = enable_da ? rast_db.data_ptr<float>() : NULL;
+    p.attr = attr.data_ptr();
+    p.rast = rast.data_ptr();
+    p.rastTri = rastTri;
+    p.tri = tri.data_ptr();
+    p.tri_u16 = nvdr_is_index16(tri);
+    p.rastDB = enable_da ? rast_db.data_ptr() : NULL;
     p.attrBC = (p.instance_mode && attr.size(0) == 1) ? 1 : 0;
 
-    // Allocate output tensors.
-    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCUDA);
+    // Allocate output tensors in the attribute type.
+    torch::TensorOptions opts = torch::TensorOptions().dtype(attr.scalar_type()).device(cpu ? torch::kCPU : torch::kCUDA);
     torch::Tensor out = torch::empty({p.depth, p.height, p.width, p.numAttr}, opts);
     torch::Tensor out_da = torch::empty({p.depth, p.height, p.width, p.numDiffAttr * 2}, opts);
 
-    p.out = out.data_ptr<float>();
-    p.outDA = enable_da ? out_da.data_ptr<float>() : NULL;
+    p.out = out.data_ptr();
+    p.outDA = enable_da ? out_da.data_ptr() : NULL;
 
     // Verify that buffers are aligned to allow float2/float4 operations.
-    NVDR_CHECK(!((uintptr_t)p.rast   & 15), "rast input tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.rastDB & 15), "rast_db input tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.outDA  &  7), "out_da output tensor not aligned to float2");
+    NVDR_CHECK(!((uintptr_t)p.rast   & (rastChannels * rast.element_size() - 1)), "rast input tensor not aligned to a whole pixel");
+    NVDR_CHECK(!((uintptr_t)p.rastDB & (4 * rast.element_size() - 1)), "rast_db input tensor not aligned to a whole pixel");
+    NVDR_CHECK(!((uintptr_t)p.outDA  & (2 * out_da.element_size() - 1)), "out_da output tensor not aligned to two elements");
 
+    // Run on the shared thread pool if on CPU.
+    if (cpu)
+    {
+        InterpolateCpuFwd(p, enable_da, ThreadPool::getGlobal());
+        return std::tuple<torch::Tensor, torch::Tensor>(out.to(dtype), out_da.to(dtype));
+    }
+
+#ifndef NVDR_CPU_ONLY
     // Choose launch parameters.
     dim3 blockSize = getLaunchBlockSize(IP_FWD_MAX_KERNEL_BLOCK_WIDTH, IP_FWD_MAX_KERNEL_BLOCK_HEIGHT, p.width, p.height);
     dim3 gridSize  = getLaunchGridSize(blockSize, p.width, p.height, p.depth);
 
     // Launch CUDA kernel.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
     void* args[] = {&p};
-    void* func = enable_da ? (void*)InterpolateFwdKernelDa : (void*)InterpolateFwdKernel;
+    static void* const func_tbl[3][4] = {
+        { (void*)InterpolateFwdKernel,     (void*)InterpolateFwdKernelDa,     (void*)InterpolateFwdKernelU16,     (void*)InterpolateFwdKernelDaU16     },
+        { (void*)InterpolateFwdKernelF16,  (void*)InterpolateFwdKernelDaF16,  (void*)InterpolateFwdKernelU16F16,  (void*)InterpolateFwdKernelDaU16F16  },
+        { (void*)InterpolateFwdKernelBF16, (void*)InterpolateFwdKernelDaBF16, (void*)InterpolateFwdKernelU16BF16, (void*)InterpolateFwdKernelDaU16BF16 },
+    };
+    void* func = func_tbl[storage][(p.tri_u16 ? 2 : 0) + (enable_da ? 1 : 0)];
+    NVDR_PROFILE_DEVICE_RANGE("interpolate_fwd/kernel", stream);
     NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func, gridSize, blockSize, args, 0, stream));
 
     // Return results.
     return std::tuple<torch::Tensor, torch::Tensor>(out, out_da);
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 // Version without derivatives.
-std::tuple<torch::Tensor, torch::Tensor> interpolate_fwd(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri)
+std::tuple<torch::Tensor, torch::Tensor> interpolate_fwd(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor rast_tri)
 {
     std::vector<int> empty_vec;
     torch::Tensor empty_tensor;
-    return interpolate_fwd_da(attr, rast, tri, empty_tensor, false, empty_vec);
+    return interpolate_fwd_da(attr, rast, tri, empty_tensor, false, empty_vec, rast_tri);
 }
 
 //------------------------------------------------------------------------
 // Gradient op.
 
-std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> interpolate_grad_da(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy, torch::Tensor rast_db, torch::Tensor dda, bool diff_attrs_all, std::vector<int>& diff_attrs_vec)
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> interpolate_grad_da(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy, torch::Tensor rast_db, torch::Tensor dda, bool diff_attrs_all, std::vector<int>& diff_attrs_vec, torch::Tensor rast_tri)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(attr));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("interpolate_grad");
+    bool cpu = attr.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, attr);
     InterpolateKernelParams p = {}; // Initialize all fields to zero.
     bool enable_da = (rast_db.defined()) && (diff_attrs_all || !diff_attrs_vec.empty());
     p.instance_mode = (attr.sizes().size() > 2) ? 1 : 0;
 
+    // Compact rasterizer output, the gradients are returned in the same layout.
+    const int* rastTri = nvdr_get_compact_tri_ids(rast, rast_tri, __func__);
+    torch::ScalarType rastType = rastTri ? torch::kFloat16 : torch::kFloat32;
+    int rastChannels = rastTri ? 2 : 4;
+
     // Check inputs.
+    ProfileRange checks("interpolate_grad/checks");
     if (enable_da)
     {
-        NVDR_CHECK_DEVICE(attr, rast, tri, dy, rast_db, dda);
+        NVDR_CHECK_DEVICE_OR_CPU(attr, rast, tri, dy, rast_db, dda);
         NVDR_CHECK_CONTIGUOUS(attr, rast, tri, rast_db);
-        NVDR_CHECK_F32(attr, rast, dy, rast_db, dda);
-        NVDR_CHECK_I32(tri);
+        NVDR_CHECK_FLOAT(attr);
+        NVDR_CHECK(rast.scalar_type() == rastType && rast_db.scalar_type() == rastType, "rast and rast_db must be float32, or float16 in the compact layout");
+        NVDR_CHECK_INDEX(tri);
+        NVDR_CHECK(dy.dtype() == attr.dtype() && dda.dtype() == attr.dtype(), "dy and dda must have the same dtype as attr");
     }
     else
     {
-        NVDR_CHECK_DEVICE(attr, rast, tri, dy);
+        NVDR_CHECK_DEVICE_OR_CPU(attr, rast, tri, dy);
         NVDR_CHECK_CONTIGUOUS(attr, rast, tri);
-        NVDR_CHECK_F32(attr, rast, dy);
-        NVDR_CHECK_I32(tri);
+        NVDR_CHECK_FLOAT(attr);
+        NVDR_CHECK(rast.scalar_type() == rastType, "rast must be float32, or float16 in the compact layout");
+        NVDR_CHECK_INDEX(tri);
+        NVDR_CHECK(dy.dtype() == attr.dtype(), "dy must have the same dtype as attr");
     }
+    checks.end();
 
     // Depth of attributes.
     int attr_depth = p.instance_mode ? (attr.sizes().size() > 1 ? attr.size(0) : 0) : 1;
 
     // Sanity checks.
-    NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == 4, "rast must have shape[>0, >0, >0, 4]");
+    NVDR_CHECK(rast.sizes().size() == 4 && rast.size(0) > 0 && rast.size(1) > 0 && rast.size(2) > 0 && rast.size(3) == rastChannels, "rast must have shape[>0, >0, >0, 4], or [>0, >0, >0, 2] in the compact layout");
     NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
     NVDR_CHECK((attr.sizes().size() == 2 || attr.sizes().size() == 3) && attr.size(0) > 0 && attr.size(1) > 0 && (attr.sizes().size() == 2 || attr.size(2) > 0), "attr must have shape [>0, >0, >0] or [>0, >0]");
     NVDR_CHECK(dy.sizes().size() == 4 && dy.size(0) > 0 && dy.size(1) == rast.size(1) && dy.size(2) == rast.size(2) && dy.size(3) > 0, "dy must have shape [>0, height, width, >0]");
@@ -194,11 +270,22 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> interpolate_grad_da(torc
     p.width        = rast.size(2);
     p.depth        = rast.size(0);
 
-    // Ensure gradients are contiguous.
-    torch::Tensor dy_ = dy.contiguous();
+    // Ensure gradients are contiguous. Half precision data is upcast on CPU.
+    torch::ScalarType dtype = attr.scalar_type();
+    int storage = nvdr_storage_type(attr);
+    bool upcast = cpu && storage != NVDR_STORAGE_F32;
+    torch::Tensor dy_ = upcast ? dy.to(torch::kFloat32).contiguous() : dy.contiguous();
     torch::Tensor dda_;
     if (enable_da)
-        dda_ = dda.contiguous();
+        dda_ = upcast ? dda.to(torch::kFloat32).contiguous() : dda.contiguous();
+    if (upcast)
+        attr = attr.to(torch::kFloat32);
+    if (cpu && rastTri)
+    {
+        rast = rast.to(torch::kFloat32);
+        if (enable_da)
+            rast_db = rast_db.to(torch::kFloat32);
+    }
 
     // Set attribute pixel differential info if enabled, otherwise leave as zero.
     if (enable_da)
@@ -207,52 +294,78 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> interpolate_grad_da(torc
         p.numDiffAttr = 0;
 
     // Get input pointers.
-    p.attr = attr.data_ptr<float>();
-    p.rast = rast.data_ptr<float>();
-    p.tri = tri.data_ptr<int>();
-    p.dy = dy_.data_ptr<float>();
-    p.rastDB = enable_da ? rast_db.data_ptr<float>() : NULL;
-    p.dda = enable_da ? dda_.data_ptr<float>() : NULL;
+    p.attr = attr.data_ptr();
+    p.rast = rast.data_ptr();
+    p.rastTri = rastTri;
+    p.tri = tri.data_ptr();
+    p.tri_u16 = nvdr_is_index16(tri);
+    p.dy = dy_.data_ptr();
+    p.rastDB = enable_da ? rast_db.data_ptr() : NULL;
+    p.dda = enable_da ? dda_.data_ptr() : NULL;
     p.attrBC = (p.instance_mode && attr_depth < p.depth) ? 1 : 0;
 
-    // Allocate output tensors.
-    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCUDA);
-    torch::Tensor gradAttr = torch::zeros_like(attr);
+    // Allocate output tensors. Attribute gradients are accumulated in fp32.
+    torch::Tensor gradAttr = torch::zeros(attr.sizes(), attr.options().dtype(torch::kFloat32));
     torch::Tensor gradRaster = torch::empty_like(rast);
     torch::Tensor gradRasterDB;
     if (enable_da)
         gradRasterDB = torch::empty_like(rast_db);
 
     p.gradAttr = gradAttr.data_ptr<float>();
-    p.gradRaster = gradRaster.data_ptr<float>();
-    p.gradRasterDB = enable_da ? gradRasterDB.data_ptr<float>() : NULL;
+    p.gradRaster = gradRaster.data_ptr();
+    p.gradRasterDB = enable_da ? gradRasterDB.data_ptr() : NULL;
 
     // Verify that buffers are aligned to allow float2/float4 operations.
-    NVDR_CHECK(!((uintptr_t)p.rast         & 15), "rast input tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.rastDB       & 15), "rast_db input tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.dda          &  7), "dda input tensor not aligned to float2");
-    NVDR_CHECK(!((uintptr_t)p.gradRaster   & 15), "grad_rast output tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.gradRasterDB & 15), "grad_rast_db output tensor not aligned to float4");
+    int rastAlign = rastChannels * rast.element_size() - 1;
+    NVDR_CHECK(!((uintptr_t)p.rast         & rastAlign), "rast input tensor not aligned to a whole pixel");
+    NVDR_CHECK(!((uintptr_t)p.rastDB       & (4 * rast.element_size() - 1)), "rast_db input tensor not aligned to a whole pixel");
+    NVDR_CHECK(!((uintptr_t)p.dda          & (2 * attr.element_size() - 1)), "dda input tensor not aligned to two elements");
+    NVDR_CHECK(!((uintptr_t)p.gradRaster   & rastAlign), "grad_rast output tensor not aligned to a whole pixel");
+    NVDR_CHECK(!((uintptr_t)p.gradRasterDB & (4 * rast.element_size() - 1)), "grad_rast_db output tensor not aligned to a whole pixel");
+
+    // Run on the shared thread pool if on CPU. Compact gradients go back to fp16.
+    if (cpu)
+    {
+        InterpolateCpuGrad(p, enable_da, ThreadPool::getGlobal());
+        if (rastTri)
+        {
+            gradRaster = gradRaster.to(rastType);
+            if (enable_da)
+                gradRasterDB = gradRasterDB.to(rastType);
+        }
+        return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>(gradAttr.to(dtype), gradRaster, gradRasterDB);
+    }
 
+#ifndef NVDR_CPU_ONLY
     // Choose launch parameters.
     dim3 blockSize = getLaunchBlockSize(IP_GRAD_MAX_KERNEL_BLOCK_WIDTH, IP_GRAD_MAX_KERNEL_BLOCK_HEIGHT, p.width, p.height);
     dim3 gridSize  = getLaunchGridSize(blockSize, p.width, p.height, p.depth);
 
     // Launch CUDA kernel.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
     void* args[] = {&p};
-    void* func = enable_da ? (void*)InterpolateGradKernelDa : (void*)InterpolateGradKernel;
+    static void* const func_tbl[3][4] = {
+        { (void*)InterpolateGradKernel,     (void*)InterpolateGradKernelDa,     (void*)InterpolateGradKernelU16,     (void*)InterpolateGradKernelDaU16     },
+        { (void*)InterpolateGradKernelF16,  (void*)InterpolateGradKernelDaF16,  (void*)InterpolateGradKernelU16F16,  (void*)InterpolateGradKernelDaU16F16  },
+        { (void*)InterpolateGradKernelBF16, (void*)InterpolateGradKernelDaBF16, (void*)InterpolateGradKernelU16BF16, (void*)InterpolateGradKernelDaU16BF16 },
+    };
+    void* func = func_tbl[storage][(p.tri_u16 ? 2 : 0) + (enable_da ? 1 : 0)];
+    NVDR_PROFILE_DEVICE_RANGE("interpolate_grad/kernel", stream);
     NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func, gridSize, blockSize, args, 0, stream));
 
     // Return results.
-    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>(gradAttr, gradRaster, gradRasterDB);
+    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>(gradAttr.to(dtype), gradRaster, gradRasterDB);
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 // Version without derivatives.
-std::tuple<torch::Tensor, torch::Tensor> interpolate_grad(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy)
+std::tuple<torch::Tensor, torch::Tensor> interpolate_grad(torch::Tensor attr, torch::Tensor rast, torch::Tensor tri, torch::Tensor dy, torch::Tensor rast_tri)
 {
     std::vector<int> empty_vec;
     torch::Tensor empty_tensor;
-    std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> result = interpolate_grad_da(attr, rast, tri, dy, empty_tensor, empty_tensor, false, empty_vec);
+    std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> result = interpolate_grad_da(attr, rast, tri, dy, empty_tensor, empty_tensor, false, empty_vec, rast_tri);
     return std::tuple<torch::Tensor, torch::Tensor>(std::get<0>(result), std::get<1>(result));
 }
 
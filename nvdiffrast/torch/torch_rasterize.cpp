@@ -10,11 +10,23 @@
 #include "torch_types.h"
 #include "../common/common.h"
 #include "../common/rasterize.h"
+#include "../common/profiler.h"
+#include "../common/threadpool.h"
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#ifndef NVDR_CPU_ONLY
 #include "../common/cudaraster/CudaRaster.hpp"
+#include "../common/cudaraster/Allocator.hpp"
 #include "../common/cudaraster/impl/Constants.hpp"
-#include <tuple>
 #ifdef USE_ROCM
 #include <ATen/hip/impl/HIPGuardImplMasqueradingAsCUDA.h>
+#include <c10/hip/HIPCachingAllocator.h>
+#define CACHING_ALLOCATOR c10::hip::HIPCachingAllocator
+#else
+#include <c10/cuda/CUDACachingAllocator.h>
+#define CACHING_ALLOCATOR c10::cuda::CUDACachingAllocator
+#endif
 #endif
 
 //------------------------------------------------------------------------
@@ -27,8 +39,24 @@
 #endif
 
 void RasterizeCudaFwdShaderKernel(const RasterizeCudaFwdShaderParams p);
+void RasterizeCudaFwdShaderKernelU16(const RasterizeCudaFwdShaderParams p);
 void RasterizeGradKernel(const RasterizeGradParams p);
 void RasterizeGradKernelDb(const RasterizeGradParams p);
+void RasterizeGradKernelU16(const RasterizeGradParams p);
+void RasterizeGradKernelDbU16(const RasterizeGradParams p);
+
+#ifndef NVDR_CPU_ONLY
+
+//------------------------------------------------------------------------
+// CudaRaster buffers from the PyTorch caching allocator. Memory is tied to
+// the current stream, which is where CudaRaster uses it.
+
+class TorchCachingAllocator : public CR::Allocator
+{
+protected:
+    void* doAllocate(size_t bytes)              { return CACHING_ALLOCATOR::raw_alloc(bytes); }
+    void  doRelease(void* ptr, size_t bytes)    { CACHING_ALLOCATOR::raw_delete(ptr); }
+};
 
 //------------------------------------------------------------------------
 // Python CudaRaster state wrapper methods.
@@ -37,49 +65,60 @@ RasterizeCRStateWrapper::RasterizeCRStateWrapper(int cudaDeviceIdx_)
 {
     const at::cuda::OptionalCUDAGuard device_guard(cudaDeviceIdx_);
     cudaDeviceIdx = cudaDeviceIdx_;
+    splitFactor = 1;
+    deviceAllocator = new TorchCachingAllocator();
     cr = new CR::CudaRaster();
+    cr->setAllocators(deviceAllocator, NULL); // Page-locked host buffers are small, keep them from the driver.
 }
 
 RasterizeCRStateWrapper::~RasterizeCRStateWrapper(void)
 {
     const at::cuda::OptionalCUDAGuard device_guard(cudaDeviceIdx);
     delete cr;
+    delete deviceAllocator;
 }
 
 //------------------------------------------------------------------------
 // Forward op (Cuda).
 
-std::tuple<torch::Tensor, torch::Tensor> rasterize_fwd_cuda(RasterizeCRStateWrapper& stateWrapper, torch::Tensor pos, torch::Tensor tri, std::tuple<int, int> resolution, torch::Tensor ranges, int peeling_idx)
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor> rasterize_fwd_cuda(RasterizeCRStateWrapper& stateWrapper, torch::Tensor pos, torch::Tensor tri, std::tuple<int, int> resolution, torch::Tensor ranges, int peeling_idx, int cull_mode, float cull_min_area, torch::Tensor mtx, bool compact)
 {
+    NVDR_PROFILE_RANGE("rasterize_fwd_cuda");
     const at::cuda::OptionalCUDAGuard device_guard(device_of(pos));
     cudaStream_t stream = at::cuda::getCurrentCUDAStream();
     CR::CudaRaster* cr = stateWrapper.cr;
 
     // Check inputs.
+    ProfileRange checks("rasterize_fwd_cuda/checks");
     NVDR_CHECK_DEVICE(pos, tri);
     NVDR_CHECK_CPU(ranges);
     NVDR_CHECK_CONTIGUOUS(pos, tri, ranges);
     NVDR_CHECK_F32(pos);
-    NVDR_CHECK_I32(tri, ranges);
+    NVDR_CHECK_I32(ranges);
+    NVDR_CHECK_INDEX(tri);
+    checks.end();
 
     // Check that CudaRaster context was created for the correct GPU.
     NVDR_CHECK(pos.get_device() == stateWrapper.cudaDeviceIdx, "CudaRaster context must must reside on the same device as input tensors");
 
-    // Determine instance mode and check input dimensions.
-    bool instance_mode = pos.sizes().size() > 2;
-    if (instance_mode)
+    // Determine instance mode and check input dimensions. Shared vertices with per-image transforms are drawn in instance mode.
+    const float* mtxPtr = nvdr_get_vertex_transforms(pos, mtx, __func__);
+    bool instance_mode = pos.sizes().size() > 2 || mtxPtr;
+    if (instance_mode && !mtxPtr)
         NVDR_CHECK(pos.sizes().size() == 3 && pos.size(0) > 0 && pos.size(1) > 0 && pos.size(2) == 4, "instance mode - pos must have shape [>0, >0, 4]");
-    else
+    else if (!instance_mode)
     {
         NVDR_CHECK(pos.sizes().size() == 2 && pos.size(0) > 0 && pos.size(1) == 4, "range mode - pos must have shape [>0, 4]");
         NVDR_CHECK(ranges.sizes().size() == 2 && ranges.size(0) > 0 && ranges.size(1) == 2, "range mode - ranges must have shape [>0, 2]");
     }
     NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
+    NVDR_CHECK(cull_mode >= 0 && cull_mode <= 2, "cull_mode must be 0 (none), 1 (back) or 2 (front)");
+    NVDR_CHECK(cull_min_area >= 0.f, "cull_min_area must be non-negative");
 
     // Get output shape.
     int height_out = std::get<0>(resolution);
     int width_out  = std::get<1>(resolution);
-    int depth      = instance_mode ? pos.size(0) : ranges.size(0); // Depth of tensor, not related to depth buffering.
+    int depth      = mtxPtr ? mtx.size(0) : instance_mode ? pos.size(0) : ranges.size(0); // Depth of tensor, not related to depth buffering.
     NVDR_CHECK(height_out > 0 && width_out > 0, "resolution must be [>0, >0]");
 
     // Round internal resolution up to tile size.
@@ -87,63 +126,109 @@ std::tuple<torch::Tensor, torch::Tensor> rasterize_fwd_cuda(RasterizeCRStateWrap
     int width  = (width_out  + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
 
     // Get position and triangle buffer sizes in vertices / triangles.
-    int posCount = instance_mode ? pos.size(1) : pos.size(0);
+    int posCount = pos.size(pos.sizes().size() > 2 ? 1 : 0);
     int triCount = tri.size(0);
 
     // Set up CudaRaster buffers.
     const float* posPtr = pos.data_ptr<float>();
     const int32_t* rangesPtr = instance_mode ? 0 : ranges.data_ptr<int32_t>(); // This is in CPU memory.
-    const int32_t* triPtr = tri.data_ptr<int32_t>();
+    const void* triPtr = tri.data_ptr();
+    bool triU16 = nvdr_is_index16(tri);
     cr->setVertexBuffer((void*)posPtr, posCount);
-    cr->setIndexBuffer((void*)triPtr, triCount);
+    cr->setVertexTransforms((const void*)mtxPtr);
+    cr->setIndexBuffer((void*)triPtr, triCount, triU16 ? CR::CudaRaster::IndexType_UInt16 : CR::CudaRaster::IndexType_Int32);
     cr->setBufferSize(width_out, height_out, depth);
 
-    // Enable depth peeling?
+    // Enable depth peeling and culling. Degenerate triangles are always culled.
     bool enablePeel = (peeling_idx > 0);
-    cr->setRenderModeFlags(enablePeel ? CR::CudaRaster::RenderModeFlag_EnableDepthPeeling : 0); // No backface culling.
+    unsigned int renderModeFlags = enablePeel ? CR::CudaRaster::RenderModeFlag_EnableDepthPeeling : 0;
+    if (cull_mode == 1)
+        renderModeFlags |= CR::CudaRaster::RenderModeFlag_EnableBackfaceCulling;
+    else if (cull_mode == 2)
+        renderModeFlags |= CR::CudaRaster::RenderModeFlag_EnableFrontfaceCulling;
+    cr->setRenderModeFlags(renderModeFlags);
+    cr->setMinTriangleArea(cull_min_area);
     if (enablePeel)
         cr->swapDepthAndPeel(); // Use previous depth buffer as peeling depth input.
 
-    // Determine viewport tiling.
-    int tileCountX = (width  + CR_MAXVIEWPORT_SIZE - 1) / CR_MAXVIEWPORT_SIZE;
-    int tileCountY = (height + CR_MAXVIEWPORT_SIZE - 1) / CR_MAXVIEWPORT_SIZE;
-    int tileSizeX = ((width  + tileCountX - 1) / tileCountX + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
-    int tileSizeY = ((height + tileCountY - 1) / tileCountY + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
-    TORCH_CHECK(tileCountX > 0 && tileCountY > 0 && tileSizeX > 0 && tileSizeY > 0,             "internal error in tile size calculation: count or size is zero");
-    TORCH_CHECK(tileSizeX <= CR_MAXVIEWPORT_SIZE && tileSizeY <= CR_MAXVIEWPORT_SIZE,           "internal error in tile size calculation: tile larger than allowed");
-    TORCH_CHECK((tileSizeX & (CR_TILE_SIZE - 1)) == 0 && (tileSizeY & (CR_TILE_SIZE - 1)) == 0, "internal error in tile size calculation: tile not divisible by ", CR_TILE_SIZE);
-    TORCH_CHECK(tileCountX * tileSizeX >= width && tileCountY * tileSizeY >= height,            "internal error in tile size calculation: tiles do not cover viewport");
-
-    // Rasterize in tiles.
-    for (int tileY = 0; tileY < tileCountY; tileY++)
-    for (int tileX = 0; tileX < tileCountX; tileX++)
+    // Viewport covers the whole output. If larger than CR_MAXVIEWPORT_SIZE, CudaRaster draws it in tiles
+    // that are handled as additional images in the same launches.
+    cr->setViewport(width_out, height_out, 0, 0);
+
+    // Largest number of triangles drawn into an image. Bounds how finely the workload can be split.
+    int maxImageTris = triCount;
+    if (!instance_mode)
     {
-        // Set CudaRaster viewport according to tile.
-        int offsetX = tileX * tileSizeX;
-        int offsetY = tileY * tileSizeY;
-        int sizeX = (width_out  - offsetX) < tileSizeX ? (width_out  - offsetX) : tileSizeX;
-        int sizeY = (height_out - offsetY) < tileSizeY ? (height_out - offsetY) : tileSizeY;
-        cr->setViewport(sizeX, sizeY, offsetX, offsetY);
-
-        // Run all triangles in one batch. In case of error, the workload could be split into smaller batches - maybe do that in the future.
-        // Only enable peeling-specific optimizations to skip first stages when image fits in one tile. Those are not valid otherwise.
-        cr->deferredClear(0u);
-        bool success = cr->drawTriangles(rangesPtr, enablePeel && (tileCountX == 1 && tileCountY == 1), stream);
-        NVDR_CHECK(success, "subtriangle count overflow");
+        maxImageTris = 1;
+        for (int i=0; i < depth; i++)
+            maxImageTris = std::max(maxImageTris, rangesPtr[2 * i + 1]);
     }
 
-    // Allocate output tensors.
+    // Peeling can reuse the intermediate results of the previous layer only if that was drawn in one chunk.
+    // After a split draw, they hold the last chunk alone.
+    bool reusePeel = enablePeel && stateWrapper.splitFactor == 1;
+
+    // Rasterize. If some image has more subtriangles than fit in the internal buffers, the triangles of every
+    // image are drawn in splitFactor consecutive chunks that are depth tested against each other. Returns false
+    // in case of overflow.
+    std::vector<int32_t> chunkRanges(instance_mode ? 0 : 2 * depth);
+    auto drawChunks = [&](int splitFactor) -> bool
+    {
+        cr->resetImageStats(); // Statistics describe the final attempt.
+        for (int chunk = 0; chunk < splitFactor; chunk++)
+        {
+            // Select the triangles of the chunk.
+            const int32_t* chunkPtr = rangesPtr;
+            if (instance_mode)
+            {
+                int first = (int)((int64_t)triCount * chunk / splitFactor);
+                int last  = (int)((int64_t)triCount * (chunk + 1) / splitFactor);
+                cr->setInstanceRange(first, last - first);
+            }
+            else if (splitFactor > 1)
+            {
+                for (int i=0; i < depth; i++)
+                {
+                    int count = rangesPtr[2 * i + 1];
+                    int first = (int)((int64_t)count * chunk / splitFactor);
+                    int last  = (int)((int64_t)count * (chunk + 1) / splitFactor);
+                    chunkRanges[2 * i + 0] = rangesPtr[2 * i] + first;
+                    chunkRanges[2 * i + 1] = last - first;
+                }
+                chunkPtr = chunkRanges.data();
+            }
+
+            // Only enable peeling-specific optimizations to skip first stages when drawn in one chunk. Those are not valid otherwise.
+            // Overflows are checked in resolve(), so that the host doesn't wait for the GPU here. When split, resolve each chunk before drawing
+            // the next one, because rendering a chunk again must not clear the results of later chunks.
+            if (chunk == 0)
+                cr->deferredClear(0u);
+            if (!cr->drawTriangles(chunkPtr, reusePeel && splitFactor == 1, stream))
+                return false;
+            if (splitFactor > 1 && cr->resolve() == CR::CudaRaster::DrawStatus_Overflow)
+                return false;
+        }
+        return true;
+    };
+
+    // Allocate output tensors. The compact layout has fp16 barycentrics and separate z/w and triangle id planes.
     torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCUDA);
-    torch::Tensor out = torch::empty({depth, height_out, width_out, 4}, opts);
-    torch::Tensor out_db = torch::empty({depth, height_out, width_out, 4}, opts);
+    torch::TensorOptions opts_bary = compact ? opts.dtype(torch::kFloat16) : opts;
+    torch::Tensor out = torch::empty({depth, height_out, width_out, compact ? 2 : 4}, opts_bary);
+    torch::Tensor out_db = torch::empty({depth, height_out, width_out, 4}, opts_bary);
+    torch::Tensor out_zw = compact ? torch::empty({depth, height_out, width_out}, opts) : torch::empty({0}, opts);
+    torch::Tensor out_tri = compact ? torch::empty({depth, height_out, width_out}, opts.dtype(torch::kInt32)) : torch::empty({0}, opts.dtype(torch::kInt32));
 
     // Populate pixel shader kernel parameters.
     RasterizeCudaFwdShaderParams p;
     p.pos = posPtr;
+    p.mtx = mtxPtr;
     p.tri = triPtr;
     p.in_idx = (const int*)cr->getColorBuffer();
-    p.out = out.data_ptr<float>();
-    p.out_db = out_db.data_ptr<float>();
+    p.out = out.data_ptr();
+    p.out_db = out_db.data_ptr();
+    p.out_zw = compact ? out_zw.data_ptr<float>() : NULL;
+    p.out_tri = compact ? out_tri.data_ptr<int>() : NULL;
     p.numTriangles = triCount;
     p.numVertices = posCount;
     p.width_in = width;
@@ -151,7 +236,8 @@ std::tuple<torch::Tensor, torch::Tensor> rasterize_fwd_cuda(RasterizeCRStateWrap
     p.width_out = width_out;
     p.height_out = height_out;
     p.depth  = depth;
-    p.instance_mode = (pos.sizes().size() > 2) ? 1 : 0;
+    p.instance_mode = instance_mode ? 1 : 0;
+    p.tri_u16 = triU16 ? 1 : 0;
     p.xs = 2.f / (float)width_out;
     p.xo = 1.f / (float)width_out - 1.f;
     p.ys = 2.f / (float)height_out;
@@ -166,74 +252,124 @@ std::tuple<torch::Tensor, torch::Tensor> rasterize_fwd_cuda(RasterizeCRStateWrap
     dim3 blockSize = getLaunchBlockSize(RAST_CUDA_FWD_SHADER_KERNEL_BLOCK_WIDTH, RAST_CUDA_FWD_SHADER_KERNEL_BLOCK_HEIGHT, p.width_out, p.height_out);
     dim3 gridSize  = getLaunchGridSize(blockSize, p.width_out, p.height_out, p.depth);
 
-    // Launch CUDA kernel.
+    // Rasterize and launch CUDA kernel, splitting the workload further until it fits.
     void* args[] = {&p};
-    NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL((void*)RasterizeCudaFwdShaderKernel, gridSize, blockSize, args, 0, stream));
+    void* shaderFunc = triU16 ? (void*)RasterizeCudaFwdShaderKernelU16 : (void*)RasterizeCudaFwdShaderKernel;
+    auto shade = [&](void)
+    {
+        NVDR_PROFILE_DEVICE_RANGE("rasterize_fwd_cuda/shader", stream);
+        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(shaderFunc, gridSize, blockSize, args, 0, stream));
+    };
+    int splitFactor = 1;
+    for (;;)
+    {
+        if (drawChunks(splitFactor))
+        {
+            shade();
+
+            // Check for overflows while the GPU works on the fine stage and the shader. This waits for the coarse stage to
+            // finish, as the outputs must be final when returned. If some images had to be rendered again, shade them again.
+            int status = cr->resolve();
+            if (status == CR::CudaRaster::DrawStatus_Retried)
+                shade();
+            if (status != CR::CudaRaster::DrawStatus_Overflow)
+                break;
+        }
+        else
+            cr->resolve(); // Drop whatever is still pending.
+
+        splitFactor *= 2;
+        NVDR_CHECK(splitFactor <= maxImageTris, "subtriangle count overflow");
+    }
+    cr->setInstanceRange(0, triCount);
+    stateWrapper.splitFactor = splitFactor;
+
     // Return.
-    return std::tuple<torch::Tensor, torch::Tensor>(out, out_db);
+    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor>(out, out_db, out_zw, out_tri);
 }
 
+#endif // NVDR_CPU_ONLY
+
 //------------------------------------------------------------------------
 // Gradient op.
 
-torch::Tensor rasterize_grad_db(torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy, torch::Tensor ddb)
+std::tuple<torch::Tensor, torch::Tensor> rasterize_grad_db(torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy, torch::Tensor ddb, torch::Tensor mtx)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(pos));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("rasterize_grad");
+    bool cpu = pos.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, pos);
     RasterizeGradParams p;
     bool enable_db = ddb.defined();
 
+    // In the compact layout, out is the int32 triangle id plane and the gradients are fp16.
+    bool compact = (out.scalar_type() == torch::kInt32);
+    torch::ScalarType gradType = compact ? torch::kFloat16 : torch::kFloat32;
+    int dyChannels = compact ? 2 : 4;
+
     // Check inputs.
+    ProfileRange checks("rasterize_grad/checks");
     if (enable_db)
     {
-        NVDR_CHECK_DEVICE(pos, tri, out, dy, ddb);
+        NVDR_CHECK_DEVICE_OR_CPU(pos, tri, out, dy, ddb);
         NVDR_CHECK_CONTIGUOUS(pos, tri, out);
-        NVDR_CHECK_F32(pos, out, dy, ddb);
-        NVDR_CHECK_I32(tri);
+        NVDR_CHECK_F32(pos);
+        NVDR_CHECK(compact || out.scalar_type() == torch::kFloat32, "out must be float32, or int32 in the compact layout");
+        NVDR_CHECK(dy.scalar_type() == gradType && ddb.scalar_type() == gradType, "dy and ddb must be float32, or float16 in the compact layout");
+        NVDR_CHECK_INDEX(tri);
     }
     else
     {
-        NVDR_CHECK_DEVICE(pos, tri, out, dy);
+        NVDR_CHECK_DEVICE_OR_CPU(pos, tri, out, dy);
         NVDR_CHECK_CONTIGUOUS(pos, tri, out);
-        NVDR_CHECK_F32(pos, out, dy);
-        NVDR_CHECK_I32(tri);
+        NVDR_CHECK_F32(pos);
+        NVDR_CHECK(compact || out.scalar_type() == torch::kFloat32, "out must be float32, or int32 in the compact layout");
+        NVDR_CHECK(dy.scalar_type() == gradType, "dy must be float32, or float16 in the compact layout");
+        NVDR_CHECK_INDEX(tri);
     }
+    checks.end();
 
-    // Determine instance mode.
-    p.instance_mode = (pos.sizes().size() > 2) ? 1 : 0;
+    // Determine instance mode. Shared vertices with per-image transforms are drawn in instance mode.
+    p.mtx = nvdr_get_vertex_transforms(pos, mtx, __func__);
+    p.instance_mode = (pos.sizes().size() > 2 || p.mtx) ? 1 : 0;
 
     // Shape is taken from the rasterizer output tensor.
-    NVDR_CHECK(out.sizes().size() == 4, "tensor out must be rank-4");
+    NVDR_CHECK(out.sizes().size() == (compact ? 3 : 4), "tensor out must be rank-4, or rank-3 in the compact layout");
     p.depth  = out.size(0);
     p.height = out.size(1);
     p.width  = out.size(2);
     NVDR_CHECK(p.depth > 0 && p.height > 0 && p.width > 0, "resolution must be [>0, >0, >0]");
 
     // Check other shapes.
-    if (p.instance_mode)
+    if (p.mtx)
+        NVDR_CHECK(mtx.size(0) == p.depth, "mtx must have shape [depth, 4, 4]");
+    else if (p.instance_mode)
         NVDR_CHECK(pos.sizes().size() == 3 && pos.size(0) == p.depth && pos.size(1) > 0 && pos.size(2) == 4, "pos must have shape [depth, >0, 4]");
     else
         NVDR_CHECK(pos.sizes().size() == 2 && pos.size(0) > 0 && pos.size(1) == 4, "pos must have shape [>0, 4]");
     NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
-    NVDR_CHECK(out.sizes().size() == 4 && out.size(0) == p.depth && out.size(1) == p.height && out.size(2) == p.width && out.size(3) == 4, "out must have shape [depth, height, width, 4]");
-    NVDR_CHECK( dy.sizes().size() == 4 &&  dy.size(0) == p.depth &&  dy.size(1) == p.height &&  dy.size(2) == p.width &&  dy.size(3) == 4, "dy must have shape [depth, height, width, 4]");
+    if (!compact)
+        NVDR_CHECK(out.sizes().size() == 4 && out.size(0) == p.depth && out.size(1) == p.height && out.size(2) == p.width && out.size(3) == 4, "out must have shape [depth, height, width, 4]");
+    NVDR_CHECK( dy.sizes().size() == 4 &&  dy.size(0) == p.depth &&  dy.size(1) == p.height &&  dy.size(2) == p.width &&  dy.size(3) == dyChannels, "dy must have shape [depth, height, width, 4], or [depth, height, width, 2] in the compact layout");
     if (enable_db)
         NVDR_CHECK(ddb.sizes().size() == 4 && ddb.size(0) == p.depth && ddb.size(1) == p.height && ddb.size(2) == p.width && ddb.size(3) == 4, "ddb must have shape [depth, height, width, 4]");
 
-    // Ensure gradients are contiguous.
-    torch::Tensor dy_ = dy.contiguous();
+    // Ensure gradients are contiguous. Compact gradients are upcast on CPU.
+    bool upcast = cpu && compact;
+    torch::Tensor dy_ = upcast ? dy.to(torch::kFloat32).contiguous() : dy.contiguous();
     torch::Tensor ddb_;
     if (enable_db)
-        ddb_ = ddb.contiguous();
+        ddb_ = upcast ? ddb.to(torch::kFloat32).contiguous() : ddb.contiguous();
 
     // Populate parameters.
     p.numTriangles = tri.size(0);
-    p.numVertices = p.instance_mode ? pos.size(1) : pos.size(0);
+    p.numVertices = pos.size(pos.sizes().size() > 2 ? 1 : 0);
     p.pos = pos.data_ptr<float>();
-    p.tri = tri.data_ptr<int>();
-    p.out = out.data_ptr<float>();
-    p.dy  = dy_.data_ptr<float>();
-    p.ddb = enable_db ? ddb_.data_ptr<float>() : NULL;
+    p.tri = tri.data_ptr();
+    p.tri_u16 = nvdr_is_index16(tri);
+    p.out = compact ? NULL : out.data_ptr<float>();
+    p.out_tri = compact ? out.data_ptr<int>() : NULL;
+    p.dy  = dy_.data_ptr();
+    p.ddb = enable_db ? ddb_.data_ptr() : NULL;
 
     // Set up pixel position to clip space x, y transform.
     p.xs = 2.f / (float)p.width;
@@ -241,33 +377,66 @@ torch::Tensor rasterize_grad_db(torch::Tensor pos, torch::Tensor tri, torch::Ten
     p.ys = 2.f / (float)p.height;
     p.yo = 1.f / (float)p.height - 1.f;
 
-    // Allocate output tensor for position gradients.
+    // Allocate output tensors for position and transform gradients.
     torch::Tensor grad = torch::zeros_like(pos);
+    torch::Tensor grad_mtx = p.mtx ? torch::zeros_like(mtx) : torch::empty({0}, pos.options());
     p.grad = grad.data_ptr<float>();
+    p.gradMtx = p.mtx ? grad_mtx.data_ptr<float>() : NULL;
 
     // Verify that buffers are aligned to allow float2/float4 operations.
     NVDR_CHECK(!((uintptr_t)p.pos & 15), "pos input tensor not aligned to float4");
-    NVDR_CHECK(!((uintptr_t)p.dy  &  7), "dy input tensor not aligned to float2");
-    NVDR_CHECK(!((uintptr_t)p.ddb & 15), "ddb input tensor not aligned to float4");
+    NVDR_CHECK(!((uintptr_t)p.dy  & (2 * dy_.element_size() - 1)), "dy input tensor not aligned to two elements");
+    NVDR_CHECK(!((uintptr_t)p.ddb & (4 * dy_.element_size() - 1)), "ddb input tensor not aligned to four elements");
 
+    // Run on the shared thread pool if on CPU.
+    if (cpu)
+    {
+        RasterizeCpuGrad(p, ThreadPool::getGlobal());
+        return std::tuple<torch::Tensor, torch::Tensor>(grad, grad_mtx);
+    }
+
+#ifndef NVDR_CPU_ONLY
     // Choose launch parameters.
     dim3 blockSize = getLaunchBlockSize(RAST_GRAD_MAX_KERNEL_BLOCK_WIDTH, RAST_GRAD_MAX_KERNEL_BLOCK_HEIGHT, p.width, p.height);
     dim3 gridSize  = getLaunchGridSize(blockSize, p.width, p.height, p.depth);
 
     // Launch CUDA kernel.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
     void* args[] = {&p};
-    void* func = enable_db ? (void*)RasterizeGradKernelDb : (void*)RasterizeGradKernel;
+    void* func = enable_db ? (p.tri_u16 ? (void*)RasterizeGradKernelDbU16 : (void*)RasterizeGradKernelDb)
+                           : (p.tri_u16 ? (void*)RasterizeGradKernelU16   : (void*)RasterizeGradKernel);
+    NVDR_PROFILE_DEVICE_RANGE("rasterize_grad/kernel", stream);
     NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func, gridSize, blockSize, args, 0, stream));
 
     // Return the gradients.
-    return grad;
+    return std::tuple<torch::Tensor, torch::Tensor>(grad, grad_mtx);
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 // Version without derivatives.
-torch::Tensor rasterize_grad(torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy)
+std::tuple<torch::Tensor, torch::Tensor> rasterize_grad(torch::Tensor pos, torch::Tensor tri, torch::Tensor out, torch::Tensor dy, torch::Tensor mtx)
 {
     torch::Tensor empty_tensor;
-    return rasterize_grad_db(pos, tri, out, dy, empty_tensor);
+    return rasterize_grad_db(pos, tri, out, dy, empty_tensor, mtx);
 }
 
+#ifndef NVDR_CPU_ONLY
+
+//------------------------------------------------------------------------
+// Per-image statistics of the latest forward op (Cuda).
+
+std::map<std::string, torch::Tensor> rasterize_stats_cuda(RasterizeCRStateWrapper& stateWrapper)
+{
+    CR::CudaRaster* cr = stateWrapper.cr;
+    std::vector<CR::ImageStats> stats(cr->getImageStats(NULL, 0));
+    cr->getImageStats(stats.data(), (int)stats.size());
+    std::map<std::string, torch::Tensor> d = nvdr_image_stats_to_dict(stats.data(), (int)stats.size(), cr->getBufferBytes());
+    d["split_factor"] = torch::tensor((int64_t)stateWrapper.splitFactor, torch::TensorOptions().dtype(torch::kInt64));
+    return d;
+}
+
+#endif // NVDR_CPU_ONLY
+
 //------------------------------------------------------------------------
@@ -0,0 +1,184 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "torch_common.inl"
+#include "torch_types.h"
+#include "../common/common.h"
+#include "../common/rasterize.h"
+#include "../common/profiler.h"
+#include "../common/threadpool.h"
+#include "../common/cpuraster/CpuRaster.hpp"
+#include "../common/cudaraster/impl/Constants.hpp"
+#include <tuple>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Python CpuRaster state wrapper methods.
+
+RasterizeCpuStateWrapper::RasterizeCpuStateWrapper(int numThreads_)
+{
+    numThreads = numThreads_;
+    cr = new CR::CpuRaster(numThreads);
+}
+
+RasterizeCpuStateWrapper::~RasterizeCpuStateWrapper(void)
+{
+    delete cr;
+}
+
+//------------------------------------------------------------------------
+// Forward op (CPU).
+
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor> rasterize_fwd_cpu(RasterizeCpuStateWrapper& stateWrapper, torch::Tensor pos, torch::Tensor tri, std::tuple<int, int> resolution, torch::Tensor ranges, int peeling_idx, int cull_mode, float cull_min_area, torch::Tensor mtx, bool compact)
+{
+    NVDR_PROFILE_RANGE("rasterize_fwd_cpu");
+    CR::CpuRaster* cr = stateWrapper.cr;
+
+    // Check inputs.
+    ProfileRange checks("rasterize_fwd_cpu/checks");
+    NVDR_CHECK_CPU(pos, tri, ranges);
+    NVDR_CHECK_CONTIGUOUS(pos, tri, ranges);
+    NVDR_CHECK_F32(pos);
+    NVDR_CHECK_I32(ranges);
+    NVDR_CHECK_INDEX(tri);
+    checks.end();
+
+    // Determine instance mode and check input dimensions. Shared vertices with per-image transforms are drawn in instance mode.
+    const float* mtxPtr = nvdr_get_vertex_transforms(pos, mtx, __func__);
+    bool instance_mode = pos.sizes().size() > 2 || mtxPtr;
+    if (instance_mode && !mtxPtr)
+        NVDR_CHECK(pos.sizes().size() == 3 && pos.size(0) > 0 && pos.size(1) > 0 && pos.size(2) == 4, "instance mode - pos must have shape [>0, >0, 4]");
+    else if (!instance_mode)
+    {
+        NVDR_CHECK(pos.sizes().size() == 2 && pos.size(0) > 0 && pos.size(1) == 4, "range mode - pos must have shape [>0, 4]");
+        NVDR_CHECK(ranges.sizes().size() == 2 && ranges.size(0) > 0 && ranges.size(1) == 2, "range mode - ranges must have shape [>0, 2]");
+    }
+    NVDR_CHECK(tri.sizes().size() == 2 && tri.size(0) > 0 && tri.size(1) == 3, "tri must have shape [>0, 3]");
+    NVDR_CHECK(cull_mode >= 0 && cull_mode <= 2, "cull_mode must be 0 (none), 1 (back) or 2 (front)");
+    NVDR_CHECK(cull_min_area >= 0.f, "cull_min_area must be non-negative");
+
+    // Get output shape.
+    int height_out = std::get<0>(resolution);
+    int width_out  = std::get<1>(resolution);
+    int depth      = mtxPtr ? mtx.size(0) : instance_mode ? pos.size(0) : ranges.size(0); // Depth of tensor, not related to depth buffering.
+    NVDR_CHECK(height_out > 0 && width_out > 0, "resolution must be [>0, >0]");
+
+    // Round internal resolution up to tile size.
+    int height = (height_out + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+    int width  = (width_out  + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+
+    // Get position and triangle buffer sizes in vertices / triangles.
+    int posCount = pos.size(pos.sizes().size() > 2 ? 1 : 0);
+    int triCount = tri.size(0);
+
+    // Set up CpuRaster buffers.
+    const float* posPtr = pos.data_ptr<float>();
+    const int32_t* rangesPtr = instance_mode ? 0 : ranges.data_ptr<int32_t>();
+    const void* triPtr = tri.data_ptr();
+    bool triU16 = nvdr_is_index16(tri);
+    cr->setVertexBuffer((const void*)posPtr, posCount);
+    cr->setVertexTransforms((const void*)mtxPtr);
+    cr->setIndexBuffer(triPtr, triCount, triU16 ? CR::CpuRaster::IndexType_UInt16 : CR::CpuRaster::IndexType_Int32);
+    cr->setBufferSize(width_out, height_out, depth);
+
+    // Enable depth peeling and culling. Degenerate triangles are always culled.
+    bool enablePeel = (peeling_idx > 0);
+    unsigned int renderModeFlags = enablePeel ? CR::CpuRaster::RenderModeFlag_EnableDepthPeeling : 0;
+    if (cull_mode == 1)
+        renderModeFlags |= CR::CpuRaster::RenderModeFlag_EnableBackfaceCulling;
+    else if (cull_mode == 2)
+        renderModeFlags |= CR::CpuRaster::RenderModeFlag_EnableFrontfaceCulling;
+    cr->setRenderModeFlags(renderModeFlags);
+    cr->setMinTriangleArea(cull_min_area);
+    if (enablePeel)
+        cr->swapDepthAndPeel(); // Use previous depth buffer as peeling depth input.
+
+    // Determine viewport tiling. Same tiling as the Cuda op so that the results match.
+    int tileCountX = (width  + CR_MAXVIEWPORT_SIZE - 1) / CR_MAXVIEWPORT_SIZE;
+    int tileCountY = (height + CR_MAXVIEWPORT_SIZE - 1) / CR_MAXVIEWPORT_SIZE;
+    int tileSizeX = ((width  + tileCountX - 1) / tileCountX + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+    int tileSizeY = ((height + tileCountY - 1) / tileCountY + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+    TORCH_CHECK(tileCountX > 0 && tileCountY > 0 && tileSizeX > 0 && tileSizeY > 0,             "internal error in tile size calculation: count or size is zero");
+    TORCH_CHECK(tileSizeX <= CR_MAXVIEWPORT_SIZE && tileSizeY <= CR_MAXVIEWPORT_SIZE,           "internal error in tile size calculation: tile larger than allowed");
+    TORCH_CHECK((tileSizeX & (CR_TILE_SIZE - 1)) == 0 && (tileSizeY & (CR_TILE_SIZE - 1)) == 0, "internal error in tile size calculation: tile not divisible by ", CR_TILE_SIZE);
+    TORCH_CHECK(tileCountX * tileSizeX >= width && tileCountY * tileSizeY >= height,            "internal error in tile size calculation: tiles do not cover viewport");
+
+    // Rasterize in tiles.
+    cr->resetImageStats();
+    for (int tileY = 0; tileY < tileCountY; tileY++)
+    for (int tileX = 0; tileX < tileCountX; tileX++)
+    {
+        // Set CpuRaster viewport according to tile.
+        int offsetX = tileX * tileSizeX;
+        int offsetY = tileY * tileSizeY;
+        int sizeX = (width_out  - offsetX) < tileSizeX ? (width_out  - offsetX) : tileSizeX;
+        int sizeY = (height_out - offsetY) < tileSizeY ? (height_out - offsetY) : tileSizeY;
+        cr->setViewport(sizeX, sizeY, offsetX, offsetY);
+
+        // Setup results can only be reused across peeling iterations when the image fits in one tile.
+        cr->deferredClear(0u);
+        bool success = cr->drawTriangles(rangesPtr, enablePeel && (tileCountX == 1 && tileCountY == 1));
+        NVDR_CHECK(success, "subtriangle count overflow");
+    }
+
+    // Allocate output tensors. The shader writes compact barycentrics in fp32, converted below.
+    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU);
+    torch::Tensor out = torch::empty({depth, height_out, width_out, compact ? 2 : 4}, opts);
+    torch::Tensor out_db = torch::empty({depth, height_out, width_out, 4}, opts);
+    torch::Tensor out_zw = compact ? torch::empty({depth, height_out, width_out}, opts) : torch::empty({0}, opts);
+    torch::Tensor out_tri = compact ? torch::empty({depth, height_out, width_out}, opts.dtype(torch::kInt32)) : torch::empty({0}, opts.dtype(torch::kInt32));
+
+    // Populate pixel shader parameters.
+    RasterizeCudaFwdShaderParams p;
+    p.pos = posPtr;
+    p.mtx = mtxPtr;
+    p.tri = triPtr;
+    p.in_idx = (const int*)cr->getColorBuffer();
+    p.out = out.data_ptr();
+    p.out_db = out_db.data_ptr();
+    p.out_zw = compact ? out_zw.data_ptr<float>() : NULL;
+    p.out_tri = compact ? out_tri.data_ptr<int>() : NULL;
+    p.numTriangles = triCount;
+    p.numVertices = posCount;
+    p.width_in = width;
+    p.height_in = height;
+    p.width_out = width_out;
+    p.height_out = height_out;
+    p.depth  = depth;
+    p.instance_mode = instance_mode ? 1 : 0;
+    p.tri_u16 = triU16 ? 1 : 0;
+    p.xs = 2.f / (float)width_out;
+    p.xo = 1.f / (float)width_out - 1.f;
+    p.ys = 2.f / (float)height_out;
+    p.yo = 1.f / (float)height_out - 1.f;
+
+    // Run shader on the rasterizer's thread pool.
+    NVDR_PROFILE_RANGE("rasterize_fwd_cpu/shader");
+    RasterizeCpuFwdShader(p, cr->getThreadPool());
+
+    // Return.
+    if (compact)
+    {
+        out = out.to(torch::kFloat16);
+        out_db = out_db.to(torch::kFloat16);
+    }
+    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor>(out, out_db, out_zw, out_tri);
+}
+
+//------------------------------------------------------------------------
+// Per-image statistics of the latest forward op (CPU).
+
+std::map<std::string, torch::Tensor> rasterize_stats_cpu(RasterizeCpuStateWrapper& stateWrapper)
+{
+    CR::CpuRaster* cr = stateWrapper.cr;
+    std::vector<CR::CpuRaster::ImageStats> stats(cr->getImageStats(NULL, 0));
+    cr->getImageStats(stats.data(), (int)stats.size());
+    return nvdr_image_stats_to_dict(stats.data(), (int)stats.size(), cr->getBufferBytes());
+}
+
+//------------------------------------------------------------------------
@@ -59,7 +59,12 @@ std::tuple<torch::Tensor, torch::Tensor> rasterize_fwd_gl(RasterizeGLStateWrappe
     NVDR_CHECK_CPU(ranges);
     NVDR_CHECK_CONTIGUOUS(pos, tri, ranges);
     NVDR_CHECK_F32(pos);
-    NVDR_CHECK_I32(tri, ranges);
+    NVDR_CHECK_I32(ranges);
+    NVDR_CHECK_INDEX(tri);
+
+    // The GL path uploads 32-bit indices only, widen 16-bit indices as unsigned.
+    if (nvdr_is_index16(tri))
+        tri = tri.to(torch::kInt32).bitwise_and(0xffff);
 
     // Check that GL context was created for the correct GPU.
     NVDR_CHECK(pos.get_device() == stateWrapper.cudaDeviceIdx, "GL context must must reside on the same device as input tensors");
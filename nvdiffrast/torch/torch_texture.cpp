@@ -10,8 +10,12 @@
 #include "torch_types.h"
 #include "../common/common.h"
 #include "../common/texture.h"
+#include "../common/profiler.h"
+#include "../common/threadpool.h"
+#ifndef NVDR_CPU_ONLY
 #include <cuda_runtime.h>
-#ifdef USE_ROCM
+#endif
+#if defined(USE_ROCM) && !defined(NVDR_CPU_ONLY)
 #include <ATen/hip/impl/HIPGuardImplMasqueradingAsCUDA.h>
 #endif
 
@@ -24,60 +28,162 @@
 #define LAUNCH_KERNEL cudaLaunchKernel
 #endif
 
-void MipBuildKernel1                            (const TextureKernelParams p);
-void MipBuildKernel2                            (const TextureKernelParams p);
-void MipBuildKernel4                            (const TextureKernelParams p);
-void TextureFwdKernelNearest1                   (const TextureKernelParams p);
-void TextureFwdKernelNearest2                   (const TextureKernelParams p);
-void TextureFwdKernelNearest4                   (const TextureKernelParams p);
-void TextureFwdKernelLinear1                    (const TextureKernelParams p);
-void TextureFwdKernelLinear2                    (const TextureKernelParams p);
-void TextureFwdKernelLinear4                    (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapNearest1       (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapNearest2       (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapNearest4       (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapLinear1        (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapLinear2        (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapLinear4        (const TextureKernelParams p);
-void TextureFwdKernelCubeNearest1               (const TextureKernelParams p);
-void TextureFwdKernelCubeNearest2               (const TextureKernelParams p);
-void TextureFwdKernelCubeNearest4               (const TextureKernelParams p);
-void TextureFwdKernelCubeLinear1                (const TextureKernelParams p);
-void TextureFwdKernelCubeLinear2                (const TextureKernelParams p);
-void TextureFwdKernelCubeLinear4                (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapNearest1   (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapNearest2   (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapNearest4   (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapLinear1    (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapLinear2    (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapLinear4    (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapNearestBO1     (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapNearestBO2     (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapNearestBO4     (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapLinearBO1      (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapLinearBO2      (const TextureKernelParams p);
-void TextureFwdKernelLinearMipmapLinearBO4      (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapNearestBO1 (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapNearestBO2 (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapNearestBO4 (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapLinearBO1  (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapLinearBO2  (const TextureKernelParams p);
-void TextureFwdKernelCubeLinearMipmapLinearBO4  (const TextureKernelParams p);
-void MipGradKernel1                             (const TextureKernelParams p);
-void MipGradKernel2                             (const TextureKernelParams p);
-void MipGradKernel4                             (const TextureKernelParams p);
-void TextureGradKernelNearest                   (const TextureKernelParams p);
-void TextureGradKernelLinear                    (const TextureKernelParams p);
-void TextureGradKernelLinearMipmapNearest       (const TextureKernelParams p);
-void TextureGradKernelLinearMipmapLinear        (const TextureKernelParams p);
-void TextureGradKernelCubeNearest               (const TextureKernelParams p);
-void TextureGradKernelCubeLinear                (const TextureKernelParams p);
-void TextureGradKernelCubeLinearMipmapNearest   (const TextureKernelParams p);
-void TextureGradKernelCubeLinearMipmapLinear    (const TextureKernelParams p);
-void TextureGradKernelLinearMipmapNearestBO     (const TextureKernelParams p);
-void TextureGradKernelLinearMipmapLinearBO      (const TextureKernelParams p);
-void TextureGradKernelCubeLinearMipmapNearestBO (const TextureKernelParams p);
-void TextureGradKernelCubeLinearMipmapLinearBO  (const TextureKernelParams p);
+void MipBuildKernel1                                (const TextureKernelParams p);
+void MipBuildKernel2                                (const TextureKernelParams p);
+void MipBuildKernel4                                (const TextureKernelParams p);
+void TextureFwdKernelNearest1                       (const TextureKernelParams p);
+void TextureFwdKernelNearest2                       (const TextureKernelParams p);
+void TextureFwdKernelNearest4                       (const TextureKernelParams p);
+void TextureFwdKernelLinear1                        (const TextureKernelParams p);
+void TextureFwdKernelLinear2                        (const TextureKernelParams p);
+void TextureFwdKernelLinear4                        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest1           (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest2           (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest4           (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear1            (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear2            (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear4            (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest1                   (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest2                   (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest4                   (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear1                    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear2                    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear4                    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest1       (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest2       (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest4       (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear1        (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear2        (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear4        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO1         (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO2         (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO4         (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO1          (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO2          (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO4          (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO1     (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO2     (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO4     (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO1      (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO2      (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO4      (const TextureKernelParams p);
+void MipGradKernel1                                 (const TextureKernelParams p);
+void MipGradKernel2                                 (const TextureKernelParams p);
+void MipGradKernel4                                 (const TextureKernelParams p);
+void TextureGradKernelNearest                       (const TextureKernelParams p);
+void TextureGradKernelLinear                        (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapNearest           (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapLinear            (const TextureKernelParams p);
+void TextureGradKernelCubeNearest                   (const TextureKernelParams p);
+void TextureGradKernelCubeLinear                    (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapNearest       (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapLinear        (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapNearestBO         (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapLinearBO          (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapNearestBO     (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapLinearBO      (const TextureKernelParams p);
+void MipBuildKernel1F16                             (const TextureKernelParams p);
+void MipBuildKernel2F16                             (const TextureKernelParams p);
+void MipBuildKernel4F16                             (const TextureKernelParams p);
+void TextureFwdKernelNearest1F16                    (const TextureKernelParams p);
+void TextureFwdKernelNearest2F16                    (const TextureKernelParams p);
+void TextureFwdKernelNearest4F16                    (const TextureKernelParams p);
+void TextureFwdKernelLinear1F16                     (const TextureKernelParams p);
+void TextureFwdKernelLinear2F16                     (const TextureKernelParams p);
+void TextureFwdKernelLinear4F16                     (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest1F16        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest2F16        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest4F16        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear1F16         (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear2F16         (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear4F16         (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest1F16                (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest2F16                (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest4F16                (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear1F16                 (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear2F16                 (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear4F16                 (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest1F16    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest2F16    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest4F16    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear1F16     (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear2F16     (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear4F16     (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO1F16      (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO2F16      (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO4F16      (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO1F16       (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO2F16       (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO4F16       (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO1F16  (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO2F16  (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO4F16  (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO1F16   (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO2F16   (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO4F16   (const TextureKernelParams p);
+void TextureGradKernelNearestF16                    (const TextureKernelParams p);
+void TextureGradKernelLinearF16                     (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapNearestF16        (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapLinearF16         (const TextureKernelParams p);
+void TextureGradKernelCubeNearestF16                (const TextureKernelParams p);
+void TextureGradKernelCubeLinearF16                 (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapNearestF16    (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapLinearF16     (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapNearestBOF16      (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapLinearBOF16       (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapNearestBOF16  (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapLinearBOF16   (const TextureKernelParams p);
+void MipBuildKernel1BF16                            (const TextureKernelParams p);
+void MipBuildKernel2BF16                            (const TextureKernelParams p);
+void MipBuildKernel4BF16                            (const TextureKernelParams p);
+void TextureFwdKernelNearest1BF16                   (const TextureKernelParams p);
+void TextureFwdKernelNearest2BF16                   (const TextureKernelParams p);
+void TextureFwdKernelNearest4BF16                   (const TextureKernelParams p);
+void TextureFwdKernelLinear1BF16                    (const TextureKernelParams p);
+void TextureFwdKernelLinear2BF16                    (const TextureKernelParams p);
+void TextureFwdKernelLinear4BF16                    (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest1BF16       (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest2BF16       (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearest4BF16       (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear1BF16        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear2BF16        (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinear4BF16        (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest1BF16               (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest2BF16               (const TextureKernelParams p);
+void TextureFwdKernelCubeNearest4BF16               (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear1BF16                (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear2BF16                (const TextureKernelParams p);
+void TextureFwdKernelCubeLinear4BF16                (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest1BF16   (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest2BF16   (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearest4BF16   (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear1BF16    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear2BF16    (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinear4BF16    (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO1BF16     (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO2BF16     (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapNearestBO4BF16     (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO1BF16      (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO2BF16      (const TextureKernelParams p);
+void TextureFwdKernelLinearMipmapLinearBO4BF16      (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO1BF16 (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO2BF16 (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapNearestBO4BF16 (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO1BF16  (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO2BF16  (const TextureKernelParams p);
+void TextureFwdKernelCubeLinearMipmapLinearBO4BF16  (const TextureKernelParams p);
+void TextureGradKernelNearestBF16                   (const TextureKernelParams p);
+void TextureGradKernelLinearBF16                    (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapNearestBF16       (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapLinearBF16        (const TextureKernelParams p);
+void TextureGradKernelCubeNearestBF16               (const TextureKernelParams p);
+void TextureGradKernelCubeLinearBF16                (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapNearestBF16   (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapLinearBF16    (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapNearestBOBF16     (const TextureKernelParams p);
+void TextureGradKernelLinearMipmapLinearBOBF16      (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapNearestBOBF16 (const TextureKernelParams p);
+void TextureGradKernelCubeLinearMipmapLinearBOBF16  (const TextureKernelParams p);
 
 //------------------------------------------------------------------------
 // Modeselektor.
@@ -106,17 +212,20 @@ static void set_modes(TextureKernelParams& p, int filter_mode, int boundary_mode
 
 TextureMipWrapper texture_construct_mip(torch::Tensor tex, int max_mip_level, bool cube_mode)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(tex));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("texture_construct_mip");
+    bool cpu = tex.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, tex);
     TextureKernelParams p = {}; // Initialize all fields to zero.
     p.mipLevelLimit = max_mip_level;
     p.boundaryMode = cube_mode ? TEX_BOUNDARY_MODE_CUBE : TEX_BOUNDARY_MODE_WRAP;
     NVDR_CHECK(p.mipLevelLimit >= -1, "invalid max_mip_level");
 
     // Check inputs.
-    NVDR_CHECK_DEVICE(tex);
+    ProfileRange checks("texture_construct_mip/checks");
+    NVDR_CHECK_DEVICE_OR_CPU(tex);
     NVDR_CHECK_CONTIGUOUS(tex);
-    NVDR_CHECK_F32(tex);
+    NVDR_CHECK_FLOAT(tex);
+    checks.end();
 
     // Populate parameters and sanity check tex shape.
     if (!cube_mode)
@@ -133,40 +242,63 @@ TextureMipWrapper texture_construct_mip(torch::Tensor tex, int max_mip_level, bo
     p.texWidth  = tex.size(cube_mode ? 3 : 2);
     p.channels  = tex.size(cube_mode ? 4 : 3);
 
+    // Half precision textures are upcast on CPU, and the mip builder rounds like the kernels.
+    torch::ScalarType dtype = tex.scalar_type();
+    p.texType = nvdr_storage_type(tex);
+    if (cpu && p.texType != NVDR_STORAGE_F32)
+        tex = tex.to(torch::kFloat32);
+
     // Set texture pointer.
-    p.tex[0] = tex.data_ptr<float>();
+    p.tex[0] = tex.data_ptr();
 
     // Generate mip offsets and calculate total size.
     int mipOffsets[TEX_MAX_MIP_LEVEL];
     int mipTotal = calculateMipInfo(NVDR_CTX_PARAMS, p, mipOffsets);
 
-    // Allocate and set mip tensor.
-    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCUDA);
+    // Allocate and set mip tensor in the texture type.
+    torch::TensorOptions opts = torch::TensorOptions().dtype(tex.scalar_type()).device(cpu ? torch::kCPU : torch::kCUDA);
     torch::Tensor mip = torch::empty({mipTotal}, opts);
-    float* pmip = mip.data_ptr<float>();
+    char* pmip = (char*)mip.data_ptr();
     for (int i=1; i <= p.mipLevelMax; i++)
-        p.tex[i] = pmip + mipOffsets[i]; // Pointers to mip levels.
-
-    // Choose kernel variants based on channel count.
-    void* args[] = {&p};
-    int channel_div_idx = 0;
-    if (!(p.channels & 3))
-        channel_div_idx = 2;  // Channel count divisible by 4.
-    else if (!(p.channels & 1))
-        channel_div_idx = 1;  // Channel count divisible by 2.
+        p.tex[i] = pmip + (size_t)mipOffsets[i] * mip.element_size(); // Pointers to mip levels.
 
     // Build mip levels.
-    for (int i=1; i <= p.mipLevelMax; i++)
+    if (cpu)
     {
-        int2 ms = mipLevelSize(p, i);
-        int3 sz = make_int3(ms.x, ms.y, p.texDepth);
-        dim3 blockSize = getLaunchBlockSize(TEX_FWD_MAX_MIP_KERNEL_BLOCK_WIDTH, TEX_FWD_MAX_MIP_KERNEL_BLOCK_HEIGHT, sz.x, sz.y);
-        dim3 gridSize  = getLaunchGridSize(blockSize, sz.x, sz.y, sz.z * (cube_mode ? 6 : 1));
-        p.mipLevelOut = i;
-
-        void* build_func_tbl[3] = { (void*)MipBuildKernel1, (void*)MipBuildKernel2, (void*)MipBuildKernel4 };
-        NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(build_func_tbl[channel_div_idx], gridSize, blockSize, args, 0, stream));
+        // Run on the shared thread pool.
+        TextureCpuBuildMip(p, ThreadPool::getGlobal());
+        mip = mip.to(dtype);
+    }
+#ifndef NVDR_CPU_ONLY
+    else
+    {
+        // Choose kernel variants based on channel count.
+        cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+        void* args[] = {&p};
+        int channel_div_idx = 0;
+        if (!(p.channels & 3))
+            channel_div_idx = 2;  // Channel count divisible by 4.
+        else if (!(p.channels & 1))
+            channel_div_idx = 1;  // Channel count divisible by 2.
+
+        for (int i=1; i <= p.mipLevelMax; i++)
+        {
+            int2 ms = mipLevelSize(p, i);
+            int3 sz = make_int3(ms.x, ms.y, p.texDepth);
+            dim3 blockSize = getLaunchBlockSize(TEX_FWD_MAX_MIP_KERNEL_BLOCK_WIDTH, TEX_FWD_MAX_MIP_KERNEL_BLOCK_HEIGHT, sz.x, sz.y);
+            dim3 gridSize  = getLaunchGridSize(blockSize, sz.x, sz.y, sz.z * (cube_mode ? 6 : 1));
+            p.mipLevelOut = i;
+
+            void* build_func_tbl[3 * 3] = {
+                (void*)MipBuildKernel1,     (void*)MipBuildKernel2,     (void*)MipBuildKernel4,
+                (void*)MipBuildKernel1F16,  (void*)MipBuildKernel2F16,  (void*)MipBuildKernel4F16,
+                (void*)MipBuildKernel1BF16, (void*)MipBuildKernel2BF16, (void*)MipBuildKernel4BF16,
+            };
+            NVDR_PROFILE_DEVICE_RANGE("texture_construct_mip/kernel", stream);
+            NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(build_func_tbl[p.texType * 3 + channel_div_idx], gridSize, blockSize, args, 0, stream));
+        }
     }
+#endif
 
     // Return the mip tensor in a wrapper.
     TextureMipWrapper mip_wrapper;
@@ -182,8 +314,9 @@ TextureMipWrapper texture_construct_mip(torch::Tensor tex, int max_mip_level, bo
 
 torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor uv_da, torch::Tensor mip_level_bias, TextureMipWrapper mip_wrapper, std::vector<torch::Tensor> mip_stack, int filter_mode, int boundary_mode)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(tex));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("texture_fwd");
+    bool cpu = tex.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, tex);
     TextureKernelParams p = {}; // Initialize all fields to zero.
     bool has_mip_stack = (mip_stack.size() > 0);
     torch::Tensor& mip_w = mip_wrapper.mip; // Unwrap.
@@ -201,36 +334,42 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
     }
 
     // Check inputs.
-    NVDR_CHECK_DEVICE(tex, uv);
+    ProfileRange checks("texture_fwd/checks");
+    NVDR_CHECK_DEVICE_OR_CPU(tex, uv);
     NVDR_CHECK_CONTIGUOUS(tex, uv);
-    NVDR_CHECK_F32(tex, uv);
+    NVDR_CHECK_FLOAT(tex);
+    NVDR_CHECK_F32(uv);
     if (p.enableMip)
     {
         if (has_mip_stack)
         {
-            TORCH_CHECK(at::cuda::check_device(mip_stack), __func__, "(): Mip stack inputs must reside on the correct GPU device");
+            std::vector<torch::Tensor> mip_stack_tex(mip_stack);
+            mip_stack_tex.push_back(tex);
+            TORCH_CHECK(nvdr_check_device_or_cpu(mip_stack_tex), __func__, "(): Mip stack inputs must reside on the same device as tex");
             nvdr_check_contiguous(mip_stack, __func__, "(): Mip stack inputs must be contiguous tensors");
-            nvdr_check_f32(mip_stack, __func__, "(): Mip stack inputs must be float32 tensors");
+            for (const torch::Tensor& t : mip_stack)
+                NVDR_CHECK(t.dtype() == tex.dtype(), "mip stack inputs must have the same dtype as tex");
         }
         else
         {
-            NVDR_CHECK_DEVICE(mip_w);
+            NVDR_CHECK_DEVICE_OR_CPU(tex, mip_w);
             NVDR_CHECK_CONTIGUOUS(mip_w);
-            NVDR_CHECK_F32(mip_w);
+            NVDR_CHECK(mip_w.dtype() == tex.dtype(), "mip must have the same dtype as tex");
         }
         if (has_uv_da)
         {
-            NVDR_CHECK_DEVICE(uv_da);
+            NVDR_CHECK_DEVICE_OR_CPU(tex, uv_da);
             NVDR_CHECK_CONTIGUOUS(uv_da);
             NVDR_CHECK_F32(uv_da);
         }
         if (has_mip_level_bias)
         {
-            NVDR_CHECK_DEVICE(mip_level_bias);
+            NVDR_CHECK_DEVICE_OR_CPU(tex, mip_level_bias);
             NVDR_CHECK_CONTIGUOUS(mip_level_bias);
             NVDR_CHECK_F32(mip_level_bias);
         }
     }
+    checks.end();
 
     // Sanity checks and state setters.
     bool cube_mode = (boundary_mode == TEX_BOUNDARY_MODE_CUBE);
@@ -270,16 +409,24 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
             NVDR_CHECK(mip_level_bias.sizes().size() == 3 && mip_level_bias.size(0) == p.n && mip_level_bias.size(1) == p.imgHeight && mip_level_bias.size(2) == p.imgWidth, "mip_level_bias must have shape [minibatch_size, height, width]");
     }
 
+    // Half precision textures are upcast on CPU, and the output converted back.
+    torch::ScalarType dtype = tex.scalar_type();
+    p.texType = nvdr_storage_type(tex);
+    bool upcast = cpu && p.texType != NVDR_STORAGE_F32;
+    if (upcast)
+        tex = tex.to(torch::kFloat32);
+    int esz = tex.element_size();
+
     // Get input pointers.
-    p.tex[0] = tex.data_ptr<float>();
+    p.tex[0] = tex.data_ptr();
     p.uv = uv.data_ptr<float>();
     p.uvDA = (p.enableMip && has_uv_da) ? uv_da.data_ptr<float>() : NULL;
     p.mipLevelBias = (p.enableMip && has_mip_level_bias) ? mip_level_bias.data_ptr<float>() : NULL;
 
-    // Allocate output tensor.
-    torch::TensorOptions opts = torch::TensorOptions().dtype(torch::kFloat32).device(torch::kCUDA);
+    // Allocate output tensor in the texture type.
+    torch::TensorOptions opts = torch::TensorOptions().dtype(tex.scalar_type()).device(cpu ? torch::kCPU : torch::kCUDA);
     torch::Tensor out = torch::empty({p.n, p.imgHeight, p.imgWidth, p.channels}, opts);
-    p.out = out.data_ptr<float>();
+    p.out = out.data_ptr();
 
     // Choose kernel variants based on channel count.
     void* args[] = {&p};
@@ -290,7 +437,7 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
         channel_div_idx = 1;  // Channel count divisible by 2.
 
     // Mip-related setup.
-    float* pmip = 0;
+    char* pmip = 0;
     if (p.enableMip)
     {
         if (has_mip_stack)
@@ -307,7 +454,9 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
                     NVDR_CHECK(t.sizes().size() == 5 && t.size(0) == tex.size(0) && t.size(1) == 6 && t.size(2) == sz.y && t.size(3) == sz.x && t.size(4) == p.channels, "mip level size mismatch in mip stack");
                 if (sz.x == 1 && sz.y == 1)
                     NVDR_CHECK(i == p.mipLevelMax, "mip level size mismatch in mip stack");
-                p.tex[i] = t.data_ptr<float>();
+                if (upcast)
+                    t = t.to(torch::kFloat32);
+                p.tex[i] = t.data_ptr();
             }
         }
         else
@@ -317,9 +466,11 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
             int mipTotal = calculateMipInfo(NVDR_CTX_PARAMS, p, mipOffsets);
             NVDR_CHECK(tex.sizes() == mip_wrapper.texture_size && cube_mode == mip_wrapper.cube_mode, "mip does not match texture size");
             NVDR_CHECK(mip_w.sizes().size() == 1 && mip_w.size(0) == mipTotal, "wrapped mip tensor size mismatch");
-            pmip = mip_w.data_ptr<float>();
+            if (upcast)
+                mip_w = mip_w.to(torch::kFloat32);
+            pmip = (char*)mip_w.data_ptr();
             for (int i=1; i <= p.mipLevelMax; i++)
-                p.tex[i] = pmip + mipOffsets[i]; // Pointers to mip levels.
+                p.tex[i] = pmip + (size_t)mipOffsets[i] * esz; // Pointers to mip levels.
         }
     }
 
@@ -329,28 +480,36 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
     if ((p.channels & 3) == 0)
     {
         for (int i=0; i <= p.mipLevelMax; i++)
-            NVDR_CHECK(!((uintptr_t)p.tex[i] & 15), "tex or mip input tensor not aligned to float4");
-        NVDR_CHECK(!((uintptr_t)p.out    & 15), "out output tensor not aligned to float4");
-        NVDR_CHECK(!((uintptr_t)pmip     & 15), "mip input tensor not aligned to float4");
+            NVDR_CHECK(!((uintptr_t)p.tex[i] & (4 * esz - 1)), "tex or mip input tensor not aligned to four elements");
+        NVDR_CHECK(!((uintptr_t)p.out    & (4 * esz - 1)), "out output tensor not aligned to four elements");
+        NVDR_CHECK(!((uintptr_t)pmip     & (4 * esz - 1)), "mip input tensor not aligned to four elements");
     }
     if ((p.channels & 1) == 0)
     {
         for (int i=0; i <= p.mipLevelMax; i++)
-            NVDR_CHECK(!((uintptr_t)p.tex[i] & 7), "tex or mip input tensor not aligned to float2");
-        NVDR_CHECK(!((uintptr_t)p.out    & 7), "out output tensor not aligned to float2");
-        NVDR_CHECK(!((uintptr_t)pmip     & 7), "mip input tensor not aligned to float2");
+            NVDR_CHECK(!((uintptr_t)p.tex[i] & (2 * esz - 1)), "tex or mip input tensor not aligned to two elements");
+        NVDR_CHECK(!((uintptr_t)p.out    & (2 * esz - 1)), "out output tensor not aligned to two elements");
+        NVDR_CHECK(!((uintptr_t)pmip     & (2 * esz - 1)), "mip input tensor not aligned to two elements");
     }
     if (!cube_mode)
         NVDR_CHECK(!((uintptr_t)p.uvDA & 15), "uv_da input tensor not aligned to float4");
     else
         NVDR_CHECK(!((uintptr_t)p.uvDA & 7), "uv_da input tensor not aligned to float2");
 
+    // Run on the shared thread pool if on CPU.
+    if (cpu)
+    {
+        TextureCpuFwd(p, ThreadPool::getGlobal());
+        return out.to(dtype);
+    }
+
+#ifndef NVDR_CPU_ONLY
     // Choose launch parameters for texture lookup kernel.
     dim3 blockSize = getLaunchBlockSize(TEX_FWD_MAX_KERNEL_BLOCK_WIDTH, TEX_FWD_MAX_KERNEL_BLOCK_HEIGHT, p.imgWidth, p.imgHeight);
     dim3 gridSize  = getLaunchGridSize(blockSize, p.imgWidth, p.imgHeight, p.n);
 
     // Choose kernel based on filter mode, cube mode, bias-only mode, and datatype.
-    void* func_tbl[TEX_MODE_COUNT * 2 * 2 * 3] = {
+    void* func_tbl[TEX_MODE_COUNT * 2 * 2 * 3 * 3] = {
         (void*)TextureFwdKernelNearest1,
         (void*)TextureFwdKernelNearest2,
         (void*)TextureFwdKernelNearest4,
@@ -399,6 +558,102 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
         (void*)TextureFwdKernelCubeLinearMipmapLinearBO1,
         (void*)TextureFwdKernelCubeLinearMipmapLinearBO2,
         (void*)TextureFwdKernelCubeLinearMipmapLinearBO4,
+        (void*)TextureFwdKernelNearest1F16,
+        (void*)TextureFwdKernelNearest2F16,
+        (void*)TextureFwdKernelNearest4F16,
+        (void*)TextureFwdKernelLinear1F16,
+        (void*)TextureFwdKernelLinear2F16,
+        (void*)TextureFwdKernelLinear4F16,
+        (void*)TextureFwdKernelLinearMipmapNearest1F16,
+        (void*)TextureFwdKernelLinearMipmapNearest2F16,
+        (void*)TextureFwdKernelLinearMipmapNearest4F16,
+        (void*)TextureFwdKernelLinearMipmapLinear1F16,
+        (void*)TextureFwdKernelLinearMipmapLinear2F16,
+        (void*)TextureFwdKernelLinearMipmapLinear4F16,
+        (void*)TextureFwdKernelCubeNearest1F16,
+        (void*)TextureFwdKernelCubeNearest2F16,
+        (void*)TextureFwdKernelCubeNearest4F16,
+        (void*)TextureFwdKernelCubeLinear1F16,
+        (void*)TextureFwdKernelCubeLinear2F16,
+        (void*)TextureFwdKernelCubeLinear4F16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearest1F16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearest2F16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearest4F16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinear1F16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinear2F16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinear4F16,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        (void*)TextureFwdKernelLinearMipmapNearestBO1F16,
+        (void*)TextureFwdKernelLinearMipmapNearestBO2F16,
+        (void*)TextureFwdKernelLinearMipmapNearestBO4F16,
+        (void*)TextureFwdKernelLinearMipmapLinearBO1F16,
+        (void*)TextureFwdKernelLinearMipmapLinearBO2F16,
+        (void*)TextureFwdKernelLinearMipmapLinearBO4F16,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        (void*)TextureFwdKernelCubeLinearMipmapNearestBO1F16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearestBO2F16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearestBO4F16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinearBO1F16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinearBO2F16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinearBO4F16,
+        (void*)TextureFwdKernelNearest1BF16,
+        (void*)TextureFwdKernelNearest2BF16,
+        (void*)TextureFwdKernelNearest4BF16,
+        (void*)TextureFwdKernelLinear1BF16,
+        (void*)TextureFwdKernelLinear2BF16,
+        (void*)TextureFwdKernelLinear4BF16,
+        (void*)TextureFwdKernelLinearMipmapNearest1BF16,
+        (void*)TextureFwdKernelLinearMipmapNearest2BF16,
+        (void*)TextureFwdKernelLinearMipmapNearest4BF16,
+        (void*)TextureFwdKernelLinearMipmapLinear1BF16,
+        (void*)TextureFwdKernelLinearMipmapLinear2BF16,
+        (void*)TextureFwdKernelLinearMipmapLinear4BF16,
+        (void*)TextureFwdKernelCubeNearest1BF16,
+        (void*)TextureFwdKernelCubeNearest2BF16,
+        (void*)TextureFwdKernelCubeNearest4BF16,
+        (void*)TextureFwdKernelCubeLinear1BF16,
+        (void*)TextureFwdKernelCubeLinear2BF16,
+        (void*)TextureFwdKernelCubeLinear4BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearest1BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearest2BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearest4BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinear1BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinear2BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinear4BF16,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        (void*)TextureFwdKernelLinearMipmapNearestBO1BF16,
+        (void*)TextureFwdKernelLinearMipmapNearestBO2BF16,
+        (void*)TextureFwdKernelLinearMipmapNearestBO4BF16,
+        (void*)TextureFwdKernelLinearMipmapLinearBO1BF16,
+        (void*)TextureFwdKernelLinearMipmapLinearBO2BF16,
+        (void*)TextureFwdKernelLinearMipmapLinearBO4BF16,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        (void*)TextureFwdKernelCubeLinearMipmapNearestBO1BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearestBO2BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapNearestBO4BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinearBO1BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinearBO2BF16,
+        (void*)TextureFwdKernelCubeLinearMipmapLinearBO4BF16,
     };
 
     // Function index.
@@ -407,13 +662,19 @@ torch::Tensor texture_fwd_mip(torch::Tensor tex, torch::Tensor uv, torch::Tensor
         func_idx += TEX_MODE_COUNT; // Cube variant.
     if (p.enableMip && !has_uv_da)
         func_idx += TEX_MODE_COUNT * 2; // Bias-only variant.
+    func_idx += p.texType * TEX_MODE_COUNT * 2 * 2; // Storage type variant.
     func_idx = func_idx * 3 + channel_div_idx; // Choose vector size.
 
     // Launch kernel.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_DEVICE_RANGE("texture_fwd/kernel", stream);
     NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func_tbl[func_idx], gridSize, blockSize, args, 0, stream));
 
     // Return output tensor.
     return out;
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 // Version without mipmaps.
@@ -429,8 +690,9 @@ torch::Tensor texture_fwd(torch::Tensor tex, torch::Tensor uv, int filter_mode,
 
 std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vector<torch::Tensor> > texture_grad_linear_mipmap_linear(torch::Tensor tex, torch::Tensor uv, torch::Tensor dy, torch::Tensor uv_da, torch::Tensor mip_level_bias, TextureMipWrapper mip_wrapper, std::vector<torch::Tensor> mip_stack, int filter_mode, int boundary_mode)
 {
-    const at::cuda::OptionalCUDAGuard device_guard(device_of(tex));
-    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    NVDR_PROFILE_RANGE("texture_grad");
+    bool cpu = tex.is_cpu();
+    NVDR_DEVICE_GUARD(cpu, tex);
     TextureKernelParams p = {}; // Initialize all fields to zero.
     bool has_mip_stack = (mip_stack.size() > 0);
     torch::Tensor& mip_w = mip_wrapper.mip; // Unwrap.
@@ -448,36 +710,42 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
     }
 
     // Check inputs.
-    NVDR_CHECK_DEVICE(tex, uv);
+    ProfileRange checks("texture_grad/checks");
+    NVDR_CHECK_DEVICE_OR_CPU(tex, uv, dy);
     NVDR_CHECK_CONTIGUOUS(tex, uv);
-    NVDR_CHECK_F32(tex, uv);
+    NVDR_CHECK_FLOAT(tex);
+    NVDR_CHECK_F32(uv);
     if (p.enableMip)
     {
         if (has_mip_stack)
         {
-            TORCH_CHECK(at::cuda::check_device(mip_stack), __func__, "(): Mip stack inputs must reside on the correct GPU device");
+            std::vector<torch::Tensor> mip_stack_tex(mip_stack);
+            mip_stack_tex.push_back(tex);
+            TORCH_CHECK(nvdr_check_device_or_cpu(mip_stack_tex), __func__, "(): Mip stack inputs must reside on the same device as tex");
             nvdr_check_contiguous(mip_stack, __func__, "(): Mip stack inputs must be contiguous tensors");
-            nvdr_check_f32(mip_stack, __func__, "(): Mip stack inputs must be float32 tensors");
+            for (const torch::Tensor& t : mip_stack)
+                NVDR_CHECK(t.dtype() == tex.dtype(), "mip stack inputs must have the same dtype as tex");
         }
         else
         {
-            NVDR_CHECK_DEVICE(mip_w);
+            NVDR_CHECK_DEVICE_OR_CPU(tex, mip_w);
             NVDR_CHECK_CONTIGUOUS(mip_w);
-            NVDR_CHECK_F32(mip_w);
+            NVDR_CHECK(mip_w.dtype() == tex.dtype(), "mip must have the same dtype as tex");
         }
         if (has_uv_da)
         {
-            NVDR_CHECK_DEVICE(uv_da);
+            NVDR_CHECK_DEVICE_OR_CPU(tex, uv_da);
             NVDR_CHECK_CONTIGUOUS(uv_da);
             NVDR_CHECK_F32(uv_da);
         }
         if (has_mip_level_bias)
         {
-            NVDR_CHECK_DEVICE(mip_level_bias);
+            NVDR_CHECK_DEVICE_OR_CPU(tex, mip_level_bias);
             NVDR_CHECK_CONTIGUOUS(mip_level_bias);
             NVDR_CHECK_F32(mip_level_bias);
         }
     }
+    checks.end();
 
     // Sanity checks and state setters.
     bool cube_mode = (boundary_mode == TEX_BOUNDARY_MODE_CUBE);
@@ -517,19 +785,28 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
             NVDR_CHECK(mip_level_bias.sizes().size() == 3 && mip_level_bias.size(0) == p.n && mip_level_bias.size(1) == p.imgHeight && mip_level_bias.size(2) == p.imgWidth, "mip_level_bias must have shape [minibatch_size, height, width]");
     }
     NVDR_CHECK(dy.sizes().size() == 4 && dy.size(0) == p.n && dy.size(1) == p.imgHeight && dy.size(2) == p.imgWidth && dy.size(3) == p.channels, "dy must have shape [minibatch_size, height, width, channels]");
+    NVDR_CHECK(dy.dtype() == tex.dtype(), "dy must have the same dtype as tex");
+
+    // Half precision textures are upcast on CPU. Texture gradients are accumulated in fp32 and converted back.
+    torch::ScalarType dtype = tex.scalar_type();
+    p.texType = nvdr_storage_type(tex);
+    bool upcast = cpu && p.texType != NVDR_STORAGE_F32;
+    if (upcast)
+        tex = tex.to(torch::kFloat32);
+    int esz = tex.element_size();
 
     // Get contiguous version of dy.
-    torch::Tensor dy_ = dy.contiguous();
+    torch::Tensor dy_ = upcast ? dy.to(torch::kFloat32).contiguous() : dy.contiguous();
 
     // Get input pointers.
-    p.tex[0] = tex.data_ptr<float>();
+    p.tex[0] = tex.data_ptr();
     p.uv = uv.data_ptr<float>();
-    p.dy = dy_.data_ptr<float>();
+    p.dy = dy_.data_ptr();
     p.uvDA = (p.enableMip && has_uv_da) ? uv_da.data_ptr<float>() : NULL;
     p.mipLevelBias = (p.enableMip && has_mip_level_bias) ? mip_level_bias.data_ptr<float>() : NULL;
 
     // Allocate output tensor for tex gradient.
-    torch::Tensor grad_tex = torch::zeros_like(tex);
+    torch::Tensor grad_tex = torch::zeros(tex.sizes(), tex.options().dtype(torch::kFloat32));
     p.gradTex[0] = grad_tex.data_ptr<float>();
 
     // Allocate output tensor for uv gradient.
@@ -570,7 +847,7 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
     // Mip-related setup.
     torch::Tensor grad_mip;
     std::vector<torch::Tensor> grad_mip_stack;
-    float* pmip = 0;
+    char* pmip = 0;
     float* pgradMip = 0;
     if (p.enableMip)
     {
@@ -589,10 +866,12 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
                 if (sz.x == 1 && sz.y == 1)
                     NVDR_CHECK(i == p.mipLevelMax, "mip level size mismatch in mip stack");
 
-                torch::Tensor g = torch::zeros_like(t);
+                if (upcast)
+                    t = t.to(torch::kFloat32);
+                torch::Tensor g = torch::zeros(t.sizes(), t.options().dtype(torch::kFloat32));
                 grad_mip_stack.push_back(g);
 
-                p.tex[i] = t.data_ptr<float>();
+                p.tex[i] = t.data_ptr();
                 p.gradTex[i] = g.data_ptr<float>();
             }
         }
@@ -603,12 +882,14 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
             int mipTotal = calculateMipInfo(NVDR_CTX_PARAMS, p, mipOffsets);
             NVDR_CHECK(tex.sizes() == mip_wrapper.texture_size && cube_mode == mip_wrapper.cube_mode, "mip does not match texture size");
             NVDR_CHECK(mip_w.sizes().size() == 1 && mip_w.size(0) == mipTotal, "mip tensor size mismatch");
-            grad_mip = torch::zeros_like(mip_w);
-            pmip = (float*)mip_w.data_ptr<float>();
+            if (upcast)
+                mip_w = mip_w.to(torch::kFloat32);
+            grad_mip = torch::zeros(mip_w.sizes(), mip_w.options().dtype(torch::kFloat32));
+            pmip = (char*)mip_w.data_ptr();
             pgradMip = grad_mip.data_ptr<float>();
             for (int i=1; i <= p.mipLevelMax; i++)
             {
-                p.tex[i] = pmip + mipOffsets[i]; // Pointers to mip levels.
+                p.tex[i] = pmip + (size_t)mipOffsets[i] * esz; // Pointers to mip levels.
                 p.gradTex[i] = pgradMip + mipOffsets[i]; // Pointers to mip gradients.
             }
         }
@@ -631,31 +912,43 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
     {
         for (int i=0; i <= p.mipLevelMax; i++)
         {
-            NVDR_CHECK(!((uintptr_t)p.tex[i]     & 15), "tex or mip input tensor not aligned to float4");
+            NVDR_CHECK(!((uintptr_t)p.tex[i]     & (4 * esz - 1)), "tex or mip input tensor not aligned to four elements");
             NVDR_CHECK(!((uintptr_t)p.gradTex[i] & 15), "grad_tex output tensor not aligned to float4");
         }
-        NVDR_CHECK(!((uintptr_t)p.dy         & 15), "dy input tensor not aligned to float4");
-        NVDR_CHECK(!((uintptr_t)pmip         & 15), "mip input tensor not aligned to float4");
+        NVDR_CHECK(!((uintptr_t)p.dy         & (4 * esz - 1)), "dy input tensor not aligned to four elements");
+        NVDR_CHECK(!((uintptr_t)pmip         & (4 * esz - 1)), "mip input tensor not aligned to four elements");
         NVDR_CHECK(!((uintptr_t)pgradMip     & 15), "internal mip gradient tensor not aligned to float4");
     }
     if ((p.channels & 1) == 0)
     {
         for (int i=0; i <= p.mipLevelMax; i++)
         {
-            NVDR_CHECK(!((uintptr_t)p.tex[i]     & 7), "tex or mip input tensor not aligned to float2");
+            NVDR_CHECK(!((uintptr_t)p.tex[i]     & (2 * esz - 1)), "tex or mip input tensor not aligned to two elements");
             NVDR_CHECK(!((uintptr_t)p.gradTex[i] & 7), "grad_tex output tensor not aligned to float2");
         }
-         NVDR_CHECK(!((uintptr_t)p.dy         & 7), "dy output tensor not aligned to float2");
-        NVDR_CHECK(!((uintptr_t)pmip         & 7), "mip input tensor not aligned to float2");
+         NVDR_CHECK(!((uintptr_t)p.dy         & (2 * esz - 1)), "dy output tensor not aligned to two elements");
+        NVDR_CHECK(!((uintptr_t)pmip         & (2 * esz - 1)), "mip input tensor not aligned to two elements");
         NVDR_CHECK(!((uintptr_t)pgradMip     & 7), "internal mip gradient tensor not aligned to float2");
     }
 
+    // Run on the shared thread pool if on CPU. Same two passes as on the GPU.
+    if (cpu)
+    {
+        TextureCpuGrad(p, ThreadPool::getGlobal());
+        if (p.enableMip && !has_mip_stack)
+            TextureCpuMipGrad(p, ThreadPool::getGlobal());
+        for (torch::Tensor& g : grad_mip_stack)
+            g = g.to(dtype);
+        return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vector<torch::Tensor> >(grad_tex.to(dtype), grad_uv, grad_uv_da, grad_mip_level_bias, grad_mip_stack);
+    }
+
+#ifndef NVDR_CPU_ONLY
     // Choose launch parameters for main gradient kernel.
     void* args[] = {&p};
     dim3 blockSize = getLaunchBlockSize(TEX_GRAD_MAX_KERNEL_BLOCK_WIDTH, TEX_GRAD_MAX_KERNEL_BLOCK_HEIGHT, p.imgWidth, p.imgHeight);
     dim3 gridSize  = getLaunchGridSize(blockSize, p.imgWidth, p.imgHeight, p.n);
 
-    void* func_tbl[TEX_MODE_COUNT * 2 * 2] = {
+    void* func_tbl[TEX_MODE_COUNT * 2 * 2 * 3] = {
         (void*)TextureGradKernelNearest,
         (void*)TextureGradKernelLinear,
         (void*)TextureGradKernelLinearMipmapNearest,
@@ -672,6 +965,38 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
         NULL,
         (void*)TextureGradKernelCubeLinearMipmapNearestBO,
         (void*)TextureGradKernelCubeLinearMipmapLinearBO,
+        (void*)TextureGradKernelNearestF16,
+        (void*)TextureGradKernelLinearF16,
+        (void*)TextureGradKernelLinearMipmapNearestF16,
+        (void*)TextureGradKernelLinearMipmapLinearF16,
+        (void*)TextureGradKernelCubeNearestF16,
+        (void*)TextureGradKernelCubeLinearF16,
+        (void*)TextureGradKernelCubeLinearMipmapNearestF16,
+        (void*)TextureGradKernelCubeLinearMipmapLinearF16,
+        NULL,
+        NULL,
+        (void*)TextureGradKernelLinearMipmapNearestBOF16,
+        (void*)TextureGradKernelLinearMipmapLinearBOF16,
+        NULL,
+        NULL,
+        (void*)TextureGradKernelCubeLinearMipmapNearestBOF16,
+        (void*)TextureGradKernelCubeLinearMipmapLinearBOF16,
+        (void*)TextureGradKernelNearestBF16,
+        (void*)TextureGradKernelLinearBF16,
+        (void*)TextureGradKernelLinearMipmapNearestBF16,
+        (void*)TextureGradKernelLinearMipmapLinearBF16,
+        (void*)TextureGradKernelCubeNearestBF16,
+        (void*)TextureGradKernelCubeLinearBF16,
+        (void*)TextureGradKernelCubeLinearMipmapNearestBF16,
+        (void*)TextureGradKernelCubeLinearMipmapLinearBF16,
+        NULL,
+        NULL,
+        (void*)TextureGradKernelLinearMipmapNearestBOBF16,
+        (void*)TextureGradKernelLinearMipmapLinearBOBF16,
+        NULL,
+        NULL,
+        (void*)TextureGradKernelCubeLinearMipmapNearestBOBF16,
+        (void*)TextureGradKernelCubeLinearMipmapLinearBOBF16,
     };
 
     // Function index.
@@ -680,9 +1005,13 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
         func_idx += TEX_MODE_COUNT; // Cube variant.
     if (p.enableMip && !has_uv_da)
         func_idx += TEX_MODE_COUNT * 2; // Bias-only variant.
+    func_idx += p.texType * TEX_MODE_COUNT * 2 * 2; // Storage type variant.
 
     // Launch main gradient kernel.
+    cudaStream_t stream = at::cuda::getCurrentCUDAStream();
+    ProfileRange gradRange("texture_grad/kernel", (void*)stream);
     NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(func_tbl[func_idx], gridSize, blockSize, args, 0, stream));
+    gradRange.end();
 
     // Launch kernel to pull gradients from mip levels. Don't do this if mip stack was supplied - individual level gradients are already there.
     if (p.enableMip && !has_mip_stack)
@@ -692,11 +1021,17 @@ std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vect
         int sharedBytes = blockSize.x * blockSize.y * p.channels * sizeof(float);
 
         void* mip_grad_func_tbl[3] = { (void*)MipGradKernel1, (void*)MipGradKernel2, (void*)MipGradKernel4 };
+        NVDR_PROFILE_DEVICE_RANGE("texture_grad/mip_kernel", stream);
         NVDR_CHECK_CUDA_ERROR(LAUNCH_KERNEL(mip_grad_func_tbl[channel_div_idx], gridSize, blockSize, args, sharedBytes, stream));
     }
 
     // Return output tensors.
-    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vector<torch::Tensor> >(grad_tex, grad_uv, grad_uv_da, grad_mip_level_bias, grad_mip_stack);
+    for (torch::Tensor& g : grad_mip_stack)
+        g = g.to(dtype);
+    return std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, std::vector<torch::Tensor> >(grad_tex.to(dtype), grad_uv, grad_uv_da, grad_mip_level_bias, grad_mip_stack);
+#else
+    NVDR_NO_CUDA_SUPPORT();
+#endif
 }
 
 // Version for nearest filter mode.
@@ -29,7 +29,7 @@ public:
 //------------------------------------------------------------------------
 // Python CudaRaster state wrapper.
 
-namespace CR { class CudaRaster; }
+namespace CR { class CudaRaster; class Allocator; }
 class RasterizeCRStateWrapper
 {
 public:
@@ -37,9 +37,25 @@ public:
     ~RasterizeCRStateWrapper    (void);
 
     CR::CudaRaster*             cr;
+    CR::Allocator*              deviceAllocator;    // PyTorch caching allocator for internal buffers.
+    int                         splitFactor;        // Number of chunks the triangles were drawn in by the latest call. Peeling reuses its results only if 1.
     int                         cudaDeviceIdx;
 };
 
+//------------------------------------------------------------------------
+// Python CpuRaster state wrapper.
+
+namespace CR { class CpuRaster; }
+class RasterizeCpuStateWrapper
+{
+public:
+    RasterizeCpuStateWrapper    (int numThreads);
+    ~RasterizeCpuStateWrapper   (void);
+
+    CR::CpuRaster*              cr;
+    int                         numThreads;     // Zero = shared global thread pool.
+};
+
 //------------------------------------------------------------------------
 // Mipmap wrapper to prevent intrusion from Python side.
 
@@ -55,6 +71,8 @@ public:
 
 //------------------------------------------------------------------------
 // Antialias topology hash wrapper to prevent intrusion from Python side.
+// The hash layout is identical on CPU and GPU, so it can be moved between
+// devices as is.
 
 class TopologyHashWrapper
 {
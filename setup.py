@@ -32,6 +32,10 @@ def get_package_data():
             'common/hipraster/impl/*.hpp',
             'common/hipraster/impl/*.inl',
             'common/hipraster/impl/*.hip',
+            'common/cpuraster/*.hpp',
+            'common/cpuraster/impl/*.cpp',
+            'common/cpuraster/impl/*.hpp',
+            'common/cpuraster/impl/*.inl',
             'lib/*.h',
             'torch/*.h',
             'torch/*.inl',
@@ -49,6 +53,10 @@ def get_package_data():
             'common/cudaraster/impl/*.hpp',
             'common/cudaraster/impl/*.inl',
             'common/cudaraster/impl/*.cu',
+            'common/cpuraster/*.hpp',
+            'common/cpuraster/impl/*.cpp',
+            'common/cpuraster/impl/*.hpp',
+            'common/cpuraster/impl/*.inl',
             'lib/*.h',
             'torch/*.h',
             'torch/*.inl',
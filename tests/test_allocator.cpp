@@ -0,0 +1,231 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "cudaraster/Allocator.hpp"
+#include "cudaraster/impl/Buffer.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Count heap allocations made through operator new, so that the tests can
+// check that the allocators don't fall back to the heap in steady state.
+
+static std::atomic<long long> s_numHeapAllocs(0);
+
+void* operator new(size_t bytes)
+{
+    s_numHeapAllocs++;
+    void* ptr = malloc(bytes ? bytes : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+//------------------------------------------------------------------------
+// The driver allocators are not linked in. Buffers default to host memory.
+
+Allocator& CR::getDefaultDeviceAllocator(void)
+{
+    static HostArenaAllocator s_allocator;
+    return s_allocator;
+}
+
+Allocator& CR::getDefaultHostAllocator(void)
+{
+    return getDefaultDeviceAllocator();
+}
+
+//------------------------------------------------------------------------
+
+static const size_t c_sizes[]   = { 1000, 70000, 300000, 5000, 256, 3 << 20 };
+static const int    c_numSizes  = (int)(sizeof(c_sizes) / sizeof(c_sizes[0]));
+
+static void allocateAll(Allocator& a, void** ptrs)
+{
+    for (int i=0; i < c_numSizes; i++)
+        ptrs[i] = a.allocate(c_sizes[i]);
+}
+
+static void releaseAll(Allocator& a, void** ptrs)
+{
+    for (int i=0; i < c_numSizes; i++)
+        a.release(ptrs[i], c_sizes[i]);
+}
+
+//------------------------------------------------------------------------
+
+static void testClassSize(void)
+{
+    TEST_CHECK(PoolAllocator::getClassSize(0) == 256);
+    TEST_CHECK(PoolAllocator::getClassSize(256) == 256);
+    TEST_CHECK(PoolAllocator::getClassSize(257) == 320);
+    TEST_CHECK(PoolAllocator::getClassSize(1 << 20) == (1 << 20));
+
+    size_t prev = 0;
+    for (size_t bytes = 1; bytes < (64 << 20); bytes = bytes * 9 / 8 + 1)
+    {
+        size_t c = PoolAllocator::getClassSize(bytes);
+        TEST_CHECK(c >= bytes);
+        TEST_CHECK(c <= 256 || c - bytes < bytes / 4 + 256); // At most a quarter step of waste.
+        TEST_CHECK(c >= prev);
+        prev = c;
+    }
+}
+
+//------------------------------------------------------------------------
+// Released arena memory is handed out again from the start of its chunk,
+// and the arena keeps its alignment.
+
+static void testHostArena(void)
+{
+    HostArenaAllocator arena(1 << 20);
+    void* first[c_numSizes];
+    void* again[c_numSizes];
+
+    allocateAll(arena, first);
+    for (int i=0; i < c_numSizes; i++)
+        TEST_CHECK(first[i] && ((uintptr_t)first[i] & 255) == 0);
+    releaseAll(arena, first);
+
+    long long heap = s_numHeapAllocs;
+    allocateAll(arena, again);
+    for (int i=0; i < c_numSizes; i++)
+        TEST_CHECK(again[i] == first[i]);
+    releaseAll(arena, again);
+    TEST_CHECK(s_numHeapAllocs == heap);
+
+    AllocatorStats s = arena.getStats();
+    TEST_CHECK(s.numAllocs == 2 * c_numSizes && s.numReleases == 2 * c_numSizes);
+    TEST_CHECK(s.bytesInUse == 0);
+}
+
+//------------------------------------------------------------------------
+// After one warm-up iteration, a pool serves a repeating sequence of
+// requests from its cache without touching the upstream allocator or the
+// heap.
+
+static void testPoolSteadyState(void)
+{
+    HostArenaAllocator arena;
+    PoolAllocator pool(arena);
+    void* ptrs[c_numSizes];
+
+    allocateAll(pool, ptrs);
+    releaseAll(pool, ptrs);
+    AllocatorStats up = arena.getStats();
+    TEST_CHECK(up.numAllocs == c_numSizes && up.numReleases == 0);
+
+    arena.resetStats();
+    pool.resetStats();
+    long long heap = s_numHeapAllocs;
+    const int numIters = 100;
+    for (int iter=0; iter < numIters; iter++)
+    {
+        allocateAll(pool, ptrs);
+        releaseAll(pool, ptrs);
+    }
+    TEST_CHECK(s_numHeapAllocs == heap);
+
+    up = arena.getStats();
+    TEST_CHECK(up.numAllocs == 0 && up.numReleases == 0);
+
+    AllocatorStats s = pool.getStats();
+    TEST_CHECK(s.numAllocs == numIters * c_numSizes && s.numReleases == numIters * c_numSizes);
+    TEST_CHECK(s.bytesInUse == 0);
+
+    long long total = 0;
+    for (int i=0; i < c_numSizes; i++)
+        total += (long long)c_sizes[i];
+    TEST_CHECK(s.peakBytesInUse == total);
+
+    // Trimming hands the cached blocks back.
+    pool.trim();
+    up = arena.getStats();
+    TEST_CHECK(up.numReleases == c_numSizes && up.bytesInUse == 0);
+}
+
+//------------------------------------------------------------------------
+// A multi-resolution loop over growing buffers allocates only until the
+// largest size has been seen, and growth is geometric.
+
+static void testBufferGrowth(void)
+{
+    HostArenaAllocator arena;
+    PoolAllocator pool(arena);
+    static const size_t resolutions[] = { 256, 512, 384, 1024, 640 };
+
+    Buffer buf;
+    HostBuffer hostBuf;
+    buf.setAllocator(pool);
+    hostBuf.setAllocator(pool);
+
+    size_t prevSize = 0;
+    for (int i=0; i < 5; i++)
+    {
+        size_t bytes = resolutions[i] * resolutions[i] * 4;
+        buf.grow(bytes);
+        hostBuf.grow(bytes / 16);
+        TEST_CHECK(buf.getSize() >= bytes && hostBuf.getSize() >= bytes / 16);
+        if (buf.getSize() != prevSize && prevSize)
+            TEST_CHECK(buf.getSize() >= prevSize + prevSize / 2);
+        prevSize = buf.getSize();
+    }
+
+    pool.resetStats();
+    long long heap = s_numHeapAllocs;
+    for (int iter=0; iter < 20; iter++)
+    {
+        for (int i=0; i < 5; i++)
+        {
+            size_t bytes = resolutions[i] * resolutions[i] * 4;
+            buf.grow(bytes);
+            hostBuf.grow(bytes / 16);
+        }
+    }
+    TEST_CHECK(pool.getStats().numAllocs == 0);
+    TEST_CHECK(s_numHeapAllocs == heap);
+
+    // Exact-size resets cycle through the pool cache once both sizes have been released.
+    for (int iter=0; iter < 2; iter++)
+    {
+        buf.reset(1000);
+        buf.reset(5000);
+    }
+    pool.resetStats();
+    arena.resetStats();
+    heap = s_numHeapAllocs;
+    for (int iter=0; iter < 20; iter++)
+    {
+        buf.reset(1000);
+        buf.reset(5000);
+    }
+    TEST_CHECK(pool.getStats().numAllocs == 40);
+    TEST_CHECK(arena.getStats().numAllocs == 0);
+    TEST_CHECK(s_numHeapAllocs == heap);
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testClassSize();
+    testHostArena();
+    testPoolSteadyState();
+    testBufferGrowth();
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,147 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "cpuraster/CpuRaster.hpp"
+#include <cstdint>
+#include <set>
+#include <vector>
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Scene in a 64x64 viewport, one triangle per entry. Positions are in
+// pixels, converted to clip space with w = 1. Triangles that are
+// counterclockwise in normalized device coordinates are front-facing.
+
+static const int c_size = 64;
+
+struct TestTriangle
+{
+    float   x[3];
+    float   y[3];
+    float   z[3];
+};
+
+enum
+{
+    Tri_FrontLarge = 0,     // Counterclockwise, left half of the viewport.
+    Tri_BackLarge,          // Clockwise, right half of the viewport.
+    Tri_FrontSmall,         // Counterclockwise, 2 pixels of area, covers one pixel center.
+    Tri_FrontSmallClipped,  // Same shape, but crosses the far plane and takes the clipping path.
+    Tri_Degenerate,         // Zero area.
+    Tri_Count
+};
+
+static const TestTriangle c_triangles[Tri_Count] =
+{
+    { {  3.f, 29.f, 16.f }, {  3.f,  3.f, 61.f }, { 0.f, 0.f, 0.f } },
+    { { 35.f, 48.f, 61.f }, {  3.f, 61.f,  3.f }, { 0.f, 0.f, 0.f } },
+    { { 58.f, 60.f, 58.f }, { 58.f, 58.f, 60.f }, { 0.f, 0.f, 0.f } },
+    { {  4.f,  6.f,  4.f }, { 58.f, 58.f, 60.f }, { 0.f, 0.f, 1.5f } },
+    { { 40.f, 44.f, 48.f }, { 40.f, 44.f, 48.f }, { 0.f, 0.f, 0.f } },
+};
+
+//------------------------------------------------------------------------
+
+// Draws the scene and returns the triangle ids found in the color buffer.
+static std::set<int> draw(CpuRaster& cr, unsigned int flags, float minArea)
+{
+    std::vector<float> vertices;
+    std::vector<int32_t> indices;
+    for (int i=0; i < Tri_Count; i++)
+    {
+        const TestTriangle& t = c_triangles[i];
+        for (int j=0; j < 3; j++)
+        {
+            vertices.push_back(t.x[j] / c_size * 2.f - 1.f);
+            vertices.push_back(t.y[j] / c_size * 2.f - 1.f);
+            vertices.push_back(t.z[j]);
+            vertices.push_back(1.f);
+            indices.push_back(i * 3 + j);
+        }
+    }
+
+    cr.setBufferSize(c_size, c_size, 1);
+    cr.setViewport(c_size, c_size, 0, 0);
+    cr.setVertexBuffer(vertices.data(), Tri_Count * 3);
+    cr.setIndexBuffer(indices.data(), Tri_Count);
+    cr.setRenderModeFlags(flags);
+    cr.setMinTriangleArea(minArea);
+    cr.deferredClear(0u);
+    TEST_CHECK(cr.drawTriangles(NULL, false));
+
+    // Color buffer holds the triangle index plus one, zero where nothing was drawn.
+    std::set<int> ids;
+    const uint32_t* color = (const uint32_t*)cr.getColorBuffer();
+    for (int i=0; i < c_size * c_size; i++)
+        if (color[i])
+            ids.insert((int)color[i] - 1);
+    return ids;
+}
+
+static bool has(const std::set<int>& ids, int tri) { return ids.count(tri) != 0; }
+
+//------------------------------------------------------------------------
+
+static void testCulling(int numThreads)
+{
+    CpuRaster cr(numThreads);
+    std::set<int> ids;
+
+    // Everything except the degenerate triangle is drawn without culling.
+    ids = draw(cr, 0, 0.f);
+    TEST_CHECK(has(ids, Tri_FrontLarge) && has(ids, Tri_BackLarge) && has(ids, Tri_FrontSmall) && has(ids, Tri_FrontSmallClipped));
+    TEST_CHECK(!has(ids, Tri_Degenerate));
+    TEST_CHECK(ids.size() == 4);
+
+    // Backface culling removes the clockwise triangle.
+    ids = draw(cr, CpuRaster::RenderModeFlag_EnableBackfaceCulling, 0.f);
+    TEST_CHECK(!has(ids, Tri_BackLarge));
+    TEST_CHECK(has(ids, Tri_FrontLarge) && has(ids, Tri_FrontSmall) && has(ids, Tri_FrontSmallClipped));
+
+    // Frontface culling removes the counterclockwise ones, also on the clipping path.
+    ids = draw(cr, CpuRaster::RenderModeFlag_EnableFrontfaceCulling, 0.f);
+    TEST_CHECK(has(ids, Tri_BackLarge));
+    TEST_CHECK(ids.size() == 1);
+
+    // Both at once leave nothing.
+    ids = draw(cr, CpuRaster::RenderModeFlag_EnableBackfaceCulling | CpuRaster::RenderModeFlag_EnableFrontfaceCulling, 0.f);
+    TEST_CHECK(ids.empty());
+
+    // Area threshold between the small and the large triangles. The clipped triangle is kept, as
+    // the threshold is not applied on the clipping path.
+    ids = draw(cr, 0, 4.f);
+    TEST_CHECK(!has(ids, Tri_FrontSmall));
+    TEST_CHECK(has(ids, Tri_FrontLarge) && has(ids, Tri_BackLarge) && has(ids, Tri_FrontSmallClipped));
+
+    // Just below the area of the small triangle.
+    ids = draw(cr, 0, 1.99f);
+    TEST_CHECK(has(ids, Tri_FrontSmall));
+
+    // Threshold above every triangle culls all but the clipped one.
+    ids = draw(cr, 0, 1e6f);
+    TEST_CHECK(has(ids, Tri_FrontSmallClipped));
+    TEST_CHECK(ids.size() == 1);
+
+    // Facing and area culling combine.
+    ids = draw(cr, CpuRaster::RenderModeFlag_EnableBackfaceCulling, 4.f);
+    TEST_CHECK(has(ids, Tri_FrontLarge) && has(ids, Tri_FrontSmallClipped));
+    TEST_CHECK(ids.size() == 2);
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testCulling(1);
+    testCulling(4);
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
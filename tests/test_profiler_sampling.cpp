@@ -0,0 +1,82 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "profiler.h"
+#include <cmath>
+
+//------------------------------------------------------------------------
+
+static unsigned long long toFixed(double rate)
+{
+    return (unsigned long long)std::floor(rate * (double)NVDR_PROFILE_RATE_ONE + .5);
+}
+
+// Counts recorded ranges among count consecutive ones starting at first.
+static long long countSampled(unsigned long long first, long long count, unsigned long long rate)
+{
+    long long n = 0;
+    for (long long i=0; i < count; i++)
+        n += isProfileSampled(first + (unsigned long long)i, rate) ? 1 : 0;
+    return n;
+}
+
+//------------------------------------------------------------------------
+// The recorded fraction matches the rate, also for rates that are not of
+// the form 1/N, and any window of calls is within one of its share.
+
+static void testRates(void)
+{
+    const double rates[] = { 1.0, 0.9, 0.67, 0.6, 0.5, 0.3, 0.1, 0.001 };
+    const long long numCalls = 100000;
+    for (int i=0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++)
+    {
+        unsigned long long rate = toFixed(rates[i]);
+        long long n = countSampled(0, numCalls, rate);
+        TEST_CHECK(std::fabs((double)n - rates[i] * numCalls) <= 1.0);
+
+        const int window = 10;
+        for (long long first=0; first < 1000; first++)
+        {
+            long long w = countSampled(first, window, rate);
+            TEST_CHECK(std::fabs((double)w - rates[i] * window) < 1.0 + 1e-6);
+        }
+    }
+
+    // Zero never records.
+    TEST_CHECK(countSampled(0, 1000, 0) == 0);
+}
+
+//------------------------------------------------------------------------
+// The pattern continues across the wrap of the index at 2^32.
+
+static void testWrap(void)
+{
+    unsigned long long rate = toFixed(0.3);
+    unsigned long long first = (1ull << 32) - 50;
+    long long n = countSampled(first, 100, rate);
+    TEST_CHECK(n >= 29 && n <= 31);
+    for (unsigned long long i=first; i < first + 100; i++)
+    {
+        // Same as computing in full precision.
+        long double a = (long double)i * (long double)rate / (long double)NVDR_PROFILE_RATE_ONE;
+        long double b = (long double)(i + 1) * (long double)rate / (long double)NVDR_PROFILE_RATE_ONE;
+        TEST_CHECK(isProfileSampled(i, rate) == (std::floor(b) != std::floor(a)));
+    }
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testRates();
+    testWrap();
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,512 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "cudaraster/impl/RasterPlanner.hpp"
+#include <cstring>
+#include <vector>
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+// Stage backend that reports a preset demand per image instead of running
+// kernels. Like the real counters, the atomics of a launch hold the full
+// demand even when it exceeds the capacities. Launches and reservations
+// are logged for inspection, and the output images record the draws whose
+// fine stage ran on them, the way the color buffer would.
+//------------------------------------------------------------------------
+
+class FakeBackend : public RasterBackend
+{
+public:
+    struct Launch
+    {
+        int             slot;
+        int             firstImage;
+        int             numImages;
+        CRCapacities    caps;
+        int             bufferImage;
+        int             batchSize;      // Of the reservation in effect.
+    };
+
+    void setDemand(int slot, const std::vector<CRAtomics>& demand)
+    {
+        if ((int)m_demand.size() <= slot)
+        {
+            m_demand.resize(slot + 1);
+            m_atomics.resize(slot + 1);
+        }
+        m_demand[slot] = demand;
+        m_atomics[slot].assign(demand.size(), CRAtomics());
+        memset(m_atomics[slot].data(), 0, demand.size() * sizeof(CRAtomics));
+        if (m_images.size() < demand.size())
+            m_images.resize(demand.size());
+    }
+
+    void setClear(int slot, bool clear)
+    {
+        if ((int)m_clear.size() <= slot)
+            m_clear.resize(slot + 1, false);
+        m_clear[slot] = clear;
+    }
+
+    virtual void reserve(const CRCapacities& caps, int batchSize)
+    {
+        m_reservedCaps = caps;
+        m_batchSize = batchSize;
+        m_numReserves++;
+    }
+
+    virtual void launch(int slot, int firstImage, int numImages, const CRCapacities& caps, int bufferImage)
+    {
+        Launch l = { slot, firstImage, numImages, caps, bufferImage, m_batchSize };
+        m_launches.push_back(l);
+        for (int i=firstImage; i < firstImage + numImages; i++)
+        {
+            // The fine stage is skipped on overflow.
+            const CRAtomics& a = m_demand[slot][i];
+            m_atomics[slot][i] = a;
+            if (a.numSubtris > caps.maxSubtris || a.numBinSegs > caps.maxBinSegs || a.numTileSegs > caps.maxTileSegs)
+                continue;
+            if (slot < (int)m_clear.size() && m_clear[slot])
+                m_images[i].clear();
+            m_images[i].push_back(slot);
+        }
+    }
+
+    virtual void wait(int) { m_numWaits++; }
+    virtual const CRAtomics* getAtomics(int slot) { return m_atomics[slot].data(); }
+
+    std::vector<Launch>                 m_launches;
+    CRCapacities                        m_reservedCaps  = { 0, 0, 0 };
+    int                                 m_batchSize     = 0;
+    int                                 m_numReserves   = 0;
+    int                                 m_numWaits      = 0;
+    std::vector<std::vector<int> >      m_images;       // Slots drawn into each output image, oldest first.
+
+private:
+    std::vector<std::vector<CRAtomics> > m_demand;
+    std::vector<std::vector<CRAtomics> > m_atomics;
+    std::vector<bool>                   m_clear;
+};
+
+//------------------------------------------------------------------------
+
+static const int c_numBins  = 4;
+static const int c_numTiles = 64;
+static const int c_triCount = 100;
+
+static CRAtomics makeAtomics(int numSubtris, int numBinSegs, int numTileSegs)
+{
+    CRAtomics a;
+    memset(&a, 0, sizeof(a));
+    a.numSubtris     = numSubtris;
+    a.numBinSegs     = numBinSegs;
+    a.numTileSegs    = numTileSegs;
+    a.numActiveTiles = 1;
+    return a;
+}
+
+static std::vector<CRImageParams> makeImageParams(int numImages)
+{
+    std::vector<CRImageParams> ip(numImages);
+    memset(ip.data(), 0, numImages * sizeof(CRImageParams));
+    for (int i=0; i < numImages; i++)
+        ip[i].triCount = c_triCount;
+    return ip;
+}
+
+static bool fits(const CRAtomics& a, const CRCapacities& c)
+{
+    return a.numSubtris <= c.maxSubtris && a.numBinSegs <= c.maxBinSegs && a.numTileSegs <= c.maxTileSegs;
+}
+
+//------------------------------------------------------------------------
+// Images 1, 2 and 4 of five overflow the subtriangle buffer. The first
+// resolve must render exactly those images again, as two runs, and a
+// repeated draw of the same shape must then be sized by the predictor.
+
+static void testPartialRetry(void)
+{
+    const int numImages = 5;
+    std::vector<CRImageParams> ip = makeImageParams(numImages);
+    std::vector<CRAtomics> demand(numImages, makeAtomics(c_triCount, 8, 16));
+    int big = c_triCount + 20000;
+    demand[1].numSubtris = big;
+    demand[2].numSubtris = big;
+    demand[4].numSubtris = big;
+
+    RasterPlanner planner;
+    FakeBackend backend;
+
+    // Overflow, then partial retry, then completion.
+    backend.setDemand(0, demand);
+    int slot = planner.submit(backend, ip.data(), numImages, Vec2i(256, 256), c_numBins, c_numTiles, false);
+    TEST_CHECK(slot == 0);
+    TEST_CHECK(planner.getNumPending() == 1);
+    TEST_CHECK(backend.m_launches.size() == 1);
+    TEST_CHECK(backend.m_launches[0].firstImage == 0 && backend.m_launches[0].numImages == numImages);
+    TEST_CHECK(!fits(demand[1], backend.m_launches[0].caps));
+
+    RasterPlanner::Status status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Retried);
+    TEST_CHECK(planner.getNumPending() == 0);
+    TEST_CHECK(backend.m_launches.size() == 3);
+    if (backend.m_launches.size() == 3)
+    {
+        const FakeBackend::Launch& a = backend.m_launches[1];
+        const FakeBackend::Launch& b = backend.m_launches[2];
+        TEST_CHECK(a.slot == 0 && a.firstImage == 1 && a.numImages == 2 && a.bufferImage == 1);
+        TEST_CHECK(b.slot == 0 && b.firstImage == 4 && b.numImages == 1 && b.bufferImage == 4);
+        TEST_CHECK(fits(demand[1], a.caps) && fits(demand[4], b.caps));
+        TEST_CHECK(backend.m_reservedCaps.maxSubtris == a.caps.maxSubtris);
+    }
+    TEST_CHECK(backend.m_numReserves == 2);
+
+    const RasterPlanner::Stats& s = planner.getStats();
+    TEST_CHECK(s.numDraws == 1 && s.numRetried == 1 && s.numPredicted == 0 && s.numMispredicted == 0);
+
+    const std::vector<RasterPlanner::ImageStats>& is = planner.getImageStats();
+    TEST_CHECK((int)is.size() == numImages);
+    if ((int)is.size() == numImages)
+    {
+        static const int expectedRetries[numImages] = { 0, 1, 1, 0, 1 };
+        for (int i=0; i < numImages; i++)
+        {
+            TEST_CHECK(is[i].numRetries == expectedRetries[i]);
+            TEST_CHECK(is[i].numSubtris == demand[i].numSubtris);
+            TEST_CHECK(is[i].numActiveTiles == 1);
+        }
+        TEST_CHECK(is[0].caps.maxSubtris < big && is[1].caps.maxSubtris >= big);
+    }
+
+    // Same shape again: predicted capacities fit at once.
+    backend.m_launches.clear();
+    backend.setDemand(0, demand);
+    planner.submit(backend, ip.data(), numImages, Vec2i(256, 256), c_numBins, c_numTiles, false);
+    status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Success);
+    TEST_CHECK(backend.m_launches.size() == 1);
+    TEST_CHECK(s.numDraws == 2 && s.numRetried == 1 && s.numPredicted == 1 && s.numMispredicted == 0);
+}
+
+//------------------------------------------------------------------------
+// Several pending draws resolve in submission order, and a peeling draw
+// is launched into the existing buffers without being checked.
+
+static void testPendingDraws(void)
+{
+    std::vector<CRImageParams> ip = makeImageParams(2);
+    std::vector<CRAtomics> small(2, makeAtomics(c_triCount, 8, 16));
+    std::vector<CRAtomics> large(2, makeAtomics(c_triCount + 20000, 8, 16));
+
+    RasterPlanner planner;
+    FakeBackend backend;
+    backend.setDemand(0, small);
+    backend.setDemand(1, large);
+    TEST_CHECK(planner.submit(backend, ip.data(), 2, Vec2i(64, 64), c_numBins, c_numTiles, false) == 0);
+    TEST_CHECK(planner.submit(backend, ip.data(), 2, Vec2i(64, 64), c_numBins, c_numTiles, false) == 1);
+    TEST_CHECK(backend.m_launches.size() == 2);
+
+    RasterPlanner::Status status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Retried);
+    TEST_CHECK(backend.m_launches.size() == 3);
+    if (backend.m_launches.size() == 3)
+        TEST_CHECK(backend.m_launches[2].slot == 1 && backend.m_launches[2].firstImage == 0 && backend.m_launches[2].numImages == 2);
+    TEST_CHECK(planner.getStats().numDraws == 2);
+    TEST_CHECK(planner.getStats().numRetried == 1);
+
+    // Peeling on top of the resolved draw.
+    backend.setDemand(0, large);
+    TEST_CHECK(planner.submit(backend, ip.data(), 2, Vec2i(64, 64), c_numBins, c_numTiles, true) == 0);
+    TEST_CHECK(backend.m_launches.size() == 4);
+    status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Success);
+    TEST_CHECK(backend.m_launches.size() == 4);
+    TEST_CHECK(planner.getStats().numDraws == 2);
+}
+
+//------------------------------------------------------------------------
+// Two pending draws into the same images, the first one clearing them. If
+// image 0 overflows in the first draw, rendering it again clears what the
+// second draw left there, so the second draw must follow for image 0, but
+// not for image 1.
+
+static void testRetryBeforePendingDraw(void)
+{
+    std::vector<CRImageParams> ip = makeImageParams(2);
+    std::vector<CRAtomics> first(2, makeAtomics(c_triCount, 8, 16));
+    std::vector<CRAtomics> second(2, makeAtomics(c_triCount, 8, 16));
+    first[0].numSubtris = c_triCount + 20000;
+
+    RasterPlanner planner;
+    FakeBackend backend;
+    backend.setDemand(0, first);
+    backend.setDemand(1, second);
+    backend.setClear(0, true);
+    planner.submit(backend, ip.data(), 2, Vec2i(64, 64), c_numBins, c_numTiles, false);
+    planner.submit(backend, ip.data(), 2, Vec2i(64, 64), c_numBins, c_numTiles, false);
+
+    RasterPlanner::Status status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Retried);
+    TEST_CHECK(backend.m_launches.size() == 4);
+    if (backend.m_launches.size() == 4)
+    {
+        const FakeBackend::Launch& a = backend.m_launches[2];
+        const FakeBackend::Launch& b = backend.m_launches[3];
+        TEST_CHECK(a.slot == 0 && a.firstImage == 0 && a.numImages == 1);
+        TEST_CHECK(b.slot == 1 && b.firstImage == 0 && b.numImages == 1);
+    }
+
+    // Both images end up with the first draw covered by the second one.
+    for (int i=0; i < 2; i++)
+    {
+        const std::vector<int>& img = backend.m_images[i];
+        TEST_CHECK(img.size() == 2 && img[0] == 0 && img[1] == 1);
+    }
+
+    const RasterPlanner::Stats& s = planner.getStats();
+    TEST_CHECK(s.numDraws == 2 && s.numRetried == 2);
+    const std::vector<RasterPlanner::ImageStats>& is = planner.getImageStats();
+    TEST_CHECK(is[0].numRetries == 2 && is[1].numRetries == 0);
+}
+
+//------------------------------------------------------------------------
+// A demand above the maximum subtriangle capacity is retried once at the
+// maximum and then reported as an overflow.
+
+static void testOverflowAtMax(void)
+{
+    std::vector<CRImageParams> ip = makeImageParams(1);
+    std::vector<CRAtomics> demand(1, makeAtomics(CR_MAXSUBTRIS_SIZE + 1, 8, 16));
+
+    RasterPlanner planner;
+    FakeBackend backend;
+    backend.setDemand(0, demand);
+    planner.submit(backend, ip.data(), 1, Vec2i(64, 64), c_numBins, c_numTiles, false);
+
+    RasterPlanner::Status status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Overflow);
+    TEST_CHECK(backend.m_launches.size() == 2);
+    if (backend.m_launches.size() == 2)
+        TEST_CHECK(backend.m_launches[1].caps.maxSubtris == CR_MAXSUBTRIS_SIZE);
+    TEST_CHECK(planner.getImageStats()[0].numRetries == 1);
+    TEST_CHECK(planner.getNumPending() == 0);
+}
+
+//------------------------------------------------------------------------
+// With a memory budget for two and a half images, draws are rendered in
+// batches that share the start of the intermediate buffers, including the
+// runs that are rendered again.
+
+static void testBudgetBatches(void)
+{
+    const int numImages = 5;
+    std::vector<CRImageParams> ip = makeImageParams(numImages);
+    std::vector<CRAtomics> demand(numImages, makeAtomics(c_triCount, 8, 16));
+    demand[1].numSubtris = c_triCount + 8000;
+    demand[2].numSubtris = c_triCount + 8000;
+    demand[4].numSubtris = c_triCount + 8000;
+
+    // Capacities of the first launch, from an unlimited planner.
+    size_t imageBytes;
+    {
+        RasterPlanner probe;
+        FakeBackend backend;
+        backend.setDemand(0, demand);
+        probe.submit(backend, ip.data(), numImages, Vec2i(256, 256), c_numBins, c_numTiles, false);
+        imageBytes = RasterPlanner::getImageBytes(probe.getCapacities());
+    }
+
+    RasterPlanner planner;
+    FakeBackend backend;
+    planner.setMemoryBudget(imageBytes * 5 / 2);
+    backend.setDemand(0, demand);
+    planner.submit(backend, ip.data(), numImages, Vec2i(256, 256), c_numBins, c_numTiles, false);
+    TEST_CHECK(planner.getBatchSize() == 2);
+    TEST_CHECK(backend.m_launches.size() == 3);
+
+    RasterPlanner::Status status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Retried);
+    TEST_CHECK(RasterPlanner::getImageBytes(planner.getCapacities()) <= planner.getMemoryBudget());
+
+    // Every image is covered once by the first pass, and the overflowed ones once more.
+    std::vector<int> covered(numImages, 0);
+    for (size_t i=0; i < backend.m_launches.size(); i++)
+    {
+        const FakeBackend::Launch& l = backend.m_launches[i];
+        TEST_CHECK(l.bufferImage == 0);
+        TEST_CHECK(l.numImages >= 1 && l.numImages <= l.batchSize);
+        TEST_CHECK((size_t)l.batchSize * RasterPlanner::getImageBytes(l.caps) <= planner.getMemoryBudget());
+        for (int j=l.firstImage; j < l.firstImage + l.numImages; j++)
+            covered[j]++;
+    }
+    static const int expectedCovered[numImages] = { 1, 2, 2, 1, 2 };
+    for (int i=0; i < numImages; i++)
+        TEST_CHECK(covered[i] == expectedCovered[i]);
+}
+
+//------------------------------------------------------------------------
+// Buffer bytes are linear in the capacities, and clamping to a budget
+// keeps the capacities between the minimum and the requested ones.
+
+static void testImageBytes(void)
+{
+    CRCapacities zero = { 0, 0, 0 };
+    CRCapacities c    = { 1000, 200, 3000 };
+    CRCapacities c2   = { 2000, 400, 6000 };
+    size_t b0 = RasterPlanner::getImageBytes(zero);
+    size_t b1 = RasterPlanner::getImageBytes(c);
+    size_t b2 = RasterPlanner::getImageBytes(c2);
+    TEST_CHECK(b0 > 0 && b1 > b0);
+    TEST_CHECK(b2 - b1 == b1 - b0);
+
+    CRCapacities more = c;
+    more.maxSubtris++;
+    TEST_CHECK(RasterPlanner::getImageBytes(more) > b1);
+    more = c;
+    more.maxBinSegs++;
+    TEST_CHECK(RasterPlanner::getImageBytes(more) > b1);
+    more = c;
+    more.maxTileSegs++;
+    TEST_CHECK(RasterPlanner::getImageBytes(more) > b1);
+}
+
+static void testClampToBudget(void)
+{
+    const CRCapacities caps = { 500000, 20000, 100000 };
+    const CRCapacities lo   = { 1, c_numBins * CR_BIN_STREAMS_SIZE, c_numTiles };
+    size_t bytes   = RasterPlanner::getImageBytes(caps);
+    size_t loBytes = RasterPlanner::getImageBytes(lo);
+
+    // No budget or enough of it leaves the capacities alone.
+    size_t budgets[] = { 0, bytes, bytes * 2 };
+    for (int i=0; i < 3; i++)
+    {
+        CRCapacities c = caps;
+        RasterPlanner::clampToBudget(c, budgets[i], c_numBins, c_numTiles);
+        TEST_CHECK(c.maxSubtris == caps.maxSubtris && c.maxBinSegs == caps.maxBinSegs && c.maxTileSegs == caps.maxTileSegs);
+    }
+
+    // Tighter budgets shrink everything above the minimum, and stay within budget.
+    for (int i=1; i < 16; i++)
+    {
+        size_t budget = loBytes + (bytes - loBytes) * i / 16;
+        CRCapacities c = caps;
+        RasterPlanner::clampToBudget(c, budget, c_numBins, c_numTiles);
+        TEST_CHECK(RasterPlanner::getImageBytes(c) <= budget);
+        TEST_CHECK(c.maxSubtris  >= lo.maxSubtris  && c.maxSubtris  < caps.maxSubtris);
+        TEST_CHECK(c.maxBinSegs  >= lo.maxBinSegs  && c.maxBinSegs  < caps.maxBinSegs);
+        TEST_CHECK(c.maxTileSegs >= lo.maxTileSegs && c.maxTileSegs < caps.maxTileSegs);
+    }
+
+    // At the minimum, the capacities drop to the minimum and fit exactly.
+    CRCapacities c = caps;
+    RasterPlanner::clampToBudget(c, loBytes, c_numBins, c_numTiles);
+    TEST_CHECK(c.maxSubtris == lo.maxSubtris && c.maxBinSegs == lo.maxBinSegs && c.maxTileSegs == lo.maxTileSegs);
+    TEST_CHECK(RasterPlanner::getImageBytes(c) == loBytes);
+
+    // Below the minimum, the capacities drop to the minimum and exceed the budget.
+    c = caps;
+    RasterPlanner::clampToBudget(c, loBytes / 2, c_numBins, c_numTiles);
+    TEST_CHECK(c.maxSubtris == lo.maxSubtris && c.maxBinSegs == lo.maxBinSegs && c.maxTileSegs == lo.maxTileSegs);
+    TEST_CHECK(RasterPlanner::getImageBytes(c) > loBytes / 2);
+}
+
+//------------------------------------------------------------------------
+// A budget below the smallest buffers of one image cannot be met by
+// splitting the workload, and is detected before drawing. The minimum
+// grows with the viewport.
+
+static void testBudgetBelowMinimum(void)
+{
+    const CRCapacities lo = { 1, c_numBins * CR_BIN_STREAMS_SIZE, c_numTiles };
+    size_t minBytes = RasterPlanner::getMinImageBytes(c_numBins, c_numTiles);
+    TEST_CHECK(minBytes == RasterPlanner::getImageBytes(lo));
+    TEST_CHECK(RasterPlanner::getMinImageBytes(c_numBins * 4, c_numTiles * 4) > minBytes);
+
+    RasterPlanner planner;
+    TEST_CHECK(planner.fitsBudget(c_numBins, c_numTiles)); // Unlimited.
+    planner.setMemoryBudget(minBytes);
+    TEST_CHECK(planner.fitsBudget(c_numBins, c_numTiles));
+    TEST_CHECK(!planner.fitsBudget(c_numBins * 4, c_numTiles * 4));
+    planner.setMemoryBudget(minBytes - 1);
+    TEST_CHECK(!planner.fitsBudget(c_numBins, c_numTiles));
+    TEST_CHECK(planner.fitsBudget(c_numBins / 2, c_numTiles / 2));
+
+    // At the minimum itself, a small draw still renders one image at a time without overflow.
+    const int numImages = 2;
+    std::vector<CRImageParams> ip = makeImageParams(numImages);
+    std::vector<CRAtomics> demand(numImages, makeAtomics(1, 8, 16));
+    FakeBackend backend;
+    planner.setMemoryBudget(minBytes);
+    backend.setDemand(0, demand);
+    planner.submit(backend, ip.data(), numImages, Vec2i(256, 256), c_numBins, c_numTiles, false);
+    TEST_CHECK(planner.getBatchSize() == 1);
+    TEST_CHECK(planner.resolve(backend) == RasterPlanner::Status_Success);
+    TEST_CHECK(backend.m_launches.size() == numImages);
+}
+
+static void testBatchSize(void)
+{
+    const CRCapacities caps = { 10000, 1000, 5000 };
+    size_t bytes = RasterPlanner::getImageBytes(caps);
+    TEST_CHECK(RasterPlanner::getBatchSize(caps, 0, 7) == 7);               // Unlimited.
+    TEST_CHECK(RasterPlanner::getBatchSize(caps, bytes * 7 / 2, 7) == 3);   // Rounds down.
+    TEST_CHECK(RasterPlanner::getBatchSize(caps, bytes * 3, 7) == 3);
+    TEST_CHECK(RasterPlanner::getBatchSize(caps, bytes * 100, 7) == 7);     // Capped by the image count.
+    TEST_CHECK(RasterPlanner::getBatchSize(caps, bytes - 1, 7) == 1);       // Single image too large, still one at a time.
+    TEST_CHECK(RasterPlanner::getBatchSize(caps, 1, 1) == 1);
+}
+
+//------------------------------------------------------------------------
+// An image that needs more than the budget allows even at the minimum
+// capacities is reported as an overflow without retrying, and the other
+// images are still rendered one at a time.
+
+static void testSingleImageTooLarge(void)
+{
+    const int numImages = 3;
+    std::vector<CRImageParams> ip = makeImageParams(numImages);
+    std::vector<CRAtomics> demand(numImages, makeAtomics(c_triCount, 8, 16));
+    demand[1].numSubtris = c_triCount + 20000;
+
+    const CRCapacities lo = { 1, c_numBins * CR_BIN_STREAMS_SIZE, c_numTiles };
+    RasterPlanner planner;
+    FakeBackend backend;
+    planner.setMemoryBudget(RasterPlanner::getImageBytes(lo) + 1);
+    backend.setDemand(0, demand);
+    planner.submit(backend, ip.data(), numImages, Vec2i(256, 256), c_numBins, c_numTiles, false);
+    TEST_CHECK(planner.getBatchSize() == 1);
+    TEST_CHECK(RasterPlanner::getImageBytes(planner.getCapacities()) <= planner.getMemoryBudget());
+    TEST_CHECK(backend.m_launches.size() == numImages);
+
+    RasterPlanner::Status status = planner.resolve(backend);
+    TEST_CHECK(status == RasterPlanner::Status_Overflow);
+    TEST_CHECK(backend.m_launches.size() == numImages);
+    TEST_CHECK(planner.getImageStats()[1].numRetries == 0);
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testPartialRetry();
+    testPendingDraws();
+    testRetryBeforePendingDraw();
+    testOverflowAtMax();
+    testBudgetBatches();
+    testImageBytes();
+    testClampToBudget();
+    testBatchSize();
+    testBudgetBelowMinimum();
+    testSingleImageTooLarge();
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,349 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "common.h"
+#include "interpolate.h"
+#include "texture.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Half and bfloat16 storage conversions of the CPU code paths, and the
+// precision of CPU interpolation and texturing on data in those types.
+
+static float bitsToFloat(unsigned int u)   { float f; memcpy(&f, &u, 4); return f; }
+static unsigned int floatToBits(float f)   { unsigned int u; memcpy(&u, &f, 4); return u; }
+
+static bool isHalfNan(unsigned short h)    { return (h & 0x7c00u) == 0x7c00u && (h & 0x3ffu); }
+static float bf16(float x)                 { return storage_round_host(x, NVDR_STORAGE_BF16); }
+
+static unsigned int s_seed = 1;
+static float randomFloat(void) // In [0, 1).
+{
+    s_seed = s_seed * 1664525u + 1013904223u;
+    return (float)(s_seed >> 8) / (float)(1 << 24);
+}
+
+// Nearest with ties to even, given the neighbors of the result on both sides.
+static bool isNearestEven(double x, double r, double lo, double hi, bool odd)
+{
+    double d = std::fabs(x - r);
+    double dlo = std::fabs(x - lo);
+    double dhi = std::fabs(x - hi);
+    return d <= dlo && d <= dhi && !(odd && (d == dlo || d == dhi));
+}
+
+//------------------------------------------------------------------------
+
+static void testHalfValues(void)
+{
+    TEST_CHECK(half_to_float_host(0x3c00) == 1.f);
+    TEST_CHECK(half_to_float_host(0xc000) == -2.f);
+    TEST_CHECK(half_to_float_host(0x7bff) == 65504.f);
+    TEST_CHECK(half_to_float_host(0x0400) == ldexpf(1.f, -14));          // Smallest normal.
+    TEST_CHECK(half_to_float_host(0x03ff) == ldexpf(1023.f, -24));       // Largest subnormal.
+    TEST_CHECK(half_to_float_host(0x0001) == ldexpf(1.f, -24));          // Smallest subnormal.
+    TEST_CHECK(half_to_float_host(0x8001) == -ldexpf(1.f, -24));
+    TEST_CHECK(floatToBits(half_to_float_host(0x8000)) == 0x80000000u);  // Negative zero.
+    TEST_CHECK(half_to_float_host(0x7c00) == INFINITY);
+    TEST_CHECK(half_to_float_host(0xfc00) == -INFINITY);
+    TEST_CHECK(std::isnan(half_to_float_host(0x7e00)));
+    TEST_CHECK(std::isnan(half_to_float_host(0x7c01)));                  // Signaling.
+    TEST_CHECK(std::isnan(half_to_float_host(0xfe00)));
+
+    TEST_CHECK(float_to_half_host(1.f) == 0x3c00);
+    TEST_CHECK(float_to_half_host(-2.f) == 0xc000);
+    TEST_CHECK(float_to_half_host(-0.f) == 0x8000);
+    TEST_CHECK(float_to_half_host(INFINITY) == 0x7c00);
+    TEST_CHECK(float_to_half_host(-INFINITY) == 0xfc00);
+    TEST_CHECK(isHalfNan(float_to_half_host(NAN)));
+    TEST_CHECK(isHalfNan(float_to_half_host(bitsToFloat(0x7f800001u)))); // Signaling, payload only in low bits.
+    TEST_CHECK(float_to_half_host(-NAN) & 0x8000);
+}
+
+// Every half value survives the trip through fp32.
+static void testHalfRoundTrip(void)
+{
+    for (int i=0; i < 0x10000; i++)
+    {
+        unsigned short h = (unsigned short)i;
+        unsigned short r = float_to_half_host(half_to_float_host(h));
+        TEST_CHECK(isHalfNan(h) ? isHalfNan(r) : r == h);
+    }
+}
+
+static void testHalfRounding(void)
+{
+    float half = ldexpf(1.f, -11); // Half an ulp at one.
+    TEST_CHECK(float_to_half_host(1.f + half) == 0x3c00);                            // Tie to even below.
+    TEST_CHECK(float_to_half_host(1.f + 3.f * half) == 0x3c02);                      // Tie to even above.
+    TEST_CHECK(float_to_half_host(nextafterf(1.f + half, 2.f)) == 0x3c01);
+    TEST_CHECK(float_to_half_host(nextafterf(1.f + half, 0.f)) == 0x3c00);
+    TEST_CHECK(float_to_half_host(-(1.f + 3.f * half)) == 0xbc02);
+
+    // Overflow. 65520 is the tie between the largest half and the next power of two.
+    TEST_CHECK(float_to_half_host(nextafterf(65520.f, 0.f)) == 0x7bff);
+    TEST_CHECK(float_to_half_host(65520.f) == 0x7c00);
+    TEST_CHECK(float_to_half_host(-65520.f) == 0xfc00);
+    TEST_CHECK(float_to_half_host(FLT_MAX) == 0x7c00);
+
+    // Subnormal results.
+    float sub = ldexpf(1.f, -25); // Half the smallest subnormal.
+    TEST_CHECK(float_to_half_host(sub) == 0x0000);
+    TEST_CHECK(float_to_half_host(nextafterf(sub, 1.f)) == 0x0001);
+    TEST_CHECK(float_to_half_host(3.f * sub) == 0x0002);
+    TEST_CHECK(float_to_half_host(5.f * sub) == 0x0002);
+    TEST_CHECK(float_to_half_host(-3.f * sub) == 0x8002);
+    TEST_CHECK(float_to_half_host(ldexpf(1.f, -14) - sub) == 0x0400);               // Tie between subnormal and normal.
+    TEST_CHECK(float_to_half_host(nextafterf(ldexpf(1.f, -14) - sub, 0.f)) == 0x03ff);
+
+    // Subnormal fp32 inputs.
+    TEST_CHECK(float_to_half_host(1e-40f) == 0x0000);
+    TEST_CHECK(float_to_half_host(-1e-40f) == 0x8000);
+    TEST_CHECK(float_to_half_host(bitsToFloat(1u)) == 0x0000);
+
+    // Sweep of fp32 values in the finite half range, including fp32 subnormals.
+    for (unsigned int u=0; u < floatToBits(65520.f); u += 0x1fd)
+    {
+        float x = bitsToFloat(u);
+        unsigned short h = float_to_half_host(x);
+        TEST_CHECK(float_to_half_host(-x) == (h | 0x8000));
+        if (h >= 0x7bff)
+        {
+            TEST_CHECK(h == 0x7bff);
+            continue;
+        }
+        double lo = h ? half_to_float_host(h - 1) : -(double)half_to_float_host(1);
+        TEST_CHECK(isNearestEven(x, half_to_float_host(h), lo, half_to_float_host(h + 1), h & 1));
+    }
+}
+
+//------------------------------------------------------------------------
+
+static void testBf16(void)
+{
+    float half = ldexpf(1.f, -8); // Half an ulp at one.
+    TEST_CHECK(bf16(1.f) == 1.f);
+    TEST_CHECK(bf16(1.f + half) == 1.f);                                   // Tie to even below.
+    TEST_CHECK(bf16(1.f + 3.f * half) == 1.f + 4.f * half);                // Tie to even above.
+    TEST_CHECK(bf16(nextafterf(1.f + half, 2.f)) == 1.f + 2.f * half);
+    TEST_CHECK(bf16(nextafterf(1.f + half, 0.f)) == 1.f);
+    TEST_CHECK(bf16(-(1.f + 3.f * half)) == -(1.f + 4.f * half));
+
+    // Overflow, inf and nan.
+    TEST_CHECK(floatToBits(bf16(bitsToFloat(0x7f7f7fffu))) == 0x7f7f0000u);
+    TEST_CHECK(bf16(bitsToFloat(0x7f7f8000u)) == INFINITY);                // Tie to even is inf.
+    TEST_CHECK(bf16(FLT_MAX) == INFINITY);
+    TEST_CHECK(bf16(-FLT_MAX) == -INFINITY);
+    TEST_CHECK(bf16(INFINITY) == INFINITY);
+    TEST_CHECK(bf16(-INFINITY) == -INFINITY);
+    TEST_CHECK(std::isnan(bf16(NAN)));
+    TEST_CHECK(std::isnan(bf16(bitsToFloat(0x7f800001u))));               // Would round to inf without the nan check.
+    TEST_CHECK(std::isnan(bf16(bitsToFloat(0xffffffffu))));
+
+    // Subnormals and zero.
+    TEST_CHECK(floatToBits(bf16(-0.f)) == 0x80000000u);
+    TEST_CHECK(floatToBits(bf16(bitsToFloat(0x00008000u))) == 0u);
+    TEST_CHECK(floatToBits(bf16(bitsToFloat(0x00008001u))) == 0x00010000u);
+    TEST_CHECK(floatToBits(bf16(bitsToFloat(0x00018000u))) == 0x00020000u);
+    TEST_CHECK(floatToBits(bf16(bitsToFloat(0x0000ffffu))) == 0x00010000u);
+    TEST_CHECK(floatToBits(bf16(bitsToFloat(0x007fffffu))) == 0x00800000u); // Subnormal rounds up to normal.
+
+    // Sweep of finite fp32 values.
+    for (unsigned int u=0; u < 0x7f7f8000u; u += 0x10001)
+    {
+        float x = bitsToFloat(u);
+        unsigned int r = floatToBits(bf16(x));
+        TEST_CHECK((r & 0xffffu) == 0);
+        TEST_CHECK(floatToBits(bf16(-x)) == (r | 0x80000000u));
+        double lo = r ? bitsToFloat(r - 0x10000u) : -(double)bitsToFloat(0x10000u);
+        TEST_CHECK(isNearestEven(x, bitsToFloat(r), lo, bitsToFloat(r + 0x10000u), (r >> 16) & 1));
+    }
+
+    // Storage type fp32 leaves values alone.
+    const unsigned int f32[] = { 0x3f800001u, 0x00000001u, 0x7f7fffffu, 0x7f800000u, 0x7fc00001u, 0x80000000u };
+    for (int i=0; i < 6; i++)
+        TEST_CHECK(floatToBits(storage_round_host(bitsToFloat(f32[i]), NVDR_STORAGE_F32)) == f32[i]);
+}
+
+//------------------------------------------------------------------------
+// The CPU code paths compute in fp32 on values upcast from the storage
+// type. A result stored back must thus be within half an ulp of the
+// storage type from the exact result, plus the fp32 rounding error.
+
+static double storageUlp(double x, int type)
+{
+    int e;
+    frexp(x, &e); // |x| = m * 2^e with m in [0.5, 1).
+    if (type == NVDR_STORAGE_F16)
+        return ldexp(1.0, std::max(e - 1, -14) - 10);
+    return ldexp(1.0, e - 1 - 7);
+}
+
+static void checkStored(float result, double exact, double fp32Error, int type)
+{
+    float stored = storage_round_host(result, type);
+    TEST_CHECK(storage_round_host(stored, type) == stored);
+    TEST_CHECK(std::fabs(stored - exact) <= .5 * storageUlp(exact, type) + fp32Error);
+    TEST_CHECK(std::fabs(result - exact) <= fp32Error);
+}
+
+static void testInterpolate(int type, ThreadPool& pool)
+{
+    const int numVertices  = 32;
+    const int numTriangles = 16;
+    const int numAttr      = 11; // Full vectors and a tail.
+    const int size         = 16;
+
+    std::vector<float> attr(numVertices * numAttr);
+    for (size_t i=0; i < attr.size(); i++)
+        attr[i] = storage_round_host(8.f * randomFloat() - 4.f, type);
+    std::vector<int> tri(numTriangles * 3);
+    for (size_t i=0; i < tri.size(); i++)
+        tri[i] = (int)(randomFloat() * numVertices);
+    std::vector<float> rast(size * size * 4);
+    for (int i=0; i < size * size; i++)
+    {
+        float b0 = randomFloat();
+        float b1 = randomFloat() * (1.f - b0);
+        rast[4 * i + 0] = b0;
+        rast[4 * i + 1] = b1;
+        rast[4 * i + 3] = triidx_to_float_host(1 + (int)(randomFloat() * numTriangles));
+    }
+
+    std::vector<float> out(size * size * numAttr);
+    InterpolateKernelParams p = {};
+    p.tri          = tri.data();
+    p.attr         = attr.data();
+    p.rast         = rast.data();
+    p.out          = out.data();
+    p.numTriangles = numTriangles;
+    p.numVertices  = numVertices;
+    p.numAttr      = numAttr;
+    p.width        = size;
+    p.height       = size;
+    p.depth        = 1;
+    InterpolateCpuFwd(p, false, pool);
+
+    for (int i=0; i < size * size; i++)
+    {
+        const int* t = &tri[3 * (float_to_triidx_host(rast[4 * i + 3]) - 1)];
+        double b[3] = { rast[4 * i + 0], rast[4 * i + 1], 1.0 - rast[4 * i + 0] - rast[4 * i + 1] };
+        for (int c=0; c < numAttr; c++)
+        {
+            double exact = 0.0, sum = 0.0;
+            for (int k=0; k < 3; k++)
+            {
+                exact += b[k] * attr[t[k] * numAttr + c];
+                sum += std::fabs(b[k] * attr[t[k] * numAttr + c]);
+            }
+            checkStored(out[i * numAttr + c], exact, ldexp(sum + 4.0, -21), type);
+        }
+    }
+}
+
+static void testTexture(int type, int channels, ThreadPool& pool)
+{
+    const int texSize  = 8;
+    const int imgSize  = 16;
+    const int numMips  = 3;
+
+    // Base level in the storage type and room for the mips.
+    std::vector<float> levels[numMips + 1];
+    for (int level=0; level <= numMips; level++)
+        levels[level].resize((texSize >> level) * (texSize >> level) * channels);
+    for (size_t i=0; i < levels[0].size(); i++)
+        levels[0][i] = storage_round_host(2.f * randomFloat() - 1.f, type);
+
+    std::vector<float> uv(imgSize * imgSize * 2);
+    for (size_t i=0; i < uv.size(); i++)
+        uv[i] = 1.2f * randomFloat() - .1f;
+    std::vector<float> out(imgSize * imgSize * channels);
+
+    TextureKernelParams p = {};
+    for (int level=0; level <= numMips; level++)
+        p.tex[level] = levels[level].data();
+    p.uv           = uv.data();
+    p.out          = out.data();
+    p.filterMode   = TEX_MODE_LINEAR;
+    p.boundaryMode = TEX_BOUNDARY_MODE_CLAMP;
+    p.channels     = channels;
+    p.imgWidth     = imgSize;
+    p.imgHeight    = imgSize;
+    p.texWidth     = texSize;
+    p.texHeight    = texSize;
+    p.texDepth     = 1;
+    p.n            = 1;
+    p.mipLevelMax  = numMips;
+    p.texType      = type;
+    TextureCpuFwd(p, pool);
+
+    // Bilinear lookups.
+    for (int i=0; i < imgSize * imgSize; i++)
+    {
+        double u = std::min(std::max(uv[2 * i + 0] * (double)texSize - .5, 0.0), texSize - 1.0);
+        double v = std::min(std::max(uv[2 * i + 1] * (double)texSize - .5, 0.0), texSize - 1.0);
+        int iu = std::min((int)u, texSize - 2);
+        int iv = std::min((int)v, texSize - 2);
+        double fu = u - iu, fv = v - iv;
+        double w[4] = { (1.0 - fu) * (1.0 - fv), fu * (1.0 - fv), (1.0 - fu) * fv, fu * fv };
+        int tc[4] = { iu + texSize * iv, iu + 1 + texSize * iv, iu + texSize * (iv + 1), iu + 1 + texSize * (iv + 1) };
+        for (int c=0; c < channels; c++)
+        {
+            double exact = 0.0;
+            for (int k=0; k < 4; k++)
+                exact += w[k] * levels[0][tc[k] * channels + c];
+            checkStored(out[i * channels + c], exact, ldexp(1.0, -19), type);
+        }
+    }
+
+    // Mip levels are stored in the storage type, each built from the one above.
+    TextureCpuBuildMip(p, pool);
+    for (int level=1; level <= numMips; level++)
+    {
+        int w = texSize >> level;
+        for (int y=0; y < w; y++)
+        for (int x=0; x < w; x++)
+        for (int c=0; c < channels; c++)
+        {
+            const std::vector<float>& in = levels[level - 1];
+            int i0 = channels * (2 * x + 4 * w * y) + c;
+            int i1 = i0 + channels * 2 * w;
+            double exact = .25 * ((double)in[i0] + in[i0 + channels] + in[i1] + in[i1 + channels]);
+            float r = levels[level][channels * (x + w * y) + c];
+            TEST_CHECK(storage_round_host(r, type) == r);
+            TEST_CHECK(std::fabs(r - exact) <= .5 * storageUlp(exact, type) + ldexp(1.0, -22));
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testHalfValues();
+    testHalfRoundTrip();
+    testHalfRounding();
+    testBf16();
+
+    ThreadPool pool(2);
+    const int types[] = { NVDR_STORAGE_F16, NVDR_STORAGE_BF16 };
+    for (int i=0; i < 2; i++)
+    {
+        testInterpolate(types[i], pool);
+        testTexture(types[i], 3, pool);
+        testTexture(types[i], 4, pool);
+    }
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
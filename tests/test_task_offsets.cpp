@@ -0,0 +1,148 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "cudaraster/impl/PrivateDefs.hpp"
+#include <cstring>
+#include <vector>
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+
+static std::vector<CRImageParams> makeImages(const std::vector<int>& triCounts)
+{
+    std::vector<CRImageParams> ip(triCounts.size());
+    if (!ip.empty())
+        memset(ip.data(), 0, ip.size() * sizeof(CRImageParams));
+    for (size_t i=0; i < ip.size(); i++)
+        ip[i].triCount = triCounts[i];
+    return ip;
+}
+
+// Launch parameters for a run of images, laid out like RasterImpl::launch() does.
+static void setupLaunch(CRParams& p, const std::vector<CRImageParams>& ip, int first, int count)
+{
+    memset(&p, 0, sizeof(p));
+    p.numImages = count;
+    memcpy(p.imageParamsFirst, &ip[first], (count < CR_EMBED_IMAGE_PARAMS ? count : CR_EMBED_IMAGE_PARAMS) * sizeof(CRImageParams));
+    p.imageParamsExtra = (count > CR_EMBED_IMAGE_PARAMS) ? &ip[first + CR_EMBED_IMAGE_PARAMS] : NULL;
+    setTaskRange(p, &ip[first], count);
+}
+
+// Maps every task of the launch to its image the way the setup kernel does, and
+// checks that each triangle of each image in the run is visited exactly once.
+static void checkLaunch(const std::vector<CRImageParams>& ip, int first, int count)
+{
+    CRParams p;
+    setupLaunch(p, ip, first, count);
+
+    S64 expected = 0;
+    std::vector<std::vector<int> > visits(count);
+    for (int i=0; i < count; i++)
+    {
+        int n = ip[first + i].triCount > 0 ? ip[first + i].triCount : 0;
+        visits[i].assign(n, 0);
+        expected += n;
+    }
+    TEST_CHECK(p.totalCount == expected);
+
+    for (int taskIdx=0; taskIdx < p.totalCount; taskIdx++)
+    {
+        int imageIdx = findImageForTask(p, taskIdx);
+        TEST_CHECK(imageIdx >= 0 && imageIdx < count);
+        if (imageIdx < 0 || imageIdx >= count)
+            continue;
+        const CRImageParams& img = getImageParams(p, imageIdx);
+        TEST_CHECK(img.taskOffset == ip[first + imageIdx].taskOffset && img.triCount == ip[first + imageIdx].triCount);
+        int local = taskIdx - (img.taskOffset - p.taskBase);
+        TEST_CHECK(local >= 0 && local < (int)visits[imageIdx].size());
+        if (local >= 0 && local < (int)visits[imageIdx].size())
+            visits[imageIdx][local]++;
+    }
+
+    for (int i=0; i < count; i++)
+        for (size_t j=0; j < visits[i].size(); j++)
+            TEST_CHECK(visits[i][j] == 1);
+}
+
+// Offsets over the whole draw, then every run of images that a batched launch could cover.
+static void checkDraw(const std::vector<int>& triCounts)
+{
+    std::vector<CRImageParams> ip = makeImages(triCounts);
+    S64 total = setTaskOffsets(ip.data(), (int)ip.size(), false);
+
+    S64 sum = 0;
+    for (size_t i=0; i < ip.size(); i++)
+    {
+        TEST_CHECK(ip[i].taskOffset == sum);
+        sum += triCounts[i] > 0 ? triCounts[i] : 0;
+    }
+    TEST_CHECK(total == sum);
+
+    int n = (int)ip.size();
+    for (int first=0; first < n; first++)
+        for (int count=1; first + count <= n; count++)
+            checkLaunch(ip, first, count);
+}
+
+//------------------------------------------------------------------------
+
+static void testSmallDraws(void)
+{
+    checkDraw(std::vector<int>{ 5 });                       // Single image.
+    checkDraw(std::vector<int>{ 0 });                       // Single empty image.
+    checkDraw(std::vector<int>{ 0, 0, 0 });                 // Nothing to do.
+    checkDraw(std::vector<int>{ 0, 3, 4 });                 // Empty first image.
+    checkDraw(std::vector<int>{ 3, 0, 4 });                 // Empty image in between.
+    checkDraw(std::vector<int>{ 3, 4, 0 });                 // Empty last image.
+    checkDraw(std::vector<int>{ 1, 0, 0, 0, 1, 0, 2 });     // Runs of empty images.
+    checkDraw(std::vector<int>{ 2, -5, 3 });                // Negative counts draw nothing.
+    checkDraw(std::vector<int>{ 1, 1, 1, 1, 1, 1 });
+}
+
+// More images than fit in the launch parameters, so that runs cross into the extra params.
+static void testManyImages(void)
+{
+    std::vector<int> triCounts;
+    unsigned int seed = 1;
+    for (int i=0; i < 2 * CR_EMBED_IMAGE_PARAMS + 7; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        triCounts.push_back((seed >> 16) % 4 == 0 ? 0 : (int)((seed >> 8) % 37));
+    }
+    checkDraw(triCounts);
+}
+
+static void testInstanceMode(void)
+{
+    std::vector<CRImageParams> ip = makeImages(std::vector<int>{ 10, 10, 10 });
+    TEST_CHECK(setTaskOffsets(ip.data(), 3, true) == 0);
+    for (int i=0; i < 3; i++)
+        TEST_CHECK(ip[i].taskOffset == 0);
+}
+
+// The total is returned at full width so that the caller can reject draws over 2^31-1 tasks.
+static void testTotalOverflow(void)
+{
+    std::vector<CRImageParams> ip = makeImages(std::vector<int>{ 0x7fffffff, 1 });
+    TEST_CHECK(setTaskOffsets(ip.data(), 2, false) == (S64)0x7fffffff + 1);
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testSmallDraws();
+    testManyImages();
+    testInstanceMode();
+    testTotalOverflow();
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
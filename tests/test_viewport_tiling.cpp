@@ -0,0 +1,148 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "cudaraster/impl/PrivateDefs.hpp"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace CR;
+
+//------------------------------------------------------------------------
+
+static const int c_sizes[] = { 1, 8, 100, 2047, 2048, 2049, 3000, 4095, 4096, 4097, 6144, 6145, 10000 };
+static const int c_numSizes = (int)(sizeof(c_sizes) / sizeof(c_sizes[0]));
+
+//------------------------------------------------------------------------
+// Tiles are as few as possible, equal, aligned, at most the maximum size,
+// and none of them is empty.
+
+static void testTiling(void)
+{
+    for (int i=0; i < c_numSizes; i++)
+    {
+        int size = c_sizes[i];
+        Vec2i numTiles(0, 0), tileSize(0, 0);
+        getViewportTiling(Vec2i(size, 300), numTiles, tileSize);
+
+        TEST_CHECK(numTiles.x == (size <= CR_MAXVIEWPORT_SIZE ? 1 : (size - 1) / CR_MAXVIEWPORT_SIZE + 1));
+        TEST_CHECK(numTiles.y == 1);
+        TEST_CHECK(tileSize.x <= CR_MAXVIEWPORT_SIZE && tileSize.x % CR_TILE_SIZE == 0);
+        TEST_CHECK(numTiles.x * tileSize.x >= size);
+        TEST_CHECK((numTiles.x - 1) * tileSize.x < size);
+        TEST_CHECK(tileSize.y == 304);
+    }
+
+    // Both axes are tiled independently.
+    Vec2i numTiles(0, 0), tileSize(0, 0);
+    getViewportTiling(Vec2i(5000, 2049), numTiles, tileSize);
+    TEST_CHECK(numTiles.x == 3 && numTiles.y == 2);
+    TEST_CHECK(tileSize.x == 1672 && tileSize.y == 1032);
+}
+
+//------------------------------------------------------------------------
+// Draw images enumerate every tile of every output image once, with the
+// tiles of an output image consecutive.
+
+static void testImageTiles(void)
+{
+    const int numOutputs = 3;
+    Vec2i numVpTiles(3, 2);
+    int numTiles = numVpTiles.x * numVpTiles.y;
+
+    std::vector<int> seen(numOutputs * numTiles, 0);
+    for (int j=0; j < numOutputs * numTiles; j++)
+    {
+        CRImageParams ip;
+        memset(&ip, 0, sizeof(ip));
+        setImageTile(ip, j, numVpTiles);
+        TEST_CHECK(ip.imageIdx == j / numTiles);
+        TEST_CHECK(ip.vpTileX >= 0 && ip.vpTileX < numVpTiles.x);
+        TEST_CHECK(ip.vpTileY >= 0 && ip.vpTileY < numVpTiles.y);
+        if (ip.imageIdx >= 0 && ip.imageIdx < numOutputs)
+            seen[(ip.imageIdx * numVpTiles.y + ip.vpTileY) * numVpTiles.x + ip.vpTileX]++;
+    }
+    for (size_t i=0; i < seen.size(); i++)
+        TEST_CHECK(seen[i] == 1);
+
+    // Untiled: one draw image per output image.
+    CRImageParams ip;
+    memset(&ip, 0, sizeof(ip));
+    setImageTile(ip, 5, Vec2i(1, 1));
+    TEST_CHECK(ip.imageIdx == 5 && ip.vpTileX == 0 && ip.vpTileY == 0);
+}
+
+//------------------------------------------------------------------------
+// Pixel position of a clip-space x coordinate in the output image, as the
+// setup stage shifts it into a viewport tile and the fine stage places the
+// tile in the output. Mirrors TriangleSetup.inl and FineRaster.inl.
+
+static double tiledPixel(const CRParams& p, double x, double w, int vpTile, int sizeVp, int widthPixels)
+{
+    double xo = (double)(p.xo - 2.f * (float)vpTile);
+    double ndc = (x * p.xs + w * xo) / w;
+    return (ndc * 0.5 + 0.5) * sizeVp + (double)vpTile * widthPixels;
+}
+
+// Set up the viewport the way RasterImpl::setViewport() does, and check that
+// the offsets of every tile reproduce the pixel positions of the untiled
+// viewport, so that each pixel is drawn by exactly one tile.
+static void checkTransform(int size, int offset)
+{
+    Vec2i numTiles(0, 0), tileSize(0, 0);
+    getViewportTiling(Vec2i(size, size), numTiles, tileSize);
+    int sizeVp = (numTiles.x > 1) ? tileSize.x : size;
+    int widthPixels = (sizeVp + CR_TILE_SIZE - 1) & (-CR_TILE_SIZE);
+
+    CRParams p;
+    memset(&p, 0, sizeof(p));
+    setViewportTransform(p, Vec2i(size, size), Vec2i(sizeVp, sizeVp), Vec2i(offset, offset));
+    TEST_CHECK(p.xs == p.ys && p.xo == p.yo);
+    if (numTiles.x > 1)
+        TEST_CHECK(widthPixels == sizeVp); // Tile spacing in pixels and in clip space agree.
+
+    const double w[] = { 0.5, 1.0, 3.0 };
+    for (int k=0; k < 3; k++)
+    for (int px=0; px < size; px += (size < 64) ? 1 : size / 61 + 1)
+    {
+        // Clip-space coordinate of the pixel center in the untiled viewport.
+        double center = px + 0.5;
+        double x = ((center / size) * 2.0 - 1.0) * w[k];
+
+        int numInside = 0;
+        for (int t=0; t < numTiles.x; t++)
+        {
+            double pos = tiledPixel(p, x, w[k], t, sizeVp, widthPixels);
+            TEST_CHECK(std::fabs(pos - (center - offset)) < 0.01);
+            double local = pos - (double)t * widthPixels;
+            numInside += (local >= 0.0 && local < sizeVp) ? 1 : 0;
+        }
+        if (offset == 0)
+            TEST_CHECK(numInside == 1);
+    }
+}
+
+static void testTransform(void)
+{
+    for (int i=0; i < c_numSizes; i++)
+        checkTransform(c_sizes[i], 0);
+    checkTransform(1000, 64); // Offset viewport, untiled.
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    testTiling();
+    testImageTiles();
+    testTransform();
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
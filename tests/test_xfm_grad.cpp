@@ -0,0 +1,434 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "testutil.h"
+#include "rasterize.h"
+#include "antialias.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Shared vertices drawn into two images with different transforms. The
+// gradients of the CPU rasterizer and antialiasing with respect to the
+// shared positions and the transforms are checked against central
+// differences of the forward passes, and against the gradients of the
+// same images drawn from materialized per-image [B, V, 4] positions.
+// The triangle id buffer is computed here and kept fixed, as it is not
+// differentiated.
+
+static const int c_size         = 32;
+static const int c_numImages    = 2;
+static const int c_numVertices  = 7;
+static const int c_numTriangles = 3;
+static const int c_channels     = 2;
+
+static const float c_vertices[c_numVertices * 4] =
+{
+    -0.7f, -0.6f,  0.2f, 1.f,
+     0.6f, -0.7f,  0.1f, 1.f,
+    -0.5f,  0.7f,  0.3f, 1.f,
+     0.7f,  0.5f,  0.2f, 1.f,   // Shares the edge 1-2 with the first triangle.
+    -0.2f, -0.3f, -0.4f, 1.f,   // In front of the others.
+     0.4f, -0.1f, -0.3f, 1.f,
+     0.0f,  0.4f, -0.5f, 1.f,
+};
+
+static const int c_triangles[c_numTriangles * 3] = { 0, 1, 2,  1, 3, 2,  4, 5, 6 };
+
+// Row-major, mostly a rotation and scale per image, with some perspective.
+static const float c_transforms[c_numImages * 16] =
+{
+     0.90f, -0.20f,  0.00f,  0.05f,
+     0.25f,  0.85f,  0.10f, -0.03f,
+     0.00f,  0.00f,  1.00f,  0.00f,
+     0.05f, -0.04f,  0.10f,  1.00f,
+
+     0.80f,  0.30f,  0.05f, -0.06f,
+    -0.30f,  0.90f,  0.00f,  0.04f,
+     0.10f,  0.00f,  0.90f,  0.10f,
+    -0.06f,  0.03f, -0.08f,  1.10f,
+};
+
+//------------------------------------------------------------------------
+
+struct Scene
+{
+    std::vector<float>  pos;        // Shared positions, [V, 4].
+    std::vector<float>  mtx;        // Transforms, [B, 16].
+    std::vector<int>    ids;        // Triangle id + 1 per pixel, [B, H, W].
+    std::vector<float>  rast;       // Rasterizer output with the ids, [B, H, W, 4].
+    std::vector<float>  dy;         // Incoming gradients of the bary output, [B, H, W, 4].
+    std::vector<float>  ddb;        // Incoming gradients of the bary differentials, [B, H, W, 4].
+    std::vector<float>  color;      // Antialiasing input, [B, H, W, C].
+    std::vector<float>  dyColor;    // Incoming gradients of the antialiased color, [B, H, W, C].
+};
+
+static unsigned int s_seed = 1;
+static float randomFloat(void) // In [-1, 1).
+{
+    s_seed = s_seed * 1664525u + 1013904223u;
+    return (float)(s_seed >> 8) / (float)(1 << 23) - 1.f;
+}
+
+// Materialized per-image positions, [B, V, 4].
+static std::vector<float> transformAll(const std::vector<float>& pos, const std::vector<float>& mtx)
+{
+    std::vector<float> out(c_numImages * c_numVertices * 4);
+    for (int b=0; b < c_numImages; b++)
+        for (int v=0; v < c_numVertices; v++)
+            xfm_pos_host(&mtx[16 * b], &pos[4 * v], &out[4 * (b * c_numVertices + v)]);
+    return out;
+}
+
+// Nearest triangle that covers the pixel center with some margin, so that
+// small perturbations of the positions don't move it outside.
+static void rasterizeIds(Scene& s)
+{
+    std::vector<float> clip = transformAll(s.pos, s.mtx);
+    s.ids.assign(c_numImages * c_size * c_size, 0);
+    s.rast.assign(c_numImages * c_size * c_size * 4, 0.f);
+    for (int b=0; b < c_numImages; b++)
+    for (int py=0; py < c_size; py++)
+    for (int px=0; px < c_size; px++)
+    {
+        double fx = (2.0 * px + 1.0) / c_size - 1.0;
+        double fy = (2.0 * py + 1.0) / c_size - 1.0;
+        double bestZ = 2.0;
+        int pidx = px + c_size * (py + c_size * b);
+        for (int t=0; t < c_numTriangles; t++)
+        {
+            const float* c[3];
+            double x[3], y[3];
+            for (int k=0; k < 3; k++)
+            {
+                c[k] = &clip[4 * (b * c_numVertices + c_triangles[3 * t + k])];
+                x[k] = c[k][0] - fx * c[k][3];
+                y[k] = c[k][1] - fy * c[k][3];
+            }
+            double a[3] = { x[1] * y[2] - y[1] * x[2], x[2] * y[0] - y[2] * x[0], x[0] * y[1] - y[0] * x[1] };
+            double sum = a[0] + a[1] + a[2];
+            if (sum == 0.0 || std::min(a[0], std::min(a[1], a[2])) / sum < 0.02)
+                continue;
+            double z = (c[0][2] * a[0] + c[1][2] * a[1] + c[2][2] * a[2]) / (c[0][3] * a[0] + c[1][3] * a[1] + c[2][3] * a[2]);
+            if (z >= bestZ)
+                continue;
+            bestZ = z;
+            s.ids[pidx] = t + 1;
+            s.rast[4 * pidx + 0] = (float)(a[0] / sum);
+            s.rast[4 * pidx + 1] = (float)(a[1] / sum);
+            s.rast[4 * pidx + 2] = (float)z;
+            s.rast[4 * pidx + 3] = triidx_to_float_host(t + 1);
+        }
+    }
+}
+
+static void makeScene(Scene& s)
+{
+    s.pos.assign(c_vertices, c_vertices + c_numVertices * 4);
+    s.mtx.assign(c_transforms, c_transforms + c_numImages * 16);
+    rasterizeIds(s);
+
+    int numPixels = c_numImages * c_size * c_size;
+    s.dy.resize(numPixels * 4);
+    s.ddb.resize(numPixels * 4);
+    s.color.resize(numPixels * c_channels);
+    s.dyColor.resize(numPixels * c_channels);
+    for (size_t i=0; i < s.dy.size(); i++)      s.dy[i] = randomFloat();
+    for (size_t i=0; i < s.ddb.size(); i++)     s.ddb[i] = randomFloat() * 0.05f; // Differentials are larger than barycentrics.
+    for (size_t i=0; i < s.dyColor.size(); i++) s.dyColor[i] = randomFloat();
+
+    // Flat color per triangle so that edges between triangles and background carry gradients.
+    for (int i=0; i < numPixels; i++)
+        for (int c=0; c < c_channels; c++)
+            s.color[i * c_channels + c] = 0.2f + 0.3f * (float)((s.ids[i] * (c + 1)) % 4);
+}
+
+//------------------------------------------------------------------------
+// Rasterizer. The loss is the dot product of the bary and bary differential
+// outputs with the incoming gradients.
+
+static double rasterizeLoss(const Scene& s, const float* pos, const float* mtx, ThreadPool& pool)
+{
+    int numPixels = c_numImages * c_size * c_size;
+    std::vector<float> out(numPixels * 4), outDb(numPixels * 4);
+
+    RasterizeCudaFwdShaderParams p = {};
+    p.pos           = pos;
+    p.mtx           = mtx;
+    p.tri           = c_triangles;
+    p.in_idx        = s.ids.data();
+    p.out           = out.data();
+    p.out_db        = outDb.data();
+    p.numTriangles  = c_numTriangles;
+    p.numVertices   = c_numVertices;
+    p.width_in      = p.width_out  = c_size;
+    p.height_in     = p.height_out = c_size;
+    p.depth         = c_numImages;
+    p.instance_mode = 1;
+    p.xs = 2.f / (float)c_size;
+    p.xo = 1.f / (float)c_size - 1.f;
+    p.ys = 2.f / (float)c_size;
+    p.yo = 1.f / (float)c_size - 1.f;
+    RasterizeCpuFwdShader(p, pool);
+
+    double loss = 0.0;
+    for (int i=0; i < numPixels; i++)
+    {
+        loss += (double)s.dy[4 * i + 0] * out[4 * i + 0] + (double)s.dy[4 * i + 1] * out[4 * i + 1];
+        for (int k=0; k < 4; k++)
+            loss += (double)s.ddb[4 * i + k] * outDb[4 * i + k];
+    }
+    return loss;
+}
+
+static void rasterizeGrad(const Scene& s, const float* pos, const float* mtx, float* grad, float* gradMtx, ThreadPool& pool)
+{
+    RasterizeGradParams p = {};
+    p.pos           = pos;
+    p.mtx           = mtx;
+    p.tri           = c_triangles;
+    p.out           = s.rast.data();
+    p.dy            = s.dy.data();
+    p.ddb           = s.ddb.data();
+    p.grad          = grad;
+    p.gradMtx       = gradMtx;
+    p.numTriangles  = c_numTriangles;
+    p.numVertices   = c_numVertices;
+    p.width         = c_size;
+    p.height        = c_size;
+    p.depth         = c_numImages;
+    p.instance_mode = 1;
+    p.xs = 2.f / (float)c_size;
+    p.xo = 1.f / (float)c_size - 1.f;
+    p.ys = 2.f / (float)c_size;
+    p.yo = 1.f / (float)c_size - 1.f;
+    RasterizeCpuGrad(p, pool);
+}
+
+//------------------------------------------------------------------------
+// Antialiasing. The loss is the dot product of the output with the
+// incoming gradients. The work buffer of the latest forward pass is kept
+// for the gradient pass.
+
+struct AntialiasState
+{
+    std::vector<int>    evHash;
+    std::vector<int>    work;
+    int                 allocTriangles;
+};
+
+static AntialiasKernelParams antialiasParams(const Scene& s, AntialiasState& st, const float* pos, const float* mtx)
+{
+    AntialiasKernelParams p = {};
+    p.color          = s.color.data();
+    p.rasterOut      = s.rast.data();
+    p.tri            = c_triangles;
+    p.pos            = pos;
+    p.mtx            = mtx;
+    p.workBuffer     = (int4*)st.work.data();
+    p.evHash         = (uint4*)st.evHash.data();
+    p.allocTriangles = st.allocTriangles;
+    p.numTriangles   = c_numTriangles;
+    p.numVertices    = c_numVertices;
+    p.width          = c_size;
+    p.height         = c_size;
+    p.n              = c_numImages;
+    p.channels       = c_channels;
+    p.xh             = .5f * (float)c_size;
+    p.yh             = .5f * (float)c_size;
+    p.instance_mode  = 1;
+    return p;
+}
+
+static void antialiasInit(AntialiasState& st, ThreadPool& pool)
+{
+    st.allocTriangles = 64;
+    st.evHash.assign(st.allocTriangles * AA_HASH_ELEMENTS_PER_TRIANGLE(st.allocTriangles) * 4, 0);
+    st.work.assign(c_numImages * c_size * c_size * 8 + 4, 0);
+
+    AntialiasKernelParams p = {};
+    p.tri            = c_triangles;
+    p.evHash         = (uint4*)st.evHash.data();
+    p.allocTriangles = st.allocTriangles;
+    p.numTriangles   = c_numTriangles;
+    p.numVertices    = 0x7fffffff;
+    AntialiasCpuConstructTopologyHash(p, pool);
+}
+
+static double antialiasLoss(const Scene& s, AntialiasState& st, const float* pos, const float* mtx, ThreadPool& pool)
+{
+    std::vector<float> out = s.color;
+    AntialiasKernelParams p = antialiasParams(s, st, pos, mtx);
+    p.output = out.data();
+    AntialiasCpuFwd(p, pool);
+
+    double loss = 0.0;
+    for (size_t i=0; i < out.size(); i++)
+        loss += (double)s.dyColor[i] * out[i];
+    return loss;
+}
+
+static void antialiasGrad(const Scene& s, AntialiasState& st, const float* pos, const float* mtx, float* grad, float* gradMtx, ThreadPool& pool)
+{
+    antialiasLoss(s, st, pos, mtx, pool); // Work items for these positions.
+    std::vector<float> gradColor = s.dyColor;
+    AntialiasKernelParams p = antialiasParams(s, st, pos, mtx);
+    p.dy        = s.dyColor.data();
+    p.gradColor = gradColor.data();
+    p.gradPos   = grad;
+    p.gradMtx   = gradMtx;
+    AntialiasCpuGrad(p, pool);
+}
+
+//------------------------------------------------------------------------
+// Checks of a pair of shared-vertex gradients.
+
+// Central difference of the loss in one parameter at two step sizes. The
+// loss is smooth around the parameter if the two agree.
+template <class LossFunc>
+static bool centralDifference(std::vector<float>& pos, std::vector<float>& mtx, float* x, LossFunc loss, float eps, double& fd)
+{
+    double d[2];
+    float x0 = *x;
+    for (int k=0; k < 2; k++)
+    {
+        float h = k ? .5f * eps : eps;
+        *x = x0 + h;
+        double lp = loss(pos.data(), mtx.data());
+        *x = x0 - h;
+        double lm = loss(pos.data(), mtx.data());
+        d[k] = (lp - lm) / (2.0 * h);
+    }
+    *x = x0;
+    fd = d[1];
+    return std::fabs(d[0] - d[1]) <= 1e-3 * (1.0 + std::fabs(d[1]));
+}
+
+// Antialiasing drops the blend of an edge where it leaves its pixel, so its
+// loss has jumps. Parameters at a jump are skipped if allowed, but most must
+// be checked; a small step makes jumps within it rare.
+template <class LossFunc>
+static void checkFiniteDifferences(const Scene& s, const std::vector<float>& grad, const std::vector<float>& gradMtx, LossFunc loss, float eps, bool allowJumps)
+{
+    std::vector<float> pos = s.pos;
+    std::vector<float> mtx = s.mtx;
+
+    double scale = 0.0;
+    for (size_t i=0; i < grad.size(); i++)      scale = std::max(scale, (double)std::fabs(grad[i]));
+    for (size_t i=0; i < gradMtx.size(); i++)   scale = std::max(scale, (double)std::fabs(gradMtx[i]));
+    TEST_CHECK(scale > 0.0);
+
+    int numParams = (int)(pos.size() + mtx.size());
+    int numChecked = 0;
+    for (int i=0; i < numParams; i++)
+    {
+        bool isPos = i < (int)pos.size();
+        float* x = isPos ? &pos[i] : &mtx[i - pos.size()];
+        float g = isPos ? grad[i] : gradMtx[i - pos.size()];
+        double fd;
+        bool smooth = centralDifference(pos, mtx, x, loss, eps, fd);
+        TEST_CHECK(smooth || allowJumps);
+        if (!smooth)
+            continue;
+        TEST_CHECK(std::fabs(fd - g) <= 1e-2 * scale + 1e-2 * std::fabs(fd));
+        numChecked++;
+    }
+    TEST_CHECK(2 * numChecked > numParams);
+}
+
+// Chain rule applied to the gradients of materialized positions, [B, V, 4].
+static void checkMaterialized(const Scene& s, const std::vector<float>& grad, const std::vector<float>& gradMtx, const std::vector<float>& gradB)
+{
+    std::vector<double> g(c_numVertices * 4, 0.0), gm(c_numImages * 16, 0.0);
+    for (int b=0; b < c_numImages; b++)
+    for (int v=0; v < c_numVertices; v++)
+    {
+        const float* gc = &gradB[4 * (b * c_numVertices + v)];
+        TEST_CHECK(gc[2] == 0.f); // No depth gradients.
+        for (int r=0; r < 4; r++)
+        for (int c=0; c < 4; c++)
+        {
+            g[4 * v + c] += (double)s.mtx[16 * b + 4 * r + c] * gc[r];
+            gm[16 * b + 4 * r + c] += (double)gc[r] * s.pos[4 * v + c];
+        }
+    }
+
+    double scale = 0.0;
+    for (size_t i=0; i < g.size(); i++)     scale = std::max(scale, std::fabs(g[i]));
+    for (size_t i=0; i < gm.size(); i++)    scale = std::max(scale, std::fabs(gm[i]));
+    for (size_t i=0; i < g.size(); i++)
+        TEST_CHECK(std::fabs(g[i] - grad[i]) <= 1e-4 * scale);
+    for (size_t i=0; i < gm.size(); i++)
+        TEST_CHECK(std::fabs(gm[i] - gradMtx[i]) <= 1e-4 * scale);
+}
+
+//------------------------------------------------------------------------
+
+static void testRasterize(const Scene& s, ThreadPool& pool)
+{
+    std::vector<float> grad(c_numVertices * 4, 0.f), gradMtx(c_numImages * 16, 0.f);
+    rasterizeGrad(s, s.pos.data(), s.mtx.data(), grad.data(), gradMtx.data(), pool);
+    for (int b=0; b < c_numImages; b++)
+        for (int c=0; c < 4; c++)
+            TEST_CHECK(gradMtx[16 * b + 8 + c] == 0.f); // Depth row.
+
+    checkFiniteDifferences(s, grad, gradMtx, [&](const float* pos, const float* mtx) { return rasterizeLoss(s, pos, mtx, pool); }, 1e-3f, false);
+
+    std::vector<float> posB = transformAll(s.pos, s.mtx);
+    std::vector<float> gradB(posB.size(), 0.f);
+    rasterizeGrad(s, posB.data(), NULL, gradB.data(), NULL, pool);
+    checkMaterialized(s, grad, gradMtx, gradB);
+}
+
+static void testAntialias(const Scene& s, ThreadPool& pool)
+{
+    AntialiasState st;
+    antialiasInit(st, pool);
+
+    std::vector<float> grad(c_numVertices * 4, 0.f), gradMtx(c_numImages * 16, 0.f);
+    antialiasGrad(s, st, s.pos.data(), s.mtx.data(), grad.data(), gradMtx.data(), pool);
+    TEST_CHECK(((const int*)st.work.data())[0] > 0); // Some edges found.
+
+    checkFiniteDifferences(s, grad, gradMtx, [&](const float* pos, const float* mtx) { return antialiasLoss(s, st, pos, mtx, pool); }, 2e-4f, true);
+
+    std::vector<float> posB = transformAll(s.pos, s.mtx);
+    std::vector<float> gradB(posB.size(), 0.f);
+    antialiasGrad(s, st, posB.data(), NULL, gradB.data(), NULL, pool);
+    checkMaterialized(s, grad, gradMtx, gradB);
+}
+
+//------------------------------------------------------------------------
+
+int main(void)
+{
+    Scene s;
+    makeScene(s);
+
+    // Both triangles in front of the background are visible in both images.
+    for (int b=0; b < c_numImages; b++)
+    {
+        int counts[c_numTriangles + 1] = {};
+        for (int i=0; i < c_size * c_size; i++)
+            counts[s.ids[b * c_size * c_size + i]]++;
+        for (int t=0; t <= c_numTriangles; t++)
+            TEST_CHECK(counts[t] > 0);
+    }
+
+    const int threadCounts[] = { 1, 4 };
+    for (int i=0; i < 2; i++)
+    {
+        ThreadPool pool(threadCounts[i]);
+        testRasterize(s, pool);
+        testAntialias(s, pool);
+    }
+    return TEST_RESULT();
+}
+
+//------------------------------------------------------------------------
@@ -0,0 +1,21 @@
+// Copyright (c) 2020, NVIDIA CORPORATION.  All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.  Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include <cstdio>
+
+//------------------------------------------------------------------------
+// Minimal checking for the host-side tests. A failed check is reported and
+// counted, and main() returns TEST_RESULT() to let ctest see the failure.
+
+static int s_testFailures = 0;
+
+#define TEST_CHECK(X) do { if (!(X)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #X); s_testFailures++; } } while(0)
+#define TEST_RESULT() (s_testFailures ? (fprintf(stderr, "%d check(s) failed\n", s_testFailures), 1) : 0)
+
+//------------------------------------------------------------------------